@@ -5,6 +5,12 @@ Implements structured binary format with:
 - Session management (headers with metadata)
 - Data blocks with checksums (CRC32)
 - Event-based flushing (time, size, high-g events)
+- High-rate event blocks around g-force triggers (see event_capture.py)
+- Deferred flushing in bounded slices, off the sampling path
+- Sector-aligned write-behind with a configurable sync policy
+- Block index footer for direct seeking in finished sessions
+- Optional compressed data blocks (fixed-point, zig-zag varint deltas)
+- Optional native module (oplnative) for CRC32 and sample packing
 - Configurable format (CSV or Binary)
 """
 
@@ -12,20 +18,33 @@ import struct
 import time
 import os
 
+# C module built into the firmware (circuitpython/native) - optional
+try:
+    import oplnative
+except ImportError:
+    oplnative = None
+
 # CircuitPython doesn't have hashlib.sha256, so always use CRC32
 HAS_HASHLIB = False
 
+# Bound once - called for every sample
+_pack_into = struct.pack_into
+_unpack_from = struct.unpack_from
+
 # =============================================================================
 # Constants
 # =============================================================================
 
+# The readers are tools/opl_types.py and, for C++ (ESP and native tools),
+# circuitpython/esp-client/opl_codec.h - a layout change here goes there too
+
 # Magic bytes "OPNY"
 MAGIC = b'OPNY'
 MAGIC_INT = 0x4F504E59
 
 # Format version
 FORMAT_VERSION_MAJOR = 2
-FORMAT_VERSION_MINOR = 0
+FORMAT_VERSION_MINOR = 1  # 2.1: optional compressed data blocks
 
 # Hardware version
 HARDWARE_VERSION_MAJOR = 1
@@ -36,6 +55,8 @@ BLOCK_TYPE_SESSION_HEADER = 0x01
 BLOCK_TYPE_DATA = 0x02
 BLOCK_TYPE_SESSION_END = 0x03
 BLOCK_TYPE_HARDWARE_CONFIG = 0x04  # Hardware configuration block
+BLOCK_TYPE_INDEX = 0x05            # Data block index (after session end)
+BLOCK_TYPE_INDEX_TRAILER = 0x06    # Fixed-size pointer to the index, last in file
 
 # Flush flags (bitmask)
 FLUSH_FLAG_TIME = 0x01      # Time-based flush (5 minutes)
@@ -44,12 +65,19 @@ FLUSH_FLAG_EVENT = 0x04     # High G-force event
 FLUSH_FLAG_MANUAL = 0x08    # Manual flush request
 FLUSH_FLAG_SHUTDOWN = 0x10  # System shutdown
 
+# Block flags (share the flush flags byte)
+BLOCK_FLAG_COMPRESSED = 0x80  # Samples use the compressed encoding
+
 # Sample types
 SAMPLE_TYPE_ACCELEROMETER = 0x01
 SAMPLE_TYPE_GPS_FIX = 0x02
 SAMPLE_TYPE_GPS_SATELLITES = 0x03
 SAMPLE_TYPE_GYROSCOPE = 0x04
 SAMPLE_TYPE_MAGNETOMETER = 0x05
+SAMPLE_TYPE_IMU = 0x06        # Accel + gyro (+ mag), one timestamp
+SAMPLE_TYPE_IMU_BURST = 0x07  # N raw FIFO records at a fixed interval
+SAMPLE_TYPE_PROFILE = 0x08    # Main loop stage timings, once a second
+SAMPLE_TYPE_LAP = 0x09        # Start/finish or sector gate crossing
 SAMPLE_TYPE_OBD_PID = 0x10
 SAMPLE_TYPE_EVENT_MARKER = 0x20
 
@@ -69,6 +97,71 @@ MAX_VEHICLE_ID = 24
 MAX_DATA_PAYLOAD = MAX_BLOCK_SIZE - 80  # Reserve space for headers
 
 MAX_HARDWARE_ITEMS = 32  # Max number of hardware items in config
+MAX_SAMPLE_SIZE = 255    # Sample length is one byte
+
+# IMU burst: record count, channel mask, interval (us), accel g/LSB,
+# gyro dps/LSB - then count records of int16 X/Y/Z per channel
+IMU_BURST_HEADER_FORMAT = '<BBHff'
+IMU_BURST_HEADER_SIZE = 12
+IMU_CHANNEL_ACCEL = 0x01
+IMU_CHANNEL_GYRO = 0x02
+IMU_BURST_STRIDE = 12    # Accel + gyro record
+IMU_BURST_MAX_RECORDS = (MAX_SAMPLE_SIZE - IMU_BURST_HEADER_SIZE) // IMU_BURST_STRIDE
+
+# Event marker: kind, first record in this block, pre-trigger records
+# (ending with the trigger record), post-trigger records, record
+# interval (us), peak g - first sample of each event block, the window
+# follows as IMU bursts (see event_capture.py)
+EVENT_MARKER_FORMAT = '<BHHHHf'
+EVENT_MARKER_SIZE = 13
+EVENT_G_FORCE = 1
+
+# Lap event: kind (1 start, 2 sector, 3 lap), gate, lap number, split us,
+# lap time us, delta to the best lap us (LAP_NO_DELTA if none) - stamped
+# with the interpolated crossing time (see lap_timer.py)
+LAP_FORMAT = '<BBHIIi'
+LAP_SIZE = 16
+LAP_NO_DELTA = -0x80000000
+
+# Loop profile: loop count, stage count - then per stage: id, count,
+# min/avg/p99 us (uint16, saturating), max us - then scheduler sample
+# deadline misses and low priority deferrals (absent in older records)
+PROFILE_HEADER_FORMAT = '<HB'
+PROFILE_HEADER_SIZE = 3
+PROFILE_STAGE_FORMAT = '<BHHHHI'
+PROFILE_STAGE_SIZE = 13
+PROFILE_DEADLINE_FORMAT = '<HH'
+PROFILE_DEADLINE_SIZE = 4
+
+# Data block header: magic, type, session ID, sequence, start/end timestamps,
+# flush flags, sample count, data size (CRC32 follows the samples)
+DATA_BLOCK_HEADER_SIZE = 46
+
+# Index entry: file offset, block sequence, start/end timestamps,
+# sample count, flush flags
+INDEX_ENTRY_FORMAT = '<IIQQHB'
+INDEX_ENTRY_SIZE = struct.calcsize(INDEX_ENTRY_FORMAT)
+INDEX_HEADER_SIZE = 25  # Magic, type, session ID, entry count
+
+# Trailer: magic, type, reserved, index offset, CRC32 of the first 12 bytes
+INDEX_TRAILER_FORMAT = '<4sB3xI'
+INDEX_TRAILER_SIZE = 16
+
+# Compressed blocks: fixed-point units per block, written as the first
+# 12 bytes of sample data (accel g, gyro dps, mag uT per count)
+COMPRESS_SCALE_FORMAT = '<fff'
+COMPRESS_SCALE_SIZE = 12
+COMPRESS_ACCEL_SCALE = 1 / 2048   # +-16g in int16
+COMPRESS_GYRO_SCALE = 1 / 16      # +-2048 dps
+COMPRESS_MAG_SCALE = 1 / 8        # +-4096 uT
+COMPRESS_GPS_SCALE = 10000000     # lat/lon counts per degree (1e-7 deg)
+_INV_ACCEL_SCALE = 1 / COMPRESS_ACCEL_SCALE
+_INV_GYRO_SCALE = 1 / COMPRESS_GYRO_SCALE
+_INV_MAG_SCALE = 1 / COMPRESS_MAG_SCALE
+# GPS fix fields saturate here so each varint stays within 5 bytes
+_GPS_MAX_LAT = 90 * COMPRESS_GPS_SCALE
+_GPS_MAX_LON = 180 * COMPRESS_GPS_SCALE
+_GPS_MAX_FIELD = 0x7FFFFFFF
 
 # Hardware types
 HW_TYPE_ACCELEROMETER = 0x01
@@ -94,6 +187,18 @@ CONN_TYPE_BUILTIN = 0x06
 FLUSH_TIME_THRESHOLD = 300  # 5 minutes in seconds
 FLUSH_GFORCE_THRESHOLD = 3.0  # 3g event threshold
 
+# Bytes CRC'd and written per service() call while a block is flushing
+FLUSH_SLICE_SIZE = 512
+
+# SD write-behind (see SectorWriter)
+SECTOR_SIZE = 512
+SYNC_BLOCK = 'block'        # Sync after every data block
+SYNC_INTERVAL = 'interval'  # Sync at most every sync_interval seconds
+SYNC_EVENT = 'event'        # Sync only for event blocks and at stop
+SYNC_POLICIES = (SYNC_BLOCK, SYNC_INTERVAL, SYNC_EVENT)
+SYNC_FORCE_FLAGS = FLUSH_FLAG_EVENT | FLUSH_FLAG_MANUAL | FLUSH_FLAG_SHUTDOWN
+SLOW_WRITE_US = 10000       # Sector writes at or over this count as slow
+
 
 # =============================================================================
 # CRC32 Implementation (for CircuitPython compatibility)
@@ -114,7 +219,7 @@ def _crc32_table():
 
 _CRC32_TABLE = None
 
-def crc32(data, initial=0):
+def _crc32_py(data, initial=0):
     """Calculate CRC32 checksum"""
     global _CRC32_TABLE
     if _CRC32_TABLE is None:
@@ -125,6 +230,15 @@ def crc32(data, initial=0):
         crc = _CRC32_TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8)
     return crc ^ 0xFFFFFFFF
 
+# Same results fastest first: oplnative (DMA sniffer), binascii, Python
+if oplnative:
+    crc32 = oplnative.crc32
+else:
+    try:
+        from binascii import crc32
+    except ImportError:
+        crc32 = _crc32_py
+
 def generate_uuid():
     """Generate a simple UUID-like identifier"""
     ts = int(time.monotonic() * 1000000)
@@ -365,42 +479,119 @@ class SessionHeader:
 # =============================================================================
 
 class DataBlock:
-    """Data block with samples"""
+    """
+    Data block with samples
+    
+    Samples are packed with struct.pack_into straight into one preallocated
+    bytearray laid out exactly as the block is written - header first, then
+    samples at a write cursor - so adding a sample allocates no buffers and
+    serialize() is a memoryview, not a copy.
+    """
     
     def __init__(self, session_id, block_seq):
         self.session_id = session_id
+        self.buffer = bytearray(MAX_BLOCK_SIZE)
+        self.buffer[0:4] = MAGIC
+        self.buffer[4] = BLOCK_TYPE_DATA
+        self.buffer[5:21] = session_id
+        self.reset(block_seq)
+    
+    def reset(self, block_seq):
+        """Empty the block for reuse as block_seq"""
         self.block_sequence = block_seq
         self.timestamp_start = None
         self.timestamp_end = None
         self.flush_flags = 0
-        self.samples = []
+        self.sample_count = 0
         self.data_size = 0
     
-    def add_sample(self, sample_type, timestamp_us, data):
-        """Add a sample to the block"""
+    def _reserve(self, sample_type, timestamp_us, length):
+        """
+        Write a sample header at the cursor and reserve length data bytes
+        
+        Returns:
+            int: Buffer offset for the sample data, or -1 if the block is full
+        """
+        if self.data_size + 4 + length > MAX_DATA_PAYLOAD:
+            return -1  # Block full
+        
         if self.timestamp_start is None:
             self.timestamp_start = timestamp_us
-        self.timestamp_end = timestamp_us
+            self.timestamp_end = timestamp_us
+        elif timestamp_us > self.timestamp_end:
+            self.timestamp_end = timestamp_us
         
-        # Calculate timestamp offset in ms
-        offset_ms = int((timestamp_us - self.timestamp_start) / 1000)
+        # Timestamp offset in ms (bursts are stamped with their oldest
+        # record, which can predate the first sample in the block)
+        offset_ms = (timestamp_us - self.timestamp_start) // 1000
         if offset_ms > 65535:
             offset_ms = 65535
+        elif offset_ms < 0:
+            offset_ms = 0
         
-        # Build sample: type (1) + offset (2) + length (1) + data (N)
-        sample = struct.pack('<BHB', sample_type, offset_ms, len(data)) + data
-        
-        # Check if adding this sample would exceed max size
-        if self.data_size + len(sample) > MAX_DATA_PAYLOAD:
-            return False  # Block full
-        
-        self.samples.append(sample)
-        self.data_size += len(sample)
+        # Sample: type (1) + offset (2) + length (1) + data (N)
+        pos = DATA_BLOCK_HEADER_SIZE + self.data_size
+        _pack_into('<BHB', self.buffer, pos, sample_type, offset_ms, length)
+        self.data_size += 4 + length
+        self.sample_count += 1
+        return pos + 4
+    
+    def add_sample(self, sample_type, timestamp_us, data):
+        """Add a sample to the block"""
+        pos = self._reserve(sample_type, timestamp_us, len(data))
+        if pos < 0:
+            return False
+        self.buffer[pos:pos + len(data)] = data
+        return True
+    
+    def add_triplet(self, sample_type, timestamp_us, x, y, z):
+        """Add a 3x float32 sample (accel/gyro/mag) without building bytes"""
+        pos = self._reserve(sample_type, timestamp_us, 12)
+        if pos < 0:
+            return False
+        _pack_into('<fff', self.buffer, pos, x, y, z)
+        return True
+    
+    def add_imu(self, timestamp_us, ax, ay, az, gx, gy, gz, mag=None):
+        """Add accel + gyro (24 bytes) or accel + gyro + mag (36 bytes)"""
+        if mag is None:
+            pos = self._reserve(SAMPLE_TYPE_IMU, timestamp_us, 24)
+            if pos < 0:
+                return False
+            _pack_into('<ffffff', self.buffer, pos, ax, ay, az, gx, gy, gz)
+        else:
+            pos = self._reserve(SAMPLE_TYPE_IMU, timestamp_us, 36)
+            if pos < 0:
+                return False
+            _pack_into('<fffffffff', self.buffer, pos, ax, ay, az, gx, gy, gz,
+                       mag[0], mag[1], mag[2])
+        return True
+    
+    def add_gps(self, timestamp_us, lat, lon, alt, speed, heading, hdop):
+        """Add a GPS fix (lat/lon float64, the rest float32)"""
+        pos = self._reserve(SAMPLE_TYPE_GPS_FIX, timestamp_us, 32)
+        if pos < 0:
+            return False
+        _pack_into('<ddffff', self.buffer, pos, lat, lon, alt, speed, heading, hdop)
+        return True
+    
+    def add_imu_burst(self, timestamp_us, records, count, interval_us,
+                      accel_lsb, gyro_lsb):
+        """Add count raw accel + gyro FIFO records as one sample"""
+        length = IMU_BURST_HEADER_SIZE + count * IMU_BURST_STRIDE
+        pos = self._reserve(SAMPLE_TYPE_IMU_BURST, timestamp_us, length)
+        if pos < 0:
+            return False
+        _pack_into(IMU_BURST_HEADER_FORMAT, self.buffer, pos, count,
+                   IMU_CHANNEL_ACCEL | IMU_CHANNEL_GYRO, interval_us,
+                   accel_lsb, gyro_lsb)
+        pos += IMU_BURST_HEADER_SIZE
+        self.buffer[pos:pos + count * IMU_BURST_STRIDE] = records[:count * IMU_BURST_STRIDE]
         return True
     
     def is_empty(self):
         """Check if block has no samples"""
-        return len(self.samples) == 0
+        return self.sample_count == 0
     
     def should_flush(self, current_time, last_flush_time, gforce_total=0):
         """Determine if block should be flushed"""
@@ -426,35 +617,651 @@ class DataBlock:
         if self.is_empty():
             return b''
         
-        # Build block header
-        header = bytearray()
+        block_data = self.serialize()
+        return bytes(block_data) + struct.pack('<I', crc32(block_data))
+    
+    def serialize(self):
+        """
+        Fill in the header and return header + samples, without the CRC32
         
-        # Magic + Block Type
-        header.extend(MAGIC)
-        header.append(BLOCK_TYPE_DATA)
+        Returns:
+            memoryview: View into the block buffer - valid until reset()
+        """
+        # Block sequence, timestamps, flush flags, sample count, data size
+        # (magic, type and session ID were written at construction)
+        _pack_into('<IQQBHH', self.buffer, 21,
+                   self.block_sequence,
+                   self.timestamp_start or 0, self.timestamp_end or 0,
+                   self.flush_flags, self.sample_count, self.data_size)
+        return memoryview(self.buffer)[:DATA_BLOCK_HEADER_SIZE + self.data_size]
+
+
+# =============================================================================
+# Native Data Block
+# =============================================================================
+
+class NativeDataBlock(DataBlock):
+    """
+    DataBlock packed by the oplnative C module
+    
+    Same bytes as DataBlock. The timestamps and counts are kept by the
+    module in the block's own header fields rather than as attributes, so
+    appending a sample is one call; they are read back only when the block
+    is flushed. data_size stays an attribute (from the append's return)
+    since should_flush() checks it every sample.
+    """
+    
+    def reset(self, block_seq):
+        """Empty the block for reuse as block_seq"""
+        self.block_sequence = block_seq
+        self.flush_flags = 0
+        self.data_size = 0
+        oplnative.block_reset(self.buffer)
+    
+    @property
+    def sample_count(self):
+        return _unpack_from('<H', self.buffer, 42)[0]
+    
+    @property
+    def timestamp_start(self):
+        return _unpack_from('<Q', self.buffer, 25)[0] if self.data_size else None
+    
+    @property
+    def timestamp_end(self):
+        return _unpack_from('<Q', self.buffer, 33)[0] if self.data_size else None
+    
+    def is_empty(self):
+        return self.data_size == 0
+    
+    def _reserve(self, sample_type, timestamp_us, length):
+        pos = oplnative.block_reserve(self.buffer, sample_type, timestamp_us, length)
+        if pos >= 0:
+            self.data_size += 4 + length
+        return pos
+    
+    def add_triplet(self, sample_type, timestamp_us, x, y, z):
+        size = oplnative.block_append_f32(self.buffer, sample_type, timestamp_us, x, y, z)
+        if size < 0:
+            return False
+        self.data_size = size
+        return True
+    
+    def add_imu(self, timestamp_us, ax, ay, az, gx, gy, gz, mag=None):
+        if mag is None:
+            size = oplnative.block_append_f32(self.buffer, SAMPLE_TYPE_IMU, timestamp_us,
+                                              ax, ay, az, gx, gy, gz)
+        else:
+            size = oplnative.block_append_f32(self.buffer, SAMPLE_TYPE_IMU, timestamp_us,
+                                              ax, ay, az, gx, gy, gz, mag[0], mag[1], mag[2])
+        if size < 0:
+            return False
+        self.data_size = size
+        return True
+    
+    def add_gps(self, timestamp_us, lat, lon, alt, speed, heading, hdop):
+        size = oplnative.block_append_gps(self.buffer, timestamp_us, lat, lon,
+                                          alt, speed, heading, hdop)
+        if size < 0:
+            return False
+        self.data_size = size
+        return True
+    
+    def serialize(self):
+        n = oplnative.block_finish(self.buffer, self.block_sequence, self.flush_flags)
+        return memoryview(self.buffer)[:n]
+
+
+# Plain blocks come from the C module when the firmware has it
+PlainDataBlock = NativeDataBlock if oplnative else DataBlock
+
+
+# =============================================================================
+# Compressed Data Block
+# =============================================================================
+
+def _put_varint(buf, pos, value):
+    """Write unsigned LEB128 varint at pos, return the next position"""
+    while value > 0x7F:
+        buf[pos] = (value & 0x7F) | 0x80
+        value >>= 7
+        pos += 1
+    buf[pos] = value
+    return pos + 1
+
+
+def _put_signed(buf, pos, value):
+    """Write zig-zag varint (small magnitudes of either sign stay short)"""
+    return _put_varint(buf, pos, (value << 1) if value >= 0 else ((-value) << 1) - 1)
+
+
+def _iround(value):
+    """Round half away from zero to int"""
+    return int(value + 0.5) if value >= 0 else int(value - 0.5)
+
+
+def _fixed(value, inv_scale):
+    """Float to int16 fixed point, saturating"""
+    q = _iround(value * inv_scale)
+    if q > 32767:
+        return 32767
+    if q < -32767:
+        return -32767
+    return q
+
+
+def _saturate(value, scale, limit):
+    """Float to fixed point clamped to +-limit counts, NaN as 0"""
+    q = value * scale
+    if q > limit:
+        return limit
+    if q < -limit:
+        return -limit
+    if q != q:
+        return 0
+    return _iround(q)
+
+
+class CompressedDataBlock(DataBlock):
+    """
+    Data block with compressed samples (format 2.1, BLOCK_FLAG_COMPRESSED)
+    
+    Sample data starts with the block's fixed-point scales, then each
+    sample is:
+    
+        type (1) + zig-zag varint delta of its ms offset from the previous
+        sample's + payload
+    
+    Payloads:
+    - Accel/gyro/mag: int16 fixed point per axis, zig-zag varint delta
+      from the previous value of that sensor in the block
+    - IMU: channel count (6 or 9) then accel, gyro (, mag) as above
+    - GPS fix: lat/lon in 1e-7 deg as signed varints - absolute for the
+      first fix in the block, then deltas from it - then alt (0.1 m),
+      speed, heading and hdop (0.01) as signed varints; out of range
+      values saturate and NaN is stored as 0
+    - IMU burst: count, interval_us, accel/gyro LSB (2x float32), then
+      raw int16 values as deltas from the previous record
+    - Anything else: varint length + the raw payload
+    
+    The predictors restart every block, so each block decodes alone. A
+    slowly moving 100Hz accel sample shrinks from 16 to ~6 bytes.
+    """
+    
+    def reset(self, block_seq):
+        """Empty the block and restart the predictors"""
+        DataBlock.reset(self, block_seq)
+        self.flush_flags = BLOCK_FLAG_COMPRESSED
+        _pack_into(COMPRESS_SCALE_FORMAT, self.buffer, DATA_BLOCK_HEADER_SIZE,
+                   COMPRESS_ACCEL_SCALE, COMPRESS_GYRO_SCALE, COMPRESS_MAG_SCALE)
+        self.data_size = COMPRESS_SCALE_SIZE
+        self._last_ms = 0
+        self._prev = {
+            SAMPLE_TYPE_ACCELEROMETER: [0, 0, 0],
+            SAMPLE_TYPE_GYROSCOPE: [0, 0, 0],
+            SAMPLE_TYPE_MAGNETOMETER: [0, 0, 0],
+        }
+        self._gps_origin = None
+    
+    def _begin(self, sample_type, timestamp_us, worst_case):
+        """
+        Write type and timestamp delta if worst_case payload bytes fit
         
-        # Session ID and block sequence
-        header.extend(self.session_id)
-        header.extend(struct.pack('<I', self.block_sequence))
+        Returns:
+            int: Buffer offset for the payload, or -1 if the block is full
+        """
+        if self.data_size + 6 + worst_case > MAX_DATA_PAYLOAD:
+            return -1
         
-        # Timestamps
-        header.extend(struct.pack('<Q', self.timestamp_start or 0))
-        header.extend(struct.pack('<Q', self.timestamp_end or 0))
+        if self.timestamp_start is None:
+            self.timestamp_start = timestamp_us
+            self.timestamp_end = timestamp_us
+        elif timestamp_us > self.timestamp_end:
+            self.timestamp_end = timestamp_us
         
-        # Flush flags, sample count, data size
-        header.append(self.flush_flags)
-        header.extend(struct.pack('<H', len(self.samples)))
-        header.extend(struct.pack('<H', self.data_size))
+        offset_ms = (timestamp_us - self.timestamp_start) // 1000
+        if offset_ms < 0:
+            offset_ms = 0
         
-        # Combine all samples
-        data_payload = b''.join(self.samples)
+        buf = self.buffer
+        pos = DATA_BLOCK_HEADER_SIZE + self.data_size
+        buf[pos] = sample_type
+        pos = _put_signed(buf, pos + 1, offset_ms - self._last_ms)
+        self._last_ms = offset_ms
+        return pos
+    
+    def _end(self, pos):
+        """Commit a sample that ends at pos"""
+        self.data_size = pos - DATA_BLOCK_HEADER_SIZE
+        self.sample_count += 1
+        return True
+    
+    def _put_axes(self, pos, sensor, inv_scale, x, y, z):
+        """Write three fixed-point deltas against the sensor's predictor"""
+        prev = self._prev[sensor]
+        buf = self.buffer
+        q = _fixed(x, inv_scale)
+        pos = _put_signed(buf, pos, q - prev[0])
+        prev[0] = q
+        q = _fixed(y, inv_scale)
+        pos = _put_signed(buf, pos, q - prev[1])
+        prev[1] = q
+        q = _fixed(z, inv_scale)
+        pos = _put_signed(buf, pos, q - prev[2])
+        prev[2] = q
+        return pos
+    
+    def add_triplet(self, sample_type, timestamp_us, x, y, z):
+        """Add accel/gyro/mag as three int16 deltas"""
+        if sample_type == SAMPLE_TYPE_GYROSCOPE:
+            inv_scale = _INV_GYRO_SCALE
+        elif sample_type == SAMPLE_TYPE_MAGNETOMETER:
+            inv_scale = _INV_MAG_SCALE
+        else:
+            inv_scale = _INV_ACCEL_SCALE
+            sample_type = SAMPLE_TYPE_ACCELEROMETER
         
-        # Calculate CRC32 checksum of header + data
-        block_data = bytes(header) + data_payload
-        checksum = crc32(block_data)
+        pos = self._begin(sample_type, timestamp_us, 9)
+        if pos < 0:
+            return False
+        return self._end(self._put_axes(pos, sample_type, inv_scale, x, y, z))
+    
+    def add_imu(self, timestamp_us, ax, ay, az, gx, gy, gz, mag=None):
+        """Add accel + gyro (+ mag) as int16 deltas"""
+        pos = self._begin(SAMPLE_TYPE_IMU, timestamp_us, 28)
+        if pos < 0:
+            return False
+        self.buffer[pos] = 6 if mag is None else 9
+        pos = self._put_axes(pos + 1, SAMPLE_TYPE_ACCELEROMETER, _INV_ACCEL_SCALE, ax, ay, az)
+        pos = self._put_axes(pos, SAMPLE_TYPE_GYROSCOPE, _INV_GYRO_SCALE, gx, gy, gz)
+        if mag is not None:
+            pos = self._put_axes(pos, SAMPLE_TYPE_MAGNETOMETER, _INV_MAG_SCALE, mag[0], mag[1], mag[2])
+        return self._end(pos)
+    
+    def add_imu_burst(self, timestamp_us, records, count, interval_us,
+                      accel_lsb, gyro_lsb):
+        """Add raw FIFO records as deltas from the previous record"""
+        values = count * (IMU_BURST_STRIDE // 2)
+        pos = self._begin(SAMPLE_TYPE_IMU_BURST, timestamp_us, 13 + values * 3)
+        if pos < 0:
+            return False
+        buf = self.buffer
+        buf[pos] = count
+        pos = _put_varint(buf, pos + 1, interval_us)
+        _pack_into('<ff', buf, pos, accel_lsb, gyro_lsb)
+        pos += 8
+        prev = [0, 0, 0, 0, 0, 0]
+        for i in range(count):
+            record = _unpack_from('<hhhhhh', records, i * IMU_BURST_STRIDE)
+            for axis in range(6):
+                pos = _put_signed(buf, pos, record[axis] - prev[axis])
+                prev[axis] = record[axis]
+        return self._end(pos)
+    
+    def _add_gps(self, timestamp_us, data):
+        """Add a GPS fix, lat/lon relative to the block's first fix"""
+        pos = self._begin(SAMPLE_TYPE_GPS_FIX, timestamp_us, 30)
+        if pos < 0:
+            return False
+        lat, lon, alt, speed, heading, hdop = _unpack_from('<ddffff', data, 0)
+        qlat = _saturate(lat, COMPRESS_GPS_SCALE, _GPS_MAX_LAT)
+        qlon = _saturate(lon, COMPRESS_GPS_SCALE, _GPS_MAX_LON)
+        buf = self.buffer
+        if self._gps_origin is None:
+            self._gps_origin = (qlat, qlon)
+            pos = _put_signed(buf, pos, qlat)
+            pos = _put_signed(buf, pos, qlon)
+        else:
+            pos = _put_signed(buf, pos, qlat - self._gps_origin[0])
+            pos = _put_signed(buf, pos, qlon - self._gps_origin[1])
+        pos = _put_signed(buf, pos, _saturate(alt, 10, _GPS_MAX_FIELD))
+        pos = _put_signed(buf, pos, _saturate(speed, 100, _GPS_MAX_FIELD))
+        pos = _put_signed(buf, pos, _saturate(heading, 100, _GPS_MAX_FIELD))
+        pos = _put_signed(buf, pos, _saturate(hdop, 100, _GPS_MAX_FIELD))
+        return self._end(pos)
+    
+    def add_gps(self, timestamp_us, lat, lon, alt, speed, heading, hdop):
+        """Add a GPS fix, compressed"""
+        return self._add_gps(timestamp_us, struct.pack('<ddffff', lat, lon, alt,
+                                                       speed, heading, hdop))
+    
+    def add_sample(self, sample_type, timestamp_us, data):
+        """Add a GPS fix compressed, anything else as length + raw bytes"""
+        if sample_type == SAMPLE_TYPE_GPS_FIX and len(data) == 32:
+            return self._add_gps(timestamp_us, data)
         
-        # Return block with CRC32 (4 bytes, little-endian)
-        return block_data + struct.pack('<I', checksum)
+        length = len(data)
+        pos = self._begin(sample_type, timestamp_us, 2 + length)
+        if pos < 0:
+            return False
+        pos = _put_varint(self.buffer, pos, length)
+        self.buffer[pos:pos + length] = data
+        return self._end(pos + length)
+
+
+# =============================================================================
+# Block Index
+# =============================================================================
+
+class BlockIndex:
+    """
+    Index of the session's data blocks
+    
+    Written after the session end marker: one fixed-size entry per data
+    block, then a 16-byte trailer as the last bytes of the file pointing
+    back to the index. Readers that stop at session end never see it;
+    readers that want a block or time range read the trailer and seek.
+    
+    Entries are packed as blocks are flushed (27 bytes each, about 40KB
+    for an hour at 100Hz), so nothing is rescanned at stop.
+    """
+    
+    def __init__(self):
+        self.entries = bytearray()
+        self.count = 0
+    
+    def add_block(self, offset, block):
+        """Record a data block written at file offset"""
+        self.entries.extend(struct.pack(INDEX_ENTRY_FORMAT,
+            offset, block.block_sequence,
+            block.timestamp_start or 0, block.timestamp_end or 0,
+            block.sample_count, block.flush_flags))
+        self.count += 1
+    
+    def write(self, f, session_id, offset):
+        """
+        Write the index block and trailer
+        
+        Args:
+            f: Log file positioned at offset
+            session_id: Session UUID
+            offset: File offset the index starts at
+        
+        Returns:
+            int: Bytes written
+        """
+        header = MAGIC + bytes([BLOCK_TYPE_INDEX]) + session_id + struct.pack('<I', self.count)
+        checksum = crc32(self.entries, crc32(header))
+        
+        f.write(header)
+        f.write(self.entries)
+        f.write(struct.pack('<I', checksum))
+        
+        trailer = struct.pack(INDEX_TRAILER_FORMAT, MAGIC, BLOCK_TYPE_INDEX_TRAILER, offset)
+        f.write(trailer + struct.pack('<I', crc32(trailer)))
+        
+        return len(header) + len(self.entries) + 4 + INDEX_TRAILER_SIZE
+
+
+def read_block_index(f):
+    """
+    Locate the block index through the trailer
+    
+    Args:
+        f: Session file opened 'rb'
+    
+    Returns:
+        tuple: (offset of first entry, entry count), or None if the file
+               has no valid index (older file, or session still open)
+    """
+    try:
+        f.seek(-INDEX_TRAILER_SIZE, 2)
+    except OSError:
+        return None
+    
+    trailer = f.read(INDEX_TRAILER_SIZE)
+    if (len(trailer) != INDEX_TRAILER_SIZE or trailer[:4] != MAGIC or
+            trailer[4] != BLOCK_TYPE_INDEX_TRAILER):
+        return None
+    if crc32(trailer[:12]) != struct.unpack_from('<I', trailer, 12)[0]:
+        return None
+    
+    index_offset = struct.unpack_from('<I', trailer, 8)[0]
+    f.seek(index_offset)
+    header = f.read(INDEX_HEADER_SIZE)
+    if len(header) != INDEX_HEADER_SIZE or header[:4] != MAGIC or header[4] != BLOCK_TYPE_INDEX:
+        return None
+    
+    return index_offset + INDEX_HEADER_SIZE, struct.unpack_from('<I', header, 21)[0]
+
+
+def read_index_entry(f, index, i):
+    """
+    Read entry i of an index located by read_block_index()
+    
+    Returns:
+        tuple: (offset, block_sequence, timestamp_start, timestamp_end,
+                sample_count, flush_flags)
+    """
+    f.seek(index[0] + i * INDEX_ENTRY_SIZE)
+    return struct.unpack(INDEX_ENTRY_FORMAT, f.read(INDEX_ENTRY_SIZE))
+
+
+# =============================================================================
+# Block Scanning
+# =============================================================================
+
+def find_data_block(f, block_sequence):
+    """
+    Find the first data block at or after block_sequence
+    
+    Finished sessions are looked up by binary search in the block index.
+    Otherwise the block headers are walked from the start of the file,
+    seeking over the payloads so only a few bytes per block are read.
+    
+    Args:
+        f: Session file opened 'rb'
+        block_sequence: Data block sequence number to look for
+    
+    Returns:
+        int: File offset of the block, or None if the file ends first
+    """
+    index = read_block_index(f)
+    if index:
+        lo, hi = 0, index[1]
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if read_index_entry(f, index, mid)[1] < block_sequence:
+                lo = mid + 1
+            else:
+                hi = mid
+        return read_index_entry(f, index, lo)[0] if lo < index[1] else None
+    
+    offset = 0
+    while True:
+        f.seek(offset)
+        head = f.read(5)
+        if len(head) < 5 or head[:4] != MAGIC:
+            return None
+        
+        block_type = head[4]
+        
+        if block_type == BLOCK_TYPE_DATA:
+            fields = f.read(DATA_BLOCK_HEADER_SIZE - 5)
+            if len(fields) < DATA_BLOCK_HEADER_SIZE - 5:
+                return None
+            if struct.unpack_from('<I', fields, 16)[0] >= block_sequence:
+                return offset
+            data_size = struct.unpack_from('<H', fields, 39)[0]
+            offset += DATA_BLOCK_HEADER_SIZE + data_size + 4
+        
+        elif block_type == BLOCK_TYPE_SESSION_HEADER:
+            # Fixed fields, then name/driver/vehicle length-prefixed strings
+            size = 33
+            for _ in range(3):
+                f.seek(offset + size)
+                n = f.read(1)
+                if not n:
+                    return None
+                size += 1 + n[0]
+            offset += size + 11  # Weather, temperature, config CRC, CRC
+        
+        elif block_type == BLOCK_TYPE_HARDWARE_CONFIG:
+            count = f.read(1)
+            if not count:
+                return None
+            size = 6
+            for _ in range(count[0]):
+                f.seek(offset + size + 2)  # Skip hw/conn type
+                n = f.read(1)
+                if not n:
+                    return None
+                size += 3 + n[0]
+            offset += size + 4  # CRC
+        
+        else:
+            # Session end (or unknown) - no data blocks follow
+            return None
+
+
+# =============================================================================
+# SD Write-Behind
+# =============================================================================
+
+class SectorWriter:
+    """
+    Append-only session file that only ever writes whole, aligned sectors
+    
+    Blocks are odd sizes (header + payload + CRC), so writing them as they
+    come leaves every write straddling a sector, which FAT turns into a
+    read-modify-write of the sector. Here the bytes that don't make up a
+    full sector wait in a 512-byte tail buffer and only complete sectors
+    go to the card.
+    
+    sync() is the durability point: it writes the partial tail sector and
+    flush()es (directory entry and FAT), then seeks back to the start of
+    that sector so the next write rewrites it whole. Between syncs data is
+    on the card but a power cut loses it from the file - how often to pay
+    for a sync is BinaryLogger's sync policy.
+    
+    With reserve > 0 the file is first extended to that size, so clusters
+    are allocated once instead of as the session grows, and cut back at
+    close(). That needs a file with truncate() - CircuitPython's FAT files
+    have none, so there the reserve is skipped.
+    """
+    
+    def __init__(self):
+        self.file = None
+        self.tail = bytearray(SECTOR_SIZE)
+        self._tail_view = memoryview(self.tail)
+        self.fill = 0           # Bytes waiting in tail
+        self.position = 0       # Bytes written through write()
+        self.preallocated = 0   # Bytes reserved at open, 0 if none
+        self._reset_stats()
+    
+    def _reset_stats(self):
+        self.writes = 0         # Sector writes (one call may be several sectors)
+        self.write_total_us = 0
+        self.write_max_us = 0
+        self.slow_writes = 0    # Writes of SLOW_WRITE_US or more
+        self.syncs = 0
+        self.sync_max_us = 0
+        self._interval_writes = 0
+        self._interval_write_us = 0
+        self._interval_syncs = 0
+        self._interval_sync_us = 0
+    
+    def open(self, path, reserve=0):
+        """Create path for writing, reserving reserve bytes if possible"""
+        self.file = open(path, 'wb')
+        self.fill = 0
+        self.position = 0
+        self.preallocated = 0
+        self._reset_stats()
+        
+        if reserve > SECTOR_SIZE and hasattr(self.file, 'truncate'):
+            try:
+                self.file.seek(reserve - 1)
+                self.file.write(b'\x00')
+                self.file.flush()
+                self.preallocated = reserve
+            except OSError as e:
+                print(f"[BinaryLog] Preallocate failed: {e}")
+            self.file.seek(0)
+    
+    def _write(self, data):
+        """Write to the card, timed"""
+        start = time.monotonic_ns()
+        self.file.write(data)
+        us = (time.monotonic_ns() - start) // 1000
+        self.writes += 1
+        self.write_total_us += us
+        if us > self.write_max_us:
+            self.write_max_us = us
+        if us >= SLOW_WRITE_US:
+            self.slow_writes += 1
+        self._interval_writes += 1
+        if us > self._interval_write_us:
+            self._interval_write_us = us
+    
+    def write(self, data):
+        """Append data, writing out any sectors it completes"""
+        n = len(data)
+        self.position += n
+        pos = 0
+        
+        if self.fill:
+            take = min(SECTOR_SIZE - self.fill, n)
+            self.tail[self.fill:self.fill + take] = data[:take]
+            self.fill += take
+            pos = take
+            if self.fill < SECTOR_SIZE:
+                return
+            self._write(self.tail)
+            self.fill = 0
+        
+        # Whole sectors straight from data, the rest into the tail
+        whole = (n - pos) & ~(SECTOR_SIZE - 1)
+        if whole:
+            self._write(memoryview(data)[pos:pos + whole])
+            pos += whole
+        if pos < n:
+            self.fill = n - pos
+            self.tail[:self.fill] = data[pos:]
+    
+    def sync(self):
+        """Make everything written so far durable"""
+        start = time.monotonic_ns()
+        if self.fill:
+            self._write(self._tail_view[:self.fill])
+        self.file.flush()
+        if self.fill:
+            # The tail sector gets written again, whole, once it fills
+            self.file.seek(self.position - self.fill)
+        us = (time.monotonic_ns() - start) // 1000
+        self.syncs += 1
+        if us > self.sync_max_us:
+            self.sync_max_us = us
+        self._interval_syncs += 1
+        if us > self._interval_sync_us:
+            self._interval_sync_us = us
+    
+    def close(self):
+        """Write the tail, drop any unused reserve and close"""
+        if self.file is None:
+            return
+        if self.fill:
+            self._write(self._tail_view[:self.fill])
+            self.fill = 0
+        if self.preallocated:
+            self.file.truncate()
+        self.file.flush()
+        self.file.close()
+        self.file = None
+    
+    def take_stats(self):
+        """
+        Writes and syncs since the last call
+        
+        Returns:
+            tuple: (writes, worst write us, syncs, worst sync us)
+        """
+        stats = (self._interval_writes, self._interval_write_us,
+                 self._interval_syncs, self._interval_sync_us)
+        self._interval_writes = 0
+        self._interval_write_us = 0
+        self._interval_syncs = 0
+        self._interval_sync_us = 0
+        return stats
 
 
 # =============================================================================
@@ -464,9 +1271,15 @@ class DataBlock:
 class BinaryLogger:
     """Binary logging with session management"""
     
-    def __init__(self, base_path="/sd"):
+    def __init__(self, base_path="/sd", compress=False, sync=SYNC_BLOCK,
+                 sync_interval=10, preallocate=0):
         self.base_path = base_path
-        self.log_file = None
+        self.compress = compress     # Write CompressedDataBlocks (format 2.1)
+        self.log_file = SectorWriter()
+        self.sync_policy = sync if sync in SYNC_POLICIES else SYNC_BLOCK
+        self.sync_interval = sync_interval  # Seconds, SYNC_INTERVAL only
+        self.preallocate = preallocate      # Bytes reserved per session file
+        self._last_sync = 0
         self.log_filename = None
         self.current_session = None
         self.current_block = None
@@ -475,6 +1288,21 @@ class BinaryLogger:
         self.active = False
         self.start_time = None
         self.bytes_written = 0
+        self.file_offset = 0
+        self.block_index = None
+        self.sample_total = 0        # Samples in flushed blocks
+        self.peak_g = 0.0            # Largest total g passed to _check_flush()
+        
+        # Deferred flush: a full block is CRC'd and written a slice at a time
+        # by service() while sampling carries on in the spare block
+        self._spare_block = None
+        self._flushing_block = None
+        self._event_block = None     # Filled by event capture, see event_block()
+        self._flush_data = None
+        self._flush_pos = 0
+        self._flush_crc = 0
+        self.forced_flushes = 0      # Next block filled before the flush finished
+        self.max_flush_step_ms = 0   # Longest single service() step
     
     def start_session(self, session_name="", driver_name="", vehicle_id="",
                      weather=WEATHER_UNKNOWN, ambient_temp=0, config_crc=0,
@@ -515,24 +1343,36 @@ class BinaryLogger:
             print(f"[BinaryLog Debug]   Generated timestamp filename: {self.log_filename}")
         
         self.bytes_written = 0
+        self.sample_total = 0
+        self.peak_g = 0.0
+        self.block_index = BlockIndex()
         # Open log file and write session header
-        self.log_file = open(self.log_filename, 'wb')
-        self.log_file.write(self.current_session.to_bytes())
-        self.log_file.flush()
+        self.log_file.open(self.log_filename, self.preallocate)
+        header_bytes = self.current_session.to_bytes()
+        self.log_file.write(header_bytes)
+        self.file_offset = len(header_bytes)
 
         # Store hardware config
         if include_hardware:
             hw_block = HardwareConfigBlock.from_hardware_setup()
             if hw_block:
-                self.log_file.write(hw_block.to_bytes())
+                hw_bytes = hw_block.to_bytes()
+                self.log_file.write(hw_bytes)
+                self.file_offset += len(hw_bytes)
                 print(f"[BinaryLog] Hardware config: {len(hw_block.items)} items")
+        self.log_file.sync()
+        self._last_sync = time.monotonic()
         
-        # Initialize first data block
+        # Initialize first data block and its spare
         self.block_sequence = 0
-        self.current_block = DataBlock(
+        block_class = CompressedDataBlock if self.compress else PlainDataBlock
+        self.current_block = block_class(
             self.current_session.session_id,
             self.block_sequence
         )
+        self._spare_block = block_class(self.current_session.session_id, 0)
+        self._flushing_block = None
+        self._flush_data = None
         self.start_time = time.monotonic()
         self._last_flush_time = time.monotonic()
         self.active = True
@@ -546,7 +1386,7 @@ class BinaryLogger:
             return False
         
         if timestamp_us is None:
-            timestamp_us = int(time.monotonic() * 1000000)
+            timestamp_us = time.monotonic_ns() // 1000
         
         # Try to add sample to current block
         if not self.current_block.add_sample(sample_type, timestamp_us, data):
@@ -554,28 +1394,156 @@ class BinaryLogger:
             self._flush_block()
             self.current_block.add_sample(sample_type, timestamp_us, data)
         
-        # Check if we should flush
-        current_time = time.monotonic()
-        if self.current_block.should_flush(current_time, self._last_flush_time, gforce_total):
+        self._check_flush(gforce_total)
+        return True
+    
+    def write_triplet(self, sample_type, x, y, z, timestamp_us=None, gforce_total=0):
+        """write_sample() for 3x float32, packed straight into the block"""
+        if not self.active:
+            return False
+        
+        if timestamp_us is None:
+            timestamp_us = time.monotonic_ns() // 1000
+        
+        if not self.current_block.add_triplet(sample_type, timestamp_us, x, y, z):
             self._flush_block()
+            self.current_block.add_triplet(sample_type, timestamp_us, x, y, z)
         
+        self._check_flush(gforce_total)
         return True
     
+    def _check_flush(self, gforce_total):
+        """Hand the block to the flush if time, size or a g event calls for it"""
+        if gforce_total > self.peak_g:
+            self.peak_g = gforce_total
+        if self.current_block.should_flush(time.monotonic(), self._last_flush_time, gforce_total):
+            self._flush_block()
+    
     def _flush_block(self):
-        """Flush current block to file"""
-        if self.current_block and not self.current_block.is_empty():
-            block_bytes = self.current_block.to_bytes()
-            self.log_file.write(block_bytes)
-            self.log_file.flush()
-            self.bytes_written += len(block_bytes)
-            
-            # Create new block
-            self.block_sequence += 1
-            self.current_block = DataBlock(
-                self.current_session.session_id,
-                self.block_sequence
-            )
-            self._last_flush_time = time.monotonic()
+        """Hand the current block to the deferred flush and switch to the spare"""
+        if not self.current_block or self.current_block.is_empty():
+            return
+        
+        if self._flush_data is not None:
+            # Still writing the previous block - nowhere to put samples
+            self.forced_flushes += 1
+            self._finish_flush()
+        
+        self._start_flush(self.current_block)
+        
+        # Keep sampling into the spare
+        self.block_sequence += 1
+        self.current_block = self._spare_block
+        self.current_block.reset(self.block_sequence)
+        self._spare_block = None
+        self._last_flush_time = time.monotonic()
+    
+    def _start_flush(self, block):
+        """Serialize block and index it; service() writes it out"""
+        self._flush_data = block.serialize()
+        self._flush_pos = 0
+        self._flush_crc = 0
+        self._flushing_block = block
+        
+        block_size = len(self._flush_data) + 4
+        self.block_index.add_block(self.file_offset, block)
+        self.sample_total += block.sample_count
+        self.bytes_written += block_size
+        self.file_offset += block_size
+    
+    def _flush_step(self):
+        """Write the next slice of the flushing block, or finish it"""
+        data = self._flush_data
+        pos = self._flush_pos
+        
+        if pos < len(data):
+            end = min(pos + FLUSH_SLICE_SIZE, len(data))
+            chunk = memoryview(data)[pos:end]
+            self._flush_crc = crc32(chunk, self._flush_crc)
+            self.log_file.write(chunk)
+            self._flush_pos = end
+            return
+        
+        self.log_file.write(struct.pack('<I', self._flush_crc))
+        if self._sync_due(self._flushing_block.flush_flags):
+            self.log_file.sync()
+            self._last_sync = time.monotonic()
+        
+        if self._flushing_block is not self._event_block:
+            self._spare_block = self._flushing_block
+        self._flushing_block = None
+        self._flush_data = None
+    
+    def _sync_due(self, flush_flags):
+        """Whether the sync policy wants a sync after a block with these flags"""
+        if flush_flags & SYNC_FORCE_FLAGS or self.sync_policy == SYNC_BLOCK:
+            return True
+        if self.sync_policy == SYNC_INTERVAL:
+            return time.monotonic() - self._last_sync >= self.sync_interval
+        return False
+    
+    def _finish_flush(self):
+        """Complete any pending flush now"""
+        while self._flush_data is not None:
+            self._flush_step()
+    
+    def service(self):
+        """
+        Advance a pending block flush by one slice
+        
+        Call once per main loop iteration. Each call CRCs and writes at most
+        FLUSH_SLICE_SIZE bytes, so a 4KB block is spread over ~10 loops
+        instead of stalling one.
+        """
+        if self._flush_data is None:
+            return
+        
+        start = time.monotonic_ns()
+        self._flush_step()
+        step_ms = (time.monotonic_ns() - start) / 1000000
+        if step_ms > self.max_flush_step_ms:
+            self.max_flush_step_ms = step_ms
+    
+    def event_block(self):
+        """
+        Empty block for an event capture window (see event_capture.py)
+        
+        Always a plain block - raw bursts don't compress. Fill it and
+        hand it back with write_event_block() in the same call.
+        
+        Returns:
+            DataBlock, or None while a flush is pending
+        """
+        if not self.active or self._flush_data is not None:
+            return None
+        # Let a half-full block flush first, so sampling never has to
+        # wait on an event block (forced flush)
+        if self.current_block.data_size >= MAX_DATA_PAYLOAD // 2:
+            return None
+        
+        session_id = self.current_session.session_id
+        if self._event_block is None or self._event_block.session_id != session_id:
+            self._event_block = PlainDataBlock(session_id, 0)
+        self._event_block.reset(0)
+        return self._event_block
+    
+    def write_event_block(self, block):
+        """
+        Flush an event block next, ahead of the current block
+        
+        The event block takes the current block's sequence number and the
+        current block moves up one, so sequences stay in file order. Event
+        blocks overlap normal blocks in time - readers sort by timestamp.
+        """
+        if block.is_empty() or self._flush_data is not None:
+            return False
+        
+        block.flush_flags |= FLUSH_FLAG_EVENT
+        block.block_sequence = self.block_sequence
+        self.block_sequence += 1
+        self.current_block.block_sequence = self.block_sequence
+        self._start_flush(block)
+        return True
     
     def stop_session(self):
         """Stop current logging session"""
@@ -584,15 +1552,33 @@ class BinaryLogger:
         
         # Flush remaining data
         self._flush_block()
+        self._finish_flush()
         
         # Write session end marker
         end_block = MAGIC + bytes([BLOCK_TYPE_SESSION_END]) + self.current_session.session_id
         self.log_file.write(end_block)
-        self.log_file.flush()
+        self.file_offset += len(end_block)
+        
+        # Block index goes after the end marker so older readers stop first
+        try:
+            self.file_offset += self.block_index.write(
+                self.log_file, self.current_session.session_id, self.file_offset)
+        except Exception as e:
+            print(f"[BinaryLog] Index write error: {e}")
+        
         self.log_file.close()
         
         self.active = False
         print(f"[BinaryLog] Session stopped: {self.log_filename}")
+        w = self.log_file
+        if w.writes:
+            print(f"[BinaryLog] SD: {w.writes} writes, avg {w.write_total_us // w.writes}us, "
+                  f"worst {w.write_max_us}us, {w.slow_writes} slow; "
+                  f"{w.syncs} syncs ({self.sync_policy}), worst {w.sync_max_us}us")
+    
+    def take_write_stats(self):
+        """SD writes and syncs since the last call, see SectorWriter.take_stats()"""
+        return self.log_file.take_stats()
     
     # Convenience methods
     def write_metadata(self, message):
@@ -619,25 +1605,98 @@ class BinaryLogger:
 
     def write_accelerometer(self, gx, gy, gz, timestamp_us=None):
         """Write accelerometer data"""
-        data = struct.pack('<fff', gx, gy, gz)
-        g_total = (gx**2 + gy**2 + gz**2)**0.5
-        return self.write_sample(SAMPLE_TYPE_ACCELEROMETER, data, timestamp_us, g_total)
+        g_total = (gx*gx + gy*gy + gz*gz) ** 0.5
+        return self.write_triplet(SAMPLE_TYPE_ACCELEROMETER, gx, gy, gz, timestamp_us, g_total)
+
+    def write_imu(self, ax, ay, az, gx, gy, gz, mag=None, timestamp_us=None):
+        """
+        Write accel (g) + gyro (dps) + optional mag (uT) as one sample
+        
+        One 4-byte sample header and one timestamp instead of three.
+        """
+        if not self.active:
+            return False
+        
+        if timestamp_us is None:
+            timestamp_us = time.monotonic_ns() // 1000
+        
+        block = self.current_block
+        if not block.add_imu(timestamp_us, ax, ay, az, gx, gy, gz, mag):
+            self._flush_block()
+            self.current_block.add_imu(timestamp_us, ax, ay, az, gx, gy, gz, mag)
+        
+        self._check_flush((ax*ax + ay*ay + az*az) ** 0.5)
+        return True
+    
+    def write_imu_burst(self, records, count, interval_us, accel_lsb, gyro_lsb,
+                        timestamp_us=None):
+        """
+        Write raw FIFO records (see LSM6DSOX/ICM20948 read_fifo)
+        
+        Args:
+            records: Buffer of count 12-byte int16 accel + gyro records
+            count: Records in buffer (at most IMU_BURST_MAX_RECORDS)
+            interval_us: Time between records
+            accel_lsb: Accelerometer g per LSB
+            gyro_lsb: Gyroscope dps per LSB
+            timestamp_us: Time of the newest record (default now)
+        """
+        if not self.active or count <= 0:
+            return False
+        
+        if timestamp_us is None:
+            timestamp_us = time.monotonic_ns() // 1000
+        
+        # Sample timestamp is the oldest record's
+        timestamp_us -= (count - 1) * interval_us
+        
+        if not self.current_block.add_imu_burst(timestamp_us, records, count,
+                                                interval_us, accel_lsb, gyro_lsb):
+            self._flush_block()
+            self.current_block.add_imu_burst(timestamp_us, records, count,
+                                             interval_us, accel_lsb, gyro_lsb)
+        
+        # Peak g in the burst for the event flush
+        peak = 0
+        for pos in range(0, count * IMU_BURST_STRIDE, IMU_BURST_STRIDE):
+            x, y, z = _unpack_from('<hhh', records, pos)
+            sq = x*x + y*y + z*z
+            if sq > peak:
+                peak = sq
+        
+        self._check_flush((peak ** 0.5) * accel_lsb)
+        return True
+
+    def write_profile(self, data, timestamp_us=None):
+        """Write a loop profile summary (see profiler.LoopProfiler)"""
+        return self.write_sample(SAMPLE_TYPE_PROFILE, data, timestamp_us)
+
+    def write_lap(self, data, timestamp_us=None):
+        """Write a lap/sector event (see lap_timer.LapTimer.event)"""
+        return self.write_sample(SAMPLE_TYPE_LAP, data, timestamp_us)
 
     def write_gyroscope(self, gx, gy, gz, timestamp_us=None):
         """Write gyroscope data (degrees/sec)"""
-        data = struct.pack('<fff', gx, gy, gz)
-        return self.write_sample(SAMPLE_TYPE_GYROSCOPE, data, timestamp_us)
+        return self.write_triplet(SAMPLE_TYPE_GYROSCOPE, gx, gy, gz, timestamp_us)
 
     def write_magnetometer(self, mx, my, mz, timestamp_us=None):
         """Write magnetometer data (micro-Tesla)"""
-        data = struct.pack('<fff', mx, my, mz)
-        return self.write_sample(SAMPLE_TYPE_MAGNETOMETER, data, timestamp_us)
+        return self.write_triplet(SAMPLE_TYPE_MAGNETOMETER, mx, my, mz, timestamp_us)
     
     def write_gps(self, lat, lon, alt, speed, heading, hdop, timestamp_us=None):
         """Write GPS fix data"""
-        #print(f"{lat} {lon} {alt} {speed} {heading} {hdop}")
-        data = struct.pack('<ddffff', lat, lon, alt, speed, heading, hdop)
-        return self.write_sample(SAMPLE_TYPE_GPS_FIX, data, timestamp_us)
+        if not self.active:
+            return False
+        
+        if timestamp_us is None:
+            timestamp_us = time.monotonic_ns() // 1000
+        
+        if not self.current_block.add_gps(timestamp_us, lat, lon, alt, speed, heading, hdop):
+            self._flush_block()
+            self.current_block.add_gps(timestamp_us, lat, lon, alt, speed, heading, hdop)
+        
+        self._check_flush(0)
+        return True
     
     def write_gps_satellites(self, satellites, timestamp_us=None):
         """
@@ -6,6 +6,7 @@ Displays active sensors and logs data
 import board
 import time
 import gc
+import math
 
 # Import hardware and sensors
 import hardware_setup as hw
@@ -13,6 +14,11 @@ from sensors import init_sensors, get_sensor, list_sensors
 from unified_accelerometer import UnifiedAccelerometer
 from gps import GPS
 from session_logger import SessionLogger 
+from config import config
+from profiler import (LoopProfiler, STAGE_IMU_FIFO, STAGE_SENSORS, STAGE_LOG,
+                      STAGE_GPS, STAGE_CONSOLE, STAGE_GC, STAGE_DISPLAY, STAGE_PIXEL,
+                      STAGE_OTHER)
+from scheduler import Scheduler, PRIORITY_SAMPLE, PRIORITY_HIGH, PRIORITY_LOW
 from neopixel_handler import NeoPixelHandler
 from oled import OLED
 from rtc_handler import RTCHandler
@@ -55,6 +61,7 @@ accel = None
 gyro = None
 mag = None
 gps_handler = None
+oled_handler = None
 neopixel_handler = None
 rtc = None
 pfc8523 = None
@@ -71,10 +78,42 @@ if MAG_AVAILABLE and get_sensor('magnetometer'):
     mag = Magnetometer(get_sensor('magnetometer'))
     print("✓ Magnetometer handler ready")
 
+# IMU in FIFO burst mode (hardware.toml: sensors.accelerometer.burst)
+imu_fifo = get_sensor('imu_fifo')
+imu_records = None
+if imu_fifo:
+    from binary_logger import IMU_BURST_MAX_RECORDS, IMU_BURST_STRIDE
+    imu_records = bytearray(IMU_BURST_MAX_RECORDS * IMU_BURST_STRIDE)
+    print("✓ IMU FIFO burst logging ready")
+
+# Pre-trigger capture of g events (hardware.toml: sensors.accelerometer.event_capture)
+event_capture = None
+if imu_fifo and config.log_format == 'binary':
+    from hardware_config import hw_config
+    if hw_config.get_bool("sensors.accelerometer.event_capture", False):
+        from event_capture import EventCapture
+        event_capture = EventCapture(
+            imu_fifo.fifo_interval_us,
+            hw_config.get_int("sensors.accelerometer.sample_rate", 416),
+            imu_fifo.accel_lsb, imu_fifo.gyro_lsb,
+            hw_config.get_float("sensors.accelerometer.event_threshold", 3.0),
+            hw_config.get_int("sensors.accelerometer.event_pre_ms", 500),
+            hw_config.get_int("sensors.accelerometer.event_post_ms", 500))
+        print(f"✓ Event capture ready ({len(event_capture.ring)} byte ring, "
+              f"logging 1 in {event_capture.decimation})")
+
 if sensors.get('gps'):
     gps_handler = GPS(get_sensor('gps'))
     print("✓ GPS handler ready")
 
+# Lap timing against the settings.toml start/finish line and sectors
+lap_timer = None
+if gps_handler and config.lap_start_line:
+    from lap_timer import LapTimer
+    lap_timer = LapTimer.from_config(config)
+    if lap_timer:
+        print(f"✓ Lap timer ready ({lap_timer.sector_count} sectors)")
+
 if hw.display:
     oled_handler = OLED(hw.display)
     oled_handler.setup_main_display()
@@ -160,33 +199,310 @@ session_id = logger.start_session(
 )
 print(f"\n✓ Session started: {session_id}")
 
+# ESP-01S link: commands in, downloads and lap events out
+esp_link = None
+if hw.esp_uart:
+    from serial_com import JSONProtocol
+    esp_link = JSONProtocol(hw.esp_uart, logger, gps_handler, hw.esp_caps,
+                            hw.esp_telemetry_hz)
+
 # =============================================================================
 # Main Loop Counters
 # =============================================================================
 
 loop_count = 0
 loop_Hz = 0
-last_telemetry = 0
-last_display_update = 0
-last_pixel_update = 0
+sample_Hz = 0
+loop_worst_ms = 0      # Longest scheduler pass in the last second
+loop_worst_ever_ms = 0 # Longest scheduler pass this session
 last_heartbeat = 0
 last_gps_log = 0
 last_rtc_sync = 0
+display_piece = 0
 
 heartbeat_state = False
 gps_has_fix = False
 
+# Per-stage timings, logged once a second with the heartbeat
+profiler = LoopProfiler()
+
 # empty last value
 data = { 'gps': {}, 'gyro': {}, 'accel': {}, 'mag': {} }
 
-# 
-# TODO - this needs to come from the config
+# Telemetry for the ESP in the shape send_telemetry() takes, refilled
+# from data on every send
+esp_payload = {
+    'g': {'x': 0.0, 'y': 0.0, 'z': 0.0, 'total': 0.0},
+    'gps': {'lat': 0.0, 'lon': 0.0, 'alt': 0.0, 'speed': 0.0,
+            'sats': 0, 'hdop': 0.0, 'fix': "NoFix"},
+}
+
+# =============================================================================
+# Tasks
+# =============================================================================
+
+def sample_task(deadline_ns):
+    """Read the sensors and log them, stamped with the time of the read"""
+    global sample_Hz
+    timestamp_us = time.monotonic_ns() // 1000
+    
+    if accel:
+        data['accel']['ax'], data['accel']['ay'], data['accel']['az'], data['accel']['ts'] = accel.read()
+        data['accel']['gx'], data['accel']['gy'], data['accel']['gz'] = accel.get_g_forces()
+        data['accel']['total'] = data['accel']['gx'] + data['accel']['gy']
+    
+    if gyro:
+        data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz'] = gyro.read()
+        data['gyro']['ang_vel'] = gyro.get_angular_velocity()
+    
+    if mag:
+        data['mag']['mx'], data['mag']['my'], data['mag']['mz'] = mag.read()
+        data['mag']['heading'] = mag.get_heading()
+        data['mag']['field'] = mag.get_field_strength()
+    
+    profiler.mark(STAGE_SENSORS)
+    
+    # Accel + gyro (+ mag) share one timestamp in a single IMU sample; in
+    # burst mode imu_fifo_task logs accel + gyro and mag is logged separately
+    if accel and gyro and not imu_fifo:
+        logger.write_imu(data['accel']['gx'], data['accel']['gy'], data['accel']['gz'],
+                         data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz'],
+                         (data['mag']['mx'], data['mag']['my'], data['mag']['mz']) if mag else None,
+                         timestamp_us)
+    else:
+        if accel and not imu_fifo:
+            logger.write_accelerometer(data['accel']['gx'], data['accel']['gy'], data['accel']['gz'],
+                                       timestamp_us)
+        if gyro and not imu_fifo:
+            logger.write_gyroscope(data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz'],
+                                   timestamp_us)
+        if mag:
+            logger.write_magnetometer(data['mag']['mx'], data['mag']['my'], data['mag']['mz'],
+                                      timestamp_us)
+    sample_Hz += 1
+
+
+def imu_fifo_task(deadline_ns):
+    """Burst mode: log everything the IMU batched since the last run"""
+    count = IMU_BURST_MAX_RECORDS
+    while count == IMU_BURST_MAX_RECORDS:
+        count = imu_fifo.read_fifo(imu_records, IMU_BURST_MAX_RECORDS)
+        if event_capture:
+            logged = event_capture.feed(imu_records, count, time.monotonic_ns() // 1000)
+            logger.write_imu_burst(event_capture.log_records, logged,
+                                   event_capture.log_interval_us,
+                                   imu_fifo.accel_lsb, imu_fifo.gyro_lsb,
+                                   event_capture.log_timestamp_us)
+        else:
+            logger.write_imu_burst(imu_records, count, imu_fifo.fifo_interval_us,
+                                   imu_fifo.accel_lsb, imu_fifo.gyro_lsb)
+
+
+def event_task(deadline_ns):
+    """Write out a captured g event, one block per run"""
+    return event_capture.service(logger)
+
+
+def esp_task(deadline_ns):
+    """Handle commands from the ESP and write out queued frames in pieces"""
+    return esp_link.process()
+
+
+def esp_telemetry_task(deadline_ns):
+    """Send the latest sample and GPS fix to the ESP"""
+    g = esp_payload['g']
+    accel_data = data['accel']
+    if accel_data:
+        gx, gy, gz = accel_data['gx'], accel_data['gy'], accel_data['gz']
+        g['x'] = gx
+        g['y'] = gy
+        g['z'] = gz
+        g['total'] = math.sqrt(gx * gx + gy * gy + gz * gz)
+    
+    gps = esp_payload['gps']
+    fix = data['gps']
+    gps['lat'] = fix.get('lat', 0.0)
+    gps['lon'] = fix.get('lon', 0.0)
+    gps['alt'] = fix.get('alt', 0.0)
+    gps['speed'] = fix.get('speed', 0.0)
+    gps['sats'] = fix.get('sats', 0)
+    gps['hdop'] = fix.get('hdop', 0.0)
+    gps['fix'] = fix.get('fix', "NoFix")
+    esp_link.send_telemetry(esp_payload)
+    
+    # A restarted ESP may have renegotiated the rate
+    esp_telemetry.period_ns = 1000000000 // esp_link.telemetry_hz
+
+
+def log_service_task(deadline_ns):
+    """Write out a slice of any block waiting to be flushed"""
+    logger.service()
+
+
+def gps_task(deadline_ns):
+    """Drain the GPS UART and log a fix"""
+    global gps_has_fix
+    gps_handler.update()
+    if gps_handler.has_fix():
+        gps_has_fix = True
+        data['gps']['fix'] = gps_handler.fix_type()
+        data['gps']['lat'], data['gps']['lon'], data['gps']['alt'] = gps_handler.get_position()
+        data['gps']['speed'] = gps_handler.get_speed()
+        data['gps']['heading'] = gps_handler.get_heading()
+        data['gps']['hdop'] = gps_handler.get_hdop()
+        data['gps']['sats'] = gps_handler.get_satellites()
+        timestamp_us = time.monotonic_ns() // 1000
+        logger.write_gps(data['gps']['lat'], data['gps']['lon'], data['gps']['alt'], 
+            data['gps']['speed'], data['gps']['heading'], data['gps']['hdop'],
+            timestamp_us)
+        if lap_timer and lap_timer.update(data['gps']['lat'], data['gps']['lon'], timestamp_us):
+            logger.write_lap(lap_timer.event, lap_timer.event_us)
+            if esp_link:
+                esp_link.send_lap(lap_timer.event)
+    else:
+        gps_has_fix = False
+        data['gps'] = {
+            'fix':      "NoFix",
+            'lat':      0.0,
+            'lon':      0.0,
+            'alt':      0.0,
+            'speed':    0.0,
+            'heading':  0.0,
+            'hdop':    25.9,
+            'stats':    0,
+        }
+    data['gps']['has_fix'] = gps_has_fix
+
+
+def telemetry_task(deadline_ns):
+    """Print telemetry to the console"""
+    print(f"[{int(time.monotonic())}s] ", end="")
+    
+    if accel:
+        print("Accel: {:+.2f}g {:+.2f}g {:+.2f}g | ".format(
+            data['accel']['gx'], data['accel']['gy'], data['accel']['gz']), end="")
+    
+    if gyro:
+        print("Gyro: {:+.1f}°/s {:+.1f}°/s {:+.1f}°/s | ".format(
+            data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz']), end="")
+    
+    if mag:
+        print("Mag: {:.0f}° {:.1f}µT | ".format(
+            data['mag']['heading'],data['mag']['field']) , end="")
+    
+    if gps_handler and gps_has_fix:
+        print("GPS: {} sats @{}".format(
+            data['gps']['sats'], data['gps']['hdop']))
+    else:
+        print("GPS: No fix")
+
+
+def gc_task(deadline_ns):
+    gc.collect()
+
+
+def display_task(deadline_ns):
+    """Update the OLED labels in two pieces, the session/SD half is slower"""
+    global display_piece
+    if display_piece == 0:
+        oled_handler.update_gps(data, rtc)
+        display_piece = 1
+        return True
+    oled_handler.update_session(logger, lap_timer)
+    display_piece = 0
+
+
+def display_refresh_task(deadline_ns):
+    """Send whatever labels changed - held back until it fits the frame"""
+    oled_handler.refresh()
+
+
+def pixel_task(deadline_ns):
+    neopixel_handler.update(data)
+
+
+def heartbeat_task(deadline_ns):
+    """Heartbeat LED, 1Hz loop stats and the profile record"""
+    global last_heartbeat, heartbeat_state, loop_Hz, sample_Hz, loop_worst_ms
+    current_time = time.monotonic()
+    heartbeat_length = current_time - last_heartbeat
+    if heartbeat_length >= 1.0:
+        last_heartbeat = current_time
+        hw.heartbeat.value = True
+        stage, stage_us = profiler.worst_stage()
+        misses, deferrals, late_us = scheduler.take_stats()
+        sd_writes, sd_write_us, sd_syncs, sd_sync_us = logger.take_write_stats()
+        print(f"{sample_Hz}Hz sampling, {loop_Hz} passes, worst pass {loop_worst_ms:.1f}ms "
+              f"(slowest stage {stage} {stage_us / 1000:.1f}ms, session {loop_worst_ever_ms:.1f}ms), "
+              f"{misses} missed / {deferrals} deferred, late {late_us / 1000:.1f}ms, "
+              f"SD {sd_writes} writes worst {sd_write_us / 1000:.1f}ms / "
+              f"{sd_syncs} syncs worst {sd_sync_us / 1000:.1f}ms")
+        logger.write_profile(profiler.summary(misses, deferrals))
+        loop_Hz = 0
+        sample_Hz = 0
+        loop_worst_ms = 0
+    elif hw.heartbeat.value:
+        if ((gps_has_fix and heartbeat_length >= 0.8) or 
+            (not gps_has_fix and heartbeat_length >= 0.2)):
+            hw.heartbeat.value = False
+            heartbeat_state = False
+
+
+def housekeeping_task(deadline_ns):
+    """GPS satellite logging (5 min) and RTC sync from GPS (60s)"""
+    global last_gps_log, last_rtc_sync
+    current_time = time.monotonic()
+    
+    if current_time - last_gps_log >= 300:
+        last_gps_log = current_time
+        sat_data = gps_handler.get_satellite_data()
+        if sat_data:
+            print(f"[GPS] {sat_data}")
+    
+    if gps_has_fix and current_time - last_rtc_sync >= 60:
+        last_rtc_sync = current_time
+        if gps_handler.has_time():
+            dt = gps_handler.get_datetime()
+            if dt:
+                hw.set_system_time(dt)
+                print(f"[RTC] Synced from GPS: {hw.get_time_string()}")
+
+
+sample_period_ms = 1000 / config.accel_sample_rate
+
+scheduler = Scheduler(profiler)
+if accel or gyro or mag:
+    scheduler.add("sample", sample_period_ms, sample_task, PRIORITY_SAMPLE, STAGE_LOG)
+if imu_fifo:
+    scheduler.add("imu_fifo", 20, imu_fifo_task, PRIORITY_HIGH, STAGE_IMU_FIFO)
+if gps_handler:
+    scheduler.add("gps", 10, gps_task, PRIORITY_HIGH, STAGE_GPS)
+    scheduler.add("housekeeping", 1000, housekeeping_task, PRIORITY_LOW, STAGE_GPS)
+scheduler.add("log", 10, log_service_task, PRIORITY_LOW, STAGE_LOG)
+if esp_link:
+    scheduler.add("esp", 20, esp_task, PRIORITY_LOW, STAGE_OTHER)
+    esp_telemetry = scheduler.add("esp_telemetry", 1000 / esp_link.telemetry_hz,
+                                  esp_telemetry_task, PRIORITY_LOW, STAGE_OTHER)
+if event_capture:
+    scheduler.add("event", 10, event_task, PRIORITY_LOW, STAGE_LOG)
+scheduler.add("heartbeat", 100, heartbeat_task, PRIORITY_LOW, STAGE_OTHER)
+scheduler.add("telemetry", 1000, telemetry_task, PRIORITY_LOW, STAGE_CONSOLE)
+scheduler.add("gc", 1000, gc_task, PRIORITY_LOW, STAGE_GC)
+if oled_handler:
+    scheduler.add("display", 200, display_task, PRIORITY_LOW, STAGE_DISPLAY)
+    scheduler.add("display_refresh", 200, display_refresh_task, PRIORITY_LOW, STAGE_DISPLAY)
+if neopixel_handler:
+    scheduler.add("pixel", 100, pixel_task, PRIORITY_LOW, STAGE_PIXEL)
+
 print("\n" + "="*60)
 print("Starting main loop...")
-print("  100Hz: Sensor reading + logging")
-print("  5Hz:   Display updates")
-print("  10Hz:  NeoPixel updates")
-print("  1Hz:   Telemetry + heartbeat")
+print(f"  {config.accel_sample_rate}Hz: Sensor reading + logging (time-triggered)")
+print("  100Hz: GPS UART")
+print("  5Hz:   Display updates (deferred around samples)")
+print("  10Hz:  NeoPixel updates (deferred around samples)")
+print("  1Hz:   Telemetry + heartbeat + gc")
+if esp_link:
+    print(f"  {esp_link.telemetry_hz}Hz:  ESP telemetry ({'binary' if esp_link.binary_telemetry else 'JSON'})")
 print("  5min:  GPS satellite logging")
 print("Press Ctrl+C to stop")
 print("="*60 + "\n")
@@ -197,124 +513,15 @@ print("="*60 + "\n")
 
 try:
     while True:
-        current_time = time.monotonic()
-        
-        # 100Hz: Read sensors and log
-        if accel:
-            data['accel']['ax'], data['accel']['ay'], data['accel']['az'], data['accel']['ts'] = accel.read()
-            data['accel']['gx'], data['accel']['gy'], data['accel']['gz'] = accel.get_g_forces()
-            data['accel']['total'] = data['accel']['gx'] + data['accel']['gy']
-            logger.write_accelerometer(data['accel']['gx'], data['accel']['gy'], data['accel']['gz'])
-        
-        if gyro:
-            data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz'] = gyro.read()
-            data['gyro']['ang_vel'] = gyro.get_angular_velocity()
-            logger.write_gyroscope(data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz'])
-        
-        if mag:
-            data['mag']['mx'], data['mag']['my'], data['mag']['mz'] = mag.read()
-            data['mag']['heading'] = mag.get_heading()
-            data['mag']['field'] = mag.get_field_strength()
-            logger.write_magnetometer(data['mag']['mx'], data['mag']['my'], data['mag']['mz'])
-        
-        # Update GPS
-        if gps_handler:
-            gps_handler.update()
-            if gps_handler.has_fix():
-                gps_has_fix = True
-                data['gps']['fix'] = gps_handler.fix_type()
-                data['gps']['lat'], data['gps']['lon'], data['gps']['alt'] = gps_handler.get_position()
-                data['gps']['speed'] = gps_handler.get_speed()
-                data['gps']['heading'] = gps_handler.get_heading()
-                data['gps']['hdop'] = gps_handler.get_hdop()
-                data['gps']['sats'] = gps_handler.get_satellites()
-                logger.write_gps(data['gps']['lat'], data['gps']['lon'], data['gps']['alt'], 
-                    data['gps']['speed'], data['gps']['heading'], data['gps']['hdop'])
-            else:
-                gps_has_fix = False
-                data['gps'] = {
-                    'fix':      "NoFix",
-                    'lat':      0.0,
-                    'lon':      0.0,
-                    'alt':      0.0,
-                    'speed':    0.0,
-                    'heading':  0.0,
-                    'hdop':    25.9,
-                    'stats':    0,
-                }
-            data['gps']['has_fix'] = gps_has_fix
-        
-        # 1Hz: Telemetry
-        if current_time - last_telemetry >= 1.0:
-            last_telemetry = current_time
-            
-            # Print telemetry
-            print(f"[{int(current_time)}s] ", end="")
-            
-            if accel:
-                print("Accel: {:+.2f}g {:+.2f}g {:+.2f}g | ".format(
-                    data['accel']['gx'], data['accel']['gy'], data['accel']['gz']), end="")
-            
-            if gyro:
-                print("Gyro: {:+.1f}°/s {:+.1f}°/s {:+.1f}°/s | ".format(
-                    data['gyro']['gx'], data['gyro']['gy'], data['gyro']['gz']), end="")
-            
-            if mag:
-                heading = mag.get_heading()
-                field = mag.get_field_strength()
-                print("Mag: {:.0f}° {:.1f}µT | ".format(
-                    data['mag']['heading'],data['mag']['field']) , end="")
-            
-            if gps_handler and gps_has_fix:
-                print("GPS: {} sats @{}".format(
-                    data['gps']['sats'], data['gps']['hdop']))
-            else:
-                print("GPS: No fix")
-            
-            gc.collect()
-        
-        # 5Hz: Update display
-        if hw.display and current_time - last_display_update >= 0.2:
-            last_display_update = current_time
-            oled_handler.update(data, logger, rtc)
-            
-        # 10Hz: Update NeoPixel (if available)
-        if hw.neopixel and current_time - last_pixel_update >= 0.1:
-            last_pixel_update = current_time
-            neopixel_handler.update(data)
-        
-        # 1Hz: Heartbeat LED
-        heartbeat_length = current_time - last_heartbeat
-        if heartbeat_length >= 1.0:
-            last_heartbeat = current_time
-            hw.heartbeat.value = True
-            print(f"{loop_Hz}Hz")
-            loop_Hz = 0
-        else:    
-            if hw.heartbeat.value:
-                if ((gps_has_fix and heartbeat_length >= 0.8) or 
-                    (not gps_has_fix and heartbeat_length >= 0.2)):
-                    hw.heartbeat.value = False
-                    heartbeat_state = False
-        
-        # 5 min: Log GPS satellites
-        if gps_handler and current_time - last_gps_log >= 300:
-            last_gps_log = current_time
-            sat_data = gps_handler.get_satellite_data()
-            if sat_data:
-                print(f"[GPS] {sat_data}")
-        
-        # 60s: Sync RTC from GPS
-        if gps_handler and gps_has_fix and current_time - last_rtc_sync >= 60:
-            last_rtc_sync = current_time
-            if gps_handler.has_time():
-                dt = gps_handler.get_datetime()
-                if dt:
-                    hw.set_system_time(dt)
-                    print(f"[RTC] Synced from GPS: {hw.get_time_string()}")
+        loop_ms = scheduler.run_once() / 1000
         
         loop_count += 1
         loop_Hz += 1
+        
+        if loop_ms > loop_worst_ms:
+            loop_worst_ms = loop_ms
+            if loop_ms > loop_worst_ever_ms:
+                loop_worst_ever_ms = loop_ms
 
 except KeyboardInterrupt:
     print("\n\n" + "="*60)
@@ -12,6 +12,10 @@ class Config:
     def __init__(self):
         # Logging format
         self.log_format = self._get('LOG_FORMAT', 'binary').lower()  # 'binary' or 'csv'
+        self.log_compress = self.get_bool('LOG_COMPRESS', False)  # Compressed binary blocks
+        self.log_sync = self._get('LOG_SYNC', 'block').lower()  # 'block', 'interval' or 'event'
+        self.log_sync_interval = self.get_float('LOG_SYNC_INTERVAL', 10.0)  # seconds
+        self.log_preallocate_kb = self.get_int('LOG_PREALLOCATE_KB', 4096)  # per session file
         
         # Session metadata
         self.session_name = self._get('SESSION_NAME', 'Track Day')
@@ -25,6 +29,11 @@ class Config:
         # Thresholds
         self.gforce_event_threshold = self.get_float('GFORCE_EVENT_THRESHOLD', 3.0)
         
+        # Lap timing (see lap_timer.py) - gates are "lat1,lon1,lat2,lon2"
+        self.lap_start_line = self._get('LAP_START_LINE', '')
+        self.lap_sectors = self._get('LAP_SECTORS', '')   # ';' between gates
+        self.lap_min_time = self.get_float('LAP_MIN_TIME', 20.0)  # seconds
+        
         # Display
         self.splash_duration = self.get_float('SPLASH_DURATION', 2.0)  # seconds
         self.oled_brightness = self.get_int('OLED_BRIGHTNESS', 255)
@@ -75,12 +84,19 @@ class Config:
         """Convert config to dictionary"""
         return {
             'log_format': self.log_format,
+            'log_compress': self.log_compress,
+            'log_sync': self.log_sync,
+            'log_sync_interval': self.log_sync_interval,
+            'log_preallocate_kb': self.log_preallocate_kb,
             'session_name': self.session_name,
             'driver_name': self.driver_name,
             'vehicle_id': self.vehicle_id,
             'accel_sample_rate': self.accel_sample_rate,
             'gps_update_rate': self.gps_update_rate,
             'gforce_event_threshold': self.gforce_event_threshold,
+            'lap_start_line': self.lap_start_line,
+            'lap_sectors': self.lap_sectors,
+            'lap_min_time': self.lap_min_time,
             'splash_duration': self.splash_duration,
             'oled_brightness': self.oled_brightness,
             'neopixel_brightness': self.neopixel_brightness,
@@ -0,0 +1,507 @@
+/**
+ * bridge.cpp - Pico link protocol for the ESP-01S bridge (see bridge.h)
+ */
+
+#include "bridge.h"
+
+TelemetryData telemetry;
+LapState lapState;
+std::vector<SatelliteData> satellites;
+unsigned long last_sat_update = 0;
+
+const char* const MESSAGE_KIND_NAMES[MSG_KINDS] = {
+    "update", "satellites", "files", "file_transfer", "reply", "lap", "other"
+};
+
+ParseStats parseStats[MSG_KINDS] = {};
+uint32_t parseErrors = 0;
+
+char rxBuffer[RX_BUFFER_SIZE];
+size_t rxStart = 0;          // First byte of the line being framed
+size_t rxScan = 0;           // Next byte to check for '\n'
+size_t rxEnd = 0;            // One past the last byte received
+bool rxDiscarding = false;   // Dropping the tail of an oversized line
+bool rxLineCorrupt = false;  // Current line contains control bytes
+bool rxLineBinary = false;   // Current line is a binary frame
+
+SerialStats serialStats = {0, 0, 0, 0};
+FrameStats frameStats = {0, 0, 0};
+uint16_t lastTelemetrySeq = 0;
+
+bool makeRxSpace();
+void frameRxLines();
+MessageKind messageKind(const char* type);
+void handleTelemetryFrame(const uint8_t* data, size_t len);
+void handleLapFrame(const uint8_t* data, size_t len);
+void updateLap(uint8_t kind, uint8_t gate, uint16_t lap, uint32_t split_us,
+               uint32_t lap_us, int32_t delta_us);
+void handleTelemetryUpdate(JsonDocument& doc);
+void handleSatelliteUpdate(JsonDocument& doc, const char* line, size_t len);
+
+// ============================================================================
+// Serial Communication
+// ============================================================================
+
+void processSerialData() {
+    int avail;
+    while ((avail = bridgeUart.available()) > 0) {
+        if (rxEnd == RX_BUFFER_SIZE && !makeRxSpace()) {
+            break;
+        }
+        
+        size_t want = min((size_t)avail, min(RX_BUFFER_SIZE - rxEnd, RX_READ_CHUNK));
+        size_t got = bridgeUart.readBytes(rxBuffer + rxEnd, want);
+        if (got == 0) {
+            break;
+        }
+        
+        rxEnd += got;
+        serialStats.rx_bytes += got;
+        frameRxLines();
+    }
+}
+
+void resetSerialFramer() {
+    rxStart = rxScan = rxEnd = 0;
+    rxDiscarding = false;
+    rxLineCorrupt = false;
+    rxLineBinary = false;
+}
+
+bool makeRxSpace() {
+    if (rxStart > 0) {
+        // Slide the partial line to the front of the buffer
+        size_t pending = rxEnd - rxStart;
+        memmove(rxBuffer, rxBuffer + rxStart, pending);
+        rxScan -= rxStart;
+        rxEnd = pending;
+        rxStart = 0;
+        return true;
+    }
+    
+    // One line fills the whole buffer - drop it up to the next '\n'
+    if (!rxDiscarding) {
+        serialStats.overruns++;
+    }
+    rxDiscarding = true;
+    rxStart = rxScan = rxEnd = 0;
+    return true;
+}
+
+void frameRxLines() {
+    while (rxScan < rxEnd) {
+        char c = rxBuffer[rxScan];
+        
+        if (c == '\n') {
+            size_t len = rxScan - rxStart;
+            
+            if (rxDiscarding || rxLineCorrupt) {
+                serialStats.discarded_lines++;
+            } else if (rxLineBinary) {
+                processBinaryFrame((uint8_t*)rxBuffer + rxStart + 1, len - 1);
+            } else {
+                if (len > 0 && rxBuffer[rxScan - 1] == '\r') {
+                    len--;
+                }
+                rxBuffer[rxStart + len] = '\0';
+                
+                if (len > 0) {
+                    serialStats.lines++;
+                    processJSONMessage(rxBuffer + rxStart, len);
+                }
+            }
+            
+            rxDiscarding = false;
+            rxLineCorrupt = false;
+            rxLineBinary = false;
+            rxStart = ++rxScan;
+        } else {
+            if (rxScan == rxStart && c == 0) {
+                // Leading 0x00 marks a binary frame
+                rxLineBinary = true;
+            } else if (!rxLineBinary && (uint8_t)c < 32 && c != '\r' && c != '\t') {
+                // Control bytes mean line noise; UTF-8 (>= 0x80) is allowed through
+                rxLineCorrupt = true;
+            }
+            rxScan++;
+        }
+    }
+    
+    if (rxStart == rxEnd) {
+        // Everything consumed - rewind so the next read starts at the front
+        rxStart = rxScan = rxEnd = 0;
+    }
+}
+
+MessageKind messageKind(const char* type) {
+    if (strcmp(type, "update") == 0) {
+        return MSG_UPDATE;
+    }
+    if (strcmp(type, "satellites") == 0) {
+        return MSG_SATELLITES;
+    }
+    if (strcmp(type, "files") == 0) {
+        return MSG_FILES;
+    }
+    if (strcmp(type, "file_start") == 0 || strcmp(type, "file_chunk") == 0 ||
+        strcmp(type, "file_end") == 0 || strcmp(type, "file_error") == 0) {
+        return MSG_FILE_TRANSFER;
+    }
+    if (strcmp(type, "ok") == 0 || strcmp(type, "error") == 0) {
+        return MSG_REPLY;
+    }
+    if (strcmp(type, "lap") == 0) {
+        return MSG_LAP;
+    }
+    return MSG_OTHER;
+}
+
+void processJSONMessage(const char* line, size_t len) {
+    StaticJsonDocument<2048> doc;
+    uint32_t start = micros();
+    DeserializationError error = deserializeJson(doc, line, len);
+    uint32_t elapsed = micros() - start;
+    
+    if (error) {
+        // Don't spam errors, just drop bad packets
+        parseErrors++;
+        return;
+    }
+    
+    MessageKind kind = messageKind(doc["type"] | "");
+    
+    ParseStats& stats = parseStats[kind];
+    stats.count++;
+    stats.total_us += elapsed;
+    stats.max_us = max(stats.max_us, elapsed);
+    
+    switch (kind) {
+        case MSG_UPDATE:
+            handleTelemetryUpdate(doc);
+            break;
+        case MSG_SATELLITES:
+            handleSatelliteUpdate(doc, line, len);
+            break;
+        case MSG_FILES:
+            handleFileList(doc, line, len);
+            break;
+        case MSG_FILE_TRANSFER:
+            handleFileTransfer(doc, line, len);
+            break;
+        case MSG_REPLY:
+            handleResponse(doc, line, len);
+            break;
+        case MSG_LAP:
+            updateLap(doc["kind"] | 0, doc["gate"] | 0, doc["lap"] | 0,
+                      doc["split_us"] | 0, doc["lap_us"] | 0,
+                      doc["delta_us"].isNull() ? LAP_NO_DELTA : (int32_t)(doc["delta_us"] | 0));
+            break;
+        default:
+            break;
+    }
+}
+
+uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Decode a COBS block in place; returns the decoded length or 0 if malformed
+size_t cobsDecode(uint8_t* buf, size_t len) {
+    size_t in = 0;
+    size_t out = 0;
+    
+    while (in < len) {
+        uint8_t code = buf[in++];
+        if (code == 0) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (in >= len) {
+                return 0;
+            }
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xFF && in < len) {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+void processBinaryFrame(uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] ^= FRAME_DELIMITER;
+    }
+    
+    size_t n = cobsDecode(data, len);
+    if (n < 3) {
+        frameStats.bad_frames++;
+        return;
+    }
+    
+    n -= 2;
+    uint16_t crc = data[n] | (data[n + 1] << 8);
+    if (crc16(data, n) != crc) {
+        frameStats.bad_frames++;
+        return;
+    }
+    
+    frameStats.frames++;
+    
+    switch (data[0]) {
+        case FRAME_TYPE_TELEMETRY:
+            handleTelemetryFrame(data, n);
+            break;
+        case FRAME_TYPE_FILE_DATA:
+            handleFileDataFrame(data, n);
+            break;
+        case FRAME_TYPE_LAP:
+            handleLapFrame(data, n);
+            break;
+        default:
+            break;
+    }
+}
+
+void handleTelemetryFrame(const uint8_t* data, size_t len) {
+    if (len != sizeof(TelemetryFrame)) {
+        frameStats.bad_frames++;
+        return;
+    }
+    
+    TelemetryFrame frame;
+    memcpy(&frame, data, sizeof(frame));
+    
+    if (telemetry.valid && frame.seq != (uint16_t)(lastTelemetrySeq + 1)) {
+        frameStats.lost_frames += (uint16_t)(frame.seq - lastTelemetrySeq - 1);
+    }
+    lastTelemetrySeq = frame.seq;
+    
+    telemetry.valid = true;
+    telemetry.gx = frame.gx;
+    telemetry.gy = frame.gy;
+    telemetry.gz = frame.gz;
+    telemetry.g_total = frame.g_total;
+    
+    telemetry.lat = frame.lat;
+    telemetry.lon = frame.lon;
+    telemetry.alt = frame.alt;
+    telemetry.speed = frame.speed;
+    telemetry.sats = frame.sats;
+    telemetry.hdop = frame.hdop;
+    telemetry.fix = frame.fix;
+    
+    telemetry.last_update = millis();
+    telemetryUpdated();
+}
+
+void handleLapFrame(const uint8_t* data, size_t len) {
+    if (len != sizeof(LapFrame)) {
+        frameStats.bad_frames++;
+        return;
+    }
+    
+    LapFrame frame;
+    memcpy(&frame, data, sizeof(frame));
+    updateLap(frame.kind, frame.gate, frame.lap, frame.split_us, frame.lap_us, frame.delta_us);
+}
+
+// Lap events are rare (one per gate crossing), so they go straight to every
+// client as JSON rather than through the subscriber slots
+void updateLap(uint8_t kind, uint8_t gate, uint16_t lap, uint32_t split_us,
+               uint32_t lap_us, int32_t delta_us) {
+    lapState.timing = true;
+    lapState.kind = kind;
+    lapState.gate = gate;
+    lapState.lap = lap;
+    lapState.split_us = split_us;
+    lapState.lap_us = lap_us;
+    lapState.has_delta = delta_us != LAP_NO_DELTA;
+    lapState.delta_us = lapState.has_delta ? delta_us : 0;
+    if (kind == LAP_EVENT_LAP) {
+        lapState.last_lap_us = lap_us;
+        if (!lapState.best_lap_us || lap_us < lapState.best_lap_us) {
+            lapState.best_lap_us = lap_us;
+        }
+    }
+    lapState.last_update = millis();
+    
+    StaticJsonDocument<256> doc;
+    doc["type"] = "lap";
+    fillLap(doc.createNestedObject("data"));
+    char line[256];
+    size_t len = serializeJson(doc, line, sizeof(line));
+    ws.textAll(line, len);
+}
+
+void fillLap(JsonObject data) {
+    data["kind"] = lapState.kind;
+    data["gate"] = lapState.gate;
+    data["lap"] = lapState.lap;
+    data["split_us"] = lapState.split_us;
+    data["lap_us"] = lapState.lap_us;
+    if (lapState.has_delta) {
+        data["delta_us"] = lapState.delta_us;
+    } else {
+        data["delta_us"] = nullptr;
+    }
+    data["last_lap_us"] = lapState.last_lap_us;
+    data["best_lap_us"] = lapState.best_lap_us;
+    data["age_ms"] = (long)(millis() - lapState.last_update);
+}
+
+void handleTelemetryUpdate(JsonDocument& doc) {
+    JsonObject data = doc["data"];
+    
+    telemetry.valid = true;
+    telemetry.gx = data["g"]["x"];
+    telemetry.gy = data["g"]["y"];
+    telemetry.gz = data["g"]["z"];
+    telemetry.g_total = data["g"]["total"];
+    
+    telemetry.lat = data["gps"]["lat"];
+    telemetry.lon = data["gps"]["lon"];
+    telemetry.alt = data["gps"]["alt"];
+    telemetry.speed = data["gps"]["speed"];
+    telemetry.sats = data["gps"]["sats"];
+    telemetry.hdop = data["gps"]["hdop"];
+    telemetry.fix = parseFixType(data["gps"]["fix"] | "NoFix");
+    
+    telemetry.last_update = millis();
+    telemetryUpdated();
+}
+
+void handleSatelliteUpdate(JsonDocument& doc, const char* line, size_t len) {
+    satellites.clear();
+    
+    JsonArray sats = doc["satellites"];
+    for (JsonObject sat : sats) {
+        SatelliteData sd;
+        sd.id = sat["id"];
+        sd.elevation = sat["elevation"];
+        sd.azimuth = sat["azimuth"];
+        sd.snr = sat["snr"];
+        satellites.push_back(sd);
+    }
+    
+    last_sat_update = millis();
+    ws.textAll(line, len);
+}
+
+// ============================================================================
+// JSON Generators
+// ============================================================================
+
+uint8_t parseFixType(const char* fix) {
+    if (strcasecmp(fix, "3d") == 0) {
+        return FIX_3D;
+    }
+    if (strcasecmp(fix, "2d") == 0) {
+        return FIX_2D;
+    }
+    return FIX_NONE;
+}
+
+const char* fixTypeName(uint8_t fix) {
+    switch (fix) {
+        case FIX_3D: return "3D";
+        case FIX_2D: return "2D";
+        default:     return "NoFix";
+    }
+}
+
+void fillTelemetry(JsonObject data) {
+    JsonObject g = data.createNestedObject("g");
+    g["x"] = telemetry.gx;
+    g["y"] = telemetry.gy;
+    g["z"] = telemetry.gz;
+    g["total"] = telemetry.g_total;
+    
+    JsonObject gps = data.createNestedObject("gps");
+    gps["fix"] = fixTypeName(telemetry.fix);
+    gps["lat"] = telemetry.lat;
+    gps["lon"] = telemetry.lon;
+    gps["alt"] = telemetry.alt;
+    gps["speed"] = telemetry.speed;
+    gps["sats"] = telemetry.sats;
+    gps["hdop"] = telemetry.hdop;
+}
+
+// Same shape as the Pico's JSON "update" line, so the page needs no changes
+size_t formatTelemetryUpdate(char* out, size_t size) {
+    StaticJsonDocument<512> doc;
+    doc["type"] = "update";
+    fillTelemetry(doc.createNestedObject("data"));
+    
+    // A result that fills the buffer may have been truncated
+    size_t n = serializeJson(doc, out, size);
+    return n < size - 1 ? n : 0;
+}
+
+// ms since the Pico last sent telemetry, -1 if it never has
+long telemetryAge() {
+    return telemetry.valid ? (long)(millis() - telemetry.last_update) : -1;
+}
+
+// Shape web/app.js expects: speed in knots, fix_quality as NMEA GGA
+void fillLive(JsonObject data) {
+    data["valid"] = telemetry.valid;
+    data["age_ms"] = telemetryAge();
+    
+    JsonObject accel = data.createNestedObject("accel");
+    accel["gx"] = telemetry.gx;
+    accel["gy"] = telemetry.gy;
+    accel["gz"] = telemetry.gz;
+    accel["g_total"] = telemetry.g_total;
+    
+    JsonObject gps = data.createNestedObject("gps");
+    gps["lat"] = telemetry.lat;
+    gps["lon"] = telemetry.lon;
+    gps["alt"] = telemetry.alt;
+    gps["speed"] = telemetry.speed / 1.15078f;
+    gps["heading"] = 0;    // Not in the telemetry stream
+    gps["satellites"] = telemetry.sats;
+    gps["fix_quality"] = telemetry.fix != FIX_NONE ? 1 : 0;
+    gps["hdop"] = telemetry.hdop;
+    
+    JsonObject system = data.createNestedObject("system");
+    system["uptime"] = millis() / 1000;
+    system["time_source"] = telemetry.fix != FIX_NONE ? "GPS" : "RTC";
+    
+    if (lapState.timing) {
+        fillLap(data.createNestedObject("lap"));
+    }
+}
+
+void fillGPS(JsonObject data) {
+    data["age_ms"] = telemetryAge();
+    data["fix"] = fixTypeName(telemetry.fix);
+    data["lat"] = telemetry.lat;
+    data["lon"] = telemetry.lon;
+    data["alt"] = telemetry.alt;
+    data["speed"] = telemetry.speed;
+    data["sats"] = telemetry.sats;
+    data["hdop"] = telemetry.hdop;
+}
+
+void fillSatellites(JsonObject data) {
+    data["count"] = satellites.size();
+    data["last_update"] = last_sat_update;
+    data["sat_age_ms"] = last_sat_update ? (long)(millis() - last_sat_update) : -1;
+    
+    JsonArray sats = data.createNestedArray("satellites");
+    for (const SatelliteData& sat : satellites) {
+        JsonObject obj = sats.createNestedObject();
+        obj["id"] = sat.id;
+        obj["elevation"] = sat.elevation;
+        obj["azimuth"] = sat.azimuth;
+        obj["snr"] = sat.snr;
+    }
+}
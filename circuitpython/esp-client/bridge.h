@@ -0,0 +1,201 @@
+/**
+ * bridge.h - Pico link protocol for the ESP-01S bridge
+ *
+ * Everything between the Pico's UART and the web side: the line framer,
+ * JSON and binary message decoding, the telemetry, satellite and lap state
+ * it updates, and the JSON generators that read that state. Nothing here
+ * touches WiFi or the web server, so host/ can build it natively and
+ * benchmark it against recorded Pico traffic.
+ *
+ * Platform interface: the sketch binds bridgeUart to PicoSerial, owns the
+ * AsyncWebSocket `ws` and implements the hooks at the end of this file;
+ * host/ supplies mocks of all three.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+// ============================================================================
+// Telemetry State
+// ============================================================================
+
+// GPS fix codes (same values the Pico packs into binary frames)
+#define FIX_NONE 0
+#define FIX_2D 2
+#define FIX_3D 3
+
+struct TelemetryData {
+    bool valid = false;
+    float gx, gy, gz, g_total;
+    float lat, lon, alt, speed;
+    int sats;
+    float hdop;
+    uint8_t fix = FIX_NONE;
+    unsigned long last_update = 0;
+};
+
+// Latest lap timer event from the Pico (lap_timer.py), for /api/live and
+// the WebSocket clients
+struct LapState {
+    bool timing = false;
+    uint8_t kind = 0;          // 1 start, 2 sector, 3 lap
+    uint8_t gate = 0;          // 0 = start/finish
+    uint16_t lap = 0;
+    uint32_t split_us = 0;
+    uint32_t lap_us = 0;
+    int32_t delta_us = 0;
+    bool has_delta = false;
+    uint32_t last_lap_us = 0;
+    uint32_t best_lap_us = 0;
+    unsigned long last_update = 0;
+};
+
+struct SatelliteData {
+    int id;
+    int elevation;
+    int azimuth;
+    int snr;
+};
+
+extern TelemetryData telemetry;
+extern LapState lapState;
+extern std::vector<SatelliteData> satellites;
+extern unsigned long last_sat_update;
+
+// ============================================================================
+// Message Parsing
+// ============================================================================
+
+enum MessageKind {
+    MSG_UPDATE,
+    MSG_SATELLITES,
+    MSG_FILES,
+    MSG_FILE_TRANSFER,
+    MSG_REPLY,
+    MSG_LAP,
+    MSG_OTHER,
+    MSG_KINDS
+};
+
+extern const char* const MESSAGE_KIND_NAMES[MSG_KINDS];
+
+struct ParseStats {
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+};
+
+// Parse cost per message type, reported by /api/metrics
+extern ParseStats parseStats[MSG_KINDS];
+extern uint32_t parseErrors;
+
+// ============================================================================
+// UART Line Framer
+// ============================================================================
+
+// Lines from the Pico are framed in place inside one fixed buffer: bytes are
+// drained from PicoSerial in bulk, each '\n' is replaced with '\0' and the
+// line is handed to the parser as a pointer/length view. Nothing is allocated
+// per byte, so the heap stays unfragmented during long sessions.
+
+const size_t RX_BUFFER_SIZE = 4096;  // Longest line we accept
+const size_t RX_READ_CHUNK = 256;    // Max bytes pulled per readBytes()
+
+struct SerialStats {
+    uint32_t rx_bytes;
+    uint32_t lines;            // Lines handed to the parser
+    uint32_t overruns;         // Lines longer than RX_BUFFER_SIZE
+    uint32_t discarded_lines;  // Overrun or corrupt lines dropped
+};
+
+// ============================================================================
+// Binary Frames
+// ============================================================================
+
+// When the Pico accepts the "bin_telemetry" capability advertised in
+// esp_ready, telemetry arrives as binary frames instead of JSON lines:
+//
+//   0x00 | COBS(payload + CRC16) ^ 0x0A ... | '\n'
+//
+// COBS removes every 0x00 from the payload and the XOR then maps the
+// encoded bytes away from '\n', so binary frames end at a newline exactly
+// like JSON lines and the framer resyncs on every line. The leading 0x00
+// can never start a JSON line. CRC16 is CCITT (0x1021, init 0xFFFF).
+
+#define FRAME_DELIMITER '\n'
+#define FRAME_TYPE_TELEMETRY 0x01
+#define FRAME_TYPE_FILE_DATA 0x02
+#define FRAME_TYPE_LAP 0x04
+
+struct __attribute__((packed)) TelemetryFrame {
+    uint8_t frame_type;
+    uint16_t seq;
+    float gx, gy, gz, g_total;
+    float lat, lon, alt, speed;
+    uint8_t sats;
+    float hdop;
+    uint8_t fix;
+};
+
+// LAP_FORMAT record as logged by the Pico
+#define LAP_EVENT_LAP 3
+#define LAP_NO_DELTA INT32_MIN
+
+struct __attribute__((packed)) LapFrame {
+    uint8_t frame_type;
+    uint8_t kind;
+    uint8_t gate;
+    uint16_t lap;
+    uint32_t split_us;
+    uint32_t lap_us;
+    int32_t delta_us;
+};
+
+struct FrameStats {
+    uint32_t frames;       // Binary frames decoded
+    uint32_t bad_frames;   // COBS/CRC/length failures
+    uint32_t lost_frames;  // Gaps in the telemetry sequence
+};
+
+extern char rxBuffer[RX_BUFFER_SIZE];
+extern SerialStats serialStats;
+extern FrameStats frameStats;
+
+// ============================================================================
+// Platform Interface
+// ============================================================================
+
+extern Stream& bridgeUart;     // UART from the Pico
+extern AsyncWebSocket ws;      // Satellite, lap and unclaimed replies go to all clients
+
+// Hooks the platform implements
+void telemetryUpdated();       // After every telemetry update
+void handleFileList(JsonDocument& doc, const char* line, size_t len);
+void handleFileTransfer(JsonDocument& doc, const char* line, size_t len);
+void handleResponse(JsonDocument& doc, const char* line, size_t len);
+void handleFileDataFrame(const uint8_t* data, size_t len);
+
+// ============================================================================
+// Protocol
+// ============================================================================
+
+void processSerialData();      // Drain bridgeUart and handle every complete line
+void resetSerialFramer();
+void processJSONMessage(const char* line, size_t len);
+void processBinaryFrame(uint8_t* data, size_t len);
+uint16_t crc16(const uint8_t* data, size_t len);
+size_t cobsDecode(uint8_t* buf, size_t len);
+
+uint8_t parseFixType(const char* fix);
+const char* fixTypeName(uint8_t fix);
+long telemetryAge();
+void fillTelemetry(JsonObject data);
+size_t formatTelemetryUpdate(char* out, size_t size);
+void fillLive(JsonObject data);
+void fillGPS(JsonObject data);
+void fillSatellites(JsonObject data);
+void fillLap(JsonObject data);
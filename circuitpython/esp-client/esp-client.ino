@@ -14,6 +14,19 @@
 #include <ESPAsyncWebServer.h>
 #include <ESPAsyncTCP.h>
 #include <ArduinoJson.h>
+#include <time.h>
+
+// Pico link protocol, shared with the host build in host/
+#include "bridge.h"
+
+// .opl block layout, shared with the native tools (tools/opl-dump.cpp)
+#include "opl_codec.h"
+
+// Full web UI, gzipped into flash by tools/prepare_web_assets_esp.py.
+// Without it the built-in page below is served at "/".
+#if __has_include("web_assets.h")
+#include "web_assets.h"
+#endif
 
 // ============================================================================
 // UART Configuration
@@ -29,6 +42,13 @@
 #define PicoSerial Serial  // Use hardware UART (GPIO1=TX, GPIO3=RX)
 #define UART_BAUD 115200    // Fast and reliable!
 
+// Telemetry rate asked of the Pico in esp_ready (binary frames). The
+// history ring samples at HISTORY_RATE_HZ, so this only needs to be higher
+// for WebSocket clients subscribed above it.
+#define PICO_TELEMETRY_HZ 10
+
+Stream& bridgeUart = PicoSerial;
+
 // ============================================================================
 // WiFi Configuration
 // ============================================================================
@@ -36,9 +56,42 @@
 const char* ssid = "OpenPonyLogger";
 const char* password = "mustanggt";
 
-IPAddress local_IP(192, 168, 4, 2);
-IPAddress gateway(192, 168, 4, 1);
-IPAddress subnet(255, 255, 255, 0);
+// Address of the AP itself (the one the README gives); the station side
+// of the uplink gets its address, gateway and DNS from DHCP
+IPAddress apIP(192, 168, 4, 1);
+IPAddress apSubnet(255, 255, 255, 0);
+
+// Optional uplink: with UPLINK_SSID and UPLINK_HOST set the ESP runs
+// AP+STA, joins this network (paddock WiFi, phone hotspot) and forwards
+// positions to a Traccar server - see "Uplink" below. Without both the
+// uplink is compiled out and costs no RAM.
+#ifndef UPLINK_ENABLED
+#if defined(UPLINK_SSID) && defined(UPLINK_HOST)
+#define UPLINK_ENABLED 1
+#else
+#define UPLINK_ENABLED 0
+#endif
+#endif
+#ifndef UPLINK_SSID
+#define UPLINK_SSID ""
+#endif
+#ifndef UPLINK_PASSWORD
+#define UPLINK_PASSWORD ""
+#endif
+#ifndef UPLINK_HOST
+#define UPLINK_HOST ""
+#endif
+#ifndef UPLINK_PORT
+#define UPLINK_PORT 5055             // Traccar OsmAnd protocol
+#endif
+#ifndef UPLINK_DEVICE_ID
+#define UPLINK_DEVICE_ID "openponylogger"
+#endif
+#ifndef UPLINK_NTP_SERVER
+#define UPLINK_NTP_SERVER "pool.ntp.org"
+#endif
+static_assert(!UPLINK_ENABLED || (sizeof(UPLINK_SSID) > 1 && sizeof(UPLINK_HOST) > 1),
+              "UPLINK_ENABLED needs UPLINK_SSID and UPLINK_HOST");
 
 // ============================================================================
 // Web Server
@@ -48,30 +101,82 @@ AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 
 // ============================================================================
-// Data Storage
+// REST Snapshots
+// ============================================================================
+
+// /api/live, /api/status, /api/gps (and the older /api/telemetry and
+// /api/satellites) are answered from the cached state above - no UART
+// round trip per request. Each body is serialised into a buffer owned by
+// its response and freed with it, so any number of responses can be
+// streaming at once.
+//
+// The Pico only sends satellites when asked, so while anyone is polling
+// for them loop() asks once per SAT_REFRESH_MS however many clients there
+// are, and stops SAT_DEMAND_MS after the last request.
+
+#define SAT_REFRESH_MS 5000
+#define SAT_DEMAND_MS 30000
+
+unsigned long lastSatDemandMs = 0;
+unsigned long lastSatRequestMs = 0;
+bool satDemand = false;
+
+// ============================================================================
+// Pico Requests
 // ============================================================================
 
-struct TelemetryData {
-    bool valid = false;
-    float gx, gy, gz, g_total;
-    float lat, lon, alt, speed;
-    int sats;
-    float hdop;
-    String fix_type;
-    unsigned long last_update = 0;
+// HTTP commands for the Pico (LIST, DELETE, START/STOP_SESSION) carry an
+// "id" and the Pico echoes it in its ok/error/files reply. The request is
+// parked in a pending slot and answered when that reply arrives, or with
+// 504 after PENDING_TIMEOUT_MS - no handler waits on the UART, and the
+// Pico works through queued commands in order. Replies without a pending
+// id (commands sent over the WebSocket, late replies) are broadcast to
+// WebSocket clients as before.
+
+#define MAX_PENDING 4
+#define PENDING_TIMEOUT_MS 3000
+
+struct PendingRequest {
+    uint16_t id;                     // 0 = slot free
+    AsyncWebServerRequest* request;
+    unsigned long sent_ms;
 };
 
-TelemetryData telemetry;
+PendingRequest pending[MAX_PENDING];
+uint16_t nextRequestId = 1;
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+// USB serial is taken by the Pico link, so /api/metrics is the only window
+// into the bridge. Everything here is a plain fixed-size counter bumped on
+// the hot path (loop() and the async callbacks all run on the one core, so
+// no locking is needed); rates and heap figures are worked out when the
+// endpoint is read, or once a second for the UART rates.
+//
+// Loop latency is the time between successive loop() calls, including the
+// WiFi stack's share, in power-of-two buckets: <1ms, <2ms, ... <128ms, more.
 
-struct SatelliteData {
-    int id;
-    int elevation;
-    int azimuth;
-    int snr;
+#define LOOP_HIST_BUCKETS 9
+#define METRICS_RATE_MS 1000
+
+struct Metrics {
+    uint32_t loop_hist[LOOP_HIST_BUCKETS];
+    uint32_t loop_max_us;
+    uint32_t last_loop_us;
+    
+    // UART rates over the last METRICS_RATE_MS
+    uint32_t rx_bytes_per_s;
+    uint32_t lines_per_s;
+    uint32_t frames_per_s;
+    uint32_t last_rx_bytes;
+    uint32_t last_lines;
+    uint32_t last_frames;
+    unsigned long last_rate_ms;
 };
 
-std::vector<SatelliteData> satellites;
-unsigned long last_sat_update = 0;
+Metrics metrics = {};
 // ============================================================================
 // HTML Page - Chunked for ESP-01S Memory Limits
 // ============================================================================
@@ -259,10 +364,12 @@ const char HTML_FILES[] PROGMEM = R"rawliteral(
         <div id="files" class="tab-content">
             <div class="card">
                 <h2>Session Files</h2>
-                <button onclick="refreshFiles()">Refresh</button>
+                <button onclick="fileOffsets=[0];refreshFiles()">Refresh</button>
                 <ul class="file-list" id="file-list">
                     <li>Loading...</li>
                 </ul>
+                <button class="secondary" id="files-newer" onclick="newerFiles()" disabled>Newer</button>
+                <button class="secondary" id="files-older" onclick="olderFiles()" disabled>Older</button>
             </div>
         </div>
 )rawliteral";
@@ -290,19 +397,22 @@ const char HTML_CONTROL[] PROGMEM = R"rawliteral(
 const char HTML_JAVASCRIPT[] PROGMEM = R"rawliteral(
     <script>
 let ws;let satellites=[];function init(){connectWebSocket();refreshFiles();drawSatelliteSky()}
-function connectWebSocket(){ws=new WebSocket('ws://'+location.hostname+'/ws');ws.onopen=()=>console.log('Connected');ws.onmessage=(e)=>{try{const data=JSON.parse(e.data);handleMessage(data)}catch(err){console.error(err)}};ws.onclose=()=>setTimeout(connectWebSocket,2000)}
+function connectWebSocket(){ws=new WebSocket('ws://'+location.hostname+'/ws');ws.onopen=()=>ws.send(JSON.stringify({cmd:'subscribe',rate:10}));ws.onmessage=(e)=>{if(typeof e.data!=='string')return;try{const data=JSON.parse(e.data);handleMessage(data)}catch(err){console.error(err)}};ws.onclose=()=>setTimeout(connectWebSocket,2000)}
 function handleMessage(data){if(data.type==='update')updateTelemetry(data.data);else if(data.type==='satellites')updateSatellites(data);else if(data.type==='files')displayFiles(data.files);}
 function updateTelemetry(d){document.getElementById('gx').textContent=d.g.x.toFixed(2)+'g';document.getElementById('gy').textContent=d.g.y.toFixed(2)+'g';document.getElementById('gz').textContent=d.g.z.toFixed(2)+'g';document.getElementById('g-total').textContent=d.g.total.toFixed(2)+'g';document.getElementById('gps-fix').textContent=d.gps.fix;document.getElementById('gps-sats').textContent=d.gps.sats;document.getElementById('gps-speed').textContent=d.gps.speed.toFixed(1);document.getElementById('gps-hdop').textContent=d.gps.hdop.toFixed(1);document.getElementById('gps-lat').textContent=d.gps.lat.toFixed(6);document.getElementById('gps-lon').textContent=d.gps.lon.toFixed(6)}
 function updateSatellites(data){satellites=data.satellites;document.getElementById('sat-update').textContent=new Date().toLocaleTimeString();drawSatelliteSky()}
 function drawSatelliteSky(){const canvas=document.getElementById('satellite-sky');const ctx=canvas.getContext('2d');const size=Math.min(canvas.width,canvas.height);const cx=size/2,cy=size/2,r=size/2-20;ctx.fillStyle='#0a0a0a';ctx.fillRect(0,0,size,size);ctx.strokeStyle='#333';ctx.lineWidth=1;for(let i=1;i<=3;i++){ctx.beginPath();ctx.arc(cx,cy,r*i/3,0,Math.PI*2);ctx.stroke()}
 ctx.fillStyle='#fff';ctx.font='16px sans-serif';ctx.textAlign='center';ctx.fillText('N',cx,cy-r-10);ctx.fillText('S',cx,cy+r+20);satellites.forEach(sat=>{const angle=(sat.azimuth-90)*Math.PI/180;const dist=r*(1-sat.elevation/90);const x=cx+dist*Math.cos(angle);const y=cy+dist*Math.sin(angle);ctx.fillStyle=sat.snr>35?'#4caf50':sat.snr>25?'#ffc107':'#f44336';ctx.beginPath();ctx.arc(x,y,6,0,Math.PI*2);ctx.fill();ctx.fillStyle='#fff';ctx.font='10px sans-serif';ctx.fillText(sat.id,x,y-10)})}
-function refreshFiles(){fetch('/api/files');document.getElementById('file-list').innerHTML='<li>Loading...</li>'}
+let fileOffsets=[0],filesNext;
+function refreshFiles(){const offset=fileOffsets[fileOffsets.length-1];document.getElementById('file-list').innerHTML='<li>Loading...</li>';fetch('/api/files?offset='+offset).then(r=>r.json()).then(d=>{filesNext=d.next;document.getElementById('files-older').disabled=d.next===undefined;document.getElementById('files-newer').disabled=fileOffsets.length<2;displayFiles(d.files||[])}).catch(()=>{})}
+function olderFiles(){if(filesNext!==undefined){fileOffsets.push(filesNext);refreshFiles()}}
+function newerFiles(){if(fileOffsets.length>1){fileOffsets.pop();refreshFiles()}}
 function displayFiles(files){const list=document.getElementById('file-list');if(files.length===0){list.innerHTML='<li>No files</li>';return}
 list.innerHTML=files.map(f=>`
                 <li class="file-item">
                     <div class="file-info">
                         <strong>${f.file}</strong><br>
-                        <small>Driver: ${f.driver} | VIN: ${f.vin}</small>
+                        <small>Driver: ${f.driver} | VIN: ${f.vin}${f.open?' | Recording':` | ${Math.round(f.size/1024)} KB | ${f.samples} samples | ${f.peak_g}g peak`}</small>
                     </div>
                     <div class="file-actions">
                         <button class="secondary" onclick="window.location='/api/download?file=${f.file}'">Download</button>
@@ -310,9 +420,9 @@ list.innerHTML=files.map(f=>`
                     </div>
                 </li>
             `).join('')}
-function deleteFile(fn){if(!confirm('Delete '+fn+'?'))return;fetch('/api/delete?file='+fn,{method:'DELETE'}).then(()=>setTimeout(refreshFiles,500))}
-function startSession(){const driver=document.getElementById('driver-name').value;const vin=document.getElementById('car-vin').value;fetch('/api/start?driver='+encodeURIComponent(driver)+'&vin='+encodeURIComponent(vin),{method:'POST'}).then(()=>{document.getElementById('session-status').textContent='Status: Recording...'})}
-function stopSession(){fetch('/api/stop',{method:'POST'}).then(()=>{document.getElementById('session-status').textContent='Status: Stopped';setTimeout(refreshFiles,500)})}
+function deleteFile(fn){if(!confirm('Delete '+fn+'?'))return;fetch('/api/delete?file='+fn,{method:'DELETE'}).then(()=>refreshFiles())}
+function startSession(){const driver=document.getElementById('driver-name').value;const vin=document.getElementById('car-vin').value;fetch('/api/start?driver='+encodeURIComponent(driver)+'&vin='+encodeURIComponent(vin),{method:'POST'}).then(r=>r.json()).then(d=>{document.getElementById('session-status').textContent='Status: '+(d.type==='ok'?'Recording...':d.message)})}
+function stopSession(){fetch('/api/stop',{method:'POST'}).then(r=>r.json()).then(d=>{document.getElementById('session-status').textContent='Status: '+(d.type==='ok'?'Stopped':d.message);refreshFiles()})}
 function showTab(tab){document.querySelectorAll('.tab-content').forEach(el=>el.classList.remove('active'));document.querySelectorAll('.tab').forEach(el=>el.classList.remove('active'));document.getElementById(tab).classList.add('active');event.target.classList.add('active');if(tab==='satellites')drawSatelliteSky();}
 window.addEventListener('load',init)
     </script>
@@ -321,11 +431,334 @@ window.addEventListener('load',init)
 )rawliteral";
 
 // ============================================================================
-// JSON Buffer
+// WebSocket Broadcast State
+// ============================================================================
+
+// Telemetry is not pushed to clients from the UART path. Each client gets a
+// slot holding the rate it subscribed at and the last snapshot it was sent;
+// loop() hands the latest snapshot to clients that are due and whose queue
+// has room. A slow phone misses snapshots instead of stalling everyone.
+//
+// Clients pick a rate and encoding with
+//   {"cmd":"subscribe","rate":10,"format":"json"|"binary"}
+// rate is in Hz (0 pauses telemetry). Binary clients receive the raw
+// TelemetryFrame struct; the WebSocket already frames and checksums it.
+
+#define MAX_WS_SUBSCRIBERS 8
+#define DEFAULT_WS_RATE_HZ 10
+#define MAX_WS_RATE_HZ 25
+
+struct WsSubscriber {
+    uint32_t client_id;     // 0 = slot free
+    uint16_t interval_ms;   // 0 = paused
+    bool binary;
+    uint32_t last_sent_ms;
+    uint32_t sent_seq;      // Snapshot last delivered
+    uint32_t drops;         // Snapshots skipped on a full queue
+};
+
+WsSubscriber subscribers[MAX_WS_SUBSCRIBERS];
+uint32_t telemetrySeq = 0;   // Bumped on every telemetry update
+
+// Latest snapshot, encoded at most once per telemetry update
+char wsTextBuffer[512];
+size_t wsTextLen = 0;
+uint32_t wsTextSeq = 0;
+TelemetryFrame wsFrame;
+uint32_t wsFrameSeq = 0;
+
+// ============================================================================
+// Session Download
+// ============================================================================
+
+// /api/download streams a session file from the Pico's SD card straight into
+// the HTTP response. The Pico sends it as FILE_DATA frames
+//
+//   type(u8) | seq(u16) | data (max DL_CHUNK_SIZE)
+//
+// and keeps at most DL_WINDOW frames unacknowledged. Frames land in a ring
+// sized for one window; the response filler drains it to TCP and ACKs each
+// frame once its bytes have left, so RAM use is bounded by the window no
+// matter how slow the phone is. When a frame is lost or fails its CRC, the
+// next one is out of sequence: we NAK the seq we wanted and the Pico goes
+// back to it. Only one download runs at a time.
+//
+// Downloads can resume. A Range header ("bytes=N-" or "bytes=N-M") becomes
+// a byte offset/length on the GET, and ?block=N asks the Pico to start at
+// data block N. Either way the reply is 206 with Content-Range. Responses
+// carry a Content-Length, so a transfer cut short is visibly incomplete
+// and the client knows where to pick up.
+
+// Small frames keep the Pico's encode and UART time per frame short
+// enough to fit between samples; the wider window keeps 1KB in flight
+#define DL_CHUNK_SIZE 128
+#define DL_WINDOW 8      // Power of two - frame slots are indexed by seq
+#define DL_BUFFER_SIZE (DL_CHUNK_SIZE * DL_WINDOW)
+#define DL_START_TIMEOUT_MS 3000
+#define DL_STALL_TIMEOUT_MS 5000
+
+enum DownloadState {
+    DL_IDLE,
+    DL_STARTING,    // GET sent, waiting for file_start
+    DL_STREAMING,
+    DL_FINISHED,    // file_end received, draining the ring
+    DL_FAILED
+};
+
+struct Download {
+    DownloadState state;
+    AsyncWebServerRequest* request;
+    char file[64];
+    bool ranged;                    // Reply 206 with Content-Range
+    uint32_t size;                  // Whole file, from file_start
+    uint32_t offset;                // First byte sent
+    uint32_t length;                // Bytes sent
+    uint32_t received;              // Bytes written into the ring
+    uint32_t drained;               // Bytes handed to TCP
+    uint32_t frame_end[DL_WINDOW];  // `received` after each unACKed frame
+    uint16_t next_seq;              // Next frame expected from the Pico
+    uint16_t acked_seq;             // Last frame ACKed to the Pico
+    uint8_t frames_held;            // Frames received but not yet ACKed
+    bool nak_sent;                  // Already asked for next_seq again
+    unsigned long last_activity_ms;
+};
+
+Download download = {DL_IDLE};
+uint8_t dlBuffer[DL_BUFFER_SIZE];
+
+// Session files are checked block by block as they stream through
+// (opl_codec.h): the layout and CRC32 of every block, with a summary of
+// the last DL_SUMMARY_BLOCKS data blocks for /api/blocks. Nothing is
+// buffered for it and the bytes go to TCP whatever it finds - a range
+// that doesn't start on a block just shows as not valid.
+#define DL_SUMMARY_BLOCKS 8
+
+struct DownloadIndex {
+    char file[64];
+    bool active;                    // Parser running on this download
+    uint32_t start;                 // File offset the download started at
+    uint32_t data_blocks;
+    uint32_t bad_crc;
+    uint32_t samples;
+    uint64_t first_us;
+    uint64_t last_us;
+    bool session_end;
+    OplBlockInfo recent[DL_SUMMARY_BLOCKS];   // Ring of data blocks
+};
+
+DownloadIndex dlIndex;
+OplStreamParser dlParser;
+
+// ============================================================================
+// Telemetry History
+// ============================================================================
+
+// The last HISTORY_SECONDS of telemetry are kept in a fixed ring, one
+// sample per 1/HISTORY_RATE_HZ whatever rate the Pico sends at (a newer
+// update in the same period replaces the sample). A WebSocket client that
+// connects mid-session gets the ring as one binary message
+//
+//   HistoryHeader | HistorySample * count   (oldest first)
+//
+// and /api/history?seconds=N returns the same bytes over HTTP. Both are
+// copied straight out of the ring, so RAM use is fixed at build time:
+// HISTORY_SECONDS * HISTORY_RATE_HZ * 22 bytes (6.6KB by default).
+
+#ifndef HISTORY_SECONDS
+#define HISTORY_SECONDS 30
+#endif
+#ifndef HISTORY_RATE_HZ
+#define HISTORY_RATE_HZ 10
+#endif
+#define HISTORY_SLOTS (HISTORY_SECONDS * HISTORY_RATE_HZ)
+#define HISTORY_PERIOD_MS (1000 / HISTORY_RATE_HZ)
+
+#define FRAME_TYPE_HISTORY 0x03
+
+struct __attribute__((packed)) HistoryHeader {
+    uint8_t frame_type;
+    uint8_t rate_hz;
+    uint16_t count;
+    uint32_t now_ms;       // millis() when sent; sample age = now_ms - ms
+};
+
+struct __attribute__((packed)) HistorySample {
+    uint32_t ms;           // millis() when received
+    int16_t gx, gy, gz;    // milli-g
+    int32_t lat, lon;      // 1e-7 degrees
+    uint16_t speed;        // 0.1 MPH
+    uint8_t sats;
+    uint8_t fix;
+};
+
+HistorySample history[HISTORY_SLOTS];
+uint32_t historyCount = 0;      // Samples ever recorded; slot = n % HISTORY_SLOTS
+uint32_t historyPeriod = 0;     // millis() / HISTORY_PERIOD_MS of the newest
+
+// ============================================================================
+// Chart Pyramid
+// ============================================================================
+
+// Min/max/avg of g total, speed, lateral g and longitudinal g at
+// CHART_LEVELS power-of-two resolutions, so the web UI can chart any part
+// of the session with at most CHART_POINTS points however long it is.
+// Level k has bins of CHART_BASE_MS << k in a ring of CHART_BINS. Every
+// telemetry update goes into the current bin of each level, so the newest
+// bin is always up to date; periods with no telemetry are left empty
+// (g total min > max).
+//
+// /api/chart?from=<ms>&to=<ms> (ESP millis(), as in now_ms) returns
+//
+//   ChartHeader | ChartBin * count   (oldest first)
+//
+// from the finest level that still holds `from` and fits the range in
+// CHART_POINTS bins; both default to the whole session. Values are a byte
+// each: g in 0.02g (lateral/longitudinal clip at +-2.54g), speed in MPH.
+// With the defaults that is 1s bins for the last 4.3 minutes up to 64s
+// bins for the last 4.5 hours, so a whole 2-hour session still charts, in
+// CHART_LEVELS * CHART_BINS * 12 bytes (21KB).
+
+#ifndef CHART_LEVELS
+#define CHART_LEVELS 7
+#endif
+#ifndef CHART_BASE_MS
+#define CHART_BASE_MS 1000
+#endif
+#ifndef CHART_BINS
+#define CHART_BINS 256               // Per level
+#endif
+#define CHART_POINTS CHART_BINS      // Most bins per response
+#define CHART_CHANNELS 4
+#define CHART_G_SCALE 0.02f
+
+enum ChartChannel {
+    CHART_G_TOTAL,         // uint8
+    CHART_SPEED,           // uint8
+    CHART_LAT_G,           // int8, gx
+    CHART_LONG_G,          // int8, gy
+};
+
+struct __attribute__((packed)) ChartHeader {
+    uint8_t level;
+    uint8_t channels;
+    uint16_t count;
+    uint32_t bin_ms;       // Bin width
+    uint32_t first_ms;     // millis() at the start of the first bin
+    uint32_t start_ms;     // millis() of the first telemetry charted
+    uint32_t now_ms;       // millis() when sent
+};
+
+struct __attribute__((packed)) ChartBin {
+    uint8_t value[CHART_CHANNELS][3];    // min, max, avg per ChartChannel
+};
+
+struct ChartLevel {
+    ChartBin bins[CHART_BINS];     // slot = period % CHART_BINS
+    uint32_t period;               // millis() / bin width of the newest bin
+    int16_t min[CHART_CHANNELS];   // Newest bin, unquantised
+    int16_t max[CHART_CHANNELS];
+    int32_t sum[CHART_CHANNELS];
+    uint16_t count;
+};
+
+ChartLevel chart[CHART_LEVELS];
+uint32_t chartSamples = 0;
+uint32_t chartStartMs = 0;
+
+// ============================================================================
+// Uplink
 // ============================================================================
 
-String jsonBuffer = "";
-const size_t MAX_JSON_BUFFER = 4096;  // Larger buffer for 57600 baud
+// Store-and-forward to Traccar while the station side is connected, so
+// live tracking needs no opl2traccar run after the session.
+//
+// Telemetry updates are decimated into a fixed ring: a position is kept
+// once it is UPLINK_MIN_DISTANCE_M from the last kept one (at most one per
+// UPLINK_MIN_INTERVAL_MS), or UPLINK_MAX_INTERVAL_MS after it while
+// parked. While the uplink is down the ring fills and then overwrites its
+// oldest positions - RAM is fixed at UPLINK_SLOTS * 18 bytes.
+//
+// loop() flushes up to UPLINK_BATCH positions per request, as one OsmAnd
+// JSON POST ({"device_id", "location": [...]}); a server that refuses
+// JSON gets one GET per position instead. The AsyncClient connects,
+// sends and reads the status line in callbacks, so neither loop() nor
+// UART ingestion ever waits on the network. Failed requests back off,
+// doubling up to UPLINK_BACKOFF_MAX_MS.
+//
+// Telemetry carries no wall-clock time, so each position keeps the
+// millis() it arrived at and is stamped from SNTP when it is sent -
+// positions queued before the clock was set still get the right time.
+//
+// The ESP8266 has one radio: when the station connects the AP moves to
+// the uplink network's channel and phones on the AP briefly drop.
+
+#ifndef UPLINK_SLOTS
+#define UPLINK_SLOTS 256
+#endif
+#ifndef UPLINK_MIN_DISTANCE_M
+#define UPLINK_MIN_DISTANCE_M 5
+#endif
+#ifndef UPLINK_MIN_INTERVAL_MS
+#define UPLINK_MIN_INTERVAL_MS 1000
+#endif
+#define UPLINK_MAX_INTERVAL_MS 30000
+#define UPLINK_BATCH 10
+#define UPLINK_FLUSH_MS 5000         // Send a short batch once its oldest is this old
+#define UPLINK_TIMEOUT_MS 10000
+#define UPLINK_BACKOFF_MS 2000
+#define UPLINK_BACKOFF_MAX_MS 60000
+#define UPLINK_MIN_EPOCH 1600000000  // time() below this = SNTP not synced yet
+#define UPLINK_REQUEST_SIZE 2048
+#define UPLINK_HEADER_SIZE 192       // Room kept in front of the body for headers
+#define UPLINK_LOCATION_SIZE 192     // Worst case JSON per position
+
+struct __attribute__((packed)) UplinkPosition {
+    uint32_t ms;           // millis() when received
+    int32_t lat, lon;      // 1e-7 degrees
+    int16_t alt;           // m
+    uint16_t speed;        // 0.1 MPH
+    uint16_t course;       // 0.1 degrees, from the previous kept position
+    uint8_t hdop;          // 0.1
+    uint8_t sats;
+};
+
+enum UplinkState {
+    UL_IDLE,
+    UL_BUSY,               // Request in flight
+};
+
+struct Uplink {
+    bool connected;       // Station has an IP
+    bool json;             // Server takes JSON batches
+    UplinkState state;
+    bool done;             // Set by the client callbacks
+    int16_t status;        // HTTP status, 0 = none yet, -1 = network error
+    uint32_t first;        // Sequence number of the first position in flight
+    uint16_t count;        // Positions in flight
+    size_t length;         // Request bytes
+    size_t written;        // Request bytes handed to TCP
+    unsigned long started_ms;
+    unsigned long retry_ms;      // No request before this
+    unsigned long backoff_ms;
+    
+    // Ring: positions head - tail are queued, slot = n % UPLINK_SLOTS
+    uint32_t head;
+    uint32_t tail;
+    bool have_last;
+    UplinkPosition last;   // Last position kept, for decimation
+    
+    uint32_t sent;
+    uint32_t dropped;      // Overwritten while the uplink was down
+    uint32_t requests;
+    uint32_t failures;
+};
+
+#if UPLINK_ENABLED
+UplinkPosition uplinkQueue[UPLINK_SLOTS];
+Uplink uplink = {};
+AsyncClient uplinkClient;
+char uplinkRequest[UPLINK_REQUEST_SIZE];
+#endif
 
 // ============================================================================
 // Setup
@@ -340,53 +773,144 @@ void setup() {
     delay(500);  // Let UART stabilize
     
     // Send startup message to Pico
-    PicoSerial.println("{\"type\":\"esp_ready\"}");
+    PicoSerial.printf("{\"type\":\"esp_ready\",\"caps\":[\"bin_telemetry\",\"file_stream\"],"
+                      "\"telemetry_hz\":%d}\n", PICO_TELEMETRY_HZ);
     
-    // Connect to WiFi
-    WiFi.mode(WIFI_AP);
-    WiFi.config(local_IP, gateway, subnet);
+    // Connect to WiFi - the station side (uplink) joins in the background
+    // and loop() reports it to the Pico when it comes up
+    WiFi.persistent(false);
+    WiFi.mode(UPLINK_ENABLED ? WIFI_AP_STA : WIFI_AP);
+    WiFi.softAPConfig(apIP, apIP, apSubnet);
     WiFi.softAP(ssid, password);
-    
-    // Wait for connection (no serial debug available)
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(500);
-        attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        // Notify Pico of WiFi status
-        StaticJsonDocument<128> doc;
-        doc["type"] = "wifi_status";
-        doc["connected"] = true;
-        doc["ip"] = WiFi.localIP().toString();
-        
-        String json;
-        serializeJson(doc, json);
-        PicoSerial.println(json);
-    }
+#if UPLINK_ENABLED
+    setupUplink();
+#endif
     
     // ========================================================================
     // Web Server Routes
     // ========================================================================
     
+#ifdef WEB_ASSET_COUNT
+    for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+        const WebAsset* asset = &WEB_ASSETS[i];
+        server.on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request){
+            serveWebAsset(request, asset->mime, asset->data, asset->length,
+                          asset->etag, asset->gzip);
+        });
+    }
+    server.on("/simple", HTTP_GET, handleRootPage);
+#else
     server.on("/", HTTP_GET, handleRootPage);
+#endif
     
     server.on("/api/telemetry", HTTP_GET, [](AsyncWebServerRequest *request){
-        String json = getTelemetryJSON();
-        request->send(200, "application/json", json);
+        StaticJsonDocument<512> doc;
+        JsonObject root = doc.to<JsonObject>();
+        root["valid"] = telemetry.valid;
+        if (telemetry.valid) {
+            fillTelemetry(root);
+        }
+        sendApiJSON(request, doc);
+    });
+    
+    server.on("/api/live", HTTP_GET, [](AsyncWebServerRequest *request){
+        StaticJsonDocument<768> doc;
+        fillLive(doc.to<JsonObject>());
+        sendApiJSON(request, doc);
+    });
+    
+    server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
+        StaticJsonDocument<768> doc;
+        fillStatus(doc.to<JsonObject>());
+        sendApiJSON(request, doc);
+    });
+    
+    server.on("/api/gps", HTTP_GET, [](AsyncWebServerRequest *request){
+        noteSatelliteDemand();
+        StaticJsonDocument<2048> doc;
+        JsonObject root = doc.to<JsonObject>();
+        fillGPS(root);
+        fillSatellites(root);
+        sendApiJSON(request, doc);
+    });
+    
+    server.on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request){
+        long seconds = HISTORY_SECONDS;
+        if (request->hasParam("seconds")) {
+            seconds = constrain(request->getParam("seconds")->value().toInt(), 0, HISTORY_SECONDS);
+        }
+        
+        // Fixed at request time so the header matches the body however
+        // many calls the filler takes
+        uint16_t count = historyAvailable(seconds);
+        uint32_t first = historyCount - count;
+        uint32_t now = millis();
+        
+        AsyncWebServerResponse *response = request->beginResponse(
+            "application/octet-stream", historyLength(count),
+            [first, count, now](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return copyHistory(buffer, maxLen, index, first, count, now);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    });
+    
+    server.on("/api/chart", HTTP_GET, [](AsyncWebServerRequest *request){
+        uint32_t now = millis();
+        uint32_t from = 0;
+        uint32_t to = now;
+        if (request->hasParam("from")) {
+            from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+        }
+        if (request->hasParam("to")) {
+            to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+        }
+        
+        // Fixed at request time, as for /api/history
+        uint8_t level;
+        uint32_t first;
+        uint16_t count;
+        chartQuery(from, to, level, first, count);
+        
+        AsyncWebServerResponse *response = request->beginResponse(
+            "application/octet-stream", chartLength(count),
+            [level, first, count, now](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return copyChart(buffer, maxLen, index, level, first, count, now);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    });
+    
+    server.on("/api/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+        StaticJsonDocument<2048> doc;
+        fillMetrics(doc.to<JsonObject>());
+        sendApiJSON(request, doc);
+    });
+    
+    server.on("/api/blocks", HTTP_GET, [](AsyncWebServerRequest *request){
+        StaticJsonDocument<2048> doc;
+        fillBlocks(doc.to<JsonObject>());
+        sendApiJSON(request, doc);
     });
     
     server.on("/api/satellites", HTTP_GET, [](AsyncWebServerRequest *request){
-        sendCommandToPico("{\"cmd\":\"GET_SATELLITES\"}");
-        String json = getSatellitesJSON();
-        request->send(200, "application/json", json);
+        noteSatelliteDemand();
+        StaticJsonDocument<2048> doc;
+        fillSatellites(doc.to<JsonObject>());
+        sendApiJSON(request, doc);
     });
     
+    // Newest first; offset/limit page through the Pico's session catalogue
     server.on("/api/files", HTTP_GET, [](AsyncWebServerRequest *request){
-        sendCommandToPico("{\"cmd\":\"LIST\"}");
-        delay(100);
-        request->send(200, "text/plain", "File list requested");
+        StaticJsonDocument<128> doc;
+        doc["cmd"] = "LIST";
+        if (request->hasParam("offset")) {
+            doc["offset"] = strtoul(request->getParam("offset")->value().c_str(), nullptr, 10);
+        }
+        if (request->hasParam("limit")) {
+            doc["limit"] = strtoul(request->getParam("limit")->value().c_str(), nullptr, 10);
+        }
+        sendCommandToPico(request, doc);
     });
     
     server.on("/api/download", HTTP_GET, [](AsyncWebServerRequest *request){
@@ -395,17 +919,32 @@ void setup() {
             return;
         }
         
+        if (download.state != DL_IDLE) {
+            request->send(503, "text/plain", "Download in progress");
+            return;
+        }
+        
         String filename = request->getParam("file")->value();
+        if (filename.length() >= sizeof(download.file)) {
+            request->send(400, "text/plain", "Filename too long");
+            return;
+        }
         
-        StaticJsonDocument<256> doc;
-        doc["cmd"] = "GET";
-        doc["file"] = filename;
+        // Resume from a data block, or honour a byte range
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        long block = -1;
+        bool ranged = false;
         
-        String json;
-        serializeJson(doc, json);
-        sendCommandToPico(json);
+        if (request->hasParam("block")) {
+            block = request->getParam("block")->value().toInt();
+            ranged = block >= 0;
+        } else if (request->hasHeader("Range")) {
+            ranged = parseRange(request->getHeader("Range")->value(), offset, length);
+        }
         
-        request->send(200, "text/plain", "Download started");
+        // Response is sent once the Pico answers with file_start
+        startDownload(request, filename, ranged, offset, length, block);
     });
     
     server.on("/api/delete", HTTP_DELETE, [](AsyncWebServerRequest *request){
@@ -419,12 +958,7 @@ void setup() {
         StaticJsonDocument<256> doc;
         doc["cmd"] = "DELETE";
         doc["file"] = filename;
-        
-        String json;
-        serializeJson(doc, json);
-        sendCommandToPico(json);
-        
-        request->send(200, "text/plain", "Delete requested");
+        sendCommandToPico(request, doc);
     });
     
     server.on("/api/start", HTTP_POST, [](AsyncWebServerRequest *request){
@@ -442,17 +976,13 @@ void setup() {
         doc["cmd"] = "START_SESSION";
         doc["driver"] = driver;
         doc["vin"] = vin;
-        
-        String json;
-        serializeJson(doc, json);
-        sendCommandToPico(json);
-        
-        request->send(200, "text/plain", "Session start requested");
+        sendCommandToPico(request, doc);
     });
     
     server.on("/api/stop", HTTP_POST, [](AsyncWebServerRequest *request){
-        sendCommandToPico("{\"cmd\":\"STOP_SESSION\"}");
-        request->send(200, "text/plain", "Session stop requested");
+        StaticJsonDocument<64> doc;
+        doc["cmd"] = "STOP_SESSION";
+        sendCommandToPico(request, doc);
     });
     
     ws.onEvent(onWsEvent);
@@ -469,8 +999,15 @@ void setup() {
 // ============================================================================
 
 void loop() {
+    recordLoopLatency();
     ws.cleanupClients();
     processSerialData();
+    serviceDownload();
+    serviceBroadcasts();
+    serviceSatelliteRefresh();
+    servicePending();
+    serviceMetrics();
+    serviceUplink();
     delay(1);  // Very small delay
 }
 
@@ -478,118 +1015,124 @@ void loop() {
 // Serial Communication
 // ============================================================================
 
-void processSerialData() {
-    while (PicoSerial.available()) {
-        char c = PicoSerial.read();
-        
-        if (c == '\n') {
-            // Complete JSON line received
-            if (jsonBuffer.length() > 0) {
-                processJSONMessage(jsonBuffer);
-                jsonBuffer = "";
-            }
-        } else if (c >= 32 && c <= 126) {
-            // Only accept printable ASCII
-            jsonBuffer += c;
-            
-            // Prevent buffer overflow
-            if (jsonBuffer.length() > MAX_JSON_BUFFER) {
-                jsonBuffer = "";  // Discard corrupted data
-            }
-        }
-        // Ignore non-printable characters (except newline)
+// Bridge hook: every telemetry update, JSON line or binary frame
+void telemetryUpdated() {
+    telemetrySeq++;
+    recordHistory();
+    recordChart();
+    recordUplink();
+}
+
+void handleFileList(JsonDocument& doc, const char* line, size_t len) {
+    if (!completePending(doc, line, len)) {
+        ws.textAll(line, len);
     }
 }
 
-void processJSONMessage(const String& jsonString) {
-    StaticJsonDocument<2048> doc;
-    DeserializationError error = deserializeJson(doc, jsonString);
-    
-    if (error) {
-        // Don't spam errors, just drop bad packets
+void handleFileTransfer(JsonDocument& doc, const char* line, size_t len) {
+    if (download.state == DL_IDLE || strcmp(doc["file"] | "", download.file) != 0) {
+        // Not ours - let WebSocket clients see it
+        ws.textAll(line, len);
         return;
     }
     
-    String type = doc["type"] | "";
+    const char* type = doc["type"];
     
-    if (type == "update") {
-        handleTelemetryUpdate(doc, jsonString);
-    }
-    else if (type == "satellites") {
-        handleSatelliteUpdate(doc, jsonString);
-    }
-    else if (type == "files") {
-        handleFileList(doc, jsonString);
+    if (strcmp(type, "file_start") == 0 && download.state == DL_STARTING) {
+        download.size = doc["size"] | 0;
+        download.offset = doc["offset"] | 0;
+        download.length = doc["length"] | download.size;
+        download.state = DL_STREAMING;
+        download.last_activity_ms = millis();
+        startDownloadIndex(download.file, download.offset);
+        
+        AsyncWebServerResponse *response = download.request->beginResponse(
+            "application/octet-stream", download.length, fillDownload);
+        response->addHeader("Accept-Ranges", "bytes");
+        response->addHeader("Content-Disposition",
+                            String("attachment; filename=\"") + download.file + "\"");
+        
+        if (download.ranged && download.length > 0) {
+            char range[48];
+            snprintf(range, sizeof(range), "bytes %lu-%lu/%lu",
+                     (unsigned long)download.offset,
+                     (unsigned long)(download.offset + download.length - 1),
+                     (unsigned long)download.size);
+            response->setCode(206);
+            response->addHeader("Content-Range", range);
+        }
+        
+        download.request->send(response);
     }
-    else if (type == "file_start" || type == "file_chunk" || type == "file_end") {
-        handleFileTransfer(doc, jsonString);
+    else if (strcmp(type, "file_end") == 0 && download.state == DL_STREAMING) {
+        download.state = DL_FINISHED;
     }
-    else if (type == "ok" || type == "error") {
-        handleResponse(doc, jsonString);
+    else if (strcmp(type, "file_error") == 0) {
+        failDownload(doc["code"] | 404, doc["message"] | "File error", doc["size"] | 0);
     }
 }
 
-void handleTelemetryUpdate(JsonDocument& doc, const String& jsonString) {
-    JsonObject data = doc["data"];
-    
-    telemetry.valid = true;
-    telemetry.gx = data["g"]["x"];
-    telemetry.gy = data["g"]["y"];
-    telemetry.gz = data["g"]["z"];
-    telemetry.g_total = data["g"]["total"];
-    
-    telemetry.lat = data["gps"]["lat"];
-    telemetry.lon = data["gps"]["lon"];
-    telemetry.alt = data["gps"]["alt"];
-    telemetry.speed = data["gps"]["speed"];
-    telemetry.sats = data["gps"]["sats"];
-    telemetry.hdop = data["gps"]["hdop"];
-    telemetry.fix_type = data["gps"]["fix"] | "NoFix";
-    
-    telemetry.last_update = millis();
-    
-    // Broadcast to WebSocket clients
-    ws.textAll(jsonString);
-}
-
-void handleSatelliteUpdate(JsonDocument& doc, const String& jsonString) {
-    satellites.clear();
-    
-    JsonArray sats = doc["satellites"];
-    for (JsonObject sat : sats) {
-        SatelliteData sd;
-        sd.id = sat["id"];
-        sd.elevation = sat["elevation"];
-        sd.azimuth = sat["azimuth"];
-        sd.snr = sat["snr"];
-        satellites.push_back(sd);
+void handleResponse(JsonDocument& doc, const char* line, size_t len) {
+    if (!completePending(doc, line, len)) {
+        ws.textAll(line, len);
     }
-    
-    last_sat_update = millis();
-    ws.textAll(jsonString);
 }
 
-void handleFileList(JsonDocument& doc, const String& jsonString) {
-    ws.textAll(jsonString);
+void sendCommandToPico(const String& json) {
+    PicoSerial.println(json);
 }
 
-void handleFileTransfer(JsonDocument& doc, const String& jsonString) {
-    ws.textAll(jsonString);
+void sendCommandToPico(const char* json, size_t len) {
+    PicoSerial.write((const uint8_t*)json, len);
+    PicoSerial.write('\n');
 }
+// ============================================================================
+// Serve HTML Page - Chunked Response
+// ============================================================================
+
+// Strong validator for the built-in page: changes with every firmware image
+String builtinPageETag;
 
-void handleResponse(JsonDocument& doc, const String& jsonString) {
-    ws.textAll(jsonString);
+bool notModified(AsyncWebServerRequest *request, const char* etag) {
+    if (!request->hasHeader("If-None-Match") ||
+        request->getHeader("If-None-Match")->value() != etag) {
+        return false;
+    }
+    
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+    return true;
 }
 
-void sendCommandToPico(const String& json) {
-    PicoSerial.println(json);
+void serveWebAsset(AsyncWebServerRequest *request, const char* mime,
+                   const uint8_t* data, size_t length, const char* etag, bool gzip) {
+    if (notModified(request, etag)) {
+        return;
+    }
+    
+    // Sent straight from flash; no-cache = use the copy but revalidate (304)
+    AsyncWebServerResponse *response = request->beginResponse_P(200, mime, data, length);
+    if (gzip) {
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
 }
-// ============================================================================
-// Serve HTML Page - Chunked Response
-// ============================================================================
 
 void handleRootPage(AsyncWebServerRequest *request) {
+    if (builtinPageETag.length() == 0) {
+        builtinPageETag = String("\"") + ESP.getSketchMD5() + "\"";
+    }
+    if (notModified(request, builtinPageETag.c_str())) {
+        return;
+    }
+    
     AsyncResponseStream *response = request->beginResponseStream("text/html");
+    response->addHeader("ETag", builtinPageETag);
+    response->addHeader("Cache-Control", "no-cache");
     
     // Send chunks from PROGMEM
     response->print(FPSTR(HTML_HEADER));
@@ -608,23 +1151,11 @@ void handleRootPage(AsyncWebServerRequest *request) {
 
 String getTelemetryJSON() {
     StaticJsonDocument<512> doc;
-    doc["valid"] = telemetry.valid;
+    JsonObject root = doc.to<JsonObject>();
+    root["valid"] = telemetry.valid;
     
     if (telemetry.valid) {
-        JsonObject g = doc.createNestedObject("g");
-        g["x"] = telemetry.gx;
-        g["y"] = telemetry.gy;
-        g["z"] = telemetry.gz;
-        g["total"] = telemetry.g_total;
-        
-        JsonObject gps = doc.createNestedObject("gps");
-        gps["fix"] = telemetry.fix_type;
-        gps["lat"] = telemetry.lat;
-        gps["lon"] = telemetry.lon;
-        gps["alt"] = telemetry.alt;
-        gps["speed"] = telemetry.speed;
-        gps["sats"] = telemetry.sats;
-        gps["hdop"] = telemetry.hdop;
+        fillTelemetry(root);
     }
     
     String json;
@@ -632,47 +1163,1165 @@ String getTelemetryJSON() {
     return json;
 }
 
-String getSatellitesJSON() {
-    StaticJsonDocument<2048> doc;
-    doc["count"] = satellites.size();
-    doc["last_update"] = last_sat_update;
+void fillStatus(JsonObject data) {
+    data["uptime"] = millis() / 1000;
+    data["telemetry_age_ms"] = telemetryAge();
+    data["gps_time_synced"] = telemetry.fix != FIX_NONE;
+    data["ws_clients"] = ws.count();
+    data["free_heap"] = ESP.getFreeHeap();
     
-    JsonArray sats = doc.createNestedArray("satellites");
-    for (const SatelliteData& sat : satellites) {
-        JsonObject obj = sats.createNestedObject();
-        obj["id"] = sat.id;
-        obj["elevation"] = sat.elevation;
-        obj["azimuth"] = sat.azimuth;
-        obj["snr"] = sat.snr;
+    JsonObject serial = data.createNestedObject("serial");
+    serial["rx_bytes"] = serialStats.rx_bytes;
+    serial["lines"] = serialStats.lines;
+    serial["overruns"] = serialStats.overruns;
+    serial["discarded"] = serialStats.discarded_lines;
+    serial["frames"] = frameStats.frames;
+    serial["bad_frames"] = frameStats.bad_frames;
+    serial["lost_frames"] = frameStats.lost_frames;
+}
+
+// ============================================================================
+// REST Snapshots
+// ============================================================================
+
+void sendApiJSON(AsyncWebServerRequest *request, JsonDocument& doc) {
+    if (doc.overflowed()) {
+        request->send(500, "text/plain", "Response too large");
+        return;
     }
     
-    String json;
-    serializeJson(doc, json);
-    return json;
+    // Serialised into the response's own buffer, sized up front
+    AsyncResponseStream *response = request->beginResponseStream("application/json",
+                                                                 measureJson(doc));
+    serializeJson(doc, *response);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// A Pico reply as the body, copied into the response's own buffer
+void sendApiBody(AsyncWebServerRequest *request, int code, const char* body, size_t len) {
+    AsyncResponseStream *response = request->beginResponseStream("application/json", len);
+    response->write((const uint8_t*)body, len);
+    if (code != 200) {
+        response->setCode(code);
+    }
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
 }
 
 // ============================================================================
-// WebSocket Handler
+// Pico Requests
 // ============================================================================
 
-void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
-               AwsEventType type, void *arg, uint8_t *data, size_t len) {
+PendingRequest* findPending(uint16_t id) {
+    for (PendingRequest& p : pending) {
+        if (p.id == id) {
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+// Send a command tagged with a request id; the HTTP response is completed
+// by completePending() or servicePending()
+void sendCommandToPico(AsyncWebServerRequest *request, JsonDocument& doc) {
+    PendingRequest* p = findPending(0);
+    if (!p) {
+        request->send(503, "text/plain", "Too many requests in flight");
+        return;
+    }
     
-    if (type == WS_EVT_CONNECT) {
-        if (telemetry.valid) {
-            String json = getTelemetryJSON();
-            client->text(json);
+    uint16_t id = nextRequestId++;
+    if (nextRequestId == 0) {
+        nextRequestId = 1;   // 0 marks replies with no request
+    }
+    
+    doc["id"] = id;
+    char json[320];
+    size_t n = serializeJson(doc, json, sizeof(json));
+    if (n == 0 || n >= sizeof(json) - 1) {
+        request->send(400, "text/plain", "Command too long");
+        return;
+    }
+    
+    p->id = id;
+    p->request = request;
+    p->sent_ms = millis();
+    
+    // The request object is freed if the client gives up - forget it then
+    request->onDisconnect([id]() {
+        PendingRequest* p = findPending(id);
+        if (p) {
+            p->id = 0;
         }
+    });
+    
+    sendCommandToPico(json, n);
+}
+
+bool completePending(JsonDocument& doc, const char* line, size_t len) {
+    uint16_t id = doc["id"] | 0;
+    PendingRequest* p = id ? findPending(id) : nullptr;
+    if (!p) {
+        return false;
     }
-    else if (type == WS_EVT_DATA) {
-        AwsFrameInfo *info = (AwsFrameInfo*)arg;
-        
-        if (info->final && info->index == 0 && info->len == len) {
-            String msg = "";
-            for (size_t i = 0; i < len; i++) {
-                msg += (char)data[i];
-            }
-            sendCommandToPico(msg);
+    
+    int code = 200;
+    if (strcmp(doc["type"] | "", "error") == 0) {
+        code = doc["code"] | 500;
+    }
+    
+    p->id = 0;
+    sendApiBody(p->request, code, line, len);
+    return true;
+}
+
+void servicePending() {
+    unsigned long now = millis();
+    
+    for (PendingRequest& p : pending) {
+        if (p.id != 0 && now - p.sent_ms > PENDING_TIMEOUT_MS) {
+            p.id = 0;
+            p.request->send(504, "text/plain", "Pico did not respond");
         }
     }
 }
+
+// ============================================================================
+// Metrics
+// ============================================================================
+
+void recordLoopLatency() {
+    uint32_t now = micros();
+    if (metrics.last_loop_us != 0) {
+        uint32_t us = now - metrics.last_loop_us;
+        uint32_t ms = us >> 10;
+        uint8_t bucket = ms ? 32 - __builtin_clz(ms) : 0;
+        metrics.loop_hist[min(bucket, (uint8_t)(LOOP_HIST_BUCKETS - 1))]++;
+        metrics.loop_max_us = max(metrics.loop_max_us, us);
+    }
+    metrics.last_loop_us = now;
+}
+
+void serviceMetrics() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - metrics.last_rate_ms;
+    if (elapsed < METRICS_RATE_MS) {
+        return;
+    }
+    
+    metrics.rx_bytes_per_s = (serialStats.rx_bytes - metrics.last_rx_bytes) * 1000UL / elapsed;
+    metrics.lines_per_s = (serialStats.lines - metrics.last_lines) * 1000UL / elapsed;
+    metrics.frames_per_s = (frameStats.frames - metrics.last_frames) * 1000UL / elapsed;
+    metrics.last_rx_bytes = serialStats.rx_bytes;
+    metrics.last_lines = serialStats.lines;
+    metrics.last_frames = frameStats.frames;
+    metrics.last_rate_ms = now;
+}
+
+void fillMetrics(JsonObject data) {
+    data["uptime"] = millis() / 1000;
+    
+    // Bucket i counts iterations under (1 << i) ms; the last one the rest
+    JsonObject loopStats = data.createNestedObject("loop");
+    JsonArray hist = loopStats.createNestedArray("hist_ms");
+    for (uint32_t count : metrics.loop_hist) {
+        hist.add(count);
+    }
+    loopStats["max_us"] = metrics.loop_max_us;
+    
+    JsonObject serial = data.createNestedObject("serial");
+    serial["rx_bytes"] = serialStats.rx_bytes;
+    serial["rx_bytes_per_s"] = metrics.rx_bytes_per_s;
+    serial["lines"] = serialStats.lines;
+    serial["lines_per_s"] = metrics.lines_per_s;
+    serial["overruns"] = serialStats.overruns;
+    serial["discarded"] = serialStats.discarded_lines;
+    serial["frames"] = frameStats.frames;
+    serial["frames_per_s"] = metrics.frames_per_s;
+    serial["bad_frames"] = frameStats.bad_frames;
+    serial["lost_frames"] = frameStats.lost_frames;
+    
+    // [count, mean us, max us] per message type
+    JsonObject parse = data.createNestedObject("parse");
+    for (uint8_t i = 0; i < MSG_KINDS; i++) {
+        const ParseStats& stats = parseStats[i];
+        JsonArray entry = parse.createNestedArray(MESSAGE_KIND_NAMES[i]);
+        entry.add(stats.count);
+        entry.add(stats.count ? stats.total_us / stats.count : 0);
+        entry.add(stats.max_us);
+    }
+    parse["errors"] = parseErrors;
+    
+    JsonObject heap = data.createNestedObject("heap");
+    heap["free"] = ESP.getFreeHeap();
+    heap["max_block"] = ESP.getMaxFreeBlockSize();
+    heap["fragmentation"] = ESP.getHeapFragmentation();
+    
+    JsonObject wifi = data.createNestedObject("wifi");
+    wifi["stations"] = WiFi.softAPgetStationNum();
+    if (WiFi.status() == WL_CONNECTED) {
+        wifi["rssi"] = WiFi.RSSI();
+    }
+    
+#if UPLINK_ENABLED
+    JsonObject up = data.createNestedObject("uplink");
+    up["connected"] = uplink.connected;
+    up["time_synced"] = time(nullptr) >= UPLINK_MIN_EPOCH;
+    up["format"] = uplink.json ? "json" : "get";
+    up["queued"] = uplink.head - uplink.tail;
+    up["sent"] = uplink.sent;
+    up["dropped"] = uplink.dropped;
+    up["requests"] = uplink.requests;
+    up["failures"] = uplink.failures;
+    up["backoff_ms"] = uplink.backoff_ms;
+#endif
+    
+    JsonArray clients = data.createNestedArray("ws_clients");
+    for (const WsSubscriber& sub : subscribers) {
+        if (sub.client_id == 0) {
+            continue;
+        }
+        AsyncWebSocketClient* client = ws.client(sub.client_id);
+        JsonObject obj = clients.createNestedObject();
+        obj["id"] = sub.client_id;
+        obj["rate_hz"] = sub.interval_ms ? 1000 / sub.interval_ms : 0;
+        obj["queue"] = client ? client->queueLen() : 0;
+        obj["drops"] = sub.drops;
+    }
+}
+
+// Block check of the current or last download (see DownloadIndex);
+// times are s since the first data block, recent blocks oldest first
+void fillBlocks(JsonObject data) {
+    data["file"] = dlIndex.file;
+    data["streaming"] = download.state == DL_STREAMING;
+    data["start"] = dlIndex.start;
+    data["bytes"] = dlIndex.active ? dlParser.offset() - dlIndex.start : 0;
+    data["valid"] = dlIndex.active && !dlParser.failed();
+    if (dlIndex.active && dlParser.failed()) {
+        data["error_offset"] = dlParser.errorOffset();
+    }
+    data["data_blocks"] = dlIndex.data_blocks;
+    data["bad_crc"] = dlIndex.bad_crc;
+    data["samples"] = dlIndex.samples;
+    data["session_end"] = dlIndex.session_end;
+    data["indexed"] = dlParser.finished();
+    if (dlIndex.data_blocks > 0) {
+        data["duration_s"] = (dlIndex.last_us - dlIndex.first_us) / 1e6;
+    }
+    
+    JsonArray recent = data.createNestedArray("recent");
+    uint32_t first = dlIndex.data_blocks > DL_SUMMARY_BLOCKS ? dlIndex.data_blocks - DL_SUMMARY_BLOCKS : 0;
+    for (uint32_t i = first; i < dlIndex.data_blocks; i++) {
+        const OplBlockInfo& block = dlIndex.recent[i % DL_SUMMARY_BLOCKS];
+        JsonObject entry = recent.createNestedObject();
+        entry["offset"] = block.offset;
+        entry["seq"] = block.sequence;
+        entry["samples"] = block.sample_count;
+        entry["bytes"] = block.length;
+        entry["flags"] = block.flags;
+        entry["t_s"] = (block.timestamp_start - dlIndex.first_us) / 1e6;
+        entry["dur_s"] = (block.timestamp_end - block.timestamp_start) / 1e6;
+        entry["crc_ok"] = block.crc == OPL_CRC_OK;
+    }
+}
+
+// ============================================================================
+// Satellite Refresh
+// ============================================================================
+
+void noteSatelliteDemand() {
+    lastSatDemandMs = millis();
+    if (!satDemand) {
+        // First poll after a quiet spell - refresh right away
+        satDemand = true;
+        lastSatRequestMs = lastSatDemandMs - SAT_REFRESH_MS;
+    }
+}
+
+void serviceSatelliteRefresh() {
+    if (!satDemand) {
+        return;
+    }
+    
+    unsigned long now = millis();
+    if (now - lastSatDemandMs > SAT_DEMAND_MS) {
+        satDemand = false;
+        return;
+    }
+    if (now - lastSatRequestMs >= SAT_REFRESH_MS) {
+        lastSatRequestMs = now;
+        sendCommandToPico("{\"cmd\":\"GET_SATELLITES\"}");
+    }
+}
+
+// ============================================================================
+// Session Download
+// ============================================================================
+
+// Accepts "bytes=N-" and "bytes=N-M". Suffix and multi-part ranges are
+// ignored, which RFC 7233 allows - the client just gets the whole file.
+bool parseRange(const String& header, uint32_t& offset, uint32_t& length) {
+    const char* s = header.c_str();
+    if (strncmp(s, "bytes=", 6) != 0 || strchr(s, ',')) {
+        return false;
+    }
+    
+    char* end;
+    unsigned long first = strtoul(s + 6, &end, 10);
+    if (end == s + 6 || *end != '-') {
+        return false;
+    }
+    
+    offset = first;
+    length = 0;   // To end of file
+    
+    if (end[1] != '\0') {
+        unsigned long last = strtoul(end + 1, &end, 10);
+        if (*end != '\0' || last < first) {
+            return false;
+        }
+        length = last - first + 1;
+    }
+    return true;
+}
+
+void startDownload(AsyncWebServerRequest *request, const String& filename,
+                   bool ranged, uint32_t offset, uint32_t length, long block) {
+    memset(&download, 0, sizeof(download));
+    download.state = DL_STARTING;
+    download.request = request;
+    download.ranged = ranged;
+    download.acked_seq = 0xFFFF;   // Pico numbers frames from 0
+    download.last_activity_ms = millis();
+    strlcpy(download.file, filename.c_str(), sizeof(download.file));
+    
+    request->onDisconnect(endDownload);
+    
+    StaticJsonDocument<256> doc;
+    doc["cmd"] = "GET";
+    doc["file"] = download.file;
+    doc["window"] = DL_WINDOW;
+    doc["chunk"] = DL_CHUNK_SIZE;
+    if (block >= 0) {
+        doc["block"] = block;
+    } else if (ranged) {
+        doc["offset"] = offset;
+        if (length > 0) {
+            doc["length"] = length;
+        }
+    }
+    
+    char json[160];
+    size_t n = serializeJson(doc, json, sizeof(json));
+    sendCommandToPico(json, n);
+}
+
+void failDownload(int code, const char* message, uint32_t size) {
+    if (download.state == DL_STARTING) {
+        AsyncWebServerResponse *response = download.request->beginResponse(code, "text/plain", message);
+        if (code == 416) {
+            response->addHeader("Content-Range", String("bytes */") + size);
+        }
+        download.request->send(response);
+    }
+    else if (download.state == DL_STREAMING || download.state == DL_FINISHED) {
+        // Headers are out - drop the connection so the client sees a short
+        // body against Content-Length and can resume with Range
+        download.request->client()->close();
+    }
+    download.state = DL_FAILED;
+}
+
+void endDownload() {
+    // Request is going away - stop the Pico unless it already finished
+    if (download.state == DL_STARTING || download.state == DL_STREAMING) {
+        sendCommandToPico("{\"cmd\":\"ABORT\"}");
+    }
+    download.state = DL_IDLE;
+    download.request = nullptr;
+}
+
+void sendDownloadAck(const char* cmd, uint16_t seq) {
+    char json[40];
+    size_t n = snprintf(json, sizeof(json), "{\"cmd\":\"%s\",\"seq\":%u}", cmd, seq);
+    sendCommandToPico(json, n);
+}
+
+void handleFileDataFrame(const uint8_t* data, size_t len) {
+    if (download.state != DL_STREAMING || len < 3) {
+        return;
+    }
+    
+    uint16_t seq = data[1] | (data[2] << 8);
+    const uint8_t* chunk = data + 3;
+    size_t n = len - 3;
+    
+    if (seq != download.next_seq) {
+        // Behind us is a resend we already have; ahead means we lost one
+        if ((int16_t)(seq - download.next_seq) > 0 && !download.nak_sent) {
+            sendDownloadAck("NAK", download.next_seq);
+            download.nak_sent = true;
+        }
+        return;
+    }
+    
+    if (n > DL_CHUNK_SIZE || download.frames_held == DL_WINDOW ||
+        download.received - download.drained + n > DL_BUFFER_SIZE) {
+        frameStats.bad_frames++;   // Pico overran the window
+        return;
+    }
+    
+    size_t pos = download.received % DL_BUFFER_SIZE;
+    size_t first = min(n, DL_BUFFER_SIZE - pos);
+    memcpy(dlBuffer + pos, chunk, first);
+    memcpy(dlBuffer, chunk + first, n - first);
+    
+    download.received += n;
+    download.frame_end[seq % DL_WINDOW] = download.received;
+    download.frames_held++;
+    download.next_seq++;
+    download.nak_sent = false;
+    download.last_activity_ms = millis();
+    
+    indexDownload(chunk, n);
+}
+
+void startDownloadIndex(const char* file, uint32_t offset) {
+    memset(&dlIndex, 0, sizeof(dlIndex));
+    strlcpy(dlIndex.file, file, sizeof(dlIndex.file));
+    dlIndex.start = offset;
+    dlIndex.active = true;
+    dlParser.reset(offset);
+}
+
+void indexDownload(const uint8_t* data, size_t len) {
+    while (len > 0 && dlIndex.active && !dlParser.failed()) {
+        size_t n = dlParser.feed(data, len);
+        data += n;
+        len -= n;
+        if (!dlParser.ready()) {
+            continue;
+        }
+        
+        const OplBlockInfo& block = dlParser.block();
+        if (block.crc == OPL_CRC_BAD) {
+            dlIndex.bad_crc++;
+        }
+        if (block.type == OPL_BLOCK_DATA) {
+            if (dlIndex.data_blocks == 0) {
+                dlIndex.first_us = block.timestamp_start;
+            }
+            dlIndex.last_us = max(dlIndex.last_us, block.timestamp_end);
+            dlIndex.samples += block.sample_count;
+            dlIndex.recent[dlIndex.data_blocks % DL_SUMMARY_BLOCKS] = block;
+            dlIndex.data_blocks++;
+        } else if (block.type == OPL_BLOCK_SESSION_END) {
+            dlIndex.session_end = true;
+        }
+    }
+}
+
+size_t fillDownload(uint8_t *buffer, size_t maxLen, size_t index) {
+    if (download.state == DL_FAILED) {
+        return 0;
+    }
+    
+    size_t avail = download.received - download.drained;
+    if (avail == 0) {
+        return download.state == DL_FINISHED ? 0 : RESPONSE_TRY_AGAIN;
+    }
+    
+    size_t n = min(avail, maxLen);
+    size_t pos = download.drained % DL_BUFFER_SIZE;
+    size_t first = min(n, DL_BUFFER_SIZE - pos);
+    memcpy(buffer, dlBuffer + pos, first);
+    memcpy(buffer + first, dlBuffer, n - first);
+    download.drained += n;
+    
+    // ACK every frame whose bytes are now all in TCP's hands
+    bool acked = false;
+    while (download.frames_held > 0) {
+        uint16_t seq = download.acked_seq + 1;
+        if (download.frame_end[seq % DL_WINDOW] > download.drained) {
+            break;
+        }
+        download.acked_seq = seq;
+        download.frames_held--;
+        acked = true;
+    }
+    if (acked) {
+        sendDownloadAck("ACK", download.acked_seq);
+    }
+    
+    return n;
+}
+
+void serviceDownload() {
+    unsigned long idle = millis() - download.last_activity_ms;
+    
+    if (download.state == DL_STARTING && idle > DL_START_TIMEOUT_MS) {
+        sendCommandToPico("{\"cmd\":\"ABORT\"}");
+        failDownload(504, "Pico did not respond", 0);
+    }
+    else if (download.state == DL_STREAMING && idle > DL_STALL_TIMEOUT_MS &&
+             download.received == download.drained) {
+        // Nothing buffered and nothing arriving - give up on the response
+        sendCommandToPico("{\"cmd\":\"ABORT\"}");
+        failDownload(504, "Transfer stalled", 0);
+    }
+}
+
+// ============================================================================
+// Telemetry History
+// ============================================================================
+
+void recordHistory() {
+    unsigned long now = millis();
+    uint32_t period = now / HISTORY_PERIOD_MS;
+    
+    if (historyCount == 0 || period != historyPeriod) {
+        historyCount++;
+        historyPeriod = period;
+    }
+    
+    HistorySample& sample = history[(historyCount - 1) % HISTORY_SLOTS];
+    sample.ms = now;
+    sample.gx = constrain(lroundf(telemetry.gx * 1000.0f), -32768L, 32767L);
+    sample.gy = constrain(lroundf(telemetry.gy * 1000.0f), -32768L, 32767L);
+    sample.gz = constrain(lroundf(telemetry.gz * 1000.0f), -32768L, 32767L);
+    sample.lat = lroundf(telemetry.lat * 1e7f);
+    sample.lon = lroundf(telemetry.lon * 1e7f);
+    sample.speed = constrain(lroundf(telemetry.speed * 10.0f), 0L, 65535L);
+    sample.sats = telemetry.sats;
+    sample.fix = telemetry.fix;
+}
+
+// Samples covering the last `seconds`, capped at what the ring holds
+uint16_t historyAvailable(uint32_t seconds) {
+    uint32_t held = min(historyCount, (uint32_t)HISTORY_SLOTS);
+    return min(held, seconds * HISTORY_RATE_HZ);
+}
+
+size_t historyLength(uint16_t count) {
+    return sizeof(HistoryHeader) + count * sizeof(HistorySample);
+}
+
+// Copy bytes [index, index + maxLen) of the history message for samples
+// first..first+count-1. A sample overwritten while an HTTP response is
+// still being filled comes out as the newer one - the oldest entries go
+// first and are normally sent long before the ring wraps onto them.
+size_t copyHistory(uint8_t* out, size_t maxLen, size_t index,
+                   uint32_t first, uint16_t count, uint32_t now_ms) {
+    HistoryHeader header = {FRAME_TYPE_HISTORY, HISTORY_RATE_HZ, count, now_ms};
+    size_t total = historyLength(count);
+    size_t n = 0;
+    
+    while (n < maxLen && index < total) {
+        size_t chunk;
+        
+        if (index < sizeof(header)) {
+            chunk = min(maxLen - n, sizeof(header) - index);
+            memcpy(out + n, (const uint8_t*)&header + index, chunk);
+        } else {
+            // Contiguous run up to the end of the ring
+            size_t offset = index - sizeof(header);
+            size_t slot = (first + offset / sizeof(HistorySample)) % HISTORY_SLOTS;
+            size_t pos = slot * sizeof(HistorySample) + offset % sizeof(HistorySample);
+            chunk = min(min(maxLen - n, total - index), sizeof(history) - pos);
+            memcpy(out + n, (const uint8_t*)history + pos, chunk);
+        }
+        
+        n += chunk;
+        index += chunk;
+    }
+    return n;
+}
+
+void sendHistory(AsyncWebSocketClient* client) {
+    uint16_t count = historyAvailable(HISTORY_SECONDS);
+    if (count == 0) {
+        return;
+    }
+    
+    // One heap copy, owned and freed by the WebSocket queue
+    size_t len = historyLength(count);
+    AsyncWebSocketMessageBuffer* buffer = ws.makeBuffer(len);
+    if (!buffer || !buffer->get()) {
+        return;
+    }
+    
+    copyHistory(buffer->get(), len, 0, historyCount - count, count, millis());
+    client->binary(buffer);
+}
+
+// ============================================================================
+// Chart Pyramid
+// ============================================================================
+
+void clearChartBin(ChartBin& bin) {
+    memset(&bin, 0, sizeof(bin));
+    bin.value[CHART_G_TOTAL][0] = 0xFF;    // min > max = empty
+}
+
+void recordChart() {
+    unsigned long now = millis();
+    int16_t value[CHART_CHANNELS];
+    value[CHART_G_TOTAL] = constrain(lroundf(telemetry.g_total / CHART_G_SCALE), 0L, 255L);
+    value[CHART_SPEED] = constrain(lroundf(telemetry.speed), 0L, 255L);
+    value[CHART_LAT_G] = constrain(lroundf(telemetry.gx / CHART_G_SCALE), -128L, 127L);
+    value[CHART_LONG_G] = constrain(lroundf(telemetry.gy / CHART_G_SCALE), -128L, 127L);
+    
+    if (chartSamples == 0) {
+        chartStartMs = now;
+    }
+    
+    for (uint8_t k = 0; k < CHART_LEVELS; k++) {
+        ChartLevel& level = chart[k];
+        uint32_t period = now / ((uint32_t)CHART_BASE_MS << k);
+        
+        if (chartSamples == 0 || period != level.period) {
+            if (chartSamples) {
+                // Empty bins for any periods without telemetry
+                uint32_t skipped = min(period - level.period - 1, (uint32_t)CHART_BINS);
+                for (uint32_t i = 1; i <= skipped; i++) {
+                    clearChartBin(level.bins[(level.period + i) % CHART_BINS]);
+                }
+            }
+            level.period = period;
+            level.count = 0;
+        }
+        
+        ChartBin& bin = level.bins[period % CHART_BINS];
+        for (uint8_t c = 0; c < CHART_CHANNELS; c++) {
+            int16_t v = value[c];
+            if (level.count == 0) {
+                level.min[c] = level.max[c] = v;
+                level.sum[c] = 0;
+            }
+            level.min[c] = min(level.min[c], v);
+            level.max[c] = max(level.max[c], v);
+            level.sum[c] += v;
+            bin.value[c][0] = (uint8_t)level.min[c];
+            bin.value[c][1] = (uint8_t)level.max[c];
+            bin.value[c][2] = (uint8_t)lroundf((float)level.sum[c] / (level.count + 1));
+        }
+        level.count++;
+    }
+    chartSamples++;
+}
+
+// Level and bin range answering [from_ms, to_ms], see the Chart Pyramid
+// notes; count is 0 if nothing has been charted in that range
+void chartQuery(uint32_t from_ms, uint32_t to_ms, uint8_t& level_out,
+                uint32_t& first_out, uint16_t& count_out) {
+    level_out = 0;
+    first_out = 0;
+    count_out = 0;
+    if (chartSamples == 0) {
+        return;
+    }
+    
+    from_ms = max(from_ms, chartStartMs);
+    for (uint8_t k = 0; k < CHART_LEVELS; k++) {
+        const ChartLevel& level = chart[k];
+        uint32_t bin_ms = (uint32_t)CHART_BASE_MS << k;
+        uint32_t oldest = max(chartStartMs / bin_ms,
+                              level.period >= CHART_BINS ? level.period - CHART_BINS + 1 : 0);
+        uint32_t first = from_ms / bin_ms;
+        uint32_t last = min(to_ms / bin_ms, level.period);
+        bool top = k == CHART_LEVELS - 1;
+        
+        if (first < oldest) {
+            if (!top) {
+                continue;    // Aged out of this level
+            }
+            first = oldest;
+        }
+        if (last < first) {
+            return;
+        }
+        if (last - first + 1 > CHART_POINTS) {
+            if (!top) {
+                continue;    // Too many points at this level
+            }
+            first = last - CHART_POINTS + 1;
+        }
+        
+        level_out = k;
+        first_out = first;
+        count_out = last - first + 1;
+        return;
+    }
+}
+
+size_t chartLength(uint16_t count) {
+    return sizeof(ChartHeader) + count * sizeof(ChartBin);
+}
+
+// Copy bytes [index, index + maxLen) of the chart response for bins
+// first..first+count-1 of `level`; same overwrite caveat as copyHistory()
+size_t copyChart(uint8_t* out, size_t maxLen, size_t index, uint8_t level,
+                 uint32_t first, uint16_t count, uint32_t now_ms) {
+    uint32_t bin_ms = (uint32_t)CHART_BASE_MS << level;
+    ChartHeader header = {level, CHART_CHANNELS, count, bin_ms,
+                          first * bin_ms, chartStartMs, now_ms};
+    const uint8_t* bins = (const uint8_t*)chart[level].bins;
+    size_t total = chartLength(count);
+    size_t n = 0;
+    
+    while (n < maxLen && index < total) {
+        size_t chunk;
+        
+        if (index < sizeof(header)) {
+            chunk = min(maxLen - n, sizeof(header) - index);
+            memcpy(out + n, (const uint8_t*)&header + index, chunk);
+        } else {
+            // Contiguous run up to the end of the ring
+            size_t offset = index - sizeof(header);
+            size_t slot = (first + offset / sizeof(ChartBin)) % CHART_BINS;
+            size_t pos = slot * sizeof(ChartBin) + offset % sizeof(ChartBin);
+            chunk = min(min(maxLen - n, total - index), sizeof(chart[level].bins) - pos);
+            memcpy(out + n, bins + pos, chunk);
+        }
+        
+        n += chunk;
+        index += chunk;
+    }
+    return n;
+}
+
+// ============================================================================
+// WebSocket Broadcast Scheduler
+// ============================================================================
+
+WsSubscriber* findSubscriber(uint32_t client_id) {
+    for (WsSubscriber& sub : subscribers) {
+        if (sub.client_id == client_id) {
+            return &sub;
+        }
+    }
+    return nullptr;
+}
+
+void addSubscriber(uint32_t client_id) {
+    WsSubscriber* sub = findSubscriber(0);
+    if (!sub) {
+        return;  // Table full - client can still send commands
+    }
+    
+    sub->client_id = client_id;
+    sub->interval_ms = 1000 / DEFAULT_WS_RATE_HZ;
+    sub->binary = false;
+    sub->last_sent_ms = 0;
+    sub->sent_seq = telemetrySeq;
+    sub->drops = 0;
+}
+
+void removeSubscriber(uint32_t client_id) {
+    WsSubscriber* sub = findSubscriber(client_id);
+    if (sub) {
+        sub->client_id = 0;
+    }
+}
+
+void handleSubscribe(AsyncWebSocketClient* client, JsonDocument& doc) {
+    WsSubscriber* sub = findSubscriber(client->id());
+    if (!sub) {
+        return;
+    }
+    
+    int rate = doc["rate"] | DEFAULT_WS_RATE_HZ;
+    rate = constrain(rate, 0, MAX_WS_RATE_HZ);
+    sub->interval_ms = rate > 0 ? 1000 / rate : 0;
+    sub->binary = strcmp(doc["format"] | "json", "binary") == 0;
+}
+
+void packTelemetryFrame(TelemetryFrame& frame) {
+    frame.frame_type = FRAME_TYPE_TELEMETRY;
+    frame.seq = (uint16_t)telemetrySeq;
+    frame.gx = telemetry.gx;
+    frame.gy = telemetry.gy;
+    frame.gz = telemetry.gz;
+    frame.g_total = telemetry.g_total;
+    frame.lat = telemetry.lat;
+    frame.lon = telemetry.lon;
+    frame.alt = telemetry.alt;
+    frame.speed = telemetry.speed;
+    frame.sats = telemetry.sats;
+    frame.hdop = telemetry.hdop;
+    frame.fix = telemetry.fix;
+}
+
+void serviceBroadcasts() {
+    if (!telemetry.valid) {
+        return;
+    }
+    
+    unsigned long now = millis();
+    
+    for (WsSubscriber& sub : subscribers) {
+        if (sub.client_id == 0 || sub.interval_ms == 0 || sub.sent_seq == telemetrySeq) {
+            continue;
+        }
+        if (now - sub.last_sent_ms < sub.interval_ms) {
+            continue;
+        }
+        
+        AsyncWebSocketClient* client = ws.client(sub.client_id);
+        if (!client) {
+            sub.client_id = 0;
+            continue;
+        }
+        
+        sub.last_sent_ms = now;
+        
+        if (!client->canSend()) {
+            // Queue full - skip this snapshot, the next one supersedes it
+            sub.drops++;
+            continue;
+        }
+        
+        if (sub.binary) {
+            if (wsFrameSeq != telemetrySeq) {
+                packTelemetryFrame(wsFrame);
+                wsFrameSeq = telemetrySeq;
+            }
+            client->binary((const uint8_t*)&wsFrame, sizeof(wsFrame));
+        } else {
+            if (wsTextSeq != telemetrySeq) {
+                wsTextLen = formatTelemetryUpdate(wsTextBuffer, sizeof(wsTextBuffer));
+                wsTextSeq = telemetrySeq;
+            }
+            if (wsTextLen > 0) {
+                client->text(wsTextBuffer, wsTextLen);
+            }
+        }
+        
+        sub.sent_seq = telemetrySeq;
+    }
+}
+
+// ============================================================================
+// WebSocket Handler
+// ============================================================================
+
+void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client,
+               AwsEventType type, void *arg, uint8_t *data, size_t len) {
+    
+    if (type == WS_EVT_CONNECT) {
+        addSubscriber(client->id());
+        sendHistory(client);
+        
+        if (telemetry.valid) {
+            String json = getTelemetryJSON();
+            client->text(json);
+        }
+    }
+    else if (type == WS_EVT_DISCONNECT) {
+        removeSubscriber(client->id());
+    }
+    else if (type == WS_EVT_DATA) {
+        AwsFrameInfo *info = (AwsFrameInfo*)arg;
+        
+        if (info->final && info->index == 0 && info->len == len) {
+            // Subscriptions are handled here; everything else goes to the Pico
+            StaticJsonDocument<128> doc;
+            if (!deserializeJson(doc, (const char*)data, len) &&
+                strcmp(doc["cmd"] | "", "subscribe") == 0) {
+                handleSubscribe(client, doc);
+                return;
+            }
+            sendCommandToPico((const char*)data, len);
+        }
+    }
+}
+
+// ============================================================================
+// Uplink
+// ============================================================================
+
+#if UPLINK_ENABLED
+void setupUplink() {
+    uplink.json = true;
+    uplink.backoff_ms = UPLINK_BACKOFF_MS;
+    
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(UPLINK_SSID, UPLINK_PASSWORD);
+    configTime(0, 0, UPLINK_NTP_SERVER);
+    
+    // Callbacks only record the outcome; serviceUplink() acts on it
+    uplinkClient.onConnect([](void*, AsyncClient* client) {
+        sendUplinkRequest(client);
+    });
+    uplinkClient.onAck([](void*, AsyncClient* client, size_t, uint32_t) {
+        sendUplinkRequest(client);
+    });
+    uplinkClient.onData([](void*, AsyncClient* client, void* data, size_t len) {
+        // Only the status line matters: "HTTP/1.1 200 ..."
+        const char* reply = (const char*)data;
+        if (uplink.status == 0 && len >= 12 && strncmp(reply, "HTTP/", 5) == 0) {
+            uplink.status = atoi(reply + 9);
+        }
+        client->close();
+    });
+    uplinkClient.onError([](void*, AsyncClient*, int8_t) {
+        uplink.done = true;
+    });
+    uplinkClient.onTimeout([](void*, AsyncClient* client, uint32_t) {
+        client->close(true);
+    });
+    uplinkClient.onDisconnect([](void*, AsyncClient*) {
+        uplink.done = true;
+    });
+}
+
+// Hands TCP as much of the request as its send buffer takes. Not copied:
+// uplinkRequest is left alone until the request is done.
+void sendUplinkRequest(AsyncClient* client) {
+    size_t n = min(client->space(), uplink.length - uplink.written);
+    if (n == 0) {
+        return;
+    }
+    if (client->add(uplinkRequest + uplink.written, n, 0) != n) {
+        client->close(true);
+        return;
+    }
+    uplink.written += n;
+    client->send();
+}
+
+void reportWifiStatus(bool connected) {
+    StaticJsonDocument<128> doc;
+    doc["type"] = "wifi_status";
+    doc["connected"] = connected;
+    if (connected) {
+        doc["ip"] = WiFi.localIP().toString();
+    }
+    
+    String json;
+    serializeJson(doc, json);
+    PicoSerial.println(json);
+}
+
+// Called with every telemetry update - decimation only, no I/O
+void recordUplink() {
+    if (telemetry.fix == FIX_NONE) {
+        return;
+    }
+    
+    unsigned long now = millis();
+    int32_t lat = lroundf(telemetry.lat * 1e7f);
+    int32_t lon = lroundf(telemetry.lon * 1e7f);
+    uint16_t course = 0;
+    
+    if (uplink.have_last) {
+        uint32_t age = now - uplink.last.ms;
+        if (age < UPLINK_MIN_INTERVAL_MS) {
+            return;
+        }
+        
+        // Equirectangular is plenty over a few metres
+        float north = (lat - uplink.last.lat) * 0.0111195f;
+        float east = (lon - uplink.last.lon) * 0.0111195f * cosf(telemetry.lat * (float)DEG_TO_RAD);
+        float moved = sqrtf(north * north + east * east);
+        if (moved < UPLINK_MIN_DISTANCE_M && age < UPLINK_MAX_INTERVAL_MS) {
+            return;
+        }
+        
+        course = uplink.last.course;
+        if (moved >= UPLINK_MIN_DISTANCE_M) {
+            float degrees = atan2f(east, north) * (float)RAD_TO_DEG;
+            course = lroundf((degrees < 0 ? degrees + 360.0f : degrees) * 10.0f) % 3600;
+        }
+    }
+    
+    if (uplink.head - uplink.tail >= UPLINK_SLOTS) {
+        uplink.tail++;
+        uplink.dropped++;
+    }
+    
+    UplinkPosition& pos = uplinkQueue[uplink.head % UPLINK_SLOTS];
+    pos.ms = now;
+    pos.lat = lat;
+    pos.lon = lon;
+    pos.alt = constrain(lroundf(telemetry.alt), -32768L, 32767L);
+    pos.speed = constrain(lroundf(telemetry.speed * 10.0f), 0L, 65535L);
+    pos.course = course;
+    pos.hdop = constrain(lroundf(telemetry.hdop * 10.0f), 0L, 255L);
+    pos.sats = telemetry.sats;
+    uplink.head++;
+    
+    uplink.last = pos;
+    uplink.have_last = true;
+}
+
+// Fixed-point value as a decimal string, e.g. -712345678 / 7 -> "-71.2345678"
+size_t formatFixed(char* out, size_t size, int32_t value, uint8_t decimals) {
+    static const uint32_t SCALE[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+    uint32_t magnitude = value < 0 ? -(int64_t)value : value;
+    return snprintf(out, size, "%s%lu.%0*lu", value < 0 ? "-" : "",
+                    (unsigned long)(magnitude / SCALE[decimals]), decimals,
+                    (unsigned long)(magnitude % SCALE[decimals]));
+}
+
+// Wall-clock seconds of a queued position
+time_t uplinkEpoch(const UplinkPosition& pos, time_t now_epoch, unsigned long now_ms) {
+    return now_epoch - (time_t)((now_ms - pos.ms) / 1000);
+}
+
+// One OsmAnd JSON location
+size_t formatUplinkLocation(char* out, size_t size, const UplinkPosition& pos, time_t epoch) {
+    char lat[16], lon[16], speed[12], course[12], hdop[8], stamp[24];
+    struct tm utc;
+    gmtime_r(&epoch, &utc);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    formatFixed(lat, sizeof(lat), pos.lat, 7);
+    formatFixed(lon, sizeof(lon), pos.lon, 7);
+    formatFixed(speed, sizeof(speed), lroundf(pos.speed * 4.4704f), 2);    // 0.1 MPH -> 0.01 m/s
+    formatFixed(course, sizeof(course), pos.course, 1);
+    formatFixed(hdop, sizeof(hdop), pos.hdop, 1);
+    return snprintf(out, size,
+                    "{\"timestamp\":\"%s\",\"coords\":{\"latitude\":%s,\"longitude\":%s,"
+                    "\"altitude\":%d,\"speed\":%s,\"heading\":%s,\"accuracy\":%s}}",
+                    stamp, lat, lon, pos.alt, speed, course, hdop);
+}
+
+// Builds uplinkRequest from the oldest queued positions; returns how many
+size_t buildUplinkRequest(unsigned long now_ms) {
+    time_t now_epoch = time(nullptr);
+    uint32_t queued = uplink.head - uplink.tail;
+    const UplinkPosition& oldest = uplinkQueue[uplink.tail % UPLINK_SLOTS];
+    
+    if (!uplink.json) {
+        // One GET per position; speed in knots
+        char lat[16], lon[16], speed[12], course[12], hdop[8];
+        formatFixed(lat, sizeof(lat), oldest.lat, 7);
+        formatFixed(lon, sizeof(lon), oldest.lon, 7);
+        formatFixed(speed, sizeof(speed), lroundf(oldest.speed * 0.868976f), 1);
+        formatFixed(course, sizeof(course), oldest.course, 1);
+        formatFixed(hdop, sizeof(hdop), oldest.hdop, 1);
+        int n = snprintf(uplinkRequest, sizeof(uplinkRequest),
+                         "GET /?id=%s&timestamp=%lu&lat=%s&lon=%s&altitude=%d&speed=%s"
+                         "&bearing=%s&hdop=%s HTTP/1.1\r\nHost: %s:%u\r\nConnection: close\r\n\r\n",
+                         UPLINK_DEVICE_ID, (unsigned long)uplinkEpoch(oldest, now_epoch, now_ms),
+                         lat, lon, oldest.alt, speed, course, hdop, UPLINK_HOST, UPLINK_PORT);
+        if (n <= 0 || n >= (int)sizeof(uplinkRequest)) {
+            return 0;
+        }
+        uplink.length = n;
+        return 1;
+    }
+    
+    // Body first, after room for the headers
+    char* body = uplinkRequest + UPLINK_HEADER_SIZE;
+    char* end = uplinkRequest + sizeof(uplinkRequest);
+    char* p = body;
+    p += snprintf(p, end - p, "{\"device_id\":\"%s\",\"location\":[", UPLINK_DEVICE_ID);
+    
+    size_t count = 0;
+    while (count < queued && count < UPLINK_BATCH && end - p > UPLINK_LOCATION_SIZE) {
+        if (count) {
+            *p++ = ',';
+        }
+        const UplinkPosition& pos = uplinkQueue[(uplink.tail + count) % UPLINK_SLOTS];
+        p += formatUplinkLocation(p, end - p, pos, uplinkEpoch(pos, now_epoch, now_ms));
+        count++;
+    }
+    *p++ = ']';
+    *p++ = '}';
+    size_t body_len = p - body;
+    
+    char header[UPLINK_HEADER_SIZE];
+    int n = snprintf(header, sizeof(header),
+                     "POST / HTTP/1.1\r\nHost: %s:%u\r\nContent-Type: application/json\r\n"
+                     "Content-Length: %u\r\nConnection: close\r\n\r\n",
+                     UPLINK_HOST, UPLINK_PORT, (unsigned)body_len);
+    if (n <= 0 || n >= (int)sizeof(header)) {
+        return 0;
+    }
+    memcpy(body - n, header, n);
+    memmove(uplinkRequest, body - n, n + body_len);
+    uplink.length = n + body_len;
+    return count;
+}
+
+void finishUplinkRequest(unsigned long now) {
+    uplink.state = UL_IDLE;
+    uplink.requests++;
+    
+    if (uplink.status >= 200 && uplink.status < 300) {
+        // Positions overwritten while in flight have already moved tail
+        uint32_t next = uplink.first + uplink.count;
+        if ((int32_t)(next - uplink.tail) > 0) {
+            uplink.tail = next;
+        }
+        uplink.sent += uplink.count;
+        uplink.backoff_ms = UPLINK_BACKOFF_MS;
+        return;
+    }
+    
+    if (uplink.json && (uplink.status == 400 || uplink.status == 404 ||
+                        uplink.status == 405 || uplink.status == 415)) {
+        // No JSON batches on this server - resend as GETs straight away
+        uplink.json = false;
+        return;
+    }
+    
+    uplink.failures++;
+    uplink.retry_ms = now + uplink.backoff_ms;
+    uplink.backoff_ms = min(uplink.backoff_ms * 2, (unsigned long)UPLINK_BACKOFF_MAX_MS);
+}
+
+void serviceUplink() {
+    unsigned long now = millis();
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected != uplink.connected) {
+        uplink.connected = connected;
+        reportWifiStatus(connected);
+    }
+    
+    if (uplink.state == UL_BUSY) {
+        if (!uplink.done && now - uplink.started_ms > UPLINK_TIMEOUT_MS) {
+            uplinkClient.close(true);
+            uplink.done = true;
+        }
+        if (uplink.done) {
+            finishUplinkRequest(now);
+        }
+        return;
+    }
+    
+    uint32_t queued = uplink.head - uplink.tail;
+    if (!connected || queued == 0 || (long)(now - uplink.retry_ms) < 0 ||
+        time(nullptr) < UPLINK_MIN_EPOCH) {
+        return;
+    }
+    
+    // Wait for a full batch unless the oldest position is getting stale
+    const UplinkPosition& oldest = uplinkQueue[uplink.tail % UPLINK_SLOTS];
+    if (uplink.json && queued < UPLINK_BATCH && now - oldest.ms < UPLINK_FLUSH_MS) {
+        return;
+    }
+    
+    uplink.first = uplink.tail;
+    uplink.count = buildUplinkRequest(now);
+    if (uplink.count == 0) {
+        return;
+    }
+    
+    uplink.status = 0;
+    uplink.written = 0;
+    uplink.done = false;
+    uplink.started_ms = now;
+    uplink.state = UL_BUSY;
+    if (!uplinkClient.connect(UPLINK_HOST, UPLINK_PORT)) {
+        uplink.status = -1;
+        uplink.done = true;
+    }
+}
+#else
+void recordUplink() {}
+void serviceUplink() {}
+#endif
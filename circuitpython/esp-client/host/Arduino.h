@@ -0,0 +1,30 @@
+/**
+ * Arduino.h - Just enough of the ESP8266 core to build bridge.cpp on the host
+ *
+ * Not the real API: only what the protocol code uses. millis() and micros()
+ * run off the host's monotonic clock (bridge_bench.cpp).
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual size_t readBytes(char* buffer, size_t length) = 0;
+};
@@ -0,0 +1,24 @@
+/**
+ * ESPAsyncWebServer.h - WebSocket mock for the host build of bridge.cpp
+ *
+ * Broadcasts are counted, not sent.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class AsyncWebSocket {
+public:
+    explicit AsyncWebSocket(const char* url) : url(url) {}
+    
+    void textAll(const char* message, size_t len) {
+        (void)message;
+        messages++;
+        bytes += len;
+    }
+    
+    const char* url;
+    uint32_t messages = 0;
+    uint64_t bytes = 0;
+};
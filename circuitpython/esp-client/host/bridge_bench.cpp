@@ -0,0 +1,231 @@
+/**
+ * bridge_bench.cpp - Replay Pico UART traffic through bridge.cpp on the host
+ *
+ * Usage: bridge_bench [--repeat N] [--chunk N] capture...
+ *
+ * A capture is the raw byte stream the Pico writes to the ESP: JSON lines
+ * and binary frames, as recorded off the Pico's TX pin with a USB-UART
+ * adapter (cat /dev/ttyUSB0 > drive.uart) or made from a logged session
+ * with opl2uart.py. Each capture is fed to processSerialData() `chunk`
+ * bytes per available() (the ESP's UART FIFO), `repeat` times, and the
+ * bridge's own counters give the message mix. Reported per capture:
+ *
+ *   msg/s, ns/msg   Wall time in processSerialData() per line or frame
+ *   heap peak       Most bytes live from operator new at any point
+ *   allocs/msg      operator new calls per line or frame
+ *
+ * The sketch-side hooks (history, chart, uplink, downloads, pending HTTP
+ * requests) are no-ops here, so the numbers are the protocol path alone.
+ */
+
+#include "bridge.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// ============================================================================
+// Platform
+// ============================================================================
+
+static const auto benchStart = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - benchStart).count();
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - benchStart).count();
+}
+
+// Capture bytes, at most `chunk` per available() like the UART FIFO
+class ReplayStream : public Stream {
+public:
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    size_t pos = 0;
+    size_t chunk = 128;
+
+    int available() override {
+        return (int)min(length - pos, chunk);
+    }
+
+    size_t readBytes(char* buffer, size_t want) override {
+        size_t n = min(want, length - pos);
+        memcpy(buffer, data + pos, n);
+        pos += n;
+        return n;
+    }
+};
+
+ReplayStream replay;
+Stream& bridgeUart = replay;
+AsyncWebSocket ws("/ws");
+
+uint32_t telemetryUpdates = 0;
+uint32_t hookCalls = 0;
+
+void telemetryUpdated() { telemetryUpdates++; }
+void handleFileList(JsonDocument&, const char*, size_t) { hookCalls++; }
+void handleFileTransfer(JsonDocument&, const char*, size_t) { hookCalls++; }
+void handleResponse(JsonDocument&, const char*, size_t) { hookCalls++; }
+void handleFileDataFrame(const uint8_t*, size_t) { hookCalls++; }
+
+// ============================================================================
+// Heap Accounting
+// ============================================================================
+
+// Each block carries its size in front so delete can account for it
+struct HeapStats {
+    uint64_t allocations;
+    size_t live;
+    size_t peak;
+};
+
+HeapStats heap = {0, 0, 0};
+const size_t HEAP_HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    uint8_t* p = (uint8_t*)malloc(size + HEAP_HEADER);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    *(size_t*)p = size;
+    heap.allocations++;
+    heap.live += size;
+    heap.peak = max(heap.peak, heap.live);
+    return p + HEAP_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) {
+        return;
+    }
+    uint8_t* p = (uint8_t*)ptr - HEAP_HEADER;
+    heap.live -= *(size_t*)p;
+    free(p);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+
+bool readCapture(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+void resetBridge() {
+    resetSerialFramer();
+    serialStats = {0, 0, 0, 0};
+    frameStats = {0, 0, 0};
+    memset(parseStats, 0, sizeof(parseStats));
+    parseErrors = 0;
+    telemetry.valid = false;
+    telemetryUpdates = 0;
+    hookCalls = 0;
+    ws.messages = 0;
+    ws.bytes = 0;
+}
+
+void benchCapture(const char* path, const std::vector<uint8_t>& capture,
+                  uint32_t repeat, size_t chunk) {
+    resetBridge();
+    replay.chunk = chunk;
+
+    // Includes the satellite vector growing on the first pass, as it
+    // would on the ESP
+    heap.peak = heap.live;
+    size_t base = heap.live;
+    uint64_t allocs = heap.allocations;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < repeat; r++) {
+        replay.data = capture.data();
+        replay.length = capture.size();
+        replay.pos = 0;
+        telemetry.valid = false;    // Don't count the wrap as lost frames
+        while (replay.pos < replay.length) {
+            processSerialData();
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    uint64_t messages = (uint64_t)serialStats.lines + frameStats.frames +
+                        frameStats.bad_frames + serialStats.discarded_lines;
+    allocs = heap.allocations - allocs;
+
+    printf("%s: %zu bytes, %llu messages per pass, %u passes\n", path, capture.size(),
+           (unsigned long long)(messages / repeat), repeat);
+    if (messages == 0) {
+        printf("  no complete lines\n");
+        return;
+    }
+    printf("  %.0f msg/s  %.0f ns/msg  %.1f MB/s\n",
+           messages / (ns / 1e9), ns / messages,
+           capture.size() * (double)repeat / (ns / 1e3));
+    printf("  heap peak %zu B  allocs/msg %.3f\n", heap.peak - base, (double)allocs / messages);
+    printf("  json lines %u  frames %u  bad frames %u  lost %u  discarded %u  parse errors %u\n",
+           serialStats.lines, frameStats.frames, frameStats.bad_frames,
+           frameStats.lost_frames, serialStats.discarded_lines, parseErrors);
+    printf("  telemetry updates %u  ws broadcasts %u (%llu B)\n", telemetryUpdates,
+           ws.messages, (unsigned long long)ws.bytes);
+    for (uint8_t i = 0; i < MSG_KINDS; i++) {
+        if (parseStats[i].count) {
+            printf("    %-14s %8u\n", MESSAGE_KIND_NAMES[i], parseStats[i].count);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t repeat = 10;
+    size_t chunk = 128;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = max(1, atoi(argv[++i]));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        fprintf(stderr, "Usage: %s [--repeat N] [--chunk N] capture...\n", argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (const char* path : paths) {
+        std::vector<uint8_t> capture;
+        if (!readCapture(path, capture)) {
+            status = 1;
+            continue;
+        }
+        benchCapture(path, capture, repeat, chunk);
+    }
+    return status;
+}
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+opl2uart.py - Replay a logged session as the Pico's UART stream to the ESP
+
+Rebuilds what the Pico would have written to the ESP-01S during a session
+from its .opl file, through the real serial_com.JSONProtocol, so the host
+benchmark (bridge_bench) can be fed real drives:
+
+- telemetry at --rate Hz from the newest accel/IMU and GPS samples
+- a satellites message whenever the log has a satellite sample
+- lap messages at each lap timer event
+
+Usage:
+    python3 opl2uart.py session_00001.opl session_00001.uart
+    python3 opl2uart.py session_00001.opl session_00001.bin.uart --binary
+"""
+
+import argparse
+import math
+import struct
+import sys
+from pathlib import Path
+
+HERE = Path(__file__).resolve().parent
+sys.path.insert(0, str(HERE.parents[2] / 'tools'))
+sys.path.insert(0, str(HERE.parents[1]))
+
+from opl2csv import OPLReader                           # noqa: E402
+from opl_types import LAP_EVENT_NAMES, LAP_NO_DELTA     # noqa: E402
+from binary_logger import LAP_FORMAT, LAP_SIZE          # noqa: E402
+from serial_com import JSONProtocol, CAP_BIN_TELEMETRY  # noqa: E402
+
+LAP_EVENT_CODES = {name: code for code, name in LAP_EVENT_NAMES.items()}
+
+
+class CaptureUART:
+    """Stands in for busio.UART, keeping everything written"""
+
+    def __init__(self):
+        self.data = bytearray()
+
+    def write(self, buf):
+        self.data += buf
+        return len(buf)
+
+
+def load_samples(filepath):
+    """All samples of a session in time order"""
+    reader = OPLReader(filepath)
+    _, blocks = reader.read_all()
+    samples = []
+    for block in blocks:
+        samples.extend(block['samples'])
+    samples.sort(key=lambda s: s['timestamp_us'])
+    return samples
+
+
+def convert(samples, binary=False, rate_hz=10):
+    """
+    Returns:
+        (bytes written to the UART, messages sent)
+    """
+    uart = CaptureUART()
+    link = JSONProtocol(uart, None, None, [CAP_BIN_TELEMETRY] if binary else [])
+
+    interval_us = 1000000 // rate_hz
+    next_us = None
+    accel = None
+    gps = None
+    lap_event = bytearray(LAP_SIZE)
+    messages = 0
+
+    for sample in samples:
+        kind = sample['type']
+        t = sample['timestamp_us']
+
+        if kind in ('accel', 'imu'):
+            accel = sample
+        elif kind == 'gps':
+            gps = sample
+        elif kind == 'satellites':
+            link.send_json({
+                "type": "satellites",
+                "count": len(sample['satellites']),
+                "satellites": sample['satellites']
+            })
+            messages += 1
+        elif kind == 'lap':
+            delta = sample['delta_us']
+            struct.pack_into(LAP_FORMAT, lap_event, 0,
+                             LAP_EVENT_CODES.get(sample['kind'], 0), sample['gate'],
+                             sample['lap'], sample['split_us'], sample['lap_us'],
+                             LAP_NO_DELTA if delta is None else delta)
+            link.send_lap(lap_event)
+            messages += 1
+
+        if (accel is None and gps is None) or (next_us is not None and t < next_us):
+            continue
+        next_us = t + interval_us
+
+        gx, gy, gz = (accel['gx'], accel['gy'], accel['gz']) if accel else (0.0, 0.0, 1.0)
+        data = {
+            "g": {"x": gx, "y": gy, "z": gz, "total": math.sqrt(gx*gx + gy*gy + gz*gz)},
+            "gps": {
+                "lat": gps['lat'] if gps else 0.0,
+                "lon": gps['lon'] if gps else 0.0,
+                "alt": gps['alt'] if gps else 0.0,
+                "speed": gps['speed'] if gps else 0.0,
+                "sats": 0,
+                "hdop": gps['hdop'] if gps else 0.0,
+                "fix": "3d" if gps else "NoFix"
+            }
+        }
+        link.send_telemetry(data)
+        messages += 1
+
+    link.flush_tx()
+    return bytes(uart.data), messages
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Rebuild the Pico-to-ESP UART stream of a session')
+    parser.add_argument('input', help='Input .opl file')
+    parser.add_argument('output', help='Output capture for bridge_bench')
+    parser.add_argument('--binary', action='store_true',
+                        help='Binary telemetry frames (ESP advertised bin_telemetry)')
+    parser.add_argument('--rate', type=int, default=10,
+                        help='Telemetry rate in Hz (default: 10)')
+    args = parser.parse_args()
+
+    try:
+        data, messages = convert(load_samples(args.input), args.binary, max(1, args.rate))
+    except Exception as e:
+        print(f"Error: {e}")
+        sys.exit(1)
+
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print(f"{args.output}: {messages} messages, {len(data)} bytes")
+
+
+if __name__ == '__main__':
+    main()
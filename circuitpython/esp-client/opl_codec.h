@@ -0,0 +1,914 @@
+/**
+ * opl_codec.h - OpenPonyLogger .opl session file codec (header only)
+ *
+ * The C++ definition of the format circuitpython/binary_logger.py writes,
+ * shared by the ESP sketch and the native tools (tools/opl-dump.cpp):
+ *
+ * - Packed structs for every fixed-layout block and sample
+ * - OplStreamParser: checks block layout and CRC32 as bytes go by, fed in
+ *   any chunking (download frames, file reads), with no heap and under
+ *   100 bytes of state
+ * - OplSampleIterator: walks the samples of one data block held in
+ *   memory, plain or compressed (format 2.1), with timestamps in us
+ *
+ * Multi-byte fields are little-endian, as on both the ESP8266 and x86 -
+ * structs are memcpy'd straight out of the byte stream.
+ *
+ * binary_logger.py is the writer and opl_types.py the Python reader;
+ * a format change touches all three. Layouts are described in
+ * docs/BINARY_LOGGING_INTEGRATION.md.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// Constants
+// ============================================================================
+
+#define OPL_MAGIC "OPNY"
+#define OPL_FORMAT_MAJOR 2
+#define OPL_FORMAT_MINOR 1
+
+// Block types
+#define OPL_BLOCK_SESSION_HEADER 0x01
+#define OPL_BLOCK_DATA 0x02
+#define OPL_BLOCK_SESSION_END 0x03
+#define OPL_BLOCK_HARDWARE_CONFIG 0x04
+#define OPL_BLOCK_INDEX 0x05           // Data block index (after session end)
+#define OPL_BLOCK_INDEX_TRAILER 0x06   // Fixed-size pointer to the index, last in file
+
+// Flush flags (bitmask), and the block flag sharing their byte
+#define OPL_FLUSH_TIME 0x01
+#define OPL_FLUSH_SIZE 0x02
+#define OPL_FLUSH_EVENT 0x04
+#define OPL_FLUSH_MANUAL 0x08
+#define OPL_FLUSH_SHUTDOWN 0x10
+#define OPL_BLOCK_COMPRESSED 0x80
+
+// Sample types
+#define OPL_SAMPLE_ACCEL 0x01
+#define OPL_SAMPLE_GPS_FIX 0x02
+#define OPL_SAMPLE_GPS_SATELLITES 0x03
+#define OPL_SAMPLE_GYRO 0x04
+#define OPL_SAMPLE_MAG 0x05
+#define OPL_SAMPLE_IMU 0x06            // Accel + gyro (+ mag), one timestamp
+#define OPL_SAMPLE_IMU_BURST 0x07      // N raw FIFO records at a fixed interval
+#define OPL_SAMPLE_PROFILE 0x08        // Main loop stage timings
+#define OPL_SAMPLE_LAP 0x09            // Start/finish or sector gate crossing
+#define OPL_SAMPLE_OBD_PID 0x10
+#define OPL_SAMPLE_EVENT_MARKER 0x20   // First sample of an event capture block
+
+// Limits
+#define OPL_MAX_BLOCK_SIZE 4096
+#define OPL_MAX_SAMPLE_SIZE 255        // Sample length is one byte
+#define OPL_MAX_HARDWARE_ITEMS 32
+
+#define OPL_IMU_CHANNEL_ACCEL 0x01
+#define OPL_IMU_CHANNEL_GYRO 0x02
+#define OPL_LAP_NO_DELTA INT32_MIN
+
+// Compressed GPS lat/lon counts per degree
+#define OPL_GPS_SCALE 10000000.0
+
+// ============================================================================
+// Blocks
+// ============================================================================
+
+// Session header: these fixed fields, then session name, driver and
+// vehicle as length-prefixed strings, then OplSessionTail (absent in
+// files from older firmware)
+struct __attribute__((packed)) OplSessionHeader {
+    char magic[4];
+    uint8_t type;
+    uint8_t format_major;
+    uint8_t format_minor;
+    uint8_t hw_major;
+    uint8_t hw_minor;
+    uint64_t timestamp_us;
+    uint8_t session_id[16];
+};
+
+struct __attribute__((packed)) OplSessionTail {
+    uint8_t weather;
+    int16_t ambient_temp;      // 0.1 C
+    uint32_t config_crc;
+    uint32_t crc;              // CRC32 of the header up to here
+};
+
+// Hardware config: magic, type, item count, then per item hardware type,
+// connection type, identifier length + identifier - then CRC32
+
+struct __attribute__((packed)) OplDataBlockHeader {
+    char magic[4];
+    uint8_t type;
+    uint8_t session_id[16];
+    uint32_t sequence;
+    uint64_t timestamp_start;  // us
+    uint64_t timestamp_end;
+    uint8_t flags;             // OPL_FLUSH_* | OPL_BLOCK_COMPRESSED
+    uint16_t sample_count;
+    uint16_t data_size;        // Sample bytes - CRC32 of header + samples follows
+};
+
+struct __attribute__((packed)) OplSessionEnd {
+    char magic[4];
+    uint8_t type;
+    uint8_t session_id[16];
+};
+
+// Index: this header, count entries, CRC32 of header + entries
+struct __attribute__((packed)) OplIndexHeader {
+    char magic[4];
+    uint8_t type;
+    uint8_t session_id[16];
+    uint32_t count;
+};
+
+struct __attribute__((packed)) OplIndexEntry {
+    uint32_t offset;           // File offset of the data block
+    uint32_t sequence;
+    uint64_t timestamp_start;
+    uint64_t timestamp_end;
+    uint16_t sample_count;
+    uint8_t flags;
+};
+
+struct __attribute__((packed)) OplIndexTrailer {
+    char magic[4];
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t index_offset;
+    uint32_t crc;              // CRC32 of the first 12 bytes
+};
+
+// ============================================================================
+// Samples
+// ============================================================================
+
+// Plain encoding: this header then `length` payload bytes. Compressed
+// blocks are re-encoded to it by OplSampleIterator.
+struct __attribute__((packed)) OplSampleHeader {
+    uint8_t type;
+    uint16_t offset_ms;        // From the block's timestamp_start
+    uint8_t length;
+};
+
+struct __attribute__((packed)) OplGpsFix {
+    double lat;
+    double lon;
+    float alt;
+    float speed;
+    float heading;
+    float hdop;
+};
+
+// GPS fix as 24-byte files from older firmware have it
+struct __attribute__((packed)) OplGpsFixV1 {
+    float lat, lon, alt, speed, heading, hdop;
+};
+
+struct __attribute__((packed)) OplSatellite {
+    uint8_t id;
+    uint16_t azimuth;
+    uint8_t elevation;
+    uint8_t snr;
+};
+
+// IMU burst: this header, then count records of int16 X/Y/Z per channel
+// (accel before gyro)
+struct __attribute__((packed)) OplImuBurstHeader {
+    uint8_t count;
+    uint8_t channels;          // OPL_IMU_CHANNEL_*
+    uint16_t interval_us;
+    float accel_lsb;           // g per count
+    float gyro_lsb;            // dps per count
+};
+
+struct __attribute__((packed)) OplEventMarker {
+    uint8_t kind;              // 1 = g force
+    uint16_t first;            // Window record this block starts at
+    uint16_t pre;              // Records up to and including the trigger
+    uint16_t post;
+    uint16_t interval_us;
+    float peak_g;
+};
+
+struct __attribute__((packed)) OplLap {
+    uint8_t kind;              // 1 start, 2 sector, 3 lap
+    uint8_t gate;              // 0 = start/finish
+    uint16_t lap;
+    uint32_t split_us;
+    uint32_t lap_us;
+    int32_t delta_us;          // OPL_LAP_NO_DELTA before a best lap exists
+};
+
+// Loop profile: this header, stages * OplProfileStage, then scheduler
+// deadline misses and deferrals (uint16 each, newer records)
+struct __attribute__((packed)) OplProfileHeader {
+    uint16_t loops;
+    uint8_t stages;
+};
+
+struct __attribute__((packed)) OplProfileStage {
+    uint8_t id;
+    uint16_t count;
+    uint16_t min_us;
+    uint16_t avg_us;
+    uint16_t p99_us;
+    uint32_t max_us;
+};
+
+static_assert(sizeof(OplSessionHeader) == 33, "session header layout");
+static_assert(sizeof(OplSessionTail) == 11, "session tail layout");
+static_assert(sizeof(OplDataBlockHeader) == 46, "data block header layout");
+static_assert(sizeof(OplSessionEnd) == 21, "session end layout");
+static_assert(sizeof(OplIndexHeader) == 25, "index header layout");
+static_assert(sizeof(OplIndexEntry) == 27, "index entry layout");
+static_assert(sizeof(OplIndexTrailer) == 16, "index trailer layout");
+static_assert(sizeof(OplSampleHeader) == 4, "sample header layout");
+static_assert(sizeof(OplGpsFix) == 32, "GPS fix layout");
+static_assert(sizeof(OplImuBurstHeader) == 12, "IMU burst layout");
+static_assert(sizeof(OplEventMarker) == 13, "event marker layout");
+static_assert(sizeof(OplLap) == 16, "lap layout");
+static_assert(sizeof(OplProfileStage) == 13, "profile stage layout");
+
+// ============================================================================
+// CRC32
+// ============================================================================
+
+// CRC-32 (zlib / binary_logger.crc32), chained like zlib.crc32(data, crc).
+// Four bits at a time - a 64-byte table, which matters on the ESP where
+// const data sits in RAM.
+inline uint32_t oplCrc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// ============================================================================
+// Stream Parser
+// ============================================================================
+
+enum OplCrcStatus : uint8_t {
+    OPL_CRC_NONE,              // Block has no CRC (session end, old header)
+    OPL_CRC_OK,
+    OPL_CRC_BAD
+};
+
+// One block as OplStreamParser saw it go by
+struct OplBlockInfo {
+    uint32_t offset;           // Stream offset of the block's magic
+    uint32_t length;           // Bytes, CRC included
+    uint8_t type;              // OPL_BLOCK_*
+    uint8_t flags;             // Data blocks
+    OplCrcStatus crc;
+    uint16_t sample_count;     // Data blocks
+    uint32_t sequence;         // Data blocks; index: entry count
+    uint64_t timestamp_start;  // Data blocks; session header: session start
+    uint64_t timestamp_end;
+};
+
+/**
+ * Checks blocks as their bytes go by and reports each one as it ends.
+ * feed() stops after the last byte of a block so it can be collected:
+ *
+ *   while (len > 0 && !parser.failed()) {
+ *       size_t n = parser.feed(data, len);
+ *       data += n;
+ *       len -= n;
+ *       if (parser.ready()) {
+ *           use(parser.block());
+ *       }
+ *   }
+ *
+ * A stream can start at any block boundary (a download resumed from a
+ * data block); anything else that isn't a block fails the parser, and
+ * errorOffset() says where.
+ */
+class OplStreamParser {
+public:
+    OplStreamParser() { reset(); }
+
+    // Start over, the next byte being at `offset` in the file
+    void reset(uint32_t offset = 0) {
+        pos_ = offset;
+        ready_ = false;
+        failed_ = false;
+        trailer_ = false;
+        beginBlock();
+    }
+
+    // Consume up to len bytes, stopping early at the end of a block
+    size_t feed(const uint8_t* data, size_t len) {
+        size_t used = 0;
+        ready_ = false;
+        while (used < len && !ready_ && !failed_) {
+            size_t n = want_ - have_;
+            if (n > len - used) {
+                n = len - used;
+            }
+            const uint8_t* p = data + used;
+            if (keep_) {
+                memcpy(head_ + have_, p, n);
+            }
+            if (step_ != STEP_CRC) {
+                crc_ = oplCrc32(p, n, crc_);
+            }
+            have_ += n;
+            used += n;
+            pos_ += n;
+            if (have_ == want_) {
+                advance();
+            }
+        }
+        return used;
+    }
+
+    bool ready() const { return ready_; }               // A block ended in the last feed()
+    const OplBlockInfo& block() const { return done_; }
+    bool failed() const { return failed_; }
+    bool finished() const { return trailer_; }          // Index trailer seen - end of file
+    uint32_t offset() const { return pos_; }
+    uint32_t errorOffset() const { return cur_.offset; } // Start of the bad block
+
+private:
+    enum Step : uint8_t {
+        STEP_MAGIC,
+        STEP_SESSION,
+        STEP_STRING_LEN,
+        STEP_STRING,
+        STEP_WEATHER,
+        STEP_SESSION_TAIL,
+        STEP_HW_COUNT,
+        STEP_HW_ITEM,
+        STEP_HW_ID,
+        STEP_DATA_HEADER,
+        STEP_DATA,
+        STEP_END,
+        STEP_INDEX_HEADER,
+        STEP_INDEX_ENTRIES,
+        STEP_TRAILER,
+        STEP_CRC
+    };
+
+    uint8_t head_[sizeof(OplDataBlockHeader)];
+    OplBlockInfo cur_;
+    OplBlockInfo done_;
+    uint32_t pos_;
+    uint32_t want_;
+    uint32_t have_;
+    uint32_t crc_;
+    uint8_t items_;
+    Step step_;
+    bool keep_;
+    bool ready_;
+    bool failed_;
+    bool trailer_;
+
+    // Keep bytes into head_ until it holds `total` from the block start
+    void expect(Step step, uint32_t total) {
+        step_ = step;
+        keep_ = true;
+        want_ = total;
+    }
+
+    // Keep the next n bytes at the start of head_
+    void take(Step step, uint32_t n) {
+        step_ = step;
+        keep_ = true;
+        have_ = 0;
+        want_ = n;
+    }
+
+    // Pass over the next n bytes (CRC'd, not kept)
+    void skip(Step step, uint32_t n) {
+        step_ = step;
+        keep_ = false;
+        have_ = 0;
+        want_ = n;
+    }
+
+    void beginBlock() {
+        memset(&cur_, 0, sizeof(cur_));
+        cur_.offset = pos_;
+        crc_ = 0;
+        have_ = 0;
+        expect(STEP_MAGIC, 5);
+    }
+
+    void endBlock(OplCrcStatus crc) {
+        cur_.crc = crc;
+        cur_.length = pos_ - cur_.offset;
+        done_ = cur_;
+        ready_ = true;
+        beginBlock();
+    }
+
+    void nextString() {
+        if (items_ == 0) {
+            take(STEP_WEATHER, 1);
+        } else {
+            items_--;
+            take(STEP_STRING_LEN, 1);
+        }
+    }
+
+    void nextHardwareItem() {
+        if (items_ == 0) {
+            take(STEP_CRC, 4);
+        } else {
+            items_--;
+            take(STEP_HW_ITEM, 3);
+        }
+    }
+
+    void toCrc(Step step, uint32_t n) {
+        if (n > 0) {
+            skip(step, n);
+        } else {
+            take(STEP_CRC, 4);
+        }
+    }
+
+    void advance() {
+        switch (step_) {
+            case STEP_MAGIC:
+                if (memcmp(head_, OPL_MAGIC, 4) != 0) {
+                    failed_ = true;
+                    return;
+                }
+                cur_.type = head_[4];
+                switch (cur_.type) {
+                    case OPL_BLOCK_SESSION_HEADER:
+                        expect(STEP_SESSION, sizeof(OplSessionHeader));
+                        break;
+                    case OPL_BLOCK_DATA:
+                        expect(STEP_DATA_HEADER, sizeof(OplDataBlockHeader));
+                        break;
+                    case OPL_BLOCK_SESSION_END:
+                        expect(STEP_END, sizeof(OplSessionEnd));
+                        break;
+                    case OPL_BLOCK_HARDWARE_CONFIG:
+                        expect(STEP_HW_COUNT, 6);
+                        break;
+                    case OPL_BLOCK_INDEX:
+                        expect(STEP_INDEX_HEADER, sizeof(OplIndexHeader));
+                        break;
+                    case OPL_BLOCK_INDEX_TRAILER:
+                        expect(STEP_TRAILER, 12);
+                        break;
+                    default:
+                        failed_ = true;
+                }
+                break;
+
+            case STEP_SESSION: {
+                OplSessionHeader h;
+                memcpy(&h, head_, sizeof(h));
+                cur_.timestamp_start = h.timestamp_us;
+                items_ = 3;   // Name, driver, vehicle
+                nextString();
+                break;
+            }
+
+            case STEP_STRING_LEN:
+                if (head_[0] > 0) {
+                    skip(STEP_STRING, head_[0]);
+                } else {
+                    nextString();
+                }
+                break;
+
+            case STEP_STRING:
+                nextString();
+                break;
+
+            case STEP_WEATHER:
+                if (head_[0] < 10) {
+                    skip(STEP_SESSION_TAIL, 6);   // Temperature, config CRC
+                } else {
+                    // Older header without the tail - that was the next
+                    // block's first byte
+                    uint8_t first = head_[0];
+                    pos_--;
+                    endBlock(OPL_CRC_NONE);
+                    head_[0] = first;
+                    crc_ = oplCrc32(&first, 1);
+                    have_ = 1;
+                    pos_++;
+                }
+                break;
+
+            case STEP_SESSION_TAIL:
+                take(STEP_CRC, 4);
+                break;
+
+            case STEP_HW_COUNT:
+                items_ = head_[5];
+                if (items_ > OPL_MAX_HARDWARE_ITEMS) {
+                    failed_ = true;
+                    return;
+                }
+                nextHardwareItem();
+                break;
+
+            case STEP_HW_ITEM:
+                if (head_[2] > 0) {
+                    skip(STEP_HW_ID, head_[2]);
+                } else {
+                    nextHardwareItem();
+                }
+                break;
+
+            case STEP_HW_ID:
+                nextHardwareItem();
+                break;
+
+            case STEP_DATA_HEADER: {
+                OplDataBlockHeader h;
+                memcpy(&h, head_, sizeof(h));
+                if (h.data_size > OPL_MAX_BLOCK_SIZE) {
+                    failed_ = true;
+                    return;
+                }
+                cur_.sequence = h.sequence;
+                cur_.timestamp_start = h.timestamp_start;
+                cur_.timestamp_end = h.timestamp_end;
+                cur_.flags = h.flags;
+                cur_.sample_count = h.sample_count;
+                toCrc(STEP_DATA, h.data_size);
+                break;
+            }
+
+            case STEP_DATA:
+                take(STEP_CRC, 4);
+                break;
+
+            case STEP_END:
+                endBlock(OPL_CRC_NONE);
+                break;
+
+            case STEP_INDEX_HEADER: {
+                OplIndexHeader h;
+                memcpy(&h, head_, sizeof(h));
+                cur_.sequence = h.count;
+                toCrc(STEP_INDEX_ENTRIES, h.count * sizeof(OplIndexEntry));
+                break;
+            }
+
+            case STEP_INDEX_ENTRIES:
+                take(STEP_CRC, 4);
+                break;
+
+            case STEP_TRAILER:
+                trailer_ = true;
+                take(STEP_CRC, 4);
+                break;
+
+            case STEP_CRC: {
+                uint32_t stored;
+                memcpy(&stored, head_, 4);
+                endBlock(stored == crc_ ? OPL_CRC_OK : OPL_CRC_BAD);
+                break;
+            }
+        }
+    }
+};
+
+// ============================================================================
+// Sample Iterator
+// ============================================================================
+
+// One sample in the plain encoding - data is inside the block, or the
+// iterator's scratch buffer for compressed blocks (valid until next())
+struct OplSample {
+    uint8_t type;
+    uint8_t length;
+    uint64_t timestamp_us;
+    const uint8_t* data;
+};
+
+/**
+ * Walks the samples of a data block in memory:
+ *
+ *   OplSampleIterator it(data, header.data_size, header.timestamp_start,
+ *                        header.flags & OPL_BLOCK_COMPRESSED);
+ *   OplSample s;
+ *   while (it.next(s)) { ... }
+ *
+ * Compressed samples are expanded one at a time into the same payloads
+ * a plain block holds (see CompressedDataBlock in binary_logger.py), so
+ * the readers below handle both. truncated() tells a clean end from a
+ * sample running past the block.
+ */
+class OplSampleIterator {
+public:
+    OplSampleIterator(const uint8_t* data, size_t size, uint64_t timestamp_start,
+                      bool compressed)
+        : data_(data), size_(size), pos_(0), start_(timestamp_start),
+          compressed_(compressed), truncated_(false), offset_ms_(0), has_origin_(false) {
+        memset(prev_, 0, sizeof(prev_));
+        if (compressed_) {
+            if (size_ < 12) {
+                pos_ = size_;
+                return;
+            }
+            memcpy(scale_, data_, 12);
+            pos_ = 12;
+        }
+    }
+
+    bool next(OplSample& sample) {
+        if (pos_ >= size_) {
+            return false;
+        }
+        if (!(compressed_ ? nextCompressed(sample) : nextPlain(sample))) {
+            truncated_ = true;
+            pos_ = size_;
+            return false;
+        }
+        return true;
+    }
+
+    bool truncated() const { return truncated_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    uint64_t start_;
+    bool compressed_;
+    bool truncated_;
+
+    // Compressed block predictors
+    int64_t offset_ms_;
+    float scale_[3];           // Accel, gyro, mag units per count
+    int32_t prev_[3][3];       // Last value per sensor and axis
+    int32_t origin_[2];        // First fix lat/lon
+    bool has_origin_;
+    uint8_t scratch_[OPL_MAX_SAMPLE_SIZE];
+
+    bool nextPlain(OplSample& sample) {
+        if (pos_ + sizeof(OplSampleHeader) > size_) {
+            return false;
+        }
+        OplSampleHeader h;
+        memcpy(&h, data_ + pos_, sizeof(h));
+        pos_ += sizeof(h);
+        if (pos_ + h.length > size_) {
+            return false;
+        }
+        sample.type = h.type;
+        sample.length = h.length;
+        sample.timestamp_us = start_ + (uint64_t)h.offset_ms * 1000;
+        sample.data = data_ + pos_;
+        pos_ += h.length;
+        return true;
+    }
+
+    bool varint(uint32_t& value) {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35; shift += 7) {
+            if (pos_ >= size_) {
+                return false;
+            }
+            uint8_t byte = data_[pos_++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool zigzag(int32_t& value) {
+        uint32_t raw;
+        if (!varint(raw)) {
+            return false;
+        }
+        value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+        return true;
+    }
+
+    // Three fixed-point deltas against a sensor's predictor, as float32
+    bool axes(uint8_t sensor, uint8_t* out) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            int32_t delta;
+            if (!zigzag(delta)) {
+                return false;
+            }
+            prev_[sensor][axis] += delta;
+            float value = (float)(prev_[sensor][axis] * (double)scale_[sensor]);
+            memcpy(out + axis * 4, &value, 4);
+        }
+        return true;
+    }
+
+    bool nextCompressed(OplSample& sample) {
+        uint8_t type = data_[pos_++];
+        int32_t delta;
+        if (!zigzag(delta)) {
+            return false;
+        }
+        offset_ms_ += delta;
+
+        uint8_t* out = scratch_;
+        size_t length;
+
+        switch (type) {
+            case OPL_SAMPLE_ACCEL:
+            case OPL_SAMPLE_GYRO:
+            case OPL_SAMPLE_MAG: {
+                uint8_t sensor = type == OPL_SAMPLE_ACCEL ? 0 : type == OPL_SAMPLE_GYRO ? 1 : 2;
+                if (!axes(sensor, out)) {
+                    return false;
+                }
+                length = 12;
+                break;
+            }
+
+            case OPL_SAMPLE_IMU: {
+                if (pos_ >= size_) {
+                    return false;
+                }
+                uint8_t channels = data_[pos_++];
+                if (!axes(0, out) || !axes(1, out + 12)) {
+                    return false;
+                }
+                length = 24;
+                if (channels == 9) {
+                    if (!axes(2, out + 24)) {
+                        return false;
+                    }
+                    length = 36;
+                }
+                break;
+            }
+
+            case OPL_SAMPLE_GPS_FIX: {
+                int32_t v[6];
+                for (uint8_t i = 0; i < 6; i++) {
+                    if (!zigzag(v[i])) {
+                        return false;
+                    }
+                }
+                if (!has_origin_) {
+                    origin_[0] = v[0];
+                    origin_[1] = v[1];
+                    has_origin_ = true;
+                } else {
+                    v[0] += origin_[0];
+                    v[1] += origin_[1];
+                }
+                OplGpsFix fix;
+                fix.lat = v[0] / OPL_GPS_SCALE;
+                fix.lon = v[1] / OPL_GPS_SCALE;
+                fix.alt = (float)(v[2] / 10.0);
+                fix.speed = (float)(v[3] / 100.0);
+                fix.heading = (float)(v[4] / 100.0);
+                fix.hdop = (float)(v[5] / 100.0);
+                memcpy(out, &fix, sizeof(fix));
+                length = sizeof(fix);
+                break;
+            }
+
+            case OPL_SAMPLE_IMU_BURST: {
+                if (pos_ >= size_) {
+                    return false;
+                }
+                OplImuBurstHeader h;
+                h.count = data_[pos_++];
+                h.channels = OPL_IMU_CHANNEL_ACCEL | OPL_IMU_CHANNEL_GYRO;
+                uint32_t interval;
+                if (!varint(interval) || pos_ + 8 > size_) {
+                    return false;
+                }
+                h.interval_us = (uint16_t)interval;
+                memcpy(&h.accel_lsb, data_ + pos_, 4);
+                memcpy(&h.gyro_lsb, data_ + pos_ + 4, 4);
+                pos_ += 8;
+                length = sizeof(h) + h.count * 12;
+                if (length > OPL_MAX_SAMPLE_SIZE) {
+                    return false;
+                }
+                memcpy(out, &h, sizeof(h));
+                int16_t record[6] = {0, 0, 0, 0, 0, 0};
+                uint8_t* r = out + sizeof(h);
+                for (uint8_t i = 0; i < h.count; i++) {
+                    for (uint8_t axis = 0; axis < 6; axis++) {
+                        if (!zigzag(delta)) {
+                            return false;
+                        }
+                        record[axis] = (int16_t)(record[axis] + delta);
+                    }
+                    memcpy(r, record, 12);
+                    r += 12;
+                }
+                break;
+            }
+
+            default: {
+                uint32_t raw;
+                if (!varint(raw) || raw > OPL_MAX_SAMPLE_SIZE || pos_ + raw > size_) {
+                    return false;
+                }
+                // Raw payloads are already plain - no copy
+                sample.type = type;
+                sample.length = (uint8_t)raw;
+                sample.timestamp_us = start_ + (uint64_t)(offset_ms_ > 0 ? offset_ms_ : 0) * 1000;
+                sample.data = data_ + pos_;
+                pos_ += raw;
+                return true;
+            }
+        }
+
+        sample.type = type;
+        sample.length = (uint8_t)length;
+        sample.timestamp_us = start_ + (uint64_t)(offset_ms_ > 0 ? offset_ms_ : 0) * 1000;
+        sample.data = scratch_;
+        return true;
+    }
+};
+
+// ============================================================================
+// Sample Readers
+// ============================================================================
+
+// Fixed-layout payloads (OplLap, OplEventMarker, OplImuBurstHeader, ...)
+template <typename T>
+inline bool oplRead(const OplSample& sample, T& out) {
+    if (sample.length < sizeof(T)) {
+        return false;
+    }
+    memcpy(&out, sample.data, sizeof(T));
+    return true;
+}
+
+// GPS fix, widening the 24-byte float layout of older files
+inline bool oplReadGps(const OplSample& sample, OplGpsFix& fix) {
+    if (sample.length >= sizeof(OplGpsFix)) {
+        memcpy(&fix, sample.data, sizeof(fix));
+        return true;
+    }
+    OplGpsFixV1 v1;
+    if (!oplRead(sample, v1)) {
+        return false;
+    }
+    fix.lat = v1.lat;
+    fix.lon = v1.lon;
+    fix.alt = v1.alt;
+    fix.speed = v1.speed;
+    fix.heading = v1.heading;
+    fix.hdop = v1.hdop;
+    return true;
+}
+
+// Accel, gyro, mag, or IMU as up to 9 floats (accel, gyro, mag);
+// returns the value count (3, 6 or 9), 0 if the sample is too short
+inline uint8_t oplReadAxes(const OplSample& sample, float* values) {
+    uint8_t count = sample.type == OPL_SAMPLE_IMU
+        ? (sample.length >= 36 ? 9 : sample.length >= 24 ? 6 : 0)
+        : (sample.length >= 12 ? 3 : 0);
+    memcpy(values, sample.data, count * 4);
+    return count;
+}
+
+// Record i of an IMU burst, scaled: accel (g) and gyro (dps), either left
+// untouched if the burst doesn't carry that channel
+inline bool oplReadBurstRecord(const OplSample& sample, const OplImuBurstHeader& h,
+                               uint8_t i, float* accel, float* gyro) {
+    bool has_accel = h.channels & OPL_IMU_CHANNEL_ACCEL;
+    bool has_gyro = h.channels & OPL_IMU_CHANNEL_GYRO;
+    size_t stride = 6 * (has_accel + has_gyro);
+    size_t at = sizeof(OplImuBurstHeader) + i * stride;
+    if (stride == 0 || i >= h.count || at + stride > sample.length) {
+        return false;
+    }
+    int16_t raw[6];
+    memcpy(raw, sample.data + at, stride);
+    uint8_t k = 0;
+    if (has_accel) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            accel[axis] = raw[k++] * h.accel_lsb;
+        }
+    }
+    if (has_gyro) {
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            gyro[axis] = raw[k++] * h.gyro_lsb;
+        }
+    }
+    return true;
+}
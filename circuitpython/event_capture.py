@@ -0,0 +1,245 @@
+"""
+event_capture.py - Pre-trigger high-rate capture of g-force events
+
+With event capture on, the IMU FIFO runs at the event rate (hardware.toml
+sensors.accelerometer.event_rate) instead of the logging rate, and every
+FIFO record goes through feed():
+
+- Every record is copied into a preallocated RAM ring holding the
+  pre-trigger window plus the post-trigger window.
+- Every Nth record goes to the normal log, so burst logging stays at
+  sample_rate.
+- A record at or above the threshold arms the trigger. Once the
+  post-trigger window has been filled, the ring is frozen and service()
+  writes it out as dedicated event blocks, one per call. The ring records
+  nothing new until that is done (hold-off); triggers in the meantime are
+  counted as missed.
+
+Each event block starts with a SAMPLE_TYPE_EVENT_MARKER sample, followed by
+the ring records as ordinary IMU bursts at the full rate. A window spans
+several blocks, and each one has the marker (EVENT_MARKER_FORMAT in
+binary_logger.py):
+
+    kind, first record in this block, pre records (ending with the
+    trigger record), post records, record interval (us), peak g
+
+The marker timestamp is the first record of the block, so the trigger
+time is marker time + (pre - 1 - first) * interval.
+"""
+
+import struct
+
+from binary_logger import (
+    EVENT_G_FORCE,
+    EVENT_MARKER_FORMAT,
+    EVENT_MARKER_SIZE,
+    IMU_BURST_MAX_RECORDS,
+    IMU_BURST_STRIDE,
+    SAMPLE_TYPE_EVENT_MARKER,
+)
+
+_unpack_from = struct.unpack_from
+
+# Ring states
+_ARMED = 0        # Recording, waiting for a trigger
+_TRIGGERED = 1    # Recording the post-trigger window
+_FROZEN = 2       # Window complete, being written out
+
+
+class EventCapture:
+    """Ring buffer of full-rate IMU records, see the module docstring"""
+
+    def __init__(self, fifo_interval_us, log_rate_hz, accel_lsb, gyro_lsb,
+                 threshold_g=3.0, pre_ms=500, post_ms=500):
+        """
+        Args:
+            fifo_interval_us: Time between FIFO records
+            log_rate_hz: Rate of the normal log (every Nth record)
+            accel_lsb: Accelerometer g per LSB
+            gyro_lsb: Gyroscope dps per LSB
+            threshold_g: Trigger level (total g)
+            pre_ms: Window before the trigger
+            post_ms: Window after the trigger
+        """
+        self.interval_us = fifo_interval_us
+        self.accel_lsb = accel_lsb
+        self.gyro_lsb = gyro_lsb
+        self._threshold_sq = int((threshold_g / accel_lsb) ** 2)
+
+        fifo_hz = 1000000 // fifo_interval_us
+        self.decimation = max(1, round(fifo_hz / log_rate_hz))
+        self.log_interval_us = fifo_interval_us * self.decimation
+        self._phase = 0
+
+        self.pre_records = max(1, pre_ms * 1000 // fifo_interval_us)
+        self.post_records = max(1, post_ms * 1000 // fifo_interval_us)
+        self.capacity = self.pre_records + self.post_records
+        self.ring = bytearray(self.capacity * IMU_BURST_STRIDE)
+        self._ring_view = memoryview(self.ring)
+        self._head = 0            # Next record slot
+        self._filled = 0          # Records in the ring, up to capacity
+
+        # Normal log output of feed()
+        self.log_records = bytearray(IMU_BURST_MAX_RECORDS * IMU_BURST_STRIDE)
+        self.log_timestamp_us = 0
+
+        # Window wrap-around is copied here to write it as one burst
+        self._chunk = bytearray(IMU_BURST_MAX_RECORDS * IMU_BURST_STRIDE)
+        self._marker = bytearray(EVENT_MARKER_SIZE)
+
+        self._state = _ARMED
+        self._post_left = 0
+        self._peak_sq = 0
+        self._window_pre = 0      # Pre records in the frozen window
+        self._window_count = 0
+        self._window_start = 0    # Ring slot of the oldest window record
+        self._window_start_us = 0
+        self._written = 0         # Window records written so far
+
+        self.events = 0           # Windows written
+        self.missed = 0           # Triggers during hold-off
+        self.truncated = 0        # Windows cut short (session ended)
+
+    def feed(self, records, count, timestamp_us):
+        """
+        Take count FIFO records (see read_fifo)
+
+        Args:
+            records: Buffer of 12-byte int16 accel + gyro records
+            count: Records in buffer
+            timestamp_us: Time of the newest record
+
+        Returns:
+            int: Records copied to log_records for the normal log, newest
+                 at log_timestamp_us and log_interval_us apart
+        """
+        stride = IMU_BURST_STRIDE
+        src = memoryview(records)
+        ring = self.ring
+        log = self.log_records
+        decimation = self.decimation
+        phase = self._phase
+        logged = 0
+        newest_logged = -1
+
+        for i in range(count):
+            pos = i * stride
+
+            if phase == 0:
+                log[logged * stride:(logged + 1) * stride] = src[pos:pos + stride]
+                logged += 1
+                newest_logged = i
+            phase += 1
+            if phase == decimation:
+                phase = 0
+
+            x, y, z = _unpack_from('<hhh', records, pos)
+            sq = x*x + y*y + z*z
+            state = self._state
+
+            if state == _FROZEN:
+                if sq >= self._threshold_sq:
+                    self.missed += 1
+                continue
+
+            slot = self._head * stride
+            ring[slot:slot + stride] = src[pos:pos + stride]
+            self._head += 1
+            if self._head == self.capacity:
+                self._head = 0
+            if self._filled < self.capacity:
+                self._filled += 1
+
+            if state == _ARMED:
+                if sq >= self._threshold_sq:
+                    self._state = _TRIGGERED
+                    self._post_left = self.post_records
+                    self._peak_sq = sq
+                    self._window_pre = min(self._filled, self.pre_records)
+                    trigger_us = timestamp_us - (count - 1 - i) * self.interval_us
+                    self._window_start_us = trigger_us - (self._window_pre - 1) * self.interval_us
+            else:
+                if sq > self._peak_sq:
+                    self._peak_sq = sq
+                self._post_left -= 1
+                if self._post_left == 0:
+                    self._freeze()
+
+        self._phase = phase
+        if logged:
+            self.log_timestamp_us = timestamp_us - (count - 1 - newest_logged) * self.interval_us
+        return logged
+
+    def _freeze(self):
+        """Window complete - hold the ring until service() has written it"""
+        self._state = _FROZEN
+        self._window_count = self._window_pre + self.post_records
+        self._window_start = (self._head - self._window_count) % self.capacity
+        self._written = 0
+
+    @property
+    def pending(self):
+        """True while a window is waiting to be written"""
+        return self._state == _FROZEN
+
+    def service(self, logger):
+        """
+        Write the next event block of a frozen window
+
+        Returns:
+            bool: True while there is more to write (scheduler: stay due)
+        """
+        if self._state != _FROZEN:
+            return False
+
+        if not logger.active:
+            self.truncated += 1
+            self._rearm()
+            return False
+
+        block = logger.event_block()
+        if block is None:
+            return True    # Another block is still being flushed
+
+        stride = IMU_BURST_STRIDE
+        interval = self.interval_us
+        first = self._written
+        struct.pack_into(EVENT_MARKER_FORMAT, self._marker, 0, EVENT_G_FORCE,
+                         first, self._window_pre, self.post_records, interval,
+                         (self._peak_sq ** 0.5) * self.accel_lsb)
+        block.add_sample(SAMPLE_TYPE_EVENT_MARKER,
+                         self._window_start_us + first * interval, self._marker)
+
+        accel_lsb = self.accel_lsb
+        gyro_lsb = self.gyro_lsb
+        while self._written < self._window_count:
+            n = min(IMU_BURST_MAX_RECORDS, self._window_count - self._written)
+            slot = (self._window_start + self._written) % self.capacity
+            if slot + n <= self.capacity:
+                records = self._ring_view[slot * stride:(slot + n) * stride]
+            else:
+                # Wraps around the end of the ring
+                head = self.capacity - slot
+                self._chunk[:head * stride] = self._ring_view[slot * stride:]
+                self._chunk[head * stride:n * stride] = self._ring_view[:(n - head) * stride]
+                records = self._chunk
+            timestamp_us = self._window_start_us + self._written * interval
+            if not block.add_imu_burst(timestamp_us, records, n, interval,
+                                       accel_lsb, gyro_lsb):
+                break    # Block full, rest goes in the next one
+            self._written += n
+
+        logger.write_event_block(block)
+
+        if self._written < self._window_count:
+            return True
+        self.events += 1
+        self._rearm()
+        return False
+
+    def _rearm(self):
+        """Start recording again from an empty ring"""
+        self._state = _ARMED
+        self._filled = 0
+        self._head = 0
+        self._peak_sq = 0
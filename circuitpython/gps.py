@@ -11,12 +11,32 @@ class SatelliteTracker:
     def __init__(self):
         self.satellites = {}
         self.last_update = 0
+        self._sequence = None    # GSV cycle (or count) last built from
     
     def update(self, gps_obj):
         """Update satellite data from GPS"""
+        # pa1010d.PA1010D parses GSV into preallocated tables
+        if hasattr(gps_obj, 'gsv_sequence'):
+            if gps_obj.gsv_sequence != self._sequence:
+                self._sequence = gps_obj.gsv_sequence
+                self.satellites = {}
+                for i in range(gps_obj.sats_in_view):
+                    prn = gps_obj.sat_prn[i]
+                    self.satellites[prn] = {
+                        "id": prn,
+                        "elevation": gps_obj.sat_elevation[i],
+                        "azimuth": gps_obj.sat_azimuth[i],
+                        "snr": gps_obj.sat_snr[i]
+                    }
+                self.last_update = time.monotonic()
+            return
+        
         # Note: adafruit_gps doesn't expose GSV data directly
-        # We'll need to parse it manually or use available data
-        # For now, create mock satellite data based on signal
+        # For now, create mock satellite data based on signal,
+        # rebuilt only when the count changes
+        if gps_obj.satellites == self._sequence:
+            return
+        self._sequence = gps_obj.satellites
         
         if gps_obj.satellites and gps_obj.satellites > 0:
             # Generate approximate satellite data
@@ -68,12 +88,32 @@ class SatelliteTracker:
     def __init__(self):
         self.satellites = {}
         self.last_update = 0
+        self._sequence = None    # GSV cycle (or count) last built from
     
     def update(self, gps_obj):
         """Update satellite data from GPS"""
+        # pa1010d.PA1010D parses GSV into preallocated tables
+        if hasattr(gps_obj, 'gsv_sequence'):
+            if gps_obj.gsv_sequence != self._sequence:
+                self._sequence = gps_obj.gsv_sequence
+                self.satellites = {}
+                for i in range(gps_obj.sats_in_view):
+                    prn = gps_obj.sat_prn[i]
+                    self.satellites[prn] = {
+                        "id": prn,
+                        "elevation": gps_obj.sat_elevation[i],
+                        "azimuth": gps_obj.sat_azimuth[i],
+                        "snr": gps_obj.sat_snr[i]
+                    }
+                self.last_update = time.monotonic()
+            return
+        
         # Note: adafruit_gps doesn't expose GSV data directly
-        # We'll need to parse it manually or use available data
-        # For now, create mock satellite data based on signal
+        # For now, create mock satellite data based on signal,
+        # rebuilt only when the count changes
+        if gps_obj.satellites == self._sequence:
+            return
+        self._sequence = gps_obj.satellites
         
         if gps_obj.satellites and gps_obj.satellites > 0:
             # Generate approximate satellite data
@@ -224,6 +264,9 @@ class GPS:
         }
 
     def get_satellites_json(self):
+        # Satellite view is open - have the fast profile output GSV
+        if hasattr(self.gps, 'request_satellites'):
+            self.gps.request_satellites()
         return self.sat_tracker.get_json()
     def has_fix(self):
         """Check if GPS has a fix"""
@@ -328,4 +371,7 @@ class GPS:
         }
 
     def get_satellites_json(self):
+        # Satellite view is open - have the fast profile output GSV
+        if hasattr(self.gps, 'request_satellites'):
+            self.gps.request_satellites()
         return self.sat_tracker.get_json()
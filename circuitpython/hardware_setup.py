@@ -229,6 +229,8 @@ if hw_config.is_enabled("radio.esp01s"):
             ready_timeout = hw_config.get_float("radio.esp01s.ready_timeout", 5.0)
             start_time = time.monotonic()
             esp_ready = False
+            esp_caps = []
+            esp_telemetry_hz = 0
             
             while time.monotonic() - start_time < ready_timeout:
                 line = esp_uart.readline()
@@ -238,7 +240,9 @@ if hw_config.is_enabled("radio.esp01s"):
                         if line_str:
                             message = json.loads(line_str)
                             if message.get("type") == "esp_ready":
-                                print("ESP-01s is ready.")
+                                esp_caps = message.get("caps", [])
+                                esp_telemetry_hz = message.get("telemetry_hz", 0)
+                                print(f"ESP-01s is ready. Capabilities: {esp_caps}")
                                 esp_ready = True
                                 break
                     except (ValueError, TypeError, UnicodeError):
@@ -249,6 +253,8 @@ if hw_config.is_enabled("radio.esp01s"):
             
             hardware['esp_uart'] = esp_uart
             hardware['esp_ready'] = esp_ready
+            hardware['esp_caps'] = esp_caps
+            hardware['esp_telemetry_hz'] = esp_telemetry_hz
     except Exception as e:
         print(f"✗ ESP-01s error: {e}")
 
@@ -387,4 +393,6 @@ heartbeat = hardware.get('heartbeat')
 pixel = hardware.get('neopixel')
 esp_uart = hardware.get('esp_uart')
 esp_ready = hardware.get('esp_ready', False)
+esp_caps = hardware.get('esp_caps', [])
+esp_telemetry_hz = hardware.get('esp_telemetry_hz', 0)
 rtc_clock = hardware.get('rtc')
@@ -6,6 +6,7 @@ Supports:
 - 3-axis gyroscope (±250/500/1000/2000 dps)
 - 3-axis magnetometer (AK09916, ±4900µT)
 - Configurable modes: accel-only, gyro-only, mag-only, or combinations
+- Hardware FIFO burst reads (accel + gyro packets) for 400Hz+ logging
 
 Hardware:
 - ICM-20948 9-axis IMU
@@ -32,6 +33,7 @@ BANK_SEL = const(0x7F)
 
 # Bank 0 registers
 WHO_AM_I = const(0x00)            # Should return 0xEA
+USER_CTRL = const(0x03)
 PWR_MGMT_1 = const(0x06)
 PWR_MGMT_2 = const(0x07)
 INT_PIN_CFG = const(0x0F)
@@ -41,12 +43,29 @@ ACCEL_XOUT_H = const(0x2D)
 GYRO_XOUT_H = const(0x33)
 TEMP_OUT_H = const(0x39)
 EXT_SLV_SENS_DATA_00 = const(0x3B)
+INT_STATUS_2 = const(0x1B)        # FIFO overflow flags
+FIFO_EN_2 = const(0x67)
+FIFO_RST = const(0x68)
+FIFO_MODE = const(0x69)
+FIFO_COUNTH = const(0x70)
+FIFO_R_W = const(0x72)
 
 # Bank 2 registers
 ACCEL_CONFIG = const(0x14)
 GYRO_CONFIG_1 = const(0x01)
 GYRO_SMPLRT_DIV = const(0x00)
 ACCEL_SMPLRT_DIV_1 = const(0x10)
+ACCEL_SMPLRT_DIV_2 = const(0x11)
+ODR_ALIGN_EN = const(0x09)
+
+# FIFO settings
+USER_CTRL_FIFO_EN = const(0x40)
+FIFO_EN_ACCEL_GYRO = const(0x1E)  # ACCEL_FIFO_EN | GYRO_{X,Y,Z}_FIFO_EN
+FIFO_PACKET_SIZE = 12             # Accel X/Y/Z then gyro X/Y/Z, int16 big-endian
+
+# Internal sample rates the dividers count down from (DLPF enabled)
+GYRO_BASE_RATE_HZ = 1100
+ACCEL_BASE_RATE_HZ = 1125
 
 # WHO_AM_I value
 ICM20948_CHIP_ID = const(0xEA)
@@ -181,6 +200,12 @@ class ICM20948:
         if self.use_mag:
             self._init_magnetometer()
         
+        # FIFO state (see enable_fifo)
+        self.fifo_enabled = False
+        self.fifo_interval_us = 0
+        self.fifo_overruns = 0
+        self._fifo_buf = None
+        
         print(f"[ICM20948] Initialized at 0x{address:02X}")
         print(f"[ICM20948] Mode: {mode}")
         if self.use_accel:
@@ -449,3 +474,104 @@ class ICM20948:
         except Exception as e:
             print(f"[ICM20948] Self-test FAILED: {e}")
             return False
+    
+    # =========================================================================
+    # FIFO Burst Mode
+    # =========================================================================
+    
+    def enable_fifo(self, rate_hz=400, max_records=20):
+        """
+        Stream accel + gyro packets into the 4KB hardware FIFO
+        
+        Both sample rate dividers only apply with the DLPF enabled, so
+        FCHOICE is set on both sensors. The same divider is used for each
+        (gyro 1100Hz and accel 1125Hz base differ by ~2%) with ODR_ALIGN_EN
+        so FIFO packets stay accel-then-gyro from one sample period.
+        
+        Args:
+            rate_hz: Requested sample rate (rounded to a divider of 1100Hz)
+            max_records: Most records read_fifo() will be asked for
+        """
+        if not (self.use_accel and self.use_gyro):
+            raise RuntimeError("FIFO burst needs accel and gyro enabled")
+        
+        div = max(0, min(255, int(GYRO_BASE_RATE_HZ / rate_hz + 0.5) - 1))
+        
+        self._select_bank(2)
+        self._write_byte(GYRO_SMPLRT_DIV, div)
+        self._write_byte(ACCEL_SMPLRT_DIV_1, 0)
+        self._write_byte(ACCEL_SMPLRT_DIV_2, div)
+        self._write_byte(GYRO_CONFIG_1, self._read_byte(GYRO_CONFIG_1) | 0x01)
+        self._write_byte(ACCEL_CONFIG, self._read_byte(ACCEL_CONFIG) | 0x01)
+        self._write_byte(ODR_ALIGN_EN, 0x01)
+        self._select_bank(0)
+        
+        # Stream mode (oldest data overwritten), reset, then enable
+        self._write_byte(FIFO_MODE, 0x00)
+        self._write_byte(FIFO_EN_2, FIFO_EN_ACCEL_GYRO)
+        self._write_byte(FIFO_RST, 0x1F)
+        self._write_byte(FIFO_RST, 0x00)
+        self._write_byte(USER_CTRL, self._read_byte(USER_CTRL) | USER_CTRL_FIFO_EN)
+        
+        actual_hz = GYRO_BASE_RATE_HZ / (1 + div)
+        self.fifo_interval_us = int(1000000 / actual_hz)
+        self.fifo_overruns = 0
+        self._fifo_buf = bytearray(max_records * FIFO_PACKET_SIZE)
+        self.fifo_enabled = True
+        
+        print(f"[ICM20948] FIFO enabled: {actual_hz:.0f}Hz accel+gyro")
+    
+    def disable_fifo(self):
+        """Stop streaming into the FIFO"""
+        self._select_bank(0)
+        self._write_byte(USER_CTRL, self._read_byte(USER_CTRL) & ~USER_CTRL_FIFO_EN)
+        self._write_byte(FIFO_EN_2, 0x00)
+        self.fifo_enabled = False
+    
+    @property
+    def accel_lsb(self):
+        """Accelerometer g per LSB (for raw FIFO records)"""
+        return 1.0 / self.accel_scale
+    
+    @property
+    def gyro_lsb(self):
+        """Gyroscope °/s per LSB (for raw FIFO records)"""
+        return 1.0 / self.gyro_scale
+    
+    def read_fifo(self, buf, max_records):
+        """
+        Drain accel + gyro packets from the FIFO into buf
+        
+        Each record is 12 bytes: accel X/Y/Z then gyro X/Y/Z, raw int16
+        little-endian (byte-swapped from the chip's big-endian). Records
+        are oldest first, fifo_interval_us apart. Whole packets are read
+        in one I2C transaction; FIFO_R_W does not auto-increment.
+        
+        Args:
+            buf: bytearray of at least max_records * 12 bytes
+            max_records: Most records to return
+        
+        Returns:
+            int: Number of records written to buf
+        """
+        if not self.fifo_enabled:
+            return 0
+        
+        self._select_bank(0)
+        if self._read_byte(INT_STATUS_2) & 0x0F:
+            self.fifo_overruns += 1
+        
+        fifo_count = struct.unpack('>H', self._read_bytes(FIFO_COUNTH, 2))[0] & 0x1FFF
+        count = fifo_count // FIFO_PACKET_SIZE
+        if count > max_records:
+            count = max_records
+        if count == 0:
+            return 0
+        
+        raw = memoryview(self._fifo_buf)[:count * FIFO_PACKET_SIZE]
+        self.i2c.readfrom_mem_into(self.address, FIFO_R_W, raw)
+        
+        for pos in range(0, count * FIFO_PACKET_SIZE, FIFO_PACKET_SIZE):
+            struct.pack_into('<hhhhhh', buf, pos, *struct.unpack_from('>hhhhhh', raw, pos))
+        
+        return count
@@ -0,0 +1,308 @@
+"""
+lap_timer.py - On-device lap timing, sector splits and predictive delta
+
+Gates are lines across the track, two lat/lon points each, set in
+settings.toml:
+
+    LAP_START_LINE = "42.1234,-71.5678,42.1236,-71.5675"   # Start/finish
+    LAP_SECTORS = "lat1,lon1,lat2,lon2;lat1,lon1,lat2,lon2" # In track order
+    LAP_MIN_TIME = "20"     # Finish crossings sooner than this are ignored (s)
+
+update() takes every new GPS fix. Positions are projected to metres on a
+flat plane around the start line and only the next gate in the sequence
+(sector 1, sector 2, ..., start/finish) and the start/finish line itself
+are tested against the segment from the previous fix, so a fix costs the
+same however many sectors there are. The crossing time is interpolated
+along that segment. A sector gate missed in a GPS dropout leaves the
+rest of that lap's sectors untimed, but the lap still ends at the line.
+
+Predictive delta: distance along the lap is binned every DELTA_BIN_M
+metres and the current lap records its elapsed time per bin. The delta
+is the elapsed time minus the best lap's time at the same distance. The
+current and best traces are two preallocated arrays that swap roles when
+a lap beats the best, so nothing is allocated per lap or per fix.
+
+Each crossing leaves a packed LAP_FORMAT record (binary_logger.py) in
+event, stamped event_us, for the log and the ESP.
+"""
+
+import math
+import struct
+from array import array
+
+from binary_logger import LAP_FORMAT, LAP_SIZE, LAP_NO_DELTA
+
+# Event kinds (LAP_FORMAT kind byte)
+LAP_EVENT_START = 1     # First start/finish crossing, lap 1 begins
+LAP_EVENT_SECTOR = 2    # Sector gate, split is the sector time
+LAP_EVENT_LAP = 3       # Lap complete, split is the last sector time
+
+MAX_SECTORS = 8
+DELTA_BIN_M = 10        # Predictive delta resolution (m)
+DELTA_BINS = 1024       # Longest lap for the delta: ~10km
+MAX_STEP_M = 500        # Fix-to-fix jumps beyond this are GPS glitches
+
+_M_PER_DEG = 6371000 * math.pi / 180
+
+
+def parse_gate(text):
+    """
+    "lat1,lon1,lat2,lon2" -> (lat1, lon1, lat2, lon2)
+
+    Returns:
+        tuple, or None if malformed
+    """
+    try:
+        values = tuple(float(v) for v in text.split(","))
+    except ValueError:
+        return None
+    return values if len(values) == 4 else None
+
+
+class LapTimer:
+    """Incremental start/finish and sector timing, see the module docstring"""
+
+    def __init__(self, start_line, sectors=(), min_lap_s=20.0):
+        """
+        Args:
+            start_line: (lat1, lon1, lat2, lon2) of the start/finish line
+            sectors: Sector gates in track order, same form
+            min_lap_s: Ignore finish crossings sooner than this into a lap
+        """
+        # Local flat projection centred on the start line
+        self._lat0 = (start_line[0] + start_line[2]) / 2
+        self._lon0 = (start_line[1] + start_line[3]) / 2
+        self._ky = _M_PER_DEG
+        self._kx = _M_PER_DEG * math.cos(math.radians(self._lat0))
+
+        # Gate 0 is start/finish, then the sectors
+        self.gates = [self._project_gate(start_line)]
+        for gate in sectors[:MAX_SECTORS]:
+            self.gates.append(self._project_gate(gate))
+        self.sector_count = len(self.gates)     # Sectors per lap incl. the last
+        self.min_lap_us = int(min_lap_s * 1000000)
+
+        self.lap = 0                # Current lap, 0 = out lap
+        self.next_gate = 0
+        self.lap_start_us = 0
+        self.sector_start_us = 0
+        self.last_lap_us = 0
+        self.best_lap_us = 0        # 0 = no complete lap yet
+        self.delta_us = LAP_NO_DELTA
+        self.laps = 0
+
+        # Elapsed lap time (ms) at the end of each sector
+        self._sectors = array('l', [0] * self.sector_count)
+        self._best_sectors = array('l', [0] * self.sector_count)
+
+        # Elapsed lap time (ms) at each DELTA_BIN_M of distance
+        self._trace = array('l', [0] * DELTA_BINS)
+        self._best_trace = array('l', [0] * DELTA_BINS)
+        self._trace_bins = 0
+        self._best_bins = 0
+        self._distance = 0.0
+
+        self._x = 0.0
+        self._y = 0.0
+        self._t = 0
+        self._lat = None
+        self._lon = None
+
+        self.event = bytearray(LAP_SIZE)
+        self.event_us = 0
+
+    @classmethod
+    def from_config(cls, config):
+        """
+        LapTimer from settings.toml (see the module docstring)
+
+        Returns:
+            LapTimer, or None if no valid start/finish line is set
+        """
+        start = parse_gate(config.lap_start_line)
+        if not start:
+            if config.lap_start_line:
+                print(f"[Lap] Bad LAP_START_LINE: {config.lap_start_line}")
+            return None
+
+        sectors = []
+        for text in config.lap_sectors.split(";"):
+            if text.strip():
+                gate = parse_gate(text)
+                if gate:
+                    sectors.append(gate)
+                else:
+                    print(f"[Lap] Bad sector gate skipped: {text}")
+        return cls(start, sectors, config.lap_min_time)
+
+    def _project(self, lat, lon):
+        return (lon - self._lon0) * self._kx, (lat - self._lat0) * self._ky
+
+    def _project_gate(self, gate):
+        ax, ay = self._project(gate[0], gate[1])
+        bx, by = self._project(gate[2], gate[3])
+        return (ax, ay, bx - ax, by - ay)
+
+    @property
+    def timing(self):
+        """True once the first start/finish crossing has been seen"""
+        return self.lap > 0
+
+    def elapsed_us(self, now_us):
+        """Time into the current lap"""
+        return now_us - self.lap_start_us if self.lap else 0
+
+    def update(self, lat, lon, timestamp_us):
+        """
+        Take a GPS fix
+
+        Repeats of the previous position (the GPS task sees each fix more
+        than once) are ignored.
+
+        Returns:
+            int: LAP_EVENT_* if a gate was crossed (see event), else 0
+        """
+        if lat == self._lat and lon == self._lon:
+            return 0
+        x, y = self._project(lat, lon)
+        t = timestamp_us
+
+        if self._lat is None:
+            self._lat, self._lon = lat, lon
+            self._x, self._y, self._t = x, y, t
+            return 0
+
+        px, py, pt = self._x, self._y, self._t
+        dx = x - px
+        dy = y - py
+        step = math.sqrt(dx * dx + dy * dy)
+        self._lat, self._lon = lat, lon
+        self._x, self._y, self._t = x, y, t
+        if step > MAX_STEP_M:
+            return 0
+
+        kind = 0
+        gate = self.next_gate
+        s = self._crossing(gate, px, py, dx, dy)
+        if s < 0.0 and gate:
+            # Start/finish still counts if a sector gate was missed
+            gate = 0
+            s = self._crossing(0, px, py, dx, dy)
+        if s >= 0.0:
+            cross_us = pt + int(s * (t - pt))
+            kind = self._crossed(gate, cross_us)
+            if kind and kind != LAP_EVENT_SECTOR:
+                # The new lap's distance starts at the line
+                self._advance(cross_us, t, (1.0 - s) * step)
+                return kind
+        if self.lap:
+            self._advance(pt, t, step)
+        return kind
+
+    def _crossing(self, gate, px, py, dx, dy):
+        """Fraction along the fix segment where it crosses gate, or -1"""
+        ax, ay, ex, ey = self.gates[gate]
+        denom = dx * ey - dy * ex
+        if not denom:
+            return -1.0
+        qx = ax - px
+        qy = ay - py
+        s = (qx * ey - qy * ex) / denom     # Along the fix segment
+        u = (qx * dy - qy * dx) / denom     # Along the gate
+        if 0.0 < s <= 1.0 and 0.0 <= u <= 1.0:
+            return s
+        return -1.0
+
+    def _advance(self, pt, t, step):
+        """
+        Add a segment from time pt to t to the lap distance, record the
+        elapsed ms at each bin boundary it passes and update the delta
+        """
+        start = self._distance
+        end = start + step
+        self._distance = end
+        last = int(end // DELTA_BIN_M)
+        if last >= DELTA_BINS:
+            last = DELTA_BINS - 1
+        trace = self._trace
+        lap_start = self.lap_start_us
+        while self._trace_bins <= last:
+            b = self._trace_bins
+            if step <= 0:
+                bin_us = t
+            else:
+                frac = (b * DELTA_BIN_M - start) / step
+                bin_us = pt + int(max(0.0, frac) * (t - pt))
+            trace[b] = (bin_us - lap_start) // 1000
+            self._trace_bins = b + 1
+
+        # Predictive delta against the best lap at this distance
+        self.delta_us = LAP_NO_DELTA
+        best_bins = self._best_bins
+        if self.best_lap_us and self.lap:
+            pos = end / DELTA_BIN_M
+            b = int(pos)
+            if b + 1 < best_bins:
+                best = self._best_trace
+                best_ms = best[b] + (best[b + 1] - best[b]) * (pos - b)
+                self.delta_us = int((t - lap_start) - best_ms * 1000)
+
+    def _crossed(self, gate, cross_us):
+        """Gate crossed at cross_us - returns the event kind or 0"""
+        if not self.lap:
+            # Out lap over, timing starts
+            self.lap = 1
+            self._start_lap(cross_us)
+            self._pack(LAP_EVENT_START, 0, 0, 0, LAP_NO_DELTA, cross_us)
+            return LAP_EVENT_START
+
+        elapsed = cross_us - self.lap_start_us
+        split = cross_us - self.sector_start_us
+        index = gate - 1 if gate else self.sector_count - 1
+        elapsed_ms = elapsed // 1000
+        delta = LAP_NO_DELTA
+        if self.best_lap_us and self._best_sectors[index] >= 0:
+            delta = (elapsed_ms - self._best_sectors[index]) * 1000
+
+        if gate:
+            self._sectors[index] = elapsed_ms
+            self.sector_start_us = cross_us
+            self.next_gate = gate + 1 if gate + 1 < self.sector_count else 0
+            self._pack(LAP_EVENT_SECTOR, gate, split, elapsed, delta, cross_us)
+            return LAP_EVENT_SECTOR
+
+        if elapsed < self.min_lap_us:
+            return 0    # Jitter on the line, or a spin back across it
+
+        # Sector gates skipped since the last one crossed have no time, and
+        # the lap event's split covers all of them
+        for i in range(self.next_gate - 1 if self.next_gate else index, index):
+            self._sectors[i] = -1
+        self._sectors[index] = elapsed_ms
+        if self.best_lap_us:
+            delta = elapsed - self.best_lap_us
+        self._pack(LAP_EVENT_LAP, 0, split, elapsed, delta, cross_us)
+
+        self.last_lap_us = elapsed
+        self.laps += 1
+        if not self.best_lap_us or elapsed < self.best_lap_us:
+            self.best_lap_us = elapsed
+            self._trace, self._best_trace = self._best_trace, self._trace
+            self._best_bins = self._trace_bins
+            self._sectors, self._best_sectors = self._best_sectors, self._sectors
+        self.lap += 1
+        self._start_lap(cross_us)
+        return LAP_EVENT_LAP
+
+    def _start_lap(self, cross_us):
+        self.lap_start_us = cross_us
+        self.sector_start_us = cross_us
+        self.next_gate = 1 if self.sector_count > 1 else 0
+        self._distance = 0.0
+        self._trace_bins = 0
+        self.delta_us = LAP_NO_DELTA
+
+    def _pack(self, kind, gate, split_us, lap_us, delta_us, cross_us):
+        struct.pack_into(LAP_FORMAT, self.event, 0, kind, gate,
+                         self.lap, split_us, lap_us, delta_us)
+        self.event_us = cross_us
@@ -5,6 +5,7 @@ Supports:
 - 3-axis accelerometer (±2/4/8/16g)
 - 3-axis gyroscope (±125/250/500/1000/2000 dps)
 - Configurable modes: accel-only, gyro-only, or both
+- Hardware FIFO burst reads (accel + gyro pairs) for 400Hz+ logging
 
 Hardware:
 - LSM6DSOX 6-axis IMU
@@ -33,6 +34,13 @@ CTRL2_G = const(0x11)             # Gyroscope control
 CTRL3_C = const(0x12)             # Control register 3
 CTRL4_C = const(0x13)             # Control register 4
 
+# FIFO registers
+FIFO_CTRL3 = const(0x09)          # Batch data rates (gyro [7:4], accel [3:0])
+FIFO_CTRL4 = const(0x0A)          # FIFO mode
+FIFO_STATUS1 = const(0x3A)        # Unread words, low byte
+FIFO_STATUS2 = const(0x3B)        # Unread words [1:0], overrun flag
+FIFO_DATA_OUT_TAG = const(0x78)   # Tag byte, then 6 data bytes per word
+
 # Data registers
 OUTX_L_G = const(0x22)            # Gyroscope X low byte
 OUTX_L_A = const(0x28)            # Accelerometer X low byte
@@ -67,6 +75,20 @@ ODR_1660_HZ = const(0x80)
 ODR_3330_HZ = const(0x90)
 ODR_6660_HZ = const(0xA0)
 
+# FIFO modes
+FIFO_MODE_BYPASS = const(0x00)
+FIFO_MODE_CONTINUOUS = const(0x06)
+
+# FIFO word tags (TAG_SENSOR, bits 7:3 of the tag byte)
+FIFO_TAG_GYRO = const(0x01)
+FIFO_TAG_ACCEL = const(0x02)
+
+# FIFO word: tag (1) + X/Y/Z int16 little-endian (6)
+FIFO_WORD_SIZE = 7
+
+# Batch data rate in Hz per ODR code (ODR_* >> 4)
+ODR_HZ = (0, 12.5, 26, 52, 104, 208, 416, 833, 1660, 3330, 6660)
+
 # Scale factors (LSB/unit)
 ACCEL_SCALE_2G = 16384.0
 ACCEL_SCALE_4G = 8192.0
@@ -151,8 +173,16 @@ class LSM6DSOX:
         else:
             self._write_byte(CTRL2_G, ODR_POWER_DOWN)
         
-        # Enable block data update
-        self._write_byte(CTRL3_C, 0x40)
+        # Enable block data update (and register auto-increment)
+        self._write_byte(CTRL3_C, 0x44)
+        
+        # FIFO state (see enable_fifo)
+        self.fifo_enabled = False
+        self.fifo_interval_us = 0
+        self.fifo_overruns = 0
+        self._fifo_buf = None
+        self._fifo_gyro = bytearray(6)
+        self._fifo_gyro_pending = False
         
         print(f"[LSM6DSOX] Initialized at 0x{address:02X}")
         print(f"[LSM6DSOX] Mode: {mode}")
@@ -366,3 +396,107 @@ class LSM6DSOX:
         except Exception as e:
             print(f"[LSM6DSOX] Self-test FAILED: {e}")
             return False
+    
+    # =========================================================================
+    # FIFO Burst Mode
+    # =========================================================================
+    
+    def enable_fifo(self, odr=ODR_416_HZ, max_records=20):
+        """
+        Batch accel + gyro into the hardware FIFO at odr
+        
+        Both sensors are switched to odr so every gyro word is followed by
+        an accel word from the same sample period; read_fifo() pairs them.
+        The FIFO holds ~9KB, so at 416Hz the main loop can fall ~0.6s
+        behind before it overruns.
+        
+        Args:
+            odr: Output/batch data rate (ODR_* constant)
+            max_records: Most records read_fifo() will be asked for
+        """
+        if self.mode != 'both':
+            raise RuntimeError("FIFO burst needs mode='both'")
+        
+        self._write_byte(CTRL1_XL, odr | self.accel_range)
+        self._write_byte(CTRL2_G, odr | self.gyro_range)
+        
+        # Bypass first to empty the FIFO, then batch both sensors
+        bdr = odr >> 4
+        self._write_byte(FIFO_CTRL4, FIFO_MODE_BYPASS)
+        self._write_byte(FIFO_CTRL3, (bdr << 4) | bdr)
+        self._write_byte(FIFO_CTRL4, FIFO_MODE_CONTINUOUS)
+        
+        self.fifo_interval_us = int(1000000 / ODR_HZ[bdr])
+        self.fifo_overruns = 0
+        self._fifo_buf = bytearray(max_records * 2 * FIFO_WORD_SIZE)
+        self._fifo_gyro_pending = False
+        self.fifo_enabled = True
+        
+        print(f"[LSM6DSOX] FIFO enabled: {ODR_HZ[bdr]}Hz accel+gyro")
+    
+    def disable_fifo(self):
+        """Stop batching and return to register reads"""
+        self._write_byte(FIFO_CTRL4, FIFO_MODE_BYPASS)
+        self._write_byte(FIFO_CTRL3, 0x00)
+        self.fifo_enabled = False
+    
+    @property
+    def accel_lsb(self):
+        """Accelerometer g per LSB (for raw FIFO records)"""
+        return 1.0 / self.accel_scale
+    
+    @property
+    def gyro_lsb(self):
+        """Gyroscope °/s per LSB (for raw FIFO records)"""
+        return 1.0 / self.gyro_scale
+    
+    def read_fifo(self, buf, max_records):
+        """
+        Drain accel + gyro pairs from the FIFO into buf
+        
+        Each record is 12 bytes: accel X/Y/Z then gyro X/Y/Z, raw int16
+        little-endian (scale with accel_lsb / gyro_lsb). Records are
+        oldest first, fifo_interval_us apart. All unread words (up to
+        max_records pairs) come back in one I2C transaction - the FIFO
+        output address rolls over from 0x7E to 0x78 on its own.
+        
+        Args:
+            buf: bytearray of at least max_records * 12 bytes
+            max_records: Most records to return
+        
+        Returns:
+            int: Number of records written to buf
+        """
+        if not self.fifo_enabled:
+            return 0
+        
+        status = self._read_bytes(FIFO_STATUS1, 2)
+        words = status[0] | ((status[1] & 0x03) << 8)
+        if status[1] & 0x40:
+            self.fifo_overruns += 1
+        
+        if words > max_records * 2:
+            words = max_records * 2
+        if words == 0:
+            return 0
+        
+        length = words * FIFO_WORD_SIZE
+        raw = memoryview(self._fifo_buf)[:length]
+        self.i2c.readfrom_mem_into(self.address, FIFO_DATA_OUT_TAG, raw)
+        
+        # Pair each accel word with the gyro word batched before it
+        count = 0
+        gyro = self._fifo_gyro
+        for pos in range(0, length, FIFO_WORD_SIZE):
+            tag = raw[pos] >> 3
+            if tag == FIFO_TAG_GYRO:
+                gyro[:] = raw[pos + 1:pos + 7]
+                self._fifo_gyro_pending = True
+            elif tag == FIFO_TAG_ACCEL and self._fifo_gyro_pending:
+                out = count * 12
+                buf[out:out + 6] = raw[pos + 1:pos + 7]
+                buf[out + 6:out + 12] = gyro
+                self._fifo_gyro_pending = False
+                count += 1
+        
+        return count
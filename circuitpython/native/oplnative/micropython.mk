@@ -0,0 +1,5 @@
+# oplnative - user C module, see oplnative.c
+OPLNATIVE_MOD_DIR := $(USERMOD_DIR)
+
+SRC_USERMOD += $(OPLNATIVE_MOD_DIR)/oplnative.c
+CFLAGS_USERMOD += -I$(OPLNATIVE_MOD_DIR)
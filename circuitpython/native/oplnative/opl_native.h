@@ -0,0 +1,173 @@
+/**
+ * opl_native.h - Data block packing for the oplnative module, plain C
+ *
+ * The logic behind oplnative.c with no MicroPython dependencies, so it
+ * can be built and checked on a host. Mirrors binary_logger.DataBlock:
+ * the running block state lives in the block's own header fields (as
+ * serialize() would write them) instead of Python attributes.
+ *
+ *   25  timestamp_start  u64   Set by the first sample
+ *   33  timestamp_end    u64
+ *   42  sample_count     u16
+ *   44  data_size        u16
+ *
+ * A layout change in binary_logger.py goes here too.
+ */
+
+#ifndef OPL_NATIVE_H
+#define OPL_NATIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define OPL_MAX_BLOCK_SIZE          4096
+#define OPL_MAX_DATA_PAYLOAD        (OPL_MAX_BLOCK_SIZE - 80)
+#define OPL_DATA_BLOCK_HEADER_SIZE  46
+#define OPL_MAX_SAMPLE_SIZE         255
+#define OPL_SAMPLE_TYPE_GPS_FIX     0x02
+#define OPL_GPS_FIX_SIZE            32      // <ddffff
+
+#define OPL_OFF_SEQUENCE    21
+#define OPL_OFF_TS_START    25
+#define OPL_OFF_TS_END      33
+#define OPL_OFF_FLAGS       41
+#define OPL_OFF_COUNT       42
+#define OPL_OFF_SIZE        44
+
+// ============================================================================
+// Little-endian Fields
+// ============================================================================
+
+static inline uint16_t opl_rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void opl_wr16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint64_t opl_rd64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline void opl_wr64(uint8_t *p, uint64_t v) {
+    memcpy(p, &v, 8);
+}
+
+// ============================================================================
+// CRC32 (IEEE, reflected - binascii/zlib compatible)
+// ============================================================================
+
+static uint32_t opl_crc_table[256];
+static int opl_crc_table_ready = 0;
+
+static inline void opl_crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : c >> 1;
+        }
+        opl_crc_table[i] = c;
+    }
+    opl_crc_table_ready = 1;
+}
+
+static inline uint32_t opl_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    if (!opl_crc_table_ready) {
+        opl_crc32_init();
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = opl_crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// ============================================================================
+// Data Block
+// ============================================================================
+
+// Empty the block (header fields only - samples are overwritten)
+static inline void opl_block_reset(uint8_t *buf) {
+    memset(buf + OPL_OFF_TS_START, 0, OPL_DATA_BLOCK_HEADER_SIZE - OPL_OFF_TS_START);
+}
+
+// Write a sample header at the cursor and reserve length data bytes.
+// Returns the data offset, or -1 if the block is full.
+static inline int opl_block_reserve(uint8_t *buf, uint8_t type, uint64_t ts, uint32_t length) {
+    uint16_t count = opl_rd16(buf + OPL_OFF_COUNT);
+    uint16_t size = opl_rd16(buf + OPL_OFF_SIZE);
+    if (size + 4 + length > OPL_MAX_DATA_PAYLOAD) {
+        return -1;
+    }
+
+    uint64_t start;
+    if (count == 0) {
+        start = ts;
+        opl_wr64(buf + OPL_OFF_TS_START, ts);
+        opl_wr64(buf + OPL_OFF_TS_END, ts);
+    } else {
+        start = opl_rd64(buf + OPL_OFF_TS_START);
+        if (ts > opl_rd64(buf + OPL_OFF_TS_END)) {
+            opl_wr64(buf + OPL_OFF_TS_END, ts);
+        }
+    }
+
+    // ms offset, clamped (bursts can predate the block's first sample)
+    uint64_t offset_ms = ts > start ? (ts - start) / 1000 : 0;
+    if (offset_ms > 65535) {
+        offset_ms = 65535;
+    }
+
+    uint8_t *p = buf + OPL_DATA_BLOCK_HEADER_SIZE + size;
+    p[0] = type;
+    opl_wr16(p + 1, (uint16_t)offset_ms);
+    p[3] = (uint8_t)length;
+    opl_wr16(buf + OPL_OFF_SIZE, (uint16_t)(size + 4 + length));
+    opl_wr16(buf + OPL_OFF_COUNT, (uint16_t)(count + 1));
+    return (int)(OPL_DATA_BLOCK_HEADER_SIZE + size + 4);
+}
+
+// n float32 values as one sample. Returns the new data size, or -1 if full.
+static inline int opl_block_append_f32(uint8_t *buf, uint8_t type, uint64_t ts,
+                                       const float *values, size_t n) {
+    int pos = opl_block_reserve(buf, type, ts, (uint32_t)(n * 4));
+    if (pos < 0) {
+        return -1;
+    }
+    memcpy(buf + pos, values, n * 4);
+    return opl_rd16(buf + OPL_OFF_SIZE);
+}
+
+// GPS fix (<ddffff). Returns the new data size, or -1 if full.
+static inline int opl_block_append_gps(uint8_t *buf, uint64_t ts, double lat, double lon,
+                                       float alt, float speed, float heading, float hdop) {
+    int pos = opl_block_reserve(buf, OPL_SAMPLE_TYPE_GPS_FIX, ts, OPL_GPS_FIX_SIZE);
+    if (pos < 0) {
+        return -1;
+    }
+    uint8_t *p = buf + pos;
+    memcpy(p, &lat, 8);
+    memcpy(p + 8, &lon, 8);
+    memcpy(p + 16, &alt, 4);
+    memcpy(p + 20, &speed, 4);
+    memcpy(p + 24, &heading, 4);
+    memcpy(p + 28, &hdop, 4);
+    return opl_rd16(buf + OPL_OFF_SIZE);
+}
+
+// Fill in sequence and flush flags. Returns header + samples length.
+static inline size_t opl_block_finish(uint8_t *buf, uint32_t sequence, uint8_t flags) {
+    buf[OPL_OFF_SEQUENCE] = (uint8_t)sequence;
+    buf[OPL_OFF_SEQUENCE + 1] = (uint8_t)(sequence >> 8);
+    buf[OPL_OFF_SEQUENCE + 2] = (uint8_t)(sequence >> 16);
+    buf[OPL_OFF_SEQUENCE + 3] = (uint8_t)(sequence >> 24);
+    buf[OPL_OFF_FLAGS] = flags;
+    return OPL_DATA_BLOCK_HEADER_SIZE + opl_rd16(buf + OPL_OFF_SIZE);
+}
+
+#endif // OPL_NATIVE_H
@@ -0,0 +1,223 @@
+/**
+ * oplnative.c - Optional C module for the binary logger hot path
+ *
+ * binary_logger.py uses it when it can be imported and falls back to
+ * Python otherwise, so the same .py files run on firmware with or without
+ * it. Build it into CircuitPython as a user C module:
+ *
+ *   make BOARD=raspberry_pi_pico USER_C_MODULES=/path/to/circuitpython/native
+ *
+ *   crc32(data, crc=0)                 binascii.crc32 compatible
+ *   block_reset(buf)                   Empty a DataBlock buffer
+ *   block_reserve(buf, type, ts, n)    Sample header, returns data offset or -1
+ *   block_append_f32(buf, type, ts, v0, ..., v8)
+ *                                      3-9 float32s, returns data size or -1
+ *   block_append_gps(buf, ts, lat, lon, alt, speed, heading, hdop)
+ *                                      GPS fix, returns data size or -1
+ *   block_finish(buf, sequence, flags) Returns header + samples length
+ *
+ * buf is the DataBlock's bytearray (MAX_BLOCK_SIZE); see opl_native.h for
+ * where the block state is kept.
+ *
+ * On the RP2040/RP2350 CRCs of 32 bytes or more run on the DMA sniffer,
+ * which checksums a DMA transfer as it happens (about a byte per clock).
+ * The first use checks it against the table and falls back for good if
+ * the two disagree or no DMA channel is free.
+ */
+
+#include "py/obj.h"
+#include "py/objint.h"
+#include "py/runtime.h"
+
+#include "opl_native.h"
+
+#if defined(PICO_RP2040) || defined(PICO_RP2350)
+#include "hardware/dma.h"
+#define OPL_DMA_CRC 1
+#else
+#define OPL_DMA_CRC 0
+#endif
+
+#define OPL_DMA_CRC_MIN 32
+
+// ============================================================================
+// DMA Sniffer CRC32
+// ============================================================================
+
+#if OPL_DMA_CRC
+
+// -1 not tried yet, -2 unusable, else the claimed channel
+static int dma_channel = -1;
+static uint32_t dma_sink;
+
+static uint32_t bitrev32(uint32_t v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+static uint32_t dma_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+
+    // Mode 1 is CRC-32 on bit-reversed data; reading the accumulator
+    // reversed and inverted gives the reflected (zlib) CRC. The seed is
+    // written untransformed, so a running CRC goes in as ~reverse(crc).
+    dma_sniffer_enable(dma_channel, 0x1, true);
+    dma_sniffer_set_output_reverse_enabled(true);
+    dma_sniffer_set_output_invert_enabled(true);
+    dma_sniffer_set_data_accumulator(bitrev32(~crc));
+
+    dma_channel_configure(dma_channel, &c, &dma_sink, data, len, true);
+    dma_channel_wait_for_finish_blocking(dma_channel);
+    uint32_t result = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    return result;
+}
+
+// Claim a channel and check the sniffer against the table once
+static bool dma_crc_ready(void) {
+    if (dma_channel >= 0) {
+        return true;
+    }
+    if (dma_channel == -2) {
+        return false;
+    }
+
+    dma_channel = dma_claim_unused_channel(false);
+    if (dma_channel < 0) {
+        dma_channel = -2;
+        return false;
+    }
+
+    uint8_t probe[OPL_DMA_CRC_MIN + 7];
+    for (size_t i = 0; i < sizeof(probe); i++) {
+        probe[i] = (uint8_t)(i * 37 + 11);
+    }
+    uint32_t seed = opl_crc32(probe, 5, 0);
+    if (dma_crc32(probe, sizeof(probe), 0) != opl_crc32(probe, sizeof(probe), 0) ||
+        dma_crc32(probe + 5, sizeof(probe) - 5, seed) != opl_crc32(probe, sizeof(probe), 0)) {
+        dma_channel_unclaim(dma_channel);
+        dma_channel = -2;
+        return false;
+    }
+    return true;
+}
+
+#endif // OPL_DMA_CRC
+
+// ============================================================================
+// Arguments
+// ============================================================================
+
+// Timestamps are microseconds since 1970 - past small int range
+static uint64_t get_u64(mp_obj_t o) {
+    if (mp_obj_is_small_int(o)) {
+        return (uint64_t)(int64_t)MP_OBJ_SMALL_INT_VALUE(o);
+    }
+    if (!mp_obj_is_int(o)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("timestamp must be an int"));
+    }
+    uint8_t bytes[8];
+    mp_obj_int_to_bytes_impl(o, false, sizeof(bytes), bytes);
+    return opl_rd64(bytes);
+}
+
+static uint8_t *get_block(mp_obj_t o) {
+    mp_buffer_info_t info;
+    mp_get_buffer_raise(o, &info, MP_BUFFER_RW);
+    if (info.len < OPL_DATA_BLOCK_HEADER_SIZE + OPL_MAX_DATA_PAYLOAD) {
+        mp_raise_ValueError(MP_ERROR_TEXT("block buffer too small"));
+    }
+    return info.buf;
+}
+
+// ============================================================================
+// Functions
+// ============================================================================
+
+static mp_obj_t oplnative_crc32(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t info;
+    mp_get_buffer_raise(args[0], &info, MP_BUFFER_READ);
+    uint32_t crc = n_args > 1 ? (uint32_t)mp_obj_int_get_truncated(args[1]) : 0;
+
+    #if OPL_DMA_CRC
+    if (info.len >= OPL_DMA_CRC_MIN && dma_crc_ready()) {
+        return mp_obj_new_int_from_uint(dma_crc32(info.buf, info.len, crc));
+    }
+    #endif
+    return mp_obj_new_int_from_uint(opl_crc32(info.buf, info.len, crc));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(oplnative_crc32_obj, 1, 2, oplnative_crc32);
+
+static mp_obj_t oplnative_block_reset(mp_obj_t buf) {
+    opl_block_reset(get_block(buf));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(oplnative_block_reset_obj, oplnative_block_reset);
+
+static mp_obj_t oplnative_block_reserve(size_t n_args, const mp_obj_t *args) {
+    uint8_t *buf = get_block(args[0]);
+    mp_int_t length = mp_obj_get_int(args[3]);
+    if (length < 0 || length > OPL_MAX_SAMPLE_SIZE) {
+        mp_raise_ValueError(MP_ERROR_TEXT("sample too long"));
+    }
+    return MP_OBJ_NEW_SMALL_INT(opl_block_reserve(buf, (uint8_t)mp_obj_get_int(args[1]),
+                                                  get_u64(args[2]), (uint32_t)length));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(oplnative_block_reserve_obj, 4, 4, oplnative_block_reserve);
+
+static mp_obj_t oplnative_block_append_f32(size_t n_args, const mp_obj_t *args) {
+    uint8_t *buf = get_block(args[0]);
+    float values[9];
+    size_t n = n_args - 3;
+    for (size_t i = 0; i < n; i++) {
+        values[i] = (float)mp_obj_get_float(args[3 + i]);
+    }
+    return MP_OBJ_NEW_SMALL_INT(opl_block_append_f32(buf, (uint8_t)mp_obj_get_int(args[1]),
+                                                     get_u64(args[2]), values, n));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(oplnative_block_append_f32_obj, 6, 12, oplnative_block_append_f32);
+
+static mp_obj_t oplnative_block_append_gps(size_t n_args, const mp_obj_t *args) {
+    uint8_t *buf = get_block(args[0]);
+    return MP_OBJ_NEW_SMALL_INT(opl_block_append_gps(buf, get_u64(args[1]),
+        (double)mp_obj_get_float(args[2]), (double)mp_obj_get_float(args[3]),
+        (float)mp_obj_get_float(args[4]), (float)mp_obj_get_float(args[5]),
+        (float)mp_obj_get_float(args[6]), (float)mp_obj_get_float(args[7])));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(oplnative_block_append_gps_obj, 8, 8, oplnative_block_append_gps);
+
+static mp_obj_t oplnative_block_finish(mp_obj_t buf, mp_obj_t sequence, mp_obj_t flags) {
+    return MP_OBJ_NEW_SMALL_INT(opl_block_finish(get_block(buf),
+        (uint32_t)mp_obj_int_get_truncated(sequence), (uint8_t)mp_obj_get_int(flags)));
+}
+static MP_DEFINE_CONST_FUN_OBJ_3(oplnative_block_finish_obj, oplnative_block_finish);
+
+// ============================================================================
+// Module
+// ============================================================================
+
+static const mp_rom_map_elem_t oplnative_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_oplnative) },
+    { MP_ROM_QSTR(MP_QSTR_crc32), MP_ROM_PTR(&oplnative_crc32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_block_reset), MP_ROM_PTR(&oplnative_block_reset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_block_reserve), MP_ROM_PTR(&oplnative_block_reserve_obj) },
+    { MP_ROM_QSTR(MP_QSTR_block_append_f32), MP_ROM_PTR(&oplnative_block_append_f32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_block_append_gps), MP_ROM_PTR(&oplnative_block_append_gps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_block_finish), MP_ROM_PTR(&oplnative_block_finish_obj) },
+    { MP_ROM_QSTR(MP_QSTR_MAX_DATA_PAYLOAD), MP_ROM_INT(OPL_MAX_DATA_PAYLOAD) },
+};
+static MP_DEFINE_CONST_DICT(oplnative_module_globals, oplnative_module_globals_table);
+
+const mp_obj_module_t oplnative_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t *)&oplnative_module_globals,
+};
+
+MP_REGISTER_MODULE(MP_QSTR_oplnative, oplnative_module);
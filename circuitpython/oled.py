@@ -8,6 +8,17 @@ from adafruit_display_text import label
 from utils import format_dms, hdop_to_bars, format_time_hms, estimate_recording_time
 import os
 import time
+from binary_logger import LAP_NO_DELTA
+
+# SD free space / remaining time is re-read this often
+SD_REFRESH_SECONDS = 10
+
+
+def _lap_time(us):
+    """us -> m:ss.s"""
+    tenths = us // 100000
+    return f"{tenths // 600}:{tenths % 600 / 10:04.1f}"
+
 
 class OLED:
     def __init__(self, display):
@@ -22,6 +33,13 @@ class OLED:
         self.line5 = None
         self.smooth_x = 0.0
         self.smooth_y = 0.0
+        self.lines = []
+        self.rendered = []          # Last text set on each line
+        self.dirty = False          # A label changed since the last refresh
+        self.refreshes = 0
+        self._session_file = None
+        self._short_name = "NoLog"
+        self._sd_checked = 0
 
     def show_splash(self, status_text="Initializing..."):
         """Display OpenPony splash screen"""
@@ -53,16 +71,36 @@ class OLED:
         self.line4 = label.Label(terminalio.FONT, text="NoLog 00:00:00", color=0xFFFFFF, x=0, y=41)
         self.line5 = label.Label(terminalio.FONT, text="SD: --h --m remain", color=0xFFFFFF, x=0, y=53)
 
-        for line in [self.line1, self.line2, self.line3, self.line4, self.line5]:
+        self.lines = [self.line1, self.line2, self.line3, self.line4, self.line5]
+        for line in self.lines:
             self.main_group.append(line)
+        self.rendered = [line.text for line in self.lines]
             
         if self.splash_status:
             self.splash_status.text = "Display ready..."
         time.sleep(0.3)
         self.display.root_group = self.main_group
+        
+        # From here on the display is only sent when refresh() is called
+        self.display.auto_refresh = False
+        self.dirty = True
+        self.refresh()
+
+    def _set_line(self, index, text):
+        """Set a label only if its text changed - each set re-lays out glyphs"""
+        if self.rendered[index] != text:
+            self.rendered[index] = text
+            self.lines[index].text = text
+            self.dirty = True
 
     def update(self, data, session, rtc_handler):
         """Update OLED display with enhanced format"""
+        self.update_gps(data, rtc_handler)
+        self.update_session(session)
+        self.refresh()
+
+    def update_gps(self, data, rtc_handler):
+        """Lines 1-3: time, fix, position, speed and g (first half of update)"""
 
         # Line 1: {HH:MM:SS} {GPS Fix} {HDOP bars}
         now = time.localtime()
@@ -77,37 +115,83 @@ class OLED:
         fix_str = data['gps']['fix']
         hdop = data['gps']['hdop']
 
-        self.line1.text = f"{time_str} {fix_str:5s} {hdop:.1f}"
+        self._set_line(0, f"{time_str} {fix_str:5s} {hdop:.1f}")
         
         # Line 2: Lat/Long
-        self.line2.text = f"{data['gps']['lat']} {data['gps']['lon']}"
+        self._set_line(1, f"{data['gps']['lat']} {data['gps']['lon']}")
         
         # Line 3: {MPH} {Total G Force}
-        self.line3.text = f"{data['gps']['speed']:3.0f}MPH  {self._smooth_g(data['accel']['ax'], data['accel']['ay']):+.2f}g"
+        self._set_line(2, f"{data['gps']['speed']:3.0f}MPH  {self._smooth_g(data['accel']['ax'], data['accel']['ay']):+.2f}g")
+
+    def update_session(self, session, lap=None):
+        """
+        Lines 4-5: log file and SD card estimate (second half of update)
+        
+        Once lap is timing (lap_timer.LapTimer), line 5 shows the lap
+        number, time into the lap and the predictive delta instead.
+        """
         
         # Line 4: {Log file name} {File record time}
         if session.active:
+            if session.filename != self._session_file:
+                # Session name only changes with the file
+                self._session_file = session.filename
+                no_ext = (session.filename.split("."))[0]
+                self._short_name = no_ext.split("_")[1] if session.filename else "NoLog"
             duration = format_time_hms(session.get_duration())
-            no_ext = (session.filename.split("."))[0]
-            short_name = no_ext.split("_")[1] if session.filename else "NoLog"
-            self.line4.text = f"Run:{short_name} {duration}"
+            self._set_line(3, f"Run:{self._short_name} {duration}")
         else:
-            self.line4.text = "NoLog 00:00:00"
+            self._set_line(3, "NoLog 00:00:00")
+        
+        # Line 5: {Lap} {Lap time} {Delta to best lap}
+        if lap and lap.timing:
+            self._set_line(4, self._lap_text(lap))
+            return
         
-        # Line 5: {Estimate of SD Card remaining time}
+        # Line 5: {Estimate of SD Card remaining time} - statvfs is slow
+        # and the estimate barely moves, so only every SD_REFRESH_SECONDS
+        now = time.monotonic()
+        if self._sd_checked and now - self._sd_checked < SD_REFRESH_SECONDS:
+            return
+        self._sd_checked = now
+        
+        sd_stat = os.statvfs("/sd")
+        free_bytes = sd_stat[0] * sd_stat[3]
         if session.active:
             bytes_per_sec = session.get_bytes_per_second()
-            # Get current free space
-            sd_stat = os.statvfs("/sd")
-            free_bytes = sd_stat[0] * sd_stat[3]
             remaining = estimate_recording_time(free_bytes, bytes_per_sec)
-            self.line5.text = f"SD: {remaining} remain"
+            self._set_line(4, f"SD: {remaining} remain")
         else:
             # Show total free space in GB
-            sd_stat = os.statvfs("/sd")
-            free_gb = (sd_stat[0] * sd_stat[3]) / (1024**3)
-            self.line5.text = f"SD: {free_gb:.1f}GB free"
-        self.display.root_group = self.main_group
+            free_gb = free_bytes / (1024**3)
+            self._set_line(4, f"SD: {free_gb:.1f}GB free")
+
+    def _lap_text(self, lap):
+        """L3 1:02.4 -0.42 - or the last lap time until there is a delta"""
+        elapsed = _lap_time(lap.elapsed_us(time.monotonic_ns() // 1000))
+        if lap.delta_us != LAP_NO_DELTA:
+            return f"L{lap.lap} {elapsed} {lap.delta_us / 1000000:+.2f}"
+        if lap.last_lap_us:
+            return f"L{lap.lap} {elapsed} {_lap_time(lap.last_lap_us)}"
+        return f"L{lap.lap} {elapsed}"
+
+    def refresh(self):
+        """
+        Send changed areas of the display, if any label changed
+        
+        With auto_refresh off this is the only I2C traffic for the
+        display, so code.py runs it as its own low priority task and the
+        scheduler holds it back until it fits before the next sample.
+        
+        Returns:
+            True if the display was refreshed
+        """
+        if not self.dirty:
+            return False
+        self.dirty = False
+        self.display.refresh()
+        self.refreshes += 1
+        return True
 
     def _smooth_g(self, new_x, new_y):
         self.smooth_x = ((self.smooth_x * 16) - self.smooth_x + new_x)/16
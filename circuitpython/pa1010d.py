@@ -20,6 +20,16 @@ I2C/STEMMA QT connections:
 - SDA -> GP8 (I2C1 SDA)
 - VIN -> 3.3V
 - GND -> GND
+
+Sentences are parsed by a byte-level state machine straight from a
+preallocated read buffer: the checksum is accumulated as bytes arrive,
+field offsets are recorded in place and numbers are decoded from the
+bytes, so a sentence costs no allocations. Sentences other than GGA,
+RMC, GSA and GSV are dropped as soon as their address has been read.
+
+fast_profile() moves the module to 10Hz RMC + GGA only (the UART is
+raised to 57600 baud to fit); request_satellites() turns GSV on for a
+while when the satellite view wants it.
 """
 
 import time
@@ -28,28 +38,71 @@ from micropython import const
 # I2C address for PA1010D
 PA1010D_ADDR = const(0x10)
 
-# Common NMEA sentence types
-NMEA_GGA = b'$GPGGA'  # Fix data
-NMEA_RMC = b'$GPRMC'  # Recommended minimum
-NMEA_GSA = b'$GPGSA'  # DOP and active satellites
-NMEA_GSV = b'$GPGSV'  # Satellites in view
-NMEA_VTG = b'$GPVTG'  # Track and ground speed
+# NMEA sentence types parsed (talker-independent: $GP, $GN, $GL, ...)
+NMEA_GGA = b'GGA'  # Fix data
+NMEA_RMC = b'RMC'  # Recommended minimum
+NMEA_GSA = b'GSA'  # DOP and active satellites
+NMEA_GSV = b'GSV'  # Satellites in view
 
 # GPS fix quality
 FIX_INVALID = const(0)
 FIX_GPS = const(1)
 FIX_DGPS = const(2)
 
+# Sentence limits - NMEA allows 82 characters including $ and CRLF
+NMEA_MAX_LENGTH = const(96)
+NMEA_MAX_FIELDS = const(24)
+READ_BUFFER_SIZE = const(255)  # One PA1010D I2C read
+MAX_SATELLITES = const(32)
+
+# Parser states
+_IDLE = const(0)          # Waiting for $
+_BODY = const(1)          # Address and fields, checksummed
+_CHECKSUM_HI = const(2)   # First hex digit after *
+_CHECKSUM_LO = const(3)
+
+# Sentence types as 24-bit ints of the three type characters
+_GGA = const(0x474741)
+_RMC = const(0x524D43)
+_GSA = const(0x475341)
+_GSV = const(0x475356)
+
+# UART rate used by fast_profile() - 10Hz RMC + GGA is ~1500 bytes/s,
+# more than 9600 baud carries
+FAST_BAUDRATE = const(57600)
+
+# How long request_satellites() keeps GSV on
+GSV_HOLD_SECONDS = 30
+
+# How long probe_baudrate() listens at each rate - sentences come at least
+# once a second
+PROBE_SECONDS = 1.2
+
+_POW10 = (1, 10, 100, 1000, 10000, 100000, 1000000, 10000000)
+
+
+def _hex_digit(b):
+    if 0x30 <= b <= 0x39:
+        return b - 0x30
+    if 0x41 <= b <= 0x46:
+        return b - 0x37
+    if 0x61 <= b <= 0x66:
+        return b - 0x57
+    return -1
+
 
 class PA1010D:
     """
     PA1010D GPS module driver
     
-    Supports both UART and I2C interfaces
+    Supports both UART and I2C interfaces. Exposes the adafruit_gps
+    attributes gps.py uses (latitude, altitude_m, track_angle_deg,
+    has_3d_fix, timestamp_utc, ...) so it can stand in for it.
     
     Example usage (UART):
         uart = busio.UART(board.GP0, board.GP1, baudrate=9600)
         gps = PA1010D(uart, mode='uart')
+        gps.fast_profile()
         
     Example usage (I2C):
         i2c = busio.I2C(board.GP9, board.GP8)
@@ -71,6 +124,11 @@ class PA1010D:
         if self.mode == 'uart':
             self.uart = interface
             self.i2c = None
+            # Never block in update() - read only what has arrived
+            try:
+                self.uart.timeout = 0
+            except AttributeError:
+                pass
         elif self.mode == 'i2c':
             self.i2c = interface
             self.uart = None
@@ -83,47 +141,70 @@ class PA1010D:
         # GPS state
         self.latitude = None
         self.longitude = None
+        self.latitude_degrees = None   # Integer degrees, exact
+        self.latitude_minutes = None
+        self.longitude_degrees = None
+        self.longitude_minutes = None
         self.altitude = None
         self.speed_knots = None
         self.speed_mph = None
         self.track_angle = None
         self.satellites = None
         self.fix_quality = FIX_INVALID
-        self.timestamp = None
-        self.date = None
         self.hdop = None
+        self._hour = None              # UTC time of the last fix
+        self._minute = 0
+        self._second = 0
+        self._day = None               # UTC date from RMC
+        self._month = 0
+        self._year = 0
         
-        # Buffer for partial sentences
-        self._buffer = bytearray()
+        # Satellites in view (GSV), published when a full cycle is in
+        self.sats_in_view = 0
+        self.sat_prn = [0] * MAX_SATELLITES
+        self.sat_elevation = [0] * MAX_SATELLITES
+        self.sat_azimuth = [0] * MAX_SATELLITES
+        self.sat_snr = [0] * MAX_SATELLITES
+        self.gsv_sequence = 0          # Bumped on each published cycle
+        self._gsv_count = 0
+        self._gsv_talker = 0
+        
+        # Parser - all buffers preallocated
+        self._rx = bytearray(READ_BUFFER_SIZE)
+        self._line = bytearray(NMEA_MAX_LENGTH)
+        self._fields = [0] * NMEA_MAX_FIELDS   # Start offset of each field
+        self._nfields = 0
+        self._pos = 0
+        self._state = _IDLE
+        self._checksum = 0
+        self._expected = 0
+        self.sentences = 0             # Valid sentences parsed
+        self.checksum_errors = 0
+        self.skipped = 0               # Dropped by the sentence filter
+        
+        # Output configuration (fast_profile / request_satellites)
+        self.rate_hz = 1
+        self._gga = True
+        self._rmc = True
+        self._gsv = False
+        self._gsv_until = 0
         
         print(f"[PA1010D] Initialized in {mode.upper()} mode")
     
     def _read_uart(self):
-        """Read available data from UART"""
+        """Read available data from UART into the read buffer"""
         if self.uart.in_waiting > 0:
-            data = self.uart.read(self.uart.in_waiting)
-            if data:
-                self._buffer.extend(data)
+            return self.uart.readinto(self._rx) or 0
+        return 0
     
     def _read_i2c(self):
-        """Read available data from I2C"""
+        """Read one I2C buffer (LF padded when the module has nothing)"""
         try:
-            # PA1010D can provide up to 255 bytes at a time over I2C
-            data = bytearray(255)
-            self.i2c.readfrom_into(PA1010D_ADDR, data)
-            
-            # Find actual data (stop at first 0x0A or null)
-            end_idx = 0
-            for i, byte in enumerate(data):
-                if byte == 0x0A or byte == 0x00:
-                    end_idx = i + 1
-                    break
-            
-            if end_idx > 0:
-                self._buffer.extend(data[:end_idx])
+            self.i2c.readfrom_into(PA1010D_ADDR, self._rx)
+            return READ_BUFFER_SIZE
         except OSError:
             # No data available
-            pass
+            return 0
     
     def update(self):
         """
@@ -132,174 +213,326 @@ class PA1010D:
         Returns:
             True if new data was processed, False otherwise
         """
+        if self._gsv_until and time.monotonic() > self._gsv_until:
+            self._gsv_until = 0
+            self._set_gsv(False)
+        
         # Read data from interface
         if self.mode == 'uart':
-            self._read_uart()
+            length = self._read_uart()
         else:
-            self._read_i2c()
+            length = self._read_i2c()
+        
+        if length:
+            return self._feed(self._rx, length)
+        return False
+    
+    def _feed(self, buf, length):
+        """
+        Run the state machine over buf[:length]
         
-        # Process complete NMEA sentences
+        Returns:
+            True if a sentence updated the GPS state
+        """
+        line = self._line
+        fields = self._fields
+        state = self._state
+        pos = self._pos
+        nfields = self._nfields
+        checksum = self._checksum
         updated = False
-        while b'\n' in self._buffer:
-            # Extract one sentence
-            line_end = self._buffer.index(b'\n')
-            sentence = bytes(self._buffer[:line_end])
-            self._buffer = self._buffer[line_end + 1:]
+        i = 0
+        
+        while i < length:
+            if state == _IDLE:
+                i = buf.find(b'$', i, length)
+                if i < 0:
+                    break
+                i += 1
+                state = _BODY
+                pos = 0
+                nfields = 1
+                fields[0] = 0
+                checksum = 0
+                continue
             
-            # Parse sentence
-            if self._parse_sentence(sentence):
-                updated = True
+            b = buf[i]
+            i += 1
+            
+            if state == _BODY:
+                if b == 0x2A:                    # '*'
+                    state = _CHECKSUM_HI
+                elif b == 0x24:                  # '$' - restart
+                    state = _IDLE
+                    i -= 1
+                    self.checksum_errors += 1
+                elif b < 0x20 or pos >= NMEA_MAX_LENGTH:
+                    state = _IDLE
+                    self.checksum_errors += 1
+                else:
+                    checksum ^= b
+                    line[pos] = b
+                    pos += 1
+                    if b == 0x2C:                # ','
+                        if nfields < NMEA_MAX_FIELDS:
+                            fields[nfields] = pos
+                            nfields += 1
+                    elif pos == 5:
+                        # Address complete (talker + type) - filter
+                        kind = (line[2] << 16) | (line[3] << 8) | line[4]
+                        if kind != _GGA and kind != _RMC and kind != _GSA and kind != _GSV:
+                            state = _IDLE
+                            self.skipped += 1
+            elif state == _CHECKSUM_HI:
+                digit = _hex_digit(b)
+                if digit < 0:
+                    state = _IDLE
+                    self.checksum_errors += 1
+                else:
+                    self._expected = digit << 4
+                    state = _CHECKSUM_LO
+            else:
+                digit = _hex_digit(b)
+                state = _IDLE
+                if digit < 0 or (self._expected | digit) != checksum or pos < 5:
+                    self.checksum_errors += 1
+                else:
+                    self._pos = pos
+                    self._nfields = nfields
+                    if self._dispatch():
+                        updated = True
         
+        self._state = state
+        self._pos = pos
+        self._nfields = nfields
+        self._checksum = checksum
         return updated
     
-    def _parse_sentence(self, sentence):
+    # -------------------------------------------------------------------------
+    # In-place field decoding (field 0 is the address)
+    # -------------------------------------------------------------------------
+    
+    def _span(self, field):
+        """(start, end) of a field in the line, empty if it is missing"""
+        if field >= self._nfields:
+            return 0, 0
+        start = self._fields[field]
+        if field + 1 < self._nfields:
+            return start, self._fields[field + 1] - 1
+        return start, self._pos
+    
+    def _empty(self, field):
+        start, end = self._span(field)
+        return start == end
+    
+    def _char(self, field):
+        """First byte of a field, 0 if empty"""
+        start, end = self._span(field)
+        return self._line[start] if end > start else 0
+    
+    def _int(self, field, start=0, digits=0):
         """
-        Parse NMEA sentence
+        Decimal integer from a field (or digits of it), None if empty
         
-        Args:
-            sentence: NMEA sentence bytes
-            
-        Returns:
-            True if sentence was parsed successfully
+        Stops at the decimal point.
         """
-        # Remove \r if present
-        sentence = sentence.rstrip(b'\r')
-        
-        # Check for valid sentence
-        if not sentence.startswith(b'$'):
-            return False
+        first, end = self._span(field)
+        first += start
+        if digits:
+            end = min(end, first + digits)
+        if first >= end:
+            return None
+        line = self._line
+        value = 0
+        negative = line[first] == 0x2D          # '-'
+        if negative:
+            first += 1
+        for p in range(first, end):
+            b = line[p]
+            if b == 0x2E:                       # '.'
+                break
+            if b < 0x30 or b > 0x39:
+                raise ValueError("bad NMEA number")
+            value = value * 10 + b - 0x30
+        return -value if negative else value
+    
+    def _float(self, field, start=0):
+        """Decimal number from a field (from offset start), None if empty"""
+        first, end = self._span(field)
+        first += start
+        if first >= end:
+            return None
+        line = self._line
+        negative = line[first] == 0x2D
+        if negative:
+            first += 1
+        whole = 0
+        frac = 0
+        decimals = -1
+        for p in range(first, end):
+            b = line[p]
+            if b == 0x2E:
+                decimals = 0
+            elif b < 0x30 or b > 0x39:
+                raise ValueError("bad NMEA number")
+            elif decimals < 0:
+                whole = whole * 10 + b - 0x30
+            elif decimals < 7:
+                frac = frac * 10 + b - 0x30
+                decimals += 1
+        value = whole + frac / _POW10[decimals] if decimals > 0 else whole
+        return -value if negative else float(value)
+    
+    def _coordinate(self, field, degree_digits):
+        """
+        ddmm.mmmm / dddmm.mmmm plus hemisphere field
         
-        # Verify checksum if present
-        if b'*' in sentence:
-            data, checksum = sentence.rsplit(b'*', 1)
-            try:
-                expected = int(checksum, 16)
-                actual = 0
-                for byte in data[1:]:  # Skip $
-                    actual ^= byte
-                if actual != expected:
+        Returns:
+            (degrees, minutes, signed decimal degrees) or None if empty
+        """
+        if self._empty(field) or self._empty(field + 1):
+            return None
+        degrees = self._int(field, 0, degree_digits)
+        minutes = self._float(field, degree_digits)
+        value = degrees + minutes / 60.0
+        hemisphere = self._char(field + 1)
+        if hemisphere == 0x53 or hemisphere == 0x57:   # 'S' / 'W'
+            degrees = -degrees
+            value = -value
+        return degrees, minutes, value
+    
+    def _time(self, field):
+        """hhmmss.sss"""
+        if not self._empty(field):
+            self._hour = self._int(field, 0, 2)
+            self._minute = self._int(field, 2, 2)
+            self._second = self._int(field, 4, 2)
+    
+    def _position(self, lat_field):
+        lat = self._coordinate(lat_field, 2)
+        if lat:
+            self.latitude_degrees, self.latitude_minutes, self.latitude = lat
+        lon = self._coordinate(lat_field + 2, 3)
+        if lon:
+            self.longitude_degrees, self.longitude_minutes, self.longitude = lon
+    
+    # -------------------------------------------------------------------------
+    # Sentences
+    # -------------------------------------------------------------------------
+    
+    def _dispatch(self):
+        """Parse the checksummed sentence in the line buffer"""
+        line = self._line
+        kind = (line[2] << 16) | (line[3] << 8) | line[4]
+        try:
+            if kind == _GGA:
+                self._parse_gga()
+            elif kind == _RMC:
+                if not self._parse_rmc():
                     return False
-            except ValueError:
+            elif kind == _GSA:
+                self._parse_gsa()
+            elif kind == _GSV:
+                self._parse_gsv()
+            else:
                 return False
-        
-        # Split into fields
-        try:
-            fields = sentence.split(b',')
-        except:
+        except ValueError:
+            self.checksum_errors += 1
             return False
+        self.sentences += 1
+        return True
+    
+    def _parse_gga(self):
+        """Parse $--GGA sentence (fix data)"""
+        self._time(1)
+        self._position(2)
         
-        # Parse based on sentence type
-        sentence_type = fields[0]
+        quality = self._int(6)
+        if quality is not None:
+            self.fix_quality = quality
         
-        if sentence_type == NMEA_GGA:
-            return self._parse_gga(fields)
-        elif sentence_type == NMEA_RMC:
-            return self._parse_rmc(fields)
-        elif sentence_type == NMEA_GSA:
-            return self._parse_gsa(fields)
+        satellites = self._int(7)
+        if satellites is not None:
+            self.satellites = satellites
         
-        return False
+        hdop = self._float(8)
+        if hdop is not None:
+            self.hdop = hdop
+        
+        altitude = self._float(9)
+        if altitude is not None:
+            self.altitude = altitude
     
-    def _parse_gga(self, fields):
-        """Parse $GPGGA sentence (fix data)"""
-        try:
-            # Time (hhmmss.sss)
-            if fields[1]:
-                self.timestamp = fields[1].decode('ascii')
-            
-            # Latitude (ddmm.mmmm)
-            if fields[2] and fields[3]:
-                lat = float(fields[2])
-                lat_deg = int(lat / 100)
-                lat_min = lat - (lat_deg * 100)
-                self.latitude = lat_deg + lat_min / 60.0
-                if fields[3] == b'S':
-                    self.latitude = -self.latitude
-            
-            # Longitude (dddmm.mmmm)
-            if fields[4] and fields[5]:
-                lon = float(fields[4])
-                lon_deg = int(lon / 100)
-                lon_min = lon - (lon_deg * 100)
-                self.longitude = lon_deg + lon_min / 60.0
-                if fields[5] == b'W':
-                    self.longitude = -self.longitude
-            
-            # Fix quality
-            if fields[6]:
-                self.fix_quality = int(fields[6])
-            
-            # Number of satellites
-            if fields[7]:
-                self.satellites = int(fields[7])
-            
-            # HDOP
-            if fields[8]:
-                self.hdop = float(fields[8])
-            
-            # Altitude
-            if fields[9]:
-                self.altitude = float(fields[9])
-            
-            return True
-        except (ValueError, IndexError):
+    def _parse_rmc(self):
+        """Parse $--RMC sentence (recommended minimum)"""
+        self._time(1)
+        
+        # Status (A=valid, V=invalid)
+        if self._char(2) != 0x41:
             return False
+        
+        self._position(3)
+        
+        speed = self._float(7)
+        if speed is not None:
+            self.speed_knots = speed
+            self.speed_mph = speed * 1.15078  # knots to mph
+        
+        track = self._float(8)
+        if track is not None:
+            self.track_angle = track
+        
+        # Date (ddmmyy)
+        if not self._empty(9):
+            self._day = self._int(9, 0, 2)
+            self._month = self._int(9, 2, 2)
+            self._year = 2000 + self._int(9, 4, 2)
+        return True
     
-    def _parse_rmc(self, fields):
-        """Parse $GPRMC sentence (recommended minimum)"""
-        try:
-            # Time
-            if fields[1]:
-                self.timestamp = fields[1].decode('ascii')
-            
-            # Status (A=valid, V=invalid)
-            if fields[2] != b'A':
-                return False
-            
-            # Latitude
-            if fields[3] and fields[4]:
-                lat = float(fields[3])
-                lat_deg = int(lat / 100)
-                lat_min = lat - (lat_deg * 100)
-                self.latitude = lat_deg + lat_min / 60.0
-                if fields[4] == b'S':
-                    self.latitude = -self.latitude
-            
-            # Longitude
-            if fields[5] and fields[6]:
-                lon = float(fields[5])
-                lon_deg = int(lon / 100)
-                lon_min = lon - (lon_deg * 100)
-                self.longitude = lon_deg + lon_min / 60.0
-                if fields[6] == b'W':
-                    self.longitude = -self.longitude
-            
-            # Speed (knots)
-            if fields[7]:
-                self.speed_knots = float(fields[7])
-                self.speed_mph = self.speed_knots * 1.15078  # knots to mph
-            
-            # Track angle
-            if fields[8]:
-                self.track_angle = float(fields[8])
-            
-            # Date (ddmmyy)
-            if fields[9]:
-                self.date = fields[9].decode('ascii')
-            
-            return True
-        except (ValueError, IndexError):
-            return False
+    def _parse_gsa(self):
+        """Parse $--GSA sentence (DOP and active satellites)"""
+        hdop = self._float(16)
+        if hdop is not None:
+            self.hdop = hdop
     
-    def _parse_gsa(self, fields):
-        """Parse $GPGSA sentence (DOP and active satellites)"""
-        try:
-            # HDOP (field 16)
-            if len(fields) > 16 and fields[16]:
-                self.hdop = float(fields[16])
-            return True
-        except (ValueError, IndexError):
-            return False
+    def _parse_gsv(self):
+        """
+        Parse $--GSV sentence (satellites in view, 4 per sentence)
+        
+        A cycle starts with message 1 of the first talker seen (GP, GL
+        ... share one table) and is published on each talker's last
+        message.
+        """
+        total = self._int(1)
+        number = self._int(2)
+        if not total or not number:
+            return
+        
+        talker = (self._line[0] << 8) | self._line[1]
+        if number == 1 and (talker == self._gsv_talker or not self._gsv_talker):
+            self._gsv_talker = talker
+            self._gsv_count = 0
+        
+        field = 4
+        while field + 3 < self._nfields and self._gsv_count < MAX_SATELLITES:
+            prn = self._int(field)
+            if prn is None:
+                break
+            i = self._gsv_count
+            self.sat_prn[i] = prn
+            self.sat_elevation[i] = self._int(field + 1) or 0
+            self.sat_azimuth[i] = self._int(field + 2) or 0
+            self.sat_snr[i] = self._int(field + 3) or 0
+            self._gsv_count = i + 1
+            field += 4
+        
+        if number == total:
+            self.sats_in_view = self._gsv_count
+            self.gsv_sequence += 1
+    
+    # -------------------------------------------------------------------------
+    # adafruit_gps compatible state
+    # -------------------------------------------------------------------------
     
     @property
     def has_fix(self):
@@ -311,6 +544,40 @@ class PA1010D:
         """Check if GPS has 3D fix (altitude valid)"""
         return self.fix_quality > FIX_INVALID and self.altitude is not None
     
+    @property
+    def has_3d_fix(self):
+        return self.fix_quality_3d
+    
+    @property
+    def altitude_m(self):
+        return self.altitude
+    
+    @property
+    def track_angle_deg(self):
+        return self.track_angle
+    
+    @property
+    def timestamp(self):
+        """UTC time of the last fix as hhmmss, None before the first"""
+        if self._hour is None:
+            return None
+        return f"{self._hour:02d}{self._minute:02d}{self._second:02d}"
+    
+    @property
+    def date(self):
+        """UTC date as ddmmyy, None before the first valid RMC"""
+        if self._day is None:
+            return None
+        return f"{self._day:02d}{self._month:02d}{self._year % 100:02d}"
+    
+    @property
+    def timestamp_utc(self):
+        """UTC date and time as time.struct_time, None until RMC has a date"""
+        if self._day is None or self._hour is None:
+            return None
+        return time.struct_time((self._year, self._month, self._day,
+                                 self._hour, self._minute, self._second, 0, -1, -1))
+    
     def send_command(self, command):
         """
         Send PMTK command to GPS
@@ -355,6 +622,9 @@ class PA1010D:
         """
         Configure which NMEA sentences to output
         
+        Each argument is a bool, or an int N to output the sentence once
+        every N fixes (e.g. gsv=10 at 10Hz for 1Hz satellites).
+        
         Args:
             gga: Enable GGA (fix data)
             rmc: Enable RMC (recommended minimum)
@@ -365,13 +635,96 @@ class PA1010D:
         # PMTK314 sets output sentences
         # Format: GLL,RMC,VTG,GGA,GSA,GSV,...
         cmd = "PMTK314,0,{},{},{},{},{},0,0,0,0,0,0,0,0,0,0,0,0,0".format(
-            1 if rmc else 0,
-            1 if vtg else 0,
-            1 if gga else 0,
-            1 if gsa else 0,
-            1 if gsv else 0
+            int(rmc),
+            int(vtg),
+            int(gga),
+            int(gsa),
+            int(gsv)
         )
         self.send_command(cmd)
+        self._gga = bool(gga)
+        self._rmc = bool(rmc)
+        self._gsv = bool(gsv)
+    
+    def set_baudrate(self, baudrate):
+        """
+        Change the module's UART rate (PMTK251) and follow it
+        
+        Args:
+            baudrate: 9600, 38400, 57600 or 115200
+        """
+        if self.mode != 'uart':
+            return
+        self.send_command(f"PMTK251,{baudrate}")
+        time.sleep(0.1)  # Let the command drain at the old rate
+        self.uart.baudrate = baudrate
+    
+    def probe_baudrate(self, rates=(9600, FAST_BAUDRATE), listen=PROBE_SECONDS):
+        """
+        Find the rate the module is sending NMEA at and follow it
+        
+        The module keeps a PMTK251 rate until it loses power, so after a
+        soft reboot of the Pico it can still be at FAST_BAUDRATE while the
+        UART was reopened at the configured rate.
+        
+        Args:
+            rates: Rates to try, in order
+            listen: Seconds to listen at each rate
+        
+        Returns:
+            The rate sentences were seen at, or None (UART left at the
+            first rate)
+        """
+        if self.mode != 'uart':
+            return None
+        for baudrate in rates:
+            self.uart.baudrate = baudrate
+            self.uart.reset_input_buffer()
+            deadline = time.monotonic() + listen
+            while time.monotonic() < deadline:
+                length = self._read_uart()
+                if length:
+                    # Talker ID of every sentence; noise at the wrong rate
+                    # is very unlikely to match
+                    chunk = bytes(self._rx[:length])
+                    if b'$GP' in chunk or b'$GN' in chunk:
+                        return baudrate
+                else:
+                    time.sleep(0.05)
+        self.uart.baudrate = rates[0]
+        return None
+    
+    def fast_profile(self, rate_hz=10, baudrate=FAST_BAUDRATE):
+        """
+        Startup profile for corner analysis: rate_hz fixes, RMC + GGA only
+        
+        GSV stays off until request_satellites(). The UART is raised first
+        so 10Hz sentences fit.
+        
+        Args:
+            rate_hz: Fix rate (1, 5 or 10)
+            baudrate: UART rate to switch to (UART mode only)
+        """
+        self.set_output_sentences(gga=True, rmc=True)
+        if baudrate and (self.mode != 'uart' or self.uart.baudrate != baudrate):
+            self.set_baudrate(baudrate)
+        self.set_update_rate(rate_hz)
+        self.rate_hz = rate_hz
+    
+    def request_satellites(self, hold=GSV_HOLD_SECONDS):
+        """
+        Satellite view is open - output GSV (1Hz) for the next hold seconds
+        
+        Called on every satellite request; GSV goes off again in update()
+        once requests stop.
+        """
+        self._gsv_until = time.monotonic() + hold
+        if not self._gsv:
+            self._set_gsv(True)
+    
+    def _set_gsv(self, enabled):
+        self.set_output_sentences(gga=self._gga, rmc=self._rmc,
+                                  gsv=self.rate_hz if enabled else 0)
     
     def factory_reset(self):
         """Reset GPS to factory defaults"""
@@ -413,5 +766,10 @@ class PA1010D:
             'speed_mph': self.speed_mph,
             'track_angle': self.track_angle,
             'timestamp': self.timestamp,
-            'date': self.date
+            'date': self.date,
+            'rate_hz': self.rate_hz,
+            'sats_in_view': self.sats_in_view,
+            'sentences': self.sentences,
+            'checksum_errors': self.checksum_errors,
+            'skipped': self.skipped
         }
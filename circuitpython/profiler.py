@@ -0,0 +1,172 @@
+"""
+profiler.py - Main loop stage profiler for OpenPonyLogger
+
+code.py calls start() at the top of each loop iteration, mark(stage) as
+each stage (IMU FIFO, sensor reads, logging, GPS, ...) finishes and end()
+at the bottom. Durations go into preallocated per-stage counters - count,
+total, min and the TOP_N largest - and once a second summary() packs them
+into a SAMPLE_TYPE_PROFILE record for the binary log. opl-info.py reports
+the records, so a slow second can be traced to the stage that caused it
+and lined up with gaps in the data.
+
+Stages that are skipped in an iteration are simply not marked; the time
+spent checking for them lands in the next stage that is.
+"""
+
+import struct
+import time
+
+from binary_logger import (
+    PROFILE_DEADLINE_FORMAT,
+    PROFILE_DEADLINE_SIZE,
+    PROFILE_HEADER_FORMAT,
+    PROFILE_HEADER_SIZE,
+    PROFILE_STAGE_FORMAT,
+    PROFILE_STAGE_SIZE,
+)
+
+_pack_into = struct.pack_into
+
+# Stage ids as written in the record (tools/opl_types.py has the same names)
+STAGE_LOOP = 0        # Whole iteration
+STAGE_IMU_FIFO = 1
+STAGE_SENSORS = 2
+STAGE_LOG = 3         # logger.write_* + logger.service()
+STAGE_GPS = 4
+STAGE_CONSOLE = 5     # 1Hz telemetry print
+STAGE_GC = 6
+STAGE_DISPLAY = 7
+STAGE_PIXEL = 8
+STAGE_OTHER = 9       # Heartbeat, RTC sync, bookkeeping
+
+PROFILE_STAGE_NAMES = ('loop', 'imu_fifo', 'sensors', 'log', 'gps',
+                       'console', 'gc', 'display', 'pixel', 'other')
+
+# Largest durations kept per stage. p99 is exact up to 100 * TOP_N
+# samples a second and a lower bound beyond that.
+TOP_N = 8
+
+_U16_MAX = 0xFFFF
+
+
+class LoopProfiler:
+    """Per-stage timing of the main loop, summarised once a second"""
+    
+    def __init__(self):
+        stages = len(PROFILE_STAGE_NAMES)
+        self.count = [0] * stages
+        self.total = [0] * stages
+        self.min = [0] * stages
+        self.top = [[0] * TOP_N for _ in range(stages)]  # Largest first
+        self.loops = 0
+        self._loop_start = 0
+        self._mark = 0
+        self._record = bytearray(PROFILE_HEADER_SIZE + stages * PROFILE_STAGE_SIZE +
+                                 PROFILE_DEADLINE_SIZE)
+    
+    def reset(self):
+        """Clear the counters for the next summary window"""
+        for stage in range(len(PROFILE_STAGE_NAMES)):
+            self.count[stage] = 0
+            self.total[stage] = 0
+            self.min[stage] = 0
+            top = self.top[stage]
+            for i in range(TOP_N):
+                top[i] = 0
+        self.loops = 0
+    
+    def start(self):
+        """Start of a loop iteration"""
+        now = time.monotonic_ns()
+        self._loop_start = now
+        self._mark = now
+    
+    def mark(self, stage):
+        """Stage has finished - charge it the time since the last mark"""
+        now = time.monotonic_ns()
+        self._add(stage, (now - self._mark) // 1000)
+        self._mark = now
+    
+    def end(self):
+        """
+        End of a loop iteration
+        
+        Returns:
+            int: Iteration time in microseconds
+        """
+        now = time.monotonic_ns()
+        self._add(STAGE_OTHER, (now - self._mark) // 1000)
+        us = (now - self._loop_start) // 1000
+        self._add(STAGE_LOOP, us)
+        self.loops += 1
+        return us
+    
+    def _add(self, stage, us):
+        count = self.count[stage]
+        self.count[stage] = count + 1
+        self.total[stage] += us
+        if count == 0 or us < self.min[stage]:
+            self.min[stage] = us
+        
+        top = self.top[stage]
+        if us > top[TOP_N - 1]:
+            i = TOP_N - 1
+            while i > 0 and top[i - 1] < us:
+                top[i] = top[i - 1]
+                i -= 1
+            top[i] = us
+    
+    def p99(self, stage):
+        """Nearest-rank 99th percentile (us) of the current window"""
+        count = self.count[stage]
+        if count == 0:
+            return 0
+        rank = count - (99 * count + 99) // 100   # Index from the largest
+        return self.top[stage][min(rank, TOP_N - 1)]
+    
+    def worst_stage(self):
+        """
+        Returns:
+            tuple: (name, max us) of the slowest stage this window
+        """
+        worst = STAGE_OTHER
+        for stage in range(STAGE_LOOP + 1, len(PROFILE_STAGE_NAMES)):
+            if self.top[stage][0] > self.top[worst][0]:
+                worst = stage
+        return PROFILE_STAGE_NAMES[worst], self.top[worst][0]
+    
+    def summary(self, misses=0, deferrals=0):
+        """
+        Pack the window into a SAMPLE_TYPE_PROFILE record and reset
+        
+        Only stages that ran are included.
+        
+        Args:
+            misses: Scheduler sample deadline misses this window
+            deferrals: Scheduler low priority deferrals this window
+        
+        Returns:
+            memoryview: Record bytes (valid until the next summary())
+        """
+        record = self._record
+        pos = PROFILE_HEADER_SIZE
+        stages = 0
+        for stage in range(len(PROFILE_STAGE_NAMES)):
+            count = self.count[stage]
+            if count == 0:
+                continue
+            _pack_into(PROFILE_STAGE_FORMAT, record, pos, stage,
+                       min(count, _U16_MAX),
+                       min(self.min[stage], _U16_MAX),
+                       min(self.total[stage] // count, _U16_MAX),
+                       min(self.p99(stage), _U16_MAX),
+                       min(self.top[stage][0], 0xFFFFFFFF))
+            pos += PROFILE_STAGE_SIZE
+            stages += 1
+        _pack_into(PROFILE_HEADER_FORMAT, record, 0, min(self.loops, _U16_MAX), stages)
+        _pack_into(PROFILE_DEADLINE_FORMAT, record, pos,
+                   min(misses, _U16_MAX), min(deferrals, _U16_MAX))
+        pos += PROFILE_DEADLINE_SIZE
+        
+        self.reset()
+        return memoryview(record)[:pos]
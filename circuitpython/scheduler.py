@@ -0,0 +1,195 @@
+"""
+scheduler.py - Deadline-driven cooperative scheduler for the main loop
+
+code.py registers each piece of main loop work as a task with a period
+and a priority, then calls run_once() forever:
+
+- PRIORITY_SAMPLE tasks are time-triggered. Each deadline is the last one
+  plus the period (no drift), the loop sleeps until it arrives and the
+  task gets the deadline it is running for. A sample that is a whole
+  period late is dropped and counted as a deadline miss.
+- PRIORITY_HIGH tasks (GPS UART, IMU FIFO) run whenever they are due.
+- PRIORITY_LOW tasks (display, NeoPixel, console, gc) run only if their
+  measured cost fits before the next sample deadline. Otherwise they are
+  deferred until after that sample, unless they are already a whole
+  period late - then they run anyway so nothing starves.
+
+A task returning True has more pieces to do: it stays due and its next
+piece is fitted in on a later pass, so long jobs can be split up.
+
+Task run times are charged to the task's profiler stage.
+"""
+
+import time
+
+from profiler import STAGE_OTHER
+
+PRIORITY_SAMPLE = 0   # Time-triggered, never deferred
+PRIORITY_HIGH = 1     # Run when due
+PRIORITY_LOW = 2      # Deferred while it would delay the next sample
+
+# Sleep until this close to the next deadline, then spin - time.sleep()
+# only has ms resolution
+SPIN_NS = 1000000
+
+# Decay of a task's cost estimate (a running max) per run: 1/8
+_COST_DECAY_SHIFT = 3
+
+
+class Task:
+    """One entry in the tick table"""
+
+    def __init__(self, name, period_ms, fn, priority, stage):
+        self.name = name
+        self.fn = fn                    # fn(deadline_ns) -> True if more pieces
+        self.priority = priority
+        self.stage = stage              # Profiler stage to charge
+        self.period_ns = int(period_ms * 1000000)
+        self.next_ns = 0                # Next deadline
+        self.cost_ns = 0                # Decaying max of the run time
+        self.runs = 0
+        self.misses = 0                 # Sample periods dropped
+        self.deferrals = 0              # Times held back for a sample
+        self.late_max_ns = 0            # Worst start after the deadline
+        self._deferred = False
+
+
+class Scheduler:
+    """Tick table of periodic tasks, see the module docstring"""
+
+    def __init__(self, profiler=None):
+        self.profiler = profiler
+        self.tasks = []                 # Priority order
+        self._sample_tasks = []
+        self.misses = 0                 # Since the last take_stats()
+        self.deferrals = 0
+        self.late_max_ns = 0
+        self.total_misses = 0           # This session
+
+    def add(self, name, period_ms, fn, priority=PRIORITY_LOW, stage=STAGE_OTHER):
+        """
+        Register a task, first run on the next pass
+
+        Args:
+            name: Name for stats
+            period_ms: Period in milliseconds
+            fn: Called as fn(deadline_ns); return True to stay due
+            priority: PRIORITY_SAMPLE, PRIORITY_HIGH or PRIORITY_LOW
+            stage: Profiler stage charged with the run time
+
+        Returns:
+            Task
+        """
+        task = Task(name, period_ms, fn, priority, stage)
+        task.next_ns = time.monotonic_ns()
+
+        i = len(self.tasks)
+        while i > 0 and self.tasks[i - 1].priority > priority:
+            i -= 1
+        self.tasks.insert(i, task)
+        if priority == PRIORITY_SAMPLE:
+            self._sample_tasks.append(task)
+        return task
+
+    def _next_sample_ns(self, default):
+        deadline = default
+        for task in self._sample_tasks:
+            if task.next_ns < deadline:
+                deadline = task.next_ns
+        return deadline
+
+    def _run(self, task, deadline_ns):
+        start = time.monotonic_ns()
+        late = start - deadline_ns
+        if late > task.late_max_ns:
+            task.late_max_ns = late
+        if task.priority == PRIORITY_SAMPLE and late > self.late_max_ns:
+            self.late_max_ns = late
+
+        more = task.fn(deadline_ns)
+
+        now = time.monotonic_ns()
+        cost = now - start
+        decayed = task.cost_ns - (task.cost_ns >> _COST_DECAY_SHIFT)
+        task.cost_ns = cost if cost > decayed else decayed
+        task.runs += 1
+        task._deferred = False
+        if self.profiler:
+            self.profiler.mark(task.stage)
+        return more, now
+
+    def _wait(self):
+        """Sleep until the earliest deadline"""
+        now = time.monotonic_ns()
+        wake = now + 1000000000
+        sample_ns = self._next_sample_ns(wake)
+        for task in self.tasks:
+            # Deferred tasks are reconsidered straight after the next sample
+            deadline = sample_ns if task._deferred else task.next_ns
+            if deadline < wake:
+                wake = deadline
+
+        if wake - now > SPIN_NS:
+            time.sleep((wake - now - SPIN_NS) / 1000000000)
+        while time.monotonic_ns() < wake:
+            pass
+
+    def run_once(self):
+        """
+        Wait for the next deadline and run every task that is due
+
+        Returns:
+            int: Busy time of the pass in microseconds
+        """
+        self._wait()
+        if self.profiler:
+            self.profiler.start()
+
+        now = time.monotonic_ns()
+        for task in self.tasks:
+            deadline = task.next_ns
+            if now < deadline:
+                continue
+
+            if task.priority == PRIORITY_SAMPLE:
+                # Samples a whole period late are dropped, not caught up
+                skipped = (now - deadline) // task.period_ns
+                if skipped:
+                    task.misses += skipped
+                    self.misses += skipped
+                    self.total_misses += skipped
+                    deadline += skipped * task.period_ns
+            elif task.priority == PRIORITY_LOW:
+                fits = now + task.cost_ns <= self._next_sample_ns(now + task.cost_ns)
+                if not fits and now - deadline < task.period_ns:
+                    if not task._deferred:
+                        task._deferred = True
+                        task.deferrals += 1
+                        self.deferrals += 1
+                    continue
+
+            more, now = self._run(task, deadline)
+            if more:
+                continue
+
+            task.next_ns = deadline + task.period_ns
+            if task.priority != PRIORITY_SAMPLE and task.next_ns <= now:
+                task.next_ns = now + task.period_ns
+
+        if self.profiler:
+            return self.profiler.end()
+        return (time.monotonic_ns() - now) // 1000
+
+    def take_stats(self):
+        """
+        Deadline stats since the last call, then reset them
+
+        Returns:
+            tuple: (sample deadline misses, low priority deferrals,
+                    worst sample lateness in us)
+        """
+        stats = (self.misses, self.deferrals, self.late_max_ns // 1000)
+        self.misses = 0
+        self.deferrals = 0
+        self.late_max_ns = 0
+        return stats
@@ -71,9 +71,12 @@ def init_accelerometer(i2c_bus):
     
     accel_type = hw_config.get("sensors.accelerometer.type", "LIS3DH").upper()
     accel_addr = hw_config.get_int("sensors.accelerometer.address", 0x18)
+    burst = hw_config.get_bool("sensors.accelerometer.burst", False)
     
     try:
-        if accel_type == "LIS3DH":
+        if burst and accel_type in ("LSM6DSOX", "LSM6DS", "ICM20948", "ICM-20948"):
+            return _init_imu_burst(i2c_bus, accel_type, accel_addr)
+        elif accel_type == "LIS3DH":
             return _init_lis3dh(i2c_bus, accel_addr)
         elif accel_type == "LSM6DSOX" or accel_type == "LSM6DS":
             return _init_lsm6dsox(i2c_bus, accel_addr)
@@ -224,6 +227,70 @@ def _init_icm20948(i2c_bus, address):
     return sensor
 
 
+def _init_imu_burst(i2c_bus, accel_type, address):
+    """
+    Initialize LSM6DSOX/ICM-20948 with the local driver and its FIFO enabled
+    
+    The Adafruit drivers have no FIFO access, so burst mode uses
+    lsm6dsox.py / icm20948.py. The sensor is registered as 'imu_fifo' as
+    well as accelerometer/gyroscope (register reads still work for the
+    display); the main loop drains it with read_fifo().
+    
+    With event_capture the FIFO runs at event_rate and event_capture.py
+    passes every Nth record on to the log at about sample_rate.
+    """
+    accel_range = hw_config.get_int("sensors.accelerometer.range", 4)
+    gyro_range = hw_config.get_int("sensors.gyroscope.range", 250)
+    sample_rate = hw_config.get_int("sensors.accelerometer.sample_rate", 416)
+    if hw_config.get_bool("sensors.accelerometer.event_capture", False):
+        sample_rate = max(sample_rate, hw_config.get_int("sensors.accelerometer.event_rate", 833))
+    
+    if accel_type.startswith("LSM6DS"):
+        import lsm6dsox
+        
+        accel_ranges = {2: lsm6dsox.ACCEL_RANGE_2G, 4: lsm6dsox.ACCEL_RANGE_4G,
+                        8: lsm6dsox.ACCEL_RANGE_8G, 16: lsm6dsox.ACCEL_RANGE_16G}
+        gyro_ranges = {125: lsm6dsox.GYRO_RANGE_125, 250: lsm6dsox.GYRO_RANGE_250,
+                       500: lsm6dsox.GYRO_RANGE_500, 1000: lsm6dsox.GYRO_RANGE_1000,
+                       2000: lsm6dsox.GYRO_RANGE_2000}
+        sensor = lsm6dsox.LSM6DSOX(i2c_bus, address=address, mode='both',
+                                   accel_range=accel_ranges.get(accel_range, lsm6dsox.ACCEL_RANGE_4G),
+                                   gyro_range=gyro_ranges.get(gyro_range, lsm6dsox.GYRO_RANGE_250))
+        
+        # Slowest ODR at or above the requested rate
+        odr = lsm6dsox.ODR_833_HZ
+        for code, hz in enumerate(lsm6dsox.ODR_HZ):
+            if code and hz >= sample_rate:
+                odr = code << 4
+                break
+        sensor.enable_fifo(odr)
+        _sensor_manager.register('lsm6dsox', sensor)
+    else:
+        import icm20948
+        
+        accel_ranges = {2: icm20948.ACCEL_RANGE_2G, 4: icm20948.ACCEL_RANGE_4G,
+                        8: icm20948.ACCEL_RANGE_8G, 16: icm20948.ACCEL_RANGE_16G}
+        gyro_ranges = {250: icm20948.GYRO_RANGE_250, 500: icm20948.GYRO_RANGE_500,
+                       1000: icm20948.GYRO_RANGE_1000, 2000: icm20948.GYRO_RANGE_2000}
+        mode = 'all' if hw_config.is_enabled("sensors.magnetometer") else 'accel_gyro'
+        sensor = icm20948.ICM20948(i2c_bus, address=address, mode=mode,
+                                   accel_range=accel_ranges.get(accel_range, icm20948.ACCEL_RANGE_4G),
+                                   gyro_range=gyro_ranges.get(gyro_range, icm20948.GYRO_RANGE_250))
+        sensor.enable_fifo(sample_rate)
+        _sensor_manager.register('icm20948', sensor)
+        if sensor.use_mag:
+            _sensor_manager.register('magnetometer', sensor)
+    
+    _sensor_manager.register('accelerometer', sensor)
+    _sensor_manager.register('gyroscope', sensor)
+    _sensor_manager.register('imu', sensor)
+    _sensor_manager.register('imu_fifo', sensor)
+    print(f"✓ {accel_type} burst mode (±{accel_range}g, ±{gyro_range}°/s, "
+          f"{1000000 // sensor.fifo_interval_us}Hz FIFO)")
+    
+    return sensor
+
+
 def _init_mpu6050(i2c_bus, address):
     """Initialize MPU-6050/GY-521 6DOF IMU (accelerometer + gyro)"""
     import adafruit_mpu6050
@@ -535,9 +602,12 @@ def init_gps(i2c_bus=None):
     
     gps_type = hw_config.get("gps.type", "ATGM336H").upper()
     gps_interface = hw_config.get("gps.interface", "uart_gps")
+    profile = hw_config.get("gps.profile", "default").lower()
     
     try:
         if "PA1010" in gps_type:
+            if profile == "fast":
+                return _init_pa1010d_fast(i2c_bus, "i2c" in gps_interface.lower())
             # PA1010D can use I2C or UART
             if "i2c" in gps_interface.lower():
                 return _init_pa1010d_i2c(i2c_bus)
@@ -600,6 +670,54 @@ def _init_pa1010d_uart():
     return _init_gps_uart()
 
 
+def _init_pa1010d_fast(i2c_bus, use_i2c):
+    """
+    Initialize PA1010D with the local driver and the fast profile
+    
+    pa1010d.py parses NMEA in place without allocating, and moves the
+    module to 10Hz RMC + GGA only (UART raised to 57600); GSV is turned
+    on while the satellite view is being polled. The sentences and
+    update_rate settings are not used. The module keeps 57600 across a
+    Pico soft reboot, so the UART rate is probed first.
+    """
+    import pa1010d
+    
+    gps_uart = None
+    if use_i2c:
+        if not i2c_bus:
+            print("[GPS] No I2C bus available for PA1010D")
+            return None, None
+        gps = pa1010d.PA1010D(i2c_bus, mode='i2c')
+    else:
+        uart_name = hw_config.get("gps.interface", "uart_gps")
+        uart_config = hw_config.get_interface_pins(uart_name)
+        if not uart_config or not uart_config.get('tx') or not uart_config.get('rx'):
+            print(f"[GPS] UART interface '{uart_name}' not found")
+            return None, None
+        baudrate = uart_config.get('baudrate', 9600)
+        gps_uart = busio.UART(uart_config['tx'], uart_config['rx'],
+                              baudrate=baudrate, timeout=0)
+        gps = pa1010d.PA1010D(gps_uart, mode='uart')
+        
+        # Still at the fast rate if only the Pico was reset
+        rates = (baudrate,) if baudrate == pa1010d.FAST_BAUDRATE else (baudrate, pa1010d.FAST_BAUDRATE)
+        found = gps.probe_baudrate(rates)
+        if found is None:
+            print(f"[GPS] No NMEA at {baudrate} or {pa1010d.FAST_BAUDRATE} baud")
+        elif found != baudrate:
+            print(f"[GPS] Module still at {found} baud")
+    
+    rate_hz = hw_config.get_int("gps.rate_hz", 10)
+    gps.fast_profile(rate_hz)
+    
+    _sensor_manager.register('gps', gps)
+    if gps_uart:
+        _sensor_manager.register('gps_uart', gps_uart)
+    
+    print(f"✓ PA1010D initialized (fast profile, {rate_hz}Hz RMC + GGA)")
+    return gps, gps_uart
+
+
 def _init_pa1010d_i2c(i2c_bus):
     """Initialize PA1010D via I2C"""
     import adafruit_gps
@@ -1,22 +1,297 @@
 """
 serial_com.py - JSON Protocol Handler for OpenPonyLogger
+
+Commands and responses are newline-delimited JSON. If the ESP advertises
+the "bin_telemetry" capability in its esp_ready message, telemetry is sent
+as compact binary frames instead:
+
+    0x00 | COBS(payload + CRC16) ^ 0x0A ... | '\n'
+
+COBS removes all zero bytes from the payload and the XOR maps the encoded
+bytes away from '\n', so a frame ends at a newline just like a JSON line.
+esp_ready may also carry "telemetry_hz", the rate code.py sends at.
+Lap and sector events (lap_timer.py) follow the same choice: a lap frame
+in binary mode, a "lap" JSON line otherwise.
+
+LIST pages through the session catalogue (session_catalog.py) newest
+first: "offset" sessions back, at most "limit" per reply, with "next" set
+when there are older ones.
+
+Commands may carry an "id"; the ok/error/files reply to that command echoes
+it, so the ESP can match replies to the HTTP requests waiting on them.
+Commands without an id get replies without one.
+
+Binary frames are queued and written to the UART UART_TX_SLICE bytes per
+process() call. A write no bigger than the UART's TX FIFO doesn't wait for
+the line, whereas a whole 512-byte frame at 115200 baud held the main
+loop for ~45ms. JSON lines are still written in one go, after the queue.
+
+Session downloads always use binary FILE_DATA frames. See FileTransfer for
+the windowing rules. A GET may start at a byte "offset" (HTTP Range) or at
+a data "block" sequence number, so a broken download can resume without
+resending what the phone already has.
 """
 
 import json
+import os
+import struct
 import time
 
+from binary_logger import find_data_block, LAP_FORMAT, LAP_SIZE, LAP_NO_DELTA
+from session_catalog import CATALOG_CLOSED, LIST_LIMIT_DEFAULT
+
+# Binary framing
+FRAME_DELIMITER = 0x0A
+FRAME_TYPE_TELEMETRY = 0x01
+FRAME_TYPE_FILE_DATA = 0x02
+FRAME_TYPE_LAP = 0x04
+CAP_BIN_TELEMETRY = "bin_telemetry"
+
+# type, seq, g x/y/z/total, lat, lon, alt, speed, sats, hdop, fix
+TELEMETRY_FORMAT = '<BHffffffffBfB'
+TELEMETRY_SIZE = struct.calcsize(TELEMETRY_FORMAT)
+
+# Lap frame: type, then the LAP_FORMAT record as logged
+LAP_FRAME_SIZE = 1 + LAP_SIZE
+
+# Telemetry rates: JSON for ESP firmware without bin_telemetry, which
+# expects the old 1Hz update lines; binary unless esp_ready names a rate
+TELEMETRY_HZ_JSON = 1
+TELEMETRY_HZ_BINARY = 10
+TELEMETRY_HZ_MAX = 25
+
+# GPS fix codes used in binary frames
+FIX_CODES = {"2d": 2, "3d": 3}
+
+# type, seq, then up to FILE_CHUNK_MAX bytes of file data
+FILE_DATA_HEADER = '<BH'
+FILE_DATA_HEADER_SIZE = struct.calcsize(FILE_DATA_HEADER)
+FILE_CHUNK_MAX = 512
+FILE_CHUNK_DEFAULT = 128   # ~11ms on the wire - encoded in one piece
+FILE_WINDOW_DEFAULT = 8
+
+# RP2040 UART TX FIFO depth
+UART_TX_SLICE = 32
+
+ACK_TIMEOUT = 1.0        # Resend the window if nothing is ACKed for this long
+TRANSFER_TIMEOUT = 10.0  # Give up if the ESP goes quiet for this long
+
+_CRC16_TABLE = None
+
+def _crc16_table():
+    """Generate CRC16-CCITT lookup table"""
+    table = []
+    for i in range(256):
+        crc = i << 8
+        for _ in range(8):
+            if crc & 0x8000:
+                crc = ((crc << 1) ^ 0x1021) & 0xFFFF
+            else:
+                crc = (crc << 1) & 0xFFFF
+        table.append(crc)
+    return table
+
+def crc16(data, length):
+    """Calculate CRC16-CCITT (init 0xFFFF) of data[:length]"""
+    global _CRC16_TABLE
+    if _CRC16_TABLE is None:
+        _CRC16_TABLE = _crc16_table()
+    
+    crc = 0xFFFF
+    for i in range(length):
+        crc = ((crc << 8) & 0xFFFF) ^ _CRC16_TABLE[((crc >> 8) ^ data[i]) & 0xFF]
+    return crc
+
+def cobs_encode(src, length, dst, start=0):
+    """
+    COBS-encode src[:length] into dst[start:], XOR'd with FRAME_DELIMITER
+    
+    Returns:
+        int: Index in dst one past the last encoded byte
+    """
+    code_pos = start
+    code = 1
+    out = start + 1
+    for i in range(length):
+        b = src[i]
+        if b == 0:
+            dst[code_pos] = code ^ FRAME_DELIMITER
+            code_pos = out
+            out += 1
+            code = 1
+        else:
+            dst[out] = b ^ FRAME_DELIMITER
+            out += 1
+            code += 1
+            if code == 0xFF:
+                dst[code_pos] = code ^ FRAME_DELIMITER
+                code_pos = out
+                out += 1
+                code = 1
+    dst[code_pos] = code ^ FRAME_DELIMITER
+    return out
+
+
+class FileTransfer:
+    """
+    One file being streamed to the ESP with go-back-N windowing
+    
+    Frame seq n carries bytes [n * chunk, (n + 1) * chunk) of the requested
+    range, so going back to a frame is a seek. At most `window` frames are outstanding. The
+    ESP ACKs cumulatively once a frame's bytes have gone out over HTTP, and
+    NAKs the frame it expected when a later one arrives. Sequence numbers on
+    the wire are the low 16 bits of next_seq/acked.
+    """
+    
+    def __init__(self, filename, path, window, chunk, offset=0, length=None, block=None):
+        """
+        Args:
+            offset: First byte to send
+            length: Bytes to send (None = to end of file)
+            block: Start at this data block instead of offset
+        """
+        self.filename = filename
+        self.size = os.stat(path)[6]
+        self.file = open(path, 'rb')
+        
+        if block is not None:
+            offset = find_data_block(self.file, block)
+            if offset is None:
+                offset = self.size
+        
+        self.offset = max(0, offset)
+        remaining = max(0, self.size - self.offset)
+        self.length = remaining if length is None else max(0, min(length, remaining))
+        
+        self.window = max(1, window)
+        self.chunk = max(1, min(FILE_CHUNK_MAX, chunk))
+        self.frames = (self.length + self.chunk - 1) // self.chunk
+        self.next_seq = 0    # Next frame to send
+        self.acked = 0       # Frames below this are confirmed
+        self.pos = -1        # Current file position
+        self.last_ack = time.monotonic()
+        self.last_send = self.last_ack
+    
+    def _unwrap(self, seq):
+        """Map a 16-bit wire seq to a frame number at or after acked"""
+        return self.acked + ((seq - self.acked) & 0xFFFF)
+    
+    def ack(self, seq):
+        """Frames up to and including seq have been consumed"""
+        frame = self._unwrap(seq)
+        if frame < self.next_seq:
+            self.acked = frame + 1
+            self.last_ack = time.monotonic()
+    
+    def rewind(self, seq):
+        """Resend from frame seq"""
+        frame = self._unwrap(seq)
+        if frame < self.next_seq:
+            self.next_seq = frame
+    
+    def can_send(self):
+        return self.next_seq < self.frames and self.next_seq - self.acked < self.window
+    
+    def check_timeout(self):
+        """
+        Returns:
+            bool: False if the transfer should be abandoned
+        """
+        now = time.monotonic()
+        if now - self.last_ack > TRANSFER_TIMEOUT:
+            return False
+        if self.next_seq > self.acked and now - max(self.last_ack, self.last_send) > ACK_TIMEOUT:
+            self.next_seq = self.acked
+        return True
+    
+    def read_frame(self, buf, offset):
+        """
+        Read the data for frame next_seq into buf[offset:]
+        
+        Returns:
+            int: Bytes read
+        """
+        start = self.offset + self.next_seq * self.chunk
+        if self.pos != start:
+            self.file.seek(start)
+        want = min(self.chunk, self.offset + self.length - start)
+        n = self.file.readinto(memoryview(buf)[offset:offset + want])
+        self.pos = start + n
+        self.next_seq += 1
+        self.last_send = time.monotonic()
+        return n
+    
+    @property
+    def done(self):
+        return self.acked >= self.frames
+    
+    def close(self):
+        try:
+            self.file.close()
+        except Exception:
+            pass
+
+
 class JSONProtocol:
     """Handle JSON commands from ESP-01S"""
     
-    def __init__(self, uart, session, gps):
+    def __init__(self, uart, session, gps, caps=None, telemetry_hz=0):
+        """
+        Args:
+            uart: UART connected to the ESP-01S
+            session: Session logger
+            gps: GPS handler
+            caps: Capabilities from the ESP's esp_ready message
+                  (hardware_setup.esp_caps)
+            telemetry_hz: Rate from the same message, 0 for the default
+                          (hardware_setup.esp_telemetry_hz)
+        """
         self.uart = uart
         self.session = session
         self.gps = gps
         self.buffer = ""
-        self.chunk_size = 512
+        self.request_id = None   # "id" of the command being handled
+        
+        # Binary telemetry buffers, reused every tick
+        self.binary_telemetry = False
+        self.telemetry_hz = TELEMETRY_HZ_JSON
+        self.telemetry_seq = 0
+        self._payload = bytearray(TELEMETRY_SIZE + 2)
+        self._lap_payload = bytearray(LAP_FRAME_SIZE + 2)
+        self._lap_payload[0] = FRAME_TYPE_LAP
+        self.set_capabilities(caps or [], telemetry_hz)
+        
+        # Session download, serviced a frame at a time from process()
+        self.transfer = None
+        file_payload_size = FILE_DATA_HEADER_SIZE + FILE_CHUNK_MAX + 2
+        self._file_payload = bytearray(file_payload_size)
+        
+        # Encoded frames waiting for the UART: room for a file frame with
+        # telemetry and lap frames queued behind it
+        self._tx = bytearray(file_payload_size + file_payload_size // 254 + 128)
+        self._tx_pos = 0
+        self._tx_len = 0
+    
+    def set_capabilities(self, caps, telemetry_hz=0):
+        """Choose the telemetry encoding and rate from the ESP's esp_ready"""
+        self.binary_telemetry = CAP_BIN_TELEMETRY in caps
+        default_hz = TELEMETRY_HZ_BINARY if self.binary_telemetry else TELEMETRY_HZ_JSON
+        try:
+            telemetry_hz = int(telemetry_hz or default_hz)
+        except (TypeError, ValueError):
+            telemetry_hz = default_hz
+        self.telemetry_hz = max(1, min(TELEMETRY_HZ_MAX, telemetry_hz))
+        print(f"[Serial] Telemetry mode: {'binary' if self.binary_telemetry else 'JSON'} "
+              f"at {self.telemetry_hz}Hz")
     
     def process(self):
-        """Check for incoming commands"""
+        """
+        Check for incoming commands and write the next piece of output
+        
+        Returns:
+            bool: True while frames are queued or a download can send
+                  more - call again as soon as there is time
+        """
         if self.uart.in_waiting:
             try:
                 # Read available bytes
@@ -43,6 +318,11 @@ class JSONProtocol:
                 print(f"Serial process error: {e}")
                 # Clear buffer on error
                 self.buffer = ""
+        
+        if self.transfer:
+            self.service_transfer()
+        more = self.service_tx()
+        return more or (self.transfer is not None and self.transfer.can_send())
     
     def handle_line(self, line):
         """Process a single line of JSON"""
@@ -59,22 +339,41 @@ class JSONProtocol:
     def handle_command(self, cmd):
         """Execute command"""
         try:
+            # ESP restarted - renegotiate the telemetry encoding and rate
+            if cmd.get("type") == "esp_ready":
+                self.set_capabilities(cmd.get("caps", []), cmd.get("telemetry_hz", 0))
+                return
+            
             cmd_type = cmd.get("cmd", "")
+            self.request_id = cmd.get("id")
             
             if cmd_type == "LIST":
-                self.send_file_list()
+                self.send_file_list(cmd.get("offset", 0), cmd.get("limit", LIST_LIMIT_DEFAULT))
             
             elif cmd_type == "GET":
                 filename = cmd.get("file", "")
                 if filename:
-                    self.send_file(filename)
+                    self.start_transfer(filename, cmd)
                 else:
                     self.send_error("Missing file parameter")
             
+            elif cmd_type == "ACK":
+                if self.transfer:
+                    self.transfer.ack(cmd.get("seq", 0))
+            
+            elif cmd_type == "NAK":
+                if self.transfer:
+                    self.transfer.rewind(cmd.get("seq", 0))
+            
+            elif cmd_type == "ABORT":
+                if self.transfer:
+                    print(f"[Serial] Download aborted: {self.transfer.filename}")
+                    self.end_transfer()
+            
             elif cmd_type == "DELETE":
                 filename = cmd.get("file", "")
                 if filename:
-                    success = FileManager.delete_file(filename)
+                    success = self.delete_file(filename)
                     if success:
                         self.send_response({"type": "ok", "message": "File deleted"})
                     else:
@@ -112,66 +411,126 @@ class JSONProtocol:
         except Exception as e:
             print(f"Command handling error: {e}")
             self.send_error(f"Error: {e}")
+        finally:
+            self.request_id = None
     
-    def send_file_list(self):
-        """Send list of session files"""
+    def send_file_list(self, offset=0, limit=LIST_LIMIT_DEFAULT):
+        """Send a page of the session catalogue, newest first"""
         try:
-            files = FileManager.list_files()[-5:]
+            catalog = self.session.catalog
+            records, next_offset = catalog.page(offset, limit)
+            files = [{
+                "file": r['file'],
+                "size": r['size'],
+                "start": r['start'],
+                "end": r['end'],
+                "driver": r['driver'],
+                "vin": r['vehicle'],
+                "samples": r['samples'],
+                "peak_g": round(r['peak_g'], 2),
+                "open": not r['flags'] & CATALOG_CLOSED
+            } for r in records]
             response = {
                 "type": "files",
                 "count": len(files),
+                "total": catalog.count,
+                "offset": offset,
                 "files": files
             }
-            self.send_json(response)
+            if next_offset is not None:
+                response["next"] = next_offset
+            self.send_response(response)
         except Exception as e:
             print(f"File list error: {e}")
             self.send_error(f"List error: {e}")
     
-    def send_file(self, filename):
-        """Send file contents in chunks"""
-        filepath = f"/sd/{filename}"
+    def delete_file(self, filename):
+        """Remove a session file and flag its catalogue record"""
+        if '/' in filename or (self.session.active and
+                               self.session.filename.endswith('/' + filename)):
+            return False
+        catalog = self.session.catalog
+        try:
+            os.remove(f"{catalog.base_path}/{filename}")
+        except OSError as e:
+            print(f"Delete error: {e}")
+            return False
+        catalog.mark_deleted(filename)
+        return True
+    
+    def start_transfer(self, filename, cmd):
+        """
+        Open a session file and start streaming it to the ESP
+        
+        Args:
+            cmd: GET command - window, chunk, and optionally offset/length
+                 or block to send only part of the file
+        """
+        if self.transfer:
+            self.end_transfer()
         
         try:
-            stat = os.stat(filepath)
-            file_size = stat[6]
-            
-            # Send file start
-            self.send_json({
-                "type": "file_start",
-                "file": filename,
-                "size": file_size
-            })
-            
-            # Send file data in chunks
-            with open(filepath, 'r') as f:
-                chunk_num = 0
-                while True:
-                    chunk = f.read(self.chunk_size)
-                    if not chunk:
-                        break
-                    
-                    self.send_json({
-                        "type": "file_chunk",
-                        "file": filename,
-                        "chunk": chunk_num,
-                        "data": chunk
-                    })
-                    chunk_num += 1
-                    time.sleep(0.05)  # Small delay between chunks
-            
-            # Send file end
-            self.send_json({
-                "type": "file_end",
-                "file": filename,
-                "chunks": chunk_num
-            })
-            
+            t = FileTransfer(filename, f"/sd/{filename}",
+                             cmd.get("window", FILE_WINDOW_DEFAULT),
+                             cmd.get("chunk", FILE_CHUNK_DEFAULT),
+                             cmd.get("offset", 0), cmd.get("length"), cmd.get("block"))
         except OSError as e:
             print(f"File error: {e}")
-            self.send_error(f"File error: {e}")
+            self.send_json({"type": "file_error", "file": filename, "code": 404,
+                            "message": f"File error: {e}"})
+            return
+        
+        if t.offset and t.offset >= t.size:
+            t.close()
+            self.send_json({"type": "file_error", "file": filename, "code": 416,
+                            "size": t.size, "message": "Range not satisfiable"})
+            return
+        
+        self.transfer = t
+        self.send_json({
+            "type": "file_start",
+            "file": filename,
+            "size": t.size,
+            "offset": t.offset,
+            "length": t.length
+        })
+    
+    def service_transfer(self):
+        """Queue the next file frame once the last one has been written out"""
+        t = self.transfer
+        if self._tx_len:
+            return
+        try:
+            if t.done:
+                self.send_json({"type": "file_end", "file": t.filename, "bytes": t.length})
+                self.end_transfer()
+                return
+            
+            if not t.check_timeout():
+                print(f"[Serial] Download timed out: {t.filename}")
+                self.send_json({"type": "file_error", "file": t.filename, "message": "Transfer timed out"})
+                self.end_transfer()
+                return
+            
+            if t.can_send():
+                self.send_file_frame(t)
         except Exception as e:
             print(f"Send file error: {e}")
-            self.send_error(f"Error: {e}")
+            self.send_json({"type": "file_error", "file": t.filename, "message": f"Error: {e}"})
+            self.end_transfer()
+    
+    def send_file_frame(self, t):
+        """Queue frame t.next_seq as a FILE_DATA frame"""
+        payload = self._file_payload
+        seq = t.next_seq & 0xFFFF
+        n = FILE_DATA_HEADER_SIZE + t.read_frame(payload, FILE_DATA_HEADER_SIZE)
+        struct.pack_into(FILE_DATA_HEADER, payload, 0, FRAME_TYPE_FILE_DATA, seq)
+        struct.pack_into('<H', payload, n, crc16(payload, n))
+        self.send_frame(payload, n + 2)
+    
+    def end_transfer(self):
+        self.transfer.close()
+        self.transfer = None
     
     def send_satellites(self):
         """Send satellite data"""
@@ -181,13 +540,15 @@ class JSONProtocol:
             print(f"Satellite send error: {e}")
     
     def send_response(self, response):
-        """Send generic response"""
+        """Send a reply to the current command, tagged with its id"""
+        if self.request_id is not None:
+            response["id"] = self.request_id
         self.send_json(response)
     
     def send_error(self, message):
         """Send error response"""
         try:
-            self.send_json({
+            self.send_response({
                 "type": "error",
                 "message": str(message)
             })
@@ -195,17 +556,104 @@ class JSONProtocol:
             print(f"Error sending error: {e}")
     
     def send_json(self, obj):
-        """Send JSON object"""
+        """Send JSON object, after any queued frames"""
         try:
             json_str = json.dumps(obj) + "\n"
+            self.flush_tx()
             self.uart.write(json_str.encode('utf-8'))
         except Exception as e:
             print(f"JSON send error: {e}")
 
     def send_telemetry(self, data):
-        """Send JSON update message to ESP"""
+        """
+        Send telemetry update to ESP
+        
+        Args:
+            data: {"g": {x, y, z, total}, "gps": {lat, lon, alt, speed, sats, hdop, fix}}
+        """
+        if self.binary_telemetry:
+            self.send_telemetry_frame(data)
+            return
+        
         msg = {
             "type": "update",
             "data": data
         }
         self.send_json(msg)
+    
+    def send_telemetry_frame(self, data):
+        """Send telemetry as a binary frame (no allocation beyond struct args)"""
+        try:
+            g = data["g"]
+            gps = data["gps"]
+            self.telemetry_seq = (self.telemetry_seq + 1) & 0xFFFF
+            
+            payload = self._payload
+            struct.pack_into(TELEMETRY_FORMAT, payload, 0,
+                FRAME_TYPE_TELEMETRY, self.telemetry_seq,
+                g["x"], g["y"], g["z"], g["total"],
+                gps["lat"] or 0.0, gps["lon"] or 0.0,
+                gps["alt"] or 0.0, gps["speed"] or 0.0,
+                min(255, gps["sats"] or 0), gps["hdop"] or 0.0,
+                FIX_CODES.get(str(gps["fix"]).lower(), 0))
+            struct.pack_into('<H', payload, TELEMETRY_SIZE, crc16(payload, TELEMETRY_SIZE))
+            self.send_frame(payload, TELEMETRY_SIZE + 2)
+        except Exception as e:
+            print(f"Telemetry frame error: {e}")
+    
+    def send_lap(self, event):
+        """
+        Send a lap/sector event to the ESP
+        
+        Args:
+            event: LAP_FORMAT record (lap_timer.LapTimer.event)
+        """
+        if self.binary_telemetry:
+            payload = self._lap_payload
+            payload[1:LAP_FRAME_SIZE] = event
+            struct.pack_into('<H', payload, LAP_FRAME_SIZE, crc16(payload, LAP_FRAME_SIZE))
+            self.send_frame(payload, LAP_FRAME_SIZE + 2)
+            return
+        
+        kind, gate, lap, split_us, lap_us, delta_us = struct.unpack_from(LAP_FORMAT, event, 0)
+        self.send_json({
+            "type": "lap",
+            "kind": kind,
+            "gate": gate,
+            "lap": lap,
+            "split_us": split_us,
+            "lap_us": lap_us,
+            "delta_us": None if delta_us == LAP_NO_DELTA else delta_us
+        })
+    
+    def send_frame(self, payload, length):
+        """COBS-frame payload[:length] onto the TX queue and start writing it"""
+        if self._tx_len + length + length // 254 + 3 > len(self._tx):
+            self.flush_tx()
+        tx = self._tx
+        tx[self._tx_len] = 0x00
+        end = cobs_encode(payload, length, tx, self._tx_len + 1)
+        tx[end] = FRAME_DELIMITER
+        self._tx_len = end + 1
+        self.service_tx()
+    
+    def service_tx(self):
+        """
+        Write the next UART_TX_SLICE bytes of queued frames
+        
+        Returns:
+            bool: True while more are queued
+        """
+        if self._tx_pos < self._tx_len:
+            end = min(self._tx_pos + UART_TX_SLICE, self._tx_len)
+            self.uart.write(memoryview(self._tx)[self._tx_pos:end])
+            self._tx_pos = end
+        if self._tx_pos < self._tx_len:
+            return True
+        self._tx_pos = self._tx_len = 0
+        return False
+    
+    def flush_tx(self):
+        """Write out everything queued, waiting on the UART"""
+        while self.service_tx():
+            pass
@@ -0,0 +1,292 @@
+"""
+session_catalog.py - Persistent session list for OpenPonyLogger
+
+/sd/sessions.cat holds one fixed-size record per session, in the order
+sessions were started:
+
+    flags        B    CATALOG_CLOSED, CATALOG_DELETED
+    (pad)        3x
+    number       I    NNNNN of session_NNNNN.opl
+    filename     20s
+    size         I    File size at stop (0 while open)
+    start_time   I    time.time() at start (RTC/GPS set)
+    end_time     I    time.time() at stop
+    driver       32s
+    vehicle      24s
+    samples      I    Samples logged
+    peak_g       f    Largest total g seen
+    crc          I    CRC32 of the record
+
+A record is appended at start_session and rewritten in place at stop, so
+listing is a seek and a read from the end of the file, and the next session
+number is the last record's number + 1. A missing catalogue is rebuilt once
+from a directory scan (older cards numbered through session_last.txt).
+"""
+
+import os
+import struct
+import time
+
+from binary_logger import crc32
+
+CATALOG_FILE = "sessions.cat"
+CATALOG_RECORD_FORMAT = '<B3xI20sIII32s24sIf'
+CATALOG_RECORD_SIZE = struct.calcsize(CATALOG_RECORD_FORMAT) + 4  # + CRC32
+
+CATALOG_CLOSED = 0x01   # stop_session() filled in size/end/samples
+CATALOG_DELETED = 0x02  # File removed, record kept so indices stay put
+
+# Records per LIST reply - the ESP relays it through a 2KB buffer
+LIST_LIMIT_DEFAULT = 5
+LIST_LIMIT_MAX = 8
+
+
+def _text(raw):
+    """Decode a NUL-padded string field"""
+    end = raw.find(b'\x00')
+    return (raw if end < 0 else raw[:end]).decode('utf-8', 'ignore')
+
+
+def _session_number(name):
+    """NNNNN from "session_NNNNN.ext", or None"""
+    if not name.startswith("session_") or not (name.endswith(".opl") or name.endswith(".csv")):
+        return None
+    try:
+        return int(name[8:-4])
+    except ValueError:
+        return None
+
+
+def _read_opl_names(path):
+    """Driver and vehicle from an .opl session header, or ("", "")"""
+    try:
+        with open(path, 'rb') as f:
+            head = f.read(33 + 3 * 256)
+        pos = 33
+        fields = []
+        for _ in range(3):
+            n = head[pos]
+            fields.append(head[pos + 1:pos + 1 + n].decode('utf-8', 'ignore'))
+            pos += 1 + n
+        return fields[1], fields[2]
+    except (OSError, IndexError):
+        return "", ""
+
+
+class SessionCatalog:
+    """Fixed-size session records on the SD card"""
+
+    def __init__(self, base_path="/sd"):
+        self.base_path = base_path
+        self.path = f"{base_path}/{CATALOG_FILE}"
+        self.count = 0
+        self.last_number = 0
+        self.current = None      # Record index of the open session
+        self._record = bytearray(CATALOG_RECORD_SIZE)
+        self._load()
+
+    def _load(self):
+        """Find the record count and last session number"""
+        try:
+            size = os.stat(self.path)[6]
+        except OSError:
+            self.rebuild()
+            return
+
+        # A torn append leaves a partial record at the end - ignore it
+        self.count = size // CATALOG_RECORD_SIZE
+        if self.count:
+            record = self.read(self.count - 1)
+            if record:
+                self.last_number = record['number']
+        print(f"[Catalog] {self.count} sessions, last {self.last_number}")
+
+    def rebuild(self):
+        """Recreate the catalogue from the session files on the card"""
+        print("[Catalog] Rebuilding from directory scan...")
+        self.count = 0
+        self.last_number = 0
+
+        # Numbering carries on from the old counter file if there is one
+        try:
+            with open(f"{self.base_path}/session_last.txt", 'r') as f:
+                self.last_number = int(f.readline().strip() or 0)
+        except (OSError, ValueError):
+            pass
+
+        try:
+            names = [n for n in os.listdir(self.base_path) if _session_number(n) is not None]
+        except OSError as e:
+            print(f"[Catalog] Scan error: {e}")
+            names = []
+        names.sort(key=_session_number)
+
+        try:
+            with open(self.path, 'wb') as f:
+                for name in names:
+                    path = f"{self.base_path}/{name}"
+                    try:
+                        stat = os.stat(path)
+                    except OSError:
+                        continue
+                    driver, vehicle = _read_opl_names(path) if name.endswith(".opl") else ("", "")
+                    number = _session_number(name)
+                    self._pack(CATALOG_CLOSED, number, name, stat[6], 0, stat[8],
+                               driver, vehicle, 0, 0.0)
+                    f.write(self._record)
+                    self.count += 1
+                    self.last_number = max(self.last_number, number)
+        except OSError as e:
+            print(f"[Catalog] Rebuild error: {e}")
+        print(f"[Catalog] Rebuilt: {self.count} sessions, last {self.last_number}")
+
+    def _pack(self, flags, number, filename, size, start_time, end_time,
+              driver, vehicle, samples, peak_g):
+        """Fill self._record"""
+        struct.pack_into(CATALOG_RECORD_FORMAT, self._record, 0, flags, number,
+                         filename.encode('utf-8'), size, start_time, end_time,
+                         driver.encode('utf-8'), vehicle.encode('utf-8'),
+                         samples, peak_g)
+        n = CATALOG_RECORD_SIZE - 4
+        struct.pack_into('<I', self._record, n, crc32(memoryview(self._record)[:n]))
+
+    def _unpack(self, raw, index):
+        """Record dict from raw bytes, or None if the CRC doesn't match"""
+        n = CATALOG_RECORD_SIZE - 4
+        if len(raw) < CATALOG_RECORD_SIZE or crc32(raw[:n]) != struct.unpack_from('<I', raw, n)[0]:
+            return None
+        (flags, number, filename, size, start_time, end_time,
+         driver, vehicle, samples, peak_g) = struct.unpack_from(CATALOG_RECORD_FORMAT, raw, 0)
+        return {
+            'index': index,
+            'flags': flags,
+            'number': number,
+            'file': _text(filename),
+            'size': size,
+            'start': start_time,
+            'end': end_time,
+            'driver': _text(driver),
+            'vehicle': _text(vehicle),
+            'samples': samples,
+            'peak_g': peak_g,
+        }
+
+    def read(self, index):
+        """Record at index, or None"""
+        try:
+            with open(self.path, 'rb') as f:
+                f.seek(index * CATALOG_RECORD_SIZE)
+                return self._unpack(f.read(CATALOG_RECORD_SIZE), index)
+        except OSError as e:
+            print(f"[Catalog] Read error: {e}")
+            return None
+
+    def next_filename(self, extension="opl"):
+        """Path for the next session, numbered after the last record"""
+        number = self.last_number + 1
+        if number > 99999:
+            number = 1  # Wrap at 5 digits
+        return f"{self.base_path}/session_{number:05d}.{extension}"
+
+    def add(self, path, driver="", vehicle=""):
+        """Append an open record for the session file at path"""
+        name = path.rsplit('/', 1)[-1]
+        number = _session_number(name) or 0
+        self._pack(0, number, name, 0, int(time.time()), 0, driver, vehicle, 0, 0.0)
+        try:
+            # At count, not the end - a torn append may have left a partial record
+            with open(self.path, 'r+b') as f:
+                f.seek(self.count * CATALOG_RECORD_SIZE)
+                f.write(self._record)
+        except OSError as e:
+            print(f"[Catalog] Add error: {e}")
+            return None
+        self.current = self.count
+        self.count += 1
+        self.last_number = number
+        return self.current
+
+    def _rewrite(self, index, record):
+        """Write record dict back at index"""
+        self._pack(record['flags'], record['number'], record['file'], record['size'],
+                   record['start'], record['end'], record['driver'], record['vehicle'],
+                   record['samples'], record['peak_g'])
+        try:
+            with open(self.path, 'r+b') as f:
+                f.seek(index * CATALOG_RECORD_SIZE)
+                f.write(self._record)
+            return True
+        except OSError as e:
+            print(f"[Catalog] Update error: {e}")
+            return False
+
+    def close(self, size, samples=0, peak_g=0.0):
+        """Fill in the open session's record at stop"""
+        if self.current is None:
+            return False
+        record = self.read(self.current)
+        index = self.current
+        self.current = None
+        if not record:
+            return False
+        record['flags'] |= CATALOG_CLOSED
+        record['size'] = size
+        record['end'] = int(time.time())
+        record['samples'] = samples
+        record['peak_g'] = peak_g
+        return self._rewrite(index, record)
+
+    def mark_deleted(self, filename):
+        """Flag the newest record for filename as deleted"""
+        number = _session_number(filename)
+        record = None
+        try:
+            with open(self.path, 'rb') as f:
+                for index in range(self.count - 1, -1, -1):
+                    f.seek(index * CATALOG_RECORD_SIZE)
+                    raw = f.read(CATALOG_RECORD_SIZE)
+                    # Number first - cheaper than decoding every record
+                    if struct.unpack_from('<I', raw, 4)[0] != number:
+                        continue
+                    record = self._unpack(raw, index)
+                    if record and record['file'] == filename and not record['flags'] & CATALOG_DELETED:
+                        break
+                    record = None
+        except OSError as e:
+            print(f"[Catalog] Delete lookup error: {e}")
+        if not record:
+            return False
+        record['flags'] |= CATALOG_DELETED
+        return self._rewrite(index, record)
+
+    def page(self, offset=0, limit=LIST_LIMIT_DEFAULT):
+        """
+        Sessions newest first, skipping deleted ones
+
+        Args:
+            offset: Records to skip back from the newest
+            limit: Most sessions to return (capped at LIST_LIMIT_MAX)
+
+        Returns:
+            tuple: (records, offset to pass for the next page or None)
+        """
+        limit = max(1, min(limit, LIST_LIMIT_MAX))
+        records = []
+        end = self.count - max(0, offset)  # One past the next record to read
+
+        try:
+            with open(self.path, 'rb') as f:
+                while end > 0 and len(records) < limit:
+                    start = max(0, end - (limit - len(records)))
+                    f.seek(start * CATALOG_RECORD_SIZE)
+                    raw = f.read((end - start) * CATALOG_RECORD_SIZE)
+                    for i in range(end - start - 1, -1, -1):
+                        pos = i * CATALOG_RECORD_SIZE
+                        record = self._unpack(raw[pos:pos + CATALOG_RECORD_SIZE], start + i)
+                        if record and not record['flags'] & CATALOG_DELETED:
+                            records.append(record)
+                    end = start
+        except OSError as e:
+            print(f"[Catalog] List error: {e}")
+
+        return records, (self.count - end if end > 0 else None)
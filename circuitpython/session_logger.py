@@ -7,6 +7,7 @@ Provides a common interface for logging that supports both formats
 import time
 import os
 from config import config
+from session_catalog import SessionCatalog
 
 # Import binary logger
 try:
@@ -97,18 +98,24 @@ def _get_next_session_number(base_path="/sd"):
     return n
 
 
-def create_session_filename(base_path="/sd", extension="opl"):
+def create_session_filename(base_path="/sd", extension="opl", catalog=None):
     """
     Create session filename with sequential numbering
     
     Args:
         base_path: Base directory (default: /sd)
         extension: File extension (opl or csv)
+        catalog: SessionCatalog to number from; without one the
+                 session_last.txt counter is used
     
     Returns:
         str: Full path like "/sd/session_00001.opl"
     """
     print(f"[Session Debug] create_session_filename called with base_path='{base_path}', extension='{extension}'")
+    if catalog:
+        filename = catalog.next_filename(extension)
+        print(f"[Session Debug] Generated filename: {filename}")
+        return filename
     n = _get_next_session_number(base_path)
     filename = f"{base_path}/session_{n:05d}.{extension}"
     print(f"[Session Debug] Generated filename: {filename}")
@@ -122,11 +129,13 @@ def create_session_filename(base_path="/sd", extension="opl"):
 class CSVLogger:
     """CSV format logger"""
     
-    def __init__(self, base_path="/sd"):
+    def __init__(self, base_path="/sd", catalog=None):
         self.base_path = base_path
+        self.catalog = catalog
         self.log_file = None
         self.log_filename = None
         self.sample_count = 0
+        self.peak_g = 0.0
         self.start_time = None
         self.bytes_written = 0
         self.active = False
@@ -137,7 +146,7 @@ class CSVLogger:
             self.stop_session()
         
         # Use sequential numbering
-        self.log_filename = create_session_filename(self.base_path, 'csv')
+        self.log_filename = create_session_filename(self.base_path, 'csv', self.catalog)
         
         # Open log file
         self.log_file = open(self.log_filename, "w")
@@ -153,6 +162,7 @@ class CSVLogger:
         self.bytes_written = len(header)
         self.active = True
         self.sample_count = 0
+        self.peak_g = 0.0
         self.start_time = time.monotonic()
         
         print(f"[CSVLog] Session started: {self.log_filename}")
@@ -182,6 +192,8 @@ class CSVLogger:
             gx, gy, gz = 0.0, 0.0, 1.0
         
         g_total = (gx**2 + gy**2 + gz**2)**0.5
+        if g_total > self.peak_g:
+            self.peak_g = g_total
         
         # Write CSV line
         line = f"{timestamp},{gx:.3f},{gy:.3f},{gz:.3f},{g_total:.3f},"
@@ -240,9 +252,13 @@ class BinaryLoggerWrapper:
     This ensures both CSV and Binary formats use the same numbering scheme
     """
     
-    def __init__(self, base_path="/sd"):
+    def __init__(self, base_path="/sd", catalog=None):
         self.base_path = base_path
-        self.logger = BinaryLogger(base_path)
+        self.catalog = catalog
+        self.logger = BinaryLogger(base_path, compress=config.log_compress,
+                                   sync=config.log_sync,
+                                   sync_interval=config.log_sync_interval,
+                                   preallocate=config.log_preallocate_kb * 1024)
     
     def start_session(self, session_name="", driver_name="", vehicle_id="",
                      weather=None, ambient_temp=0, config_crc=0, include_hardware=True):
@@ -252,7 +268,7 @@ class BinaryLoggerWrapper:
         
         # Generate sequential filename
         print(f"[Session Debug] Calling create_session_filename()...")
-        filename = create_session_filename(self.base_path, 'opl')
+        filename = create_session_filename(self.base_path, 'opl', self.catalog)
         print(f"[Session Debug] Got filename: {filename}")
         
         # Pass filename to BinaryLogger.start_session() so it doesn't generate its own
@@ -280,6 +296,36 @@ class BinaryLoggerWrapper:
     def write_gps_satellites(self, satellites, timestamp_us=None):
         return self.logger.write_gps_satellites(satellites, timestamp_us)
     
+    def write_gyroscope(self, gx, gy, gz, timestamp_us=None):
+        return self.logger.write_gyroscope(gx, gy, gz, timestamp_us)
+    
+    def write_magnetometer(self, mx, my, mz, timestamp_us=None):
+        return self.logger.write_magnetometer(mx, my, mz, timestamp_us)
+    
+    def write_imu(self, ax, ay, az, gx, gy, gz, mag=None, timestamp_us=None):
+        return self.logger.write_imu(ax, ay, az, gx, gy, gz, mag, timestamp_us)
+    
+    def write_imu_burst(self, records, count, interval_us, accel_lsb, gyro_lsb, timestamp_us=None):
+        return self.logger.write_imu_burst(records, count, interval_us, accel_lsb, gyro_lsb, timestamp_us)
+    
+    def write_profile(self, data, timestamp_us=None):
+        return self.logger.write_profile(data, timestamp_us)
+    
+    def write_lap(self, data, timestamp_us=None):
+        return self.logger.write_lap(data, timestamp_us)
+    
+    def event_block(self):
+        return self.logger.event_block()
+    
+    def write_event_block(self, block):
+        return self.logger.write_event_block(block)
+    
+    def service(self):
+        self.logger.service()
+    
+    def take_write_stats(self):
+        return self.logger.take_write_stats()
+    
     def stop_session(self):
         return self.logger.stop_session()
     
@@ -299,7 +345,11 @@ class BinaryLoggerWrapper:
     
     @property
     def sample_count(self):
-        return 0  # Binary format doesn't track samples
+        return self.logger.sample_total
+    
+    @property
+    def peak_g(self):
+        return self.logger.peak_g
 
 
 # =============================================================================
@@ -312,6 +362,7 @@ class SessionLogger:
     def __init__(self, base_path="/sd"):
         self.base_path = base_path
         self.format = config.log_format
+        self.catalog = SessionCatalog(base_path)
         
         print(f"[SessionLogger Debug] __init__ called with base_path='{base_path}'")
         print(f"[SessionLogger Debug] config.log_format = '{self.format}'")
@@ -320,14 +371,14 @@ class SessionLogger:
         # Create appropriate logger
         if self.format == 'binary' and BINARY_AVAILABLE:
             print(f"[SessionLogger Debug] Creating BinaryLoggerWrapper...")
-            self.logger = BinaryLoggerWrapper(base_path)
+            self.logger = BinaryLoggerWrapper(base_path, self.catalog)
             print(f"[SessionLogger Debug] Created logger type: {type(self.logger)}")
             print(f"[SessionLogger Debug] Logger is BinaryLoggerWrapper: {isinstance(self.logger, BinaryLoggerWrapper)}")
             print(f"[SessionLogger] Using binary format")
         else:
             if self.format == 'binary':
                 print(f"[SessionLogger] Binary format requested but not available, using CSV")
-            self.logger = CSVLogger(base_path)
+            self.logger = CSVLogger(base_path, self.catalog)
             print(f"[SessionLogger] Using CSV format")
     
     def start_session(self, session_name=None, driver_name=None, vehicle_id=None,
@@ -350,16 +401,19 @@ class SessionLogger:
         if isinstance(self.logger, BinaryLoggerWrapper):
             print(f"[SessionLogger Debug] Calling BinaryLoggerWrapper.start_session()...")
             weather = weather if weather is not None else WEATHER_UNKNOWN
-            return self.logger.start_session(
+            result = self.logger.start_session(
                 session_name, driver_name, vehicle_id,
                 weather, ambient_temp, config_crc
             )
         else:
             print(f"[SessionLogger Debug] Calling CSVLogger.start_session()...")
             # CSV format gets basic metadata
-            return self.logger.start_session(
+            result = self.logger.start_session(
                 session_name, driver_name, vehicle_id
             )
+        
+        self.catalog.add(self.filename, driver_name, vehicle_id)
+        return result
     
     def write_accelerometer(self, gx, gy, gz, timestamp_us=None):
         """Write accelerometer data"""
@@ -375,9 +429,77 @@ class SessionLogger:
             return self.logger.write_gps_satellites(satellites, timestamp_us)
         return True
     
+    def write_gyroscope(self, gx, gy, gz, timestamp_us=None):
+        """Write gyroscope data (binary format only)"""
+        if hasattr(self.logger, 'write_gyroscope'):
+            return self.logger.write_gyroscope(gx, gy, gz, timestamp_us)
+        return True
+    
+    def write_magnetometer(self, mx, my, mz, timestamp_us=None):
+        """Write magnetometer data (binary format only)"""
+        if hasattr(self.logger, 'write_magnetometer'):
+            return self.logger.write_magnetometer(mx, my, mz, timestamp_us)
+        return True
+    
+    def write_imu(self, ax, ay, az, gx, gy, gz, mag=None, timestamp_us=None):
+        """Write accel + gyro (+ mag) with one timestamp (CSV keeps accel only)"""
+        if hasattr(self.logger, 'write_imu'):
+            return self.logger.write_imu(ax, ay, az, gx, gy, gz, mag, timestamp_us)
+        return self.logger.write_accelerometer(ax, ay, az, timestamp_us)
+    
+    def write_imu_burst(self, records, count, interval_us, accel_lsb, gyro_lsb, timestamp_us=None):
+        """Write raw IMU FIFO records (binary format only)"""
+        if hasattr(self.logger, 'write_imu_burst'):
+            return self.logger.write_imu_burst(records, count, interval_us,
+                                               accel_lsb, gyro_lsb, timestamp_us)
+        return True
+    
+    def write_profile(self, data, timestamp_us=None):
+        """Write a loop profile summary (binary format only)"""
+        if hasattr(self.logger, 'write_profile'):
+            return self.logger.write_profile(data, timestamp_us)
+        return True
+    
+    def write_lap(self, data, timestamp_us=None):
+        """Write a lap/sector event (binary format only)"""
+        if hasattr(self.logger, 'write_lap'):
+            return self.logger.write_lap(data, timestamp_us)
+        return True
+    
+    def event_block(self):
+        """Empty block for an event capture window (binary format only)"""
+        if hasattr(self.logger, 'event_block'):
+            return self.logger.event_block()
+        return None
+    
+    def write_event_block(self, block):
+        """Flush a filled event block (binary format only)"""
+        if hasattr(self.logger, 'write_event_block'):
+            return self.logger.write_event_block(block)
+        return False
+    
+    def service(self):
+        """Run deferred logger work (binary format flushes blocks here)"""
+        if hasattr(self.logger, 'service'):
+            self.logger.service()
+    
+    def take_write_stats(self):
+        """SD writes/syncs since the last call (binary format only)"""
+        if hasattr(self.logger, 'take_write_stats'):
+            return self.logger.take_write_stats()
+        return (0, 0, 0, 0)
+    
     def stop_session(self):
-        """Stop current session"""
-        return self.logger.stop_session()
+        """Stop current session and fill in its catalogue record"""
+        was_active = self.logger.active
+        result = self.logger.stop_session()
+        if was_active:
+            try:
+                size = os.stat(self.filename)[6]
+            except OSError:
+                size = 0
+            self.catalog.close(size, self.sample_count, self.logger.peak_g)
+        return result
     
     def get_duration(self):
         """Get current session duration"""
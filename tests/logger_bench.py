@@ -0,0 +1,134 @@
+"""
+Binary Logger Benchmark
+Samples/s of the logger hot path with and without the oplnative C module
+
+Copy to the Pico (with binary_logger.py in place and the SD card mounted)
+and run from the REPL:
+
+    import logger_bench
+
+Also runs on a PC from the repo root:
+
+    python3 tests/logger_bench.py [base_path]
+
+Each path is timed three ways:
+  pack - IMU + GPS samples into a DataBlock, serialized and CRC'd (no I/O)
+  log  - the same through BinaryLogger.write_imu/write_gps to a file
+  crc  - CRC32 of a full 4KB block
+"""
+
+import sys
+import time
+import gc
+
+try:
+    import binary_logger as bl
+except ImportError:
+    sys.path.insert(0, "circuitpython")
+    import binary_logger as bl
+
+BASE_PATH = sys.argv[1] if len(sys.argv) > 1 and __name__ == "__main__" else "/sd"
+SAMPLES = 2000          # IMU samples per run; +1 GPS fix per 10
+CRC_ROUNDS = 20
+
+try:
+    from binascii import crc32 as binascii_crc32
+except ImportError:
+    binascii_crc32 = None
+
+
+def now_us():
+    return time.monotonic_ns() // 1000
+
+
+def bench_pack(block_class):
+    """Samples/s packing into blocks, flushing each full one"""
+    block = block_class(bytes(16), 0)
+    t = 1_760_000_000_000_000
+    seq = 0
+    gc.collect()
+    start = now_us()
+    for i in range(SAMPLES):
+        t += 10000
+        if not block.add_imu(t, 0.01, -0.02, 1.0, 0.5, -0.3, 0.1):
+            bl.crc32(block.serialize())
+            seq += 1
+            block.reset(seq)
+            block.add_imu(t, 0.01, -0.02, 1.0, 0.5, -0.3, 0.1)
+        if i % 10 == 0:
+            if not block.add_gps(t, 42.123456, -71.654321, 35.0, 22.5, 90.0, 0.9):
+                bl.crc32(block.serialize())
+                seq += 1
+                block.reset(seq)
+                block.add_gps(t, 42.123456, -71.654321, 35.0, 22.5, 90.0, 0.9)
+    elapsed = now_us() - start
+    return (SAMPLES + SAMPLES // 10) * 1000000 / max(elapsed, 1)
+
+
+def bench_log():
+    """Samples/s through BinaryLogger, SD writes included"""
+    logger = bl.BinaryLogger(BASE_PATH)
+    if not logger.start_session("Bench", "bench", "bench", include_hardware=False,
+                                filename=f"{BASE_PATH}/bench.opl"):
+        return 0
+    t = 1_760_000_000_000_000
+    gc.collect()
+    start = now_us()
+    for i in range(SAMPLES):
+        t += 10000
+        logger.write_imu(0.01, -0.02, 1.0, 0.5, -0.3, 0.1, timestamp_us=t)
+        if i % 10 == 0:
+            logger.write_gps(42.123456, -71.654321, 35.0, 22.5, 90.0, 0.9, timestamp_us=t)
+        logger.service()
+    elapsed = now_us() - start
+    logger.stop_session()
+    return (SAMPLES + SAMPLES // 10) * 1000000 / max(elapsed, 1)
+
+
+def bench_crc(fn):
+    """CRC32 throughput in KB/s"""
+    data = bytearray(bl.MAX_BLOCK_SIZE)
+    for i in range(len(data)):
+        data[i] = (i * 37 + 11) & 0xFF
+    gc.collect()
+    start = now_us()
+    for _ in range(CRC_ROUNDS):
+        fn(data)
+    elapsed = now_us() - start
+    return CRC_ROUNDS * len(data) * 1000000 / 1024 / max(elapsed, 1)
+
+
+def run(name, block_class, crc_fn):
+    bl.PlainDataBlock = block_class
+    bl.crc32 = crc_fn
+    try:
+        pack = bench_pack(block_class)
+        log = bench_log()
+        crc = bench_crc(crc_fn)
+        print(f"{name:<10} {pack:>9.0f} {log:>9.0f} {crc:>9.0f}")
+    except Exception as e:
+        print(f"{name:<10} error: {e}")
+
+
+print("\n" + "="*50)
+print("OpenPonyLogger Binary Logger Benchmark")
+print("="*50)
+print(f"{SAMPLES} IMU + {SAMPLES // 10} GPS samples, base path {BASE_PATH}")
+print(f"oplnative: {'yes' if bl.oplnative else 'not in this firmware'}\n")
+print(f"{'path':<10} {'pack/s':>9} {'log/s':>9} {'crc KB/s':>9}")
+
+# Restored after - the logger may be used again in the same REPL
+saved = (bl.PlainDataBlock, bl.crc32)
+if bl.oplnative:
+    run("native", bl.NativeDataBlock, bl.oplnative.crc32)
+if binascii_crc32:
+    run("binascii", bl.DataBlock, binascii_crc32)
+run("python", bl.DataBlock, bl._crc32_py)
+bl.PlainDataBlock, bl.crc32 = saved
+
+try:
+    import os
+    os.remove(f"{BASE_PATH}/bench.opl")
+except OSError:
+    pass
+print("\nDone")
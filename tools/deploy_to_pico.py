@@ -256,7 +256,12 @@ def deploy_python_modules(drive_path, backup=True):
         "lsm6dsox.py",
         "magnetometer.py",
         "pa1010d.py",
+        "profiler.py",
+        "scheduler.py",
         "sensors.py",
+        "event_capture.py",
+        "lap_timer.py",
+        "session_catalog.py",
     ]
     
     # Create set of known files for orphan detection
@@ -386,6 +391,8 @@ def clean_deployment(drive_path):
         "lsm6dsox.py",
         "magnetometer.py",
         "pa1010d.py",
+        "profiler.py",
+        "scheduler.py",
         "sensors.py",
     ]
     
@@ -460,6 +467,8 @@ def validate_deployment(drive_path):
         "lsm6dsox.py",
         "magnetometer.py",
         "pa1010d.py",
+        "profiler.py",
+        "scheduler.py",
         "sensors.py",
     ]
     
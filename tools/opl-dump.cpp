@@ -0,0 +1,364 @@
+/**
+ * opl-dump.cpp - Native .opl decoder and decode benchmark
+ *
+ * Usage: opl-dump [--blocks] [--samples] [--repeat N] session.opl...
+ *
+ * Decodes a session with the same codec the ESP runs
+ * (circuitpython/esp-client/opl_codec.h): every block is checked for
+ * layout and CRC32, and every sample of every data block is decoded to
+ * values, plain or compressed. Reported per file:
+ *
+ *   blocks        By type, with CRC failures and sample count mismatches
+ *   samples       By type (IMU bursts also as records)
+ *   decode        Best of --repeat passes over the file in memory:
+ *                 MB/s and samples/s
+ *
+ * --blocks lists every block, --samples prints every sample as text.
+ *
+ * Build: make opl-dump
+ */
+
+#include "opl_codec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// ============================================================================
+// Decode Pass
+// ============================================================================
+
+struct DumpOptions {
+    bool blocks = false;
+    bool samples = false;
+    uint32_t repeat = 5;
+};
+
+struct DumpStats {
+    uint32_t blocks[8];        // By block type, 0 = unknown
+    uint32_t bad_crc;
+    uint32_t count_mismatch;   // Header sample_count != samples decoded
+    uint32_t truncated;        // Data blocks ending mid-sample
+    uint32_t samples[256];     // By sample type
+    uint64_t records;          // IMU burst records
+    uint64_t first_us;
+    uint64_t last_us;
+    double checksum;           // Sum of decoded values, keeps the decode honest
+    bool failed;
+    uint32_t error_offset;
+};
+
+const char* blockTypeName(uint8_t type) {
+    switch (type) {
+        case OPL_BLOCK_SESSION_HEADER: return "session";
+        case OPL_BLOCK_DATA: return "data";
+        case OPL_BLOCK_SESSION_END: return "end";
+        case OPL_BLOCK_HARDWARE_CONFIG: return "hardware";
+        case OPL_BLOCK_INDEX: return "index";
+        case OPL_BLOCK_INDEX_TRAILER: return "trailer";
+        default: return "unknown";
+    }
+}
+
+const char* sampleTypeName(uint8_t type) {
+    switch (type) {
+        case OPL_SAMPLE_ACCEL: return "accel";
+        case OPL_SAMPLE_GPS_FIX: return "gps";
+        case OPL_SAMPLE_GPS_SATELLITES: return "satellites";
+        case OPL_SAMPLE_GYRO: return "gyro";
+        case OPL_SAMPLE_MAG: return "mag";
+        case OPL_SAMPLE_IMU: return "imu";
+        case OPL_SAMPLE_IMU_BURST: return "imu_burst";
+        case OPL_SAMPLE_PROFILE: return "profile";
+        case OPL_SAMPLE_LAP: return "lap";
+        case OPL_SAMPLE_OBD_PID: return "obd";
+        case OPL_SAMPLE_EVENT_MARKER: return "event";
+        default: return nullptr;
+    }
+}
+
+const char* crcName(OplCrcStatus crc) {
+    return crc == OPL_CRC_OK ? "ok" : crc == OPL_CRC_BAD ? "BAD" : "-";
+}
+
+void printSample(const OplSample& s) {
+    float v[9];
+    OplGpsFix fix;
+    OplLap lap;
+    OplEventMarker marker;
+    OplImuBurstHeader burst;
+    const char* name = sampleTypeName(s.type);
+
+    if (s.type == OPL_SAMPLE_IMU_BURST && oplRead(s, burst)) {
+        for (uint8_t i = 0; i < burst.count; i++) {
+            float a[3] = {0, 0, 0};
+            float g[3] = {0, 0, 0};
+            if (oplReadBurstRecord(s, burst, i, a, g)) {
+                printf("%llu,imu,%.6f,%.6f,%.6f,%.4f,%.4f,%.4f\n",
+                       (unsigned long long)(s.timestamp_us + (uint64_t)i * burst.interval_us),
+                       a[0], a[1], a[2], g[0], g[1], g[2]);
+            }
+        }
+        return;
+    }
+
+    printf("%llu,%s", (unsigned long long)s.timestamp_us, name ? name : "unknown");
+    if (s.type == OPL_SAMPLE_GPS_FIX && oplReadGps(s, fix)) {
+        printf(",%.8f,%.8f,%.2f,%.2f,%.2f,%.2f", fix.lat, fix.lon, fix.alt, fix.speed,
+               fix.heading, fix.hdop);
+    } else if (s.type == OPL_SAMPLE_LAP && oplRead(s, lap)) {
+        printf(",%u,%u,%u,%u,%u", lap.kind, lap.gate, lap.lap, lap.split_us, lap.lap_us);
+        if (lap.delta_us != OPL_LAP_NO_DELTA) {
+            printf(",%d", lap.delta_us);
+        }
+    } else if (s.type == OPL_SAMPLE_EVENT_MARKER && oplRead(s, marker)) {
+        printf(",%u,%u,%u,%u,%u,%.3f", marker.kind, marker.first, marker.pre, marker.post,
+               marker.interval_us, marker.peak_g);
+    } else if (s.type == OPL_SAMPLE_GPS_SATELLITES && s.length > 0) {
+        printf(",%u", s.data[0]);
+        for (size_t at = 1; at + sizeof(OplSatellite) <= s.length; at += sizeof(OplSatellite)) {
+            OplSatellite sat;
+            memcpy(&sat, s.data + at, sizeof(sat));
+            printf(",%u:%u", sat.id, sat.snr);
+        }
+    } else {
+        uint8_t n = (s.type == OPL_SAMPLE_ACCEL || s.type == OPL_SAMPLE_GYRO ||
+                     s.type == OPL_SAMPLE_MAG || s.type == OPL_SAMPLE_IMU)
+                    ? oplReadAxes(s, v) : 0;
+        for (uint8_t i = 0; i < n; i++) {
+            printf(",%.6f", v[i]);
+        }
+        if (n == 0) {
+            printf(",%u bytes", s.length);
+        }
+    }
+    printf("\n");
+}
+
+// Decode every sample of a data block into values
+void decodeBlock(const uint8_t* file, const OplBlockInfo& b, DumpStats& stats,
+                 const DumpOptions& opt) {
+    const uint8_t* data = file + b.offset + sizeof(OplDataBlockHeader);
+    size_t size = b.length - sizeof(OplDataBlockHeader) - 4;
+    OplSampleIterator it(data, size, b.timestamp_start, b.flags & OPL_BLOCK_COMPRESSED);
+    OplSample s;
+    uint32_t count = 0;
+    float v[9];
+    OplGpsFix fix;
+    OplImuBurstHeader burst;
+
+    while (it.next(s)) {
+        count++;
+        stats.samples[s.type]++;
+        if (s.timestamp_us < stats.first_us) {
+            stats.first_us = s.timestamp_us;
+        }
+        if (s.timestamp_us > stats.last_us) {
+            stats.last_us = s.timestamp_us;
+        }
+
+        switch (s.type) {
+            case OPL_SAMPLE_ACCEL:
+            case OPL_SAMPLE_GYRO:
+            case OPL_SAMPLE_MAG:
+            case OPL_SAMPLE_IMU: {
+                uint8_t n = oplReadAxes(s, v);
+                for (uint8_t i = 0; i < n; i++) {
+                    stats.checksum += v[i];
+                }
+                break;
+            }
+            case OPL_SAMPLE_GPS_FIX:
+                if (oplReadGps(s, fix)) {
+                    stats.checksum += fix.lat + fix.lon + fix.speed;
+                }
+                break;
+            case OPL_SAMPLE_IMU_BURST:
+                if (oplRead(s, burst)) {
+                    float a[3] = {0, 0, 0};
+                    float g[3] = {0, 0, 0};
+                    for (uint8_t i = 0; i < burst.count; i++) {
+                        if (oplReadBurstRecord(s, burst, i, a, g)) {
+                            stats.checksum += a[0] + a[1] + a[2] + g[0] + g[1] + g[2];
+                            stats.records++;
+                        }
+                    }
+                }
+                break;
+        }
+
+        if (opt.samples) {
+            printSample(s);
+        }
+    }
+
+    if (it.truncated()) {
+        stats.truncated++;
+    }
+    if (count != b.sample_count) {
+        stats.count_mismatch++;
+    }
+}
+
+void decodeFile(const std::vector<uint8_t>& file, DumpStats& stats, const DumpOptions& opt) {
+    memset(&stats, 0, sizeof(stats));
+    stats.first_us = UINT64_MAX;
+
+    OplStreamParser parser;
+    const uint8_t* p = file.data();
+    size_t len = file.size();
+
+    while (len > 0 && !parser.failed()) {
+        size_t n = parser.feed(p, len);
+        p += n;
+        len -= n;
+        if (!parser.ready()) {
+            continue;
+        }
+
+        const OplBlockInfo& b = parser.block();
+        stats.blocks[b.type < 8 ? b.type : 0]++;
+        if (b.crc == OPL_CRC_BAD) {
+            stats.bad_crc++;
+        }
+        if (opt.blocks) {
+            printf("%10u  %-8s  %6u  %6u  %5u  0x%02X  %-3s  %llu\n", b.offset,
+                   blockTypeName(b.type), b.sequence, b.sample_count, b.length, b.flags,
+                   crcName(b.crc), (unsigned long long)b.timestamp_start);
+        }
+        if (b.type == OPL_BLOCK_DATA) {
+            decodeBlock(file.data(), b, stats, opt);
+        }
+    }
+
+    stats.failed = parser.failed();
+    stats.error_offset = parser.errorOffset();
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        out.insert(out.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+void dumpFile(const char* path, const std::vector<uint8_t>& file, const DumpOptions& opt) {
+    DumpStats stats;
+
+    if (opt.blocks) {
+        printf("    offset  type         seq  samples bytes  flags crc  start_us\n");
+    }
+    decodeFile(file, stats, opt);
+
+    // Timing passes print nothing, so they measure the decode alone
+    DumpOptions quiet;
+    double best_ns = 0;
+    for (uint32_t r = 0; r < opt.repeat; r++) {
+        DumpStats pass;
+        auto start = std::chrono::steady_clock::now();
+        decodeFile(file, pass, quiet);
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || ns < best_ns) {
+            best_ns = ns;
+        }
+    }
+
+    if (opt.samples) {
+        return;
+    }
+
+    printf("%s: %zu bytes\n", path, file.size());
+    printf("  blocks:");
+    for (uint8_t t = 1; t < 8; t++) {
+        if (stats.blocks[t]) {
+            printf(" %s %u", blockTypeName(t), stats.blocks[t]);
+        }
+    }
+    printf("\n");
+    printf("  bad CRC %u  sample count mismatches %u  truncated %u\n",
+           stats.bad_crc, stats.count_mismatch, stats.truncated);
+    if (stats.failed) {
+        printf("  ✗ not a block at offset %u - stopped there\n", stats.error_offset);
+    }
+
+    uint64_t total = 0;
+    printf("  samples:");
+    for (int t = 0; t < 256; t++) {
+        if (stats.samples[t]) {
+            const char* name = sampleTypeName(t);
+            if (name) {
+                printf(" %s %u", name, stats.samples[t]);
+            } else {
+                printf(" 0x%02X %u", t, stats.samples[t]);
+            }
+            total += stats.samples[t];
+        }
+    }
+    printf("\n");
+    if (stats.records) {
+        printf("  IMU burst records: %llu\n", (unsigned long long)stats.records);
+    }
+    if (total > 0) {
+        printf("  span: %llu - %llu us (%.1f s)\n", (unsigned long long)stats.first_us,
+               (unsigned long long)stats.last_us, (stats.last_us - stats.first_us) / 1e6);
+    }
+    if (opt.repeat > 0 && best_ns > 0) {
+        printf("  decode: %.2f ms  %.1f MB/s  %.2f M samples/s  (checksum %.3f)\n",
+               best_ns / 1e6, file.size() / (best_ns / 1e3),
+               (total + stats.records) / (best_ns / 1e3), stats.checksum);
+    }
+}
+
+int main(int argc, char** argv) {
+    DumpOptions opt;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--blocks") == 0) {
+            opt.blocks = true;
+        } else if (strcmp(argv[i], "--samples") == 0) {
+            opt.samples = true;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            opt.repeat = atoi(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        fprintf(stderr, "Usage: %s [--blocks] [--samples] [--repeat N] session.opl...\n", argv[0]);
+        return 2;
+    }
+
+    // Sample output is data only
+    if (opt.samples) {
+        opt.blocks = false;
+        opt.repeat = 0;
+    }
+
+    int status = 0;
+    for (const char* path : paths) {
+        std::vector<uint8_t> file;
+        if (!readFile(path, file)) {
+            status = 1;
+            continue;
+        }
+        dumpFile(path, file, opt);
+    }
+    return status;
+}
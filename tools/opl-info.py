@@ -12,6 +12,8 @@ Usage:
     python3 opl-info.py session_00001.opl --no-hardware
     python3 opl-info.py session_00001.opl --verify-checksums
     python3 opl-info.py session_00001.opl --detailed
+    python3 opl-info.py session_00001.opl --no-profile
+    python3 opl-info.py session_00001.opl --no-laps
     python3 opl-info.py *.opl --brief
 """
 
@@ -31,7 +33,8 @@ from opl_types import (
     SAMPLE_TYPE_OBD_PID,
     SAMPLE_TYPE_EVENT_MARKER,
     OPLTimestamp,
-    format_duration
+    format_duration,
+    format_timestamp
 )
 
 # Import OPL reader from opl2csv
@@ -53,7 +56,10 @@ class OPLInspector:
         # Analysis results
         self.header = None
         self.blocks = None
+        self.index = None
         self.sample_stats = None
+        self.profiles = []
+        self.laps = []
         self.time_stats = None
         self.integrity_issues = []
         
@@ -62,13 +68,14 @@ class OPLInspector:
         try:
             # Read file
             self.header, self.blocks = self.reader.read_all()
+            self.index = self.reader.read_index()
+            
+            # Timestamps first - sample rates need the session duration
+            self._analyze_timestamps()
             
             # Analyze samples
             self._analyze_samples()
             
-            # Analyze timestamps
-            self._analyze_timestamps()
-            
             # Check integrity
             self._check_integrity()
             
@@ -94,8 +101,13 @@ class OPLInspector:
             for sample_type, count in type_counts.items():
                 sample_rates[sample_type] = count / total_time
         
-        # Find data gaps
-        gaps = self._find_data_gaps(all_samples)
+        # Loop profile records arrive once a second whatever the sensors
+        # do, so they are kept out of the gap search
+        self.profiles = sorted((s for s in all_samples if s['type'] == 'profile'),
+                               key=lambda s: s['timestamp_us'])
+        gaps = self._find_data_gaps([s for s in all_samples if s['type'] != 'profile'])
+        self.laps = sorted((s for s in all_samples if s['type'] == 'lap'),
+                           key=lambda s: s['timestamp_us'])
         
         self.sample_stats = {
             'total': len(all_samples),
@@ -167,6 +179,12 @@ class OPLInspector:
         if not self.blocks:
             self.integrity_issues.append("No data blocks found")
         
+        # Check the block index agrees with what was read
+        if self.index is not None and len(self.index) != len(self.blocks):
+            self.integrity_issues.append(
+                f"Block index lists {len(self.index)} blocks but {len(self.blocks)} were read"
+            )
+        
         # Check for timestamp issues
         if self.time_stats and self.time_stats.get('backwards_jumps', 0) > 0:
             self.integrity_issues.append(
@@ -211,6 +229,8 @@ class OPLInspector:
             if diff > 1_000_000:
                 gaps.append({
                     'sample': i,
+                    'start_us': samples[i-1]['timestamp_us'],
+                    'end_us': samples[i]['timestamp_us'],
                     'duration_us': diff,
                     'duration_sec': diff / 1_000_000
                 })
@@ -282,8 +302,12 @@ class OPLInspector:
         print("Sample Types:")
         type_names = {
             'accel': 'Accelerometer',
+            'imu': 'IMU',
+            'imu_event': 'IMU (event)',
             'gps': 'GPS Fixes',
             'satellites': 'Satellite Data',
+            'profile': 'Loop Profile',
+            'lap': 'Lap Events',
             'obd': 'OBD-II PIDs',
             'event': 'Event Markers'
         }
@@ -292,6 +316,20 @@ class OPLInspector:
             rate = stats['sample_rates'].get(sample_type, 0)
             print(f"  {name:<20} {count:>8,} samples  ({rate:>6.1f} Hz)")
         
+        # Event capture windows - one marker per event block, the first
+        # block of a window has first == 0
+        events = [s for block in self.blocks for s in block['samples']
+                  if s['type'] == 'event' and s['first'] == 0]
+        if events:
+            print()
+            print("G Events:")
+            for event in events:
+                trigger_us = event['timestamp_us'] + (event['pre'] - 1) * event['interval_us']
+                window_ms = (event['pre'] + event['post']) * event['interval_us'] / 1000
+                rate = 1000000 / event['interval_us'] if event['interval_us'] else 0
+                print(f"  {format_timestamp(trigger_us)}  {event['peak_g']:5.2f}g peak  "
+                      f"{window_ms:.0f}ms window @ {rate:.0f}Hz")
+        
         # Time information
         if self.time_stats and self.time_stats.get('valid'):
             print()
@@ -385,6 +423,117 @@ class OPLInspector:
             total_size = sum(len(b['samples']) for b in self.blocks)
             avg_size = total_size / len(self.blocks)
             print(f"  Average Size:  {avg_size:.1f} samples/block")
+        if self.index is not None:
+            print(f"Block Index:     {len(self.index)} entries")
+        else:
+            print(f"Block Index:     not present")
+    
+    def print_laps(self):
+        """Print lap times and sector splits from the on-device lap timer"""
+        if not self.laps:
+            return
+        
+        def lap_time(us):
+            return f"{us // 60000000}:{us % 60000000 / 1000000:06.3f}"
+        
+        print(f"\n{'='*70}")
+        print(f"LAPS")
+        print(f"{'='*70}")
+        
+        completed = [e for e in self.laps if e['kind'] == 'lap']
+        if not completed:
+            print("Timing started, no complete laps")
+            return
+        
+        best = min(e['lap_us'] for e in completed)
+        splits = []
+        for event in self.laps:
+            if event['kind'] == 'start':
+                splits = []
+            elif event['kind'] == 'sector':
+                splits.append(event['split_us'])
+            elif event['kind'] == 'lap':
+                splits.append(event['split_us'])
+                sectors = "  ".join(f"{us / 1000000:6.2f}" for us in splits)
+                marker = " *" if event['lap_us'] == best else ""
+                delta = event['delta_us']
+                delta_str = f"{delta / 1000000:+7.3f}" if delta is not None else " " * 7
+                print(f"  Lap {event['lap']:>3}  {lap_time(event['lap_us'])}  {delta_str}  "
+                      f"{sectors}{marker}")
+                splits = []
+        print()
+        print(f"Best lap:        {lap_time(best)} ({len(completed)} laps)")
+    
+    def print_profile(self):
+        """Print main loop stage timings and what the loop was doing in data gaps"""
+        if not self.profiles:
+            return
+        
+        print(f"\n{'='*70}")
+        print(f"LOOP PROFILE")
+        print(f"{'='*70}")
+        print(f"Records:         {len(self.profiles):,} (one per second)")
+        
+        # Scheduler deadline stats (newer firmware only)
+        scheduled = [p for p in self.profiles if p.get('misses') is not None]
+        if scheduled:
+            misses = sum(p['misses'] for p in scheduled)
+            deferrals = sum(p['deferrals'] for p in scheduled)
+            missed_secs = sum(1 for p in scheduled if p['misses'])
+            print(f"Deadline Misses: {misses:,} samples dropped in {missed_secs:,} seconds")
+            print(f"Deferrals:       {deferrals:,} low priority task runs held back")
+        print()
+        
+        # Aggregate the per-second windows
+        totals = {}
+        for profile in self.profiles:
+            for name, stage in profile['stages'].items():
+                agg = totals.setdefault(name, {'count': 0, 'total_us': 0, 'p99_us': 0, 'max_us': 0})
+                agg['count'] += stage['count']
+                agg['total_us'] += stage['avg_us'] * stage['count']
+                agg['p99_us'] = max(agg['p99_us'], stage['p99_us'])
+                agg['max_us'] = max(agg['max_us'], stage['max_us'])
+        
+        windows = len(self.profiles)
+        print(f"  {'Stage':<10} {'Runs/s':>8} {'Avg ms':>8} {'Worst p99':>10} {'Max ms':>8}")
+        for name, agg in totals.items():
+            avg_ms = agg['total_us'] / agg['count'] / 1000 if agg['count'] else 0
+            print(f"  {name:<10} {agg['count'] / windows:>8.1f} {avg_ms:>8.2f} "
+                  f"{agg['p99_us'] / 1000:>8.2f}ms {agg['max_us'] / 1000:>8.2f}")
+        
+        def slowest_stage(profile):
+            stages = [(stage['max_us'], name) for name, stage in profile['stages'].items()
+                      if name != 'loop']
+            return max(stages) if stages else (0, '-')
+        
+        first_us = self.profiles[0]['timestamp_us']
+        
+        # Worst seconds by longest loop iteration
+        by_loop = sorted(self.profiles, key=lambda p: p['stages'].get('loop', {}).get('max_us', 0),
+                         reverse=True)
+        print()
+        print("Slowest Seconds:")
+        for profile in by_loop[:5]:
+            loop_us = profile['stages'].get('loop', {}).get('max_us', 0)
+            stage_us, stage = slowest_stage(profile)
+            offset = format_duration(profile['timestamp_us'] - first_us)
+            print(f"  +{offset:<12} loop {loop_us / 1000:>7.1f}ms  "
+                  f"{profile['loops']:>4} loops  slowest: {stage} {stage_us / 1000:.1f}ms")
+        
+        # A gap is explained by the record written as the loop recovered
+        gaps = [g for g in self.sample_stats['gaps'] if g['duration_sec'] > 1.0] if self.sample_stats else []
+        if gaps:
+            print()
+            print("Data Gaps vs Profile:")
+            for gap in gaps[:10]:
+                after = [p for p in self.profiles
+                         if gap['start_us'] < p['timestamp_us'] <= gap['end_us'] + 1_000_000]
+                if after:
+                    stage_us, stage = max(slowest_stage(p) for p in after)
+                    cause = f"slowest stage {stage} {stage_us / 1000:.1f}ms"
+                else:
+                    cause = "no profile record"
+                print(f"  {gap['duration_sec']:.1f}s gap at +{format_duration(gap['start_us'] - first_us)}: {cause}")
     
     def print_integrity_report(self):
         """Print integrity check results"""
@@ -522,6 +671,10 @@ Examples:
                        help='Hide data summary')
     parser.add_argument('--no-integrity', action='store_true',
                        help='Hide integrity check')
+    parser.add_argument('--no-profile', action='store_true',
+                       help='Hide main loop profile')
+    parser.add_argument('--no-laps', action='store_true',
+                       help='Hide lap times')
     
     parser.add_argument('-v', '--verbose', action='store_true',
                        help='Verbose output (for debugging)')
@@ -588,6 +741,12 @@ Examples:
             if not args.no_summary:
                 inspector.print_summary()
             
+            if not args.no_laps:
+                inspector.print_laps()
+            
+            if not args.no_profile:
+                inspector.print_profile()
+            
             if not args.no_integrity:
                 inspector.print_integrity_report()
                 if inspector.integrity_issues:
@@ -10,9 +10,14 @@ Usage:
     python3 opl2csv.py session_00001.opl --verbose
 """
 
+import contextlib
+import io
+import math
 import struct
 import sys
 import argparse
+from collections import Counter
+from concurrent.futures import ProcessPoolExecutor, as_completed
 from pathlib import Path
 from datetime import datetime, timedelta
 
@@ -25,18 +30,28 @@ from opl_types import (
     BLOCK_TYPE_HARDWARE_CONFIG,
     BLOCK_TYPE_DATA_BLOCK,
     BLOCK_TYPE_SESSION_END,
-    BLOCK_TYPE_DATA_BLOCK_OLD,
-    BLOCK_TYPE_SESSION_END_OLD,
     SAMPLE_TYPE_ACCELEROMETER,
     SAMPLE_TYPE_GPS_FIX,
     SAMPLE_TYPE_GPS_SATELLITES,
+    SAMPLE_TYPE_IMU,
+    SAMPLE_TYPE_IMU_BURST,
+    SAMPLE_TYPE_PROFILE,
+    SAMPLE_TYPE_LAP,
     SAMPLE_TYPE_OBD_PID,
     SAMPLE_TYPE_EVENT_MARKER,
+    BLOCK_FLAG_COMPRESSED,
     WEATHER_MAP,
     HW_TYPE_MAP,
     CONN_TYPE_MAP,
+    COLUMNS,
+    DATA_BLOCK_HEADER,
+    SAMPLE_HEADER,
+    OPLFile,
     OPLTimestamp,
-    SampleParser
+    SampleParser,
+    TimestampFilter,
+    read_block_index,
+    find_blocks_in_range
 )
 
 
@@ -50,6 +65,7 @@ class OPLReader:
         self.session_header = None
         self.hardware_config = None
         self.data_blocks = []
+        self.block_index = None
         
     def log(self, msg):
         """Print message if verbose enabled"""
@@ -259,35 +275,22 @@ class OPLReader:
         # Read block type
         block_type = struct.unpack('<B', self.file.read(1))[0]
         
-        # Check for session end (both old and new numbering)
-        if block_type == BLOCK_TYPE_SESSION_END or block_type == BLOCK_TYPE_SESSION_END_OLD:
+        if block_type == BLOCK_TYPE_SESSION_END:
             self.log("Reached session end block")
             return None
         
-        # Check for data block (both old and new numbering)
-        if block_type != BLOCK_TYPE_DATA_BLOCK and block_type != BLOCK_TYPE_DATA_BLOCK_OLD:
+        if block_type != BLOCK_TYPE_DATA_BLOCK:
             self.log(f"Unknown block type: {block_type:#x}")
             return None
         
-        if block_type == BLOCK_TYPE_DATA_BLOCK_OLD:
-            self.log("Note: Using old block type numbering (0x02 for data block)")
-        
-        # Read session ID
-        session_id = self.file.read(16).hex()
-        
-        # Read block sequence number
-        block_seq = struct.unpack('<I', self.file.read(4))[0]
-        
-        # Read timestamps
-        timestamp_start_us = struct.unpack('<Q', self.file.read(8))[0]
-        timestamp_end_us = struct.unpack('<Q', self.file.read(8))[0]
-        
-        # Read flush flags
-        flush_flags = struct.unpack('<B', self.file.read(1))[0]
-        
-        # Read sample count and data size (both are 2 bytes)
-        sample_count = struct.unpack('<H', self.file.read(2))[0]
-        data_size = struct.unpack('<H', self.file.read(2))[0]
+        # Session ID, sequence, start/end timestamps, flush flags,
+        # sample count, data size
+        fields = self.file.read(DATA_BLOCK_HEADER.size)
+        if len(fields) < DATA_BLOCK_HEADER.size:
+            self.log("Truncated data block header")
+            return None
+        (_, block_seq, timestamp_start_us, timestamp_end_us,
+         flush_flags, sample_count, data_size) = DATA_BLOCK_HEADER.unpack(fields)
         
         # Read sample data
         sample_data = self.file.read(data_size)
@@ -300,7 +303,8 @@ class OPLReader:
         self.log(f"Block {block_seq}: {sample_count} samples, {data_size} bytes")
         
         # Parse samples
-        samples = self.parse_samples(sample_data, timestamp_start_us)
+        samples = self.parse_samples(sample_data, timestamp_start_us,
+                                     compressed=bool(flush_flags & BLOCK_FLAG_COMPRESSED))
         
         return {
             'block_seq': block_seq,
@@ -310,19 +314,21 @@ class OPLReader:
             'samples': samples
         }
     
-    def parse_samples(self, data, base_timestamp_us):
-        """Parse packed sample data"""
+    def parse_samples(self, data, base_timestamp_us, compressed=False):
+        """Parse packed sample data (plain or compressed encoding)"""
+        if compressed:
+            data = SampleParser.expand_compressed(data)
+        
         samples = []
         offset = 0
+        imu_type = 'imu'    # 'imu_event' once an event marker starts the block
         
         while offset < len(data):
             if offset + 4 > len(data):
                 break  # Not enough data for header
             
-            # Read sample header: type (1) + timestamp_offset (2) + length (1)
-            sample_type = struct.unpack('<B', data[offset:offset+1])[0]
-            timestamp_offset = struct.unpack('<H', data[offset+1:offset+3])[0]
-            sample_len = struct.unpack('<B', data[offset+3:offset+4])[0]
+            # Sample header: type (1) + timestamp offset in ms (2) + length (1)
+            sample_type, offset_ms, sample_len = SAMPLE_HEADER.unpack_from(data, offset)
             offset += 4
             
             if offset + sample_len > len(data):
@@ -332,7 +338,7 @@ class OPLReader:
             offset += sample_len
             
             # Calculate absolute timestamp
-            timestamp_us = base_timestamp_us + timestamp_offset
+            timestamp_us = base_timestamp_us + offset_ms * 1000
             
             # Parse based on type
             if sample_type == SAMPLE_TYPE_ACCELEROMETER:
@@ -344,6 +350,24 @@ class OPLReader:
                         **accel
                     })
             
+            elif sample_type == SAMPLE_TYPE_IMU:
+                imu = SampleParser.parse_imu(sample_data)
+                if imu:
+                    samples.append({
+                        'type': 'imu',
+                        'timestamp_us': timestamp_us,
+                        **imu
+                    })
+            
+            elif sample_type == SAMPLE_TYPE_IMU_BURST:
+                records = SampleParser.parse_imu_burst(sample_data)
+                for record in records or []:
+                    samples.append({
+                        'type': imu_type,
+                        'timestamp_us': timestamp_us + record.pop('offset_us'),
+                        **record
+                    })
+            
             elif sample_type == SAMPLE_TYPE_GPS_FIX:
                 gps = SampleParser.parse_gps_fix(sample_data)
                 if gps:
@@ -361,6 +385,34 @@ class OPLReader:
                         'timestamp_us': timestamp_us,
                         'satellites': satellites
                     })
+            
+            elif sample_type == SAMPLE_TYPE_EVENT_MARKER:
+                marker = SampleParser.parse_event_marker(sample_data)
+                if marker:
+                    imu_type = 'imu_event'
+                    samples.append({
+                        'type': 'event',
+                        'timestamp_us': timestamp_us,
+                        **marker
+                    })
+            
+            elif sample_type == SAMPLE_TYPE_LAP:
+                lap = SampleParser.parse_lap(sample_data)
+                if lap:
+                    samples.append({
+                        'type': 'lap',
+                        'timestamp_us': timestamp_us,
+                        **lap
+                    })
+            
+            elif sample_type == SAMPLE_TYPE_PROFILE:
+                profile = SampleParser.parse_profile(sample_data)
+                if profile:
+                    samples.append({
+                        'type': 'profile',
+                        'timestamp_us': timestamp_us,
+                        **profile
+                    })
         
         return samples
     
@@ -385,11 +437,65 @@ class OPLReader:
         self.log(f"Read {len(self.data_blocks)} data blocks")
         return self.session_header, self.data_blocks
     
+    def read_index(self):
+        """
+        Read the block index footer
+        
+        Returns:
+            List of BlockIndexEntry, or None for older files and sessions
+            that were never stopped
+        """
+        with open(self.filepath, 'rb') as f:
+            self.block_index = read_block_index(f)
+        
+        if self.block_index is not None:
+            self.log(f"Block index: {len(self.block_index)} entries")
+        return self.block_index
+    
+    def read_blocks_in_range(self, start_us=None, end_us=None):
+        """
+        Read only the data blocks overlapping [start_us, end_us]
+        
+        Seeks straight to each block through the index when the file has
+        one, otherwise reads the whole file and filters.
+        """
+        index = self.read_index()
+        if index is None:
+            self.read_all()
+            return [b for b in self.data_blocks
+                    if (start_us is None or b['timestamp_end'] >= start_us) and
+                       (end_us is None or b['timestamp_start'] <= end_us)]
+        
+        blocks = []
+        with open(self.filepath, 'rb') as f:
+            self.file = f
+            self.session_header = self.read_session_header()
+            for entry in find_blocks_in_range(index, start_us, end_us):
+                f.seek(entry.offset)
+                block = self.read_data_block()
+                if block is not None:
+                    blocks.append(block)
+        
+        self.log(f"Read {len(blocks)} of {len(index)} data blocks via index")
+        return blocks
+    
+    def read_header(self):
+        """Read only the session header and hardware config blocks"""
+        with open(self.filepath, 'rb') as f:
+            self.file = f
+            self.session_header = self.read_session_header()
+            self.hardware_config = self.read_hardware_config()
+        return self.session_header
+    
     def to_csv(self, output_path=None, drop_bad_time=False, patch_time_jumps=False,
                time_threshold=946684800000000, jump_threshold=60.0):
         """
         Convert to CSV format with optional timestamp filtering and patching
         
+        Streams the file a block at a time through OPLFile: samples are
+        decoded into columns per block, merged by timestamp and written,
+        so memory stays at one block however long the session.
+        
         Args:
             output_path: Output CSV file path
             drop_bad_time: Drop samples with timestamps below threshold
@@ -400,30 +506,16 @@ class OPLReader:
         if output_path is None:
             output_path = self.filepath.with_suffix('.csv')
         
-        # Read file if not already read
+        # Read header if not already read
         if not self.session_header:
-            self.read_all()
+            self.read_header()
+        
+        fix_time = TimestampFilter(drop_bad_time, patch_time_jumps,
+                                   time_threshold, jump_threshold, self.verbose)
+        counts = Counter()
+        block_count = 0
         
-        # Collect all samples
-        all_samples = []
-        for block in self.data_blocks:
-            all_samples.extend(block['samples'])
-        
-        # Sort by timestamp
-        all_samples.sort(key=lambda s: s['timestamp_us'])
-        
-        # Filter and patch timestamps
-        if drop_bad_time or patch_time_jumps:
-            all_samples = self._process_timestamps(
-                all_samples, 
-                drop_bad_time, 
-                patch_time_jumps,
-                time_threshold, 
-                jump_threshold
-            )
-        
-        # Write CSV
-        with open(output_path, 'w') as f:
+        with OPLFile(self.filepath) as opl, open(output_path, 'w') as f:
             # Write header comments
             h = self.session_header
             f.write(f"# OpenPonyLogger Session Export\n")
@@ -452,108 +544,85 @@ class OPLReader:
             f.write(f"#\n")
             
             # Write CSV header
-            f.write("timestamp_us,type,gx,gy,gz,lat,lon,alt,speed,heading,hdop,satellites\n")
+            f.write("timestamp_us,type,gx,gy,gz,lat,lon,alt,speed,heading,hdop,satellites,"
+                    "rx,ry,rz,mx,my,mz\n")
             
-            # Write samples
-            for sample in all_samples:
-                timestamp = sample['timestamp_us']
-                sample_type = sample['type']
-                
-                if sample_type == 'accel':
-                    f.write(f"{timestamp},accel,{sample['gx']:.6f},{sample['gy']:.6f},{sample['gz']:.6f},,,,,,,\n")
-                
-                elif sample_type == 'gps':
-                    f.write(f"{timestamp},gps,,,{sample['lat']:.8f},{sample['lon']:.8f},"
-                           f"{sample['alt']:.2f},{sample['speed']:.2f},{sample['heading']:.2f},{sample['hdop']:.2f},\n")
-                
-                elif sample_type == 'satellites':
-                    sat_list = ';'.join([f"{s['id']}:{s['snr']}" for s in sample['satellites']])
-                    f.write(f"{timestamp},satellites,,,,,,,,,{sat_list}\n")
-        
+            # Write samples, merged by timestamp within each block
+            for block in opl.blocks():
+                block_count += 1
+                rows = self._block_rows(opl, block)
+                for timestamp, sample_type, line in rows:
+                    timestamp = fix_time(timestamp)
+                    if timestamp is None:
+                        continue
+                    f.write(f"{timestamp},{line}")
+                    counts[sample_type] += 1
+        
+        fix_time.report()
         print(f"✓ Converted to CSV: {output_path}")
-        print(f"  Total samples: {len(all_samples)}")
-        print(f"  Accelerometer: {sum(1 for s in all_samples if s['type'] == 'accel')}")
-        print(f"  GPS fixes: {sum(1 for s in all_samples if s['type'] == 'gps')}")
-        print(f"  Satellite data: {sum(1 for s in all_samples if s['type'] == 'satellites')}")
+        print(f"  Blocks: {block_count}")
+        print(f"  Total samples: {sum(counts.values())}")
+        print(f"  Accelerometer: {counts['accel']}")
+        print(f"  IMU: {counts['imu']}")
+        if counts['event']:
+            print(f"  IMU event records: {counts['event']}")
+        print(f"  GPS fixes: {counts['gps']}")
+        print(f"  Satellite data: {counts['satellites']}")
         
         return output_path
     
-    def _process_timestamps(self, samples, drop_bad_time, patch_time_jumps,
-                           time_threshold, jump_threshold):
+    @staticmethod
+    def _columns_as_rows(columns, names):
+        """(timestamp, values) pairs from numpy or list columns"""
+        if isinstance(columns, dict):
+            return zip(columns['timestamp_us'], zip(*(columns[n] for n in names)))
+        return zip(columns['timestamp_us'].tolist(),
+                   zip(*(columns[n].tolist() for n in names)))
+    
+    def _block_rows(self, opl, block):
         """
-        Filter and patch timestamps
-        
-        Args:
-            samples: List of sample dictionaries
-            drop_bad_time: Drop samples below threshold
-            patch_time_jumps: Smooth out time jumps
-            time_threshold: Minimum valid timestamp (microseconds)
-            jump_threshold: Maximum time jump (seconds)
+        CSV lines for one block, sorted by timestamp
         
         Returns:
-            Processed list of samples
+            List of (timestamp_us, type, line without the timestamp)
         """
-        if not samples:
-            return samples
-        
-        processed = []
-        dropped_count = 0
-        patched_count = 0
-        
-        # Step 1: Drop samples with bad timestamps
-        if drop_bad_time:
-            for sample in samples:
-                if OPLTimestamp.is_rtc_synced(sample['timestamp_us']):
-                    processed.append(sample)
-                else:
-                    dropped_count += 1
-            
-            if dropped_count > 0:
-                print(f"  Dropped {dropped_count} samples with bad timestamps (before RTC sync)")
-            
-            samples = processed
-            processed = []
-        
-        # Step 2: Patch time jumps
-        if patch_time_jumps and len(samples) > 0:
-            # Convert jump threshold to microseconds
-            jump_threshold_us = jump_threshold * 1_000_000
-            
-            last_timestamp = samples[0]['timestamp_us']
-            time_offset = 0  # Accumulated offset from patching
-            
-            for sample in samples:
-                current_timestamp = sample['timestamp_us']
-                time_diff = current_timestamp - last_timestamp
-                
-                # Detect large forward jump (RTC sync)
-                if time_diff > jump_threshold_us:
-                    # Calculate offset needed to smooth this jump
-                    # We want to continue from last_timestamp with normal progression
-                    time_offset = last_timestamp - current_timestamp
-                    patched_count += 1
-                    
-                    if self.verbose:
-                        jump_sec = time_diff / 1_000_000
-                        print(f"  Detected time jump: {jump_sec:.1f}s at sample {len(processed)}")
-                        print(f"    From: {last_timestamp} µs")
-                        print(f"    To:   {current_timestamp} µs")
-                        print(f"    Applying offset: {time_offset} µs")
-                
-                # Apply accumulated offset
-                patched_sample = sample.copy()
-                patched_sample['timestamp_us'] = current_timestamp + time_offset
-                processed.append(patched_sample)
-                
-                last_timestamp = patched_sample['timestamp_us']
-            
-            if patched_count > 0:
-                print(f"  Patched {patched_count} time jumps > {jump_threshold}s")
-        else:
-            processed = samples
+        rows = []
+        
+        accel = opl.decode_block(block, 'accel')
+        if accel is not None:
+            for ts, (gx, gy, gz) in self._columns_as_rows(accel, COLUMNS['accel']):
+                rows.append((ts, 'accel', f"accel,{gx:.6f},{gy:.6f},{gz:.6f},,,,,,,\n"))
+        
+        imu = opl.decode_block(block, 'imu')
+        if imu is not None:
+            for ts, (gx, gy, gz, rx, ry, rz, mx, my, mz) in self._columns_as_rows(imu, COLUMNS['imu']):
+                mag = ",," if math.isnan(mx) else f"{mx:.2f},{my:.2f},{mz:.2f}"
+                rows.append((ts, 'imu', f"imu,{gx:.6f},{gy:.6f},{gz:.6f},,,,,,,,"
+                                        f"{rx:.4f},{ry:.4f},{rz:.4f},{mag}\n"))
+        
+        # Full-rate records around a g event, alongside the normal IMU rows
+        event = opl.decode_block(block, 'event')
+        if event is not None:
+            for ts, (gx, gy, gz, rx, ry, rz, mx, my, mz) in self._columns_as_rows(event, COLUMNS['event']):
+                rows.append((ts, 'event', f"imu_event,{gx:.6f},{gy:.6f},{gz:.6f},,,,,,,,"
+                                          f"{rx:.4f},{ry:.4f},{rz:.4f},,,\n"))
+        
+        gps = opl.decode_block(block, 'gps')
+        if gps is not None:
+            for ts, (lat, lon, alt, speed, heading, hdop) in self._columns_as_rows(gps, COLUMNS['gps']):
+                rows.append((ts, 'gps', f"gps,,,{lat:.8f},{lon:.8f},"
+                                        f"{alt:.2f},{speed:.2f},{heading:.2f},{hdop:.2f},\n"))
+        
+        # Satellites are variable length and rare - parsed one by one
+        for sample_type, ts, pos, length in opl.sample_headers(block):
+            if sample_type == SAMPLE_TYPE_GPS_SATELLITES:
+                satellites = SampleParser.parse_gps_satellites(block.data[pos:pos + length])
+                if satellites:
+                    sat_list = ';'.join([f"{s['id']}:{s['snr']}" for s in satellites])
+                    rows.append((ts, 'satellites', f"satellites,,,,,,,,,{sat_list}\n"))
         
-        return processed
-
+        rows.sort(key=lambda row: row[0])
+        return rows
 
 
 def main():
@@ -566,6 +635,7 @@ Examples:
   %(prog)s session_00001.opl -o output.csv
   %(prog)s session_00001.opl --verbose
   %(prog)s *.opl  # Convert all OPL files
+  %(prog)s *.opl --jobs 4  # Four files at a time
   
   # Drop samples recorded before RTC sync (monotonic time)
   %(prog)s session_00001.opl --drop-bad-time
@@ -594,58 +664,100 @@ Examples:
     parser.add_argument('--jump-threshold', type=float, default=60.0,
                        help='Time jump threshold in seconds for patching (default: 60.0)')
     
+    parser.add_argument('-j', '--jobs', type=int, default=1,
+                       help='Convert this many files in parallel (default: 1)')
+    
     args = parser.parse_args()
     
-    # Process each input file
-    for input_file in args.input:
-        input_path = Path(input_file)
-        
-        if not input_path.exists():
-            print(f"✗ File not found: {input_path}")
-            continue
-        
-        if not input_path.suffix == '.opl':
-            print(f"⚠ Warning: {input_path} doesn't have .opl extension")
-        
-        print(f"\n{'='*60}")
-        print(f"Converting: {input_path}")
-        print(f"{'='*60}")
-        
-        try:
-            reader = OPLReader(input_path, verbose=args.verbose)
-            
-            # Read and display header
-            header, blocks = reader.read_all()
-            
-            print(f"\nSession Information:")
-            print(f"  Name:     {header['session_name']}")
-            print(f"  Driver:   {header['driver_name']}")
-            print(f"  Vehicle:  {header['vehicle_id']}")
-            print(f"  Date:     {header['timestamp']}")
-            print(f"  Weather:  {header['weather']}, {header['ambient_temp']}°C")
-            print(f"  Blocks:   {len(blocks)}")
-            
-            # Convert to CSV
-            output_path = args.output if args.output else None
-            reader.to_csv(
-                output_path,
-                drop_bad_time=args.drop_bad_time,
-                patch_time_jumps=args.patch_time_jumps,
-                time_threshold=args.time_threshold,
-                jump_threshold=args.jump_threshold
-            )
-            
-        except Exception as e:
-            print(f"✗ Error processing {input_path}: {e}")
-            import traceback
-            if args.verbose:
-                traceback.print_exc()
-            else:
-                print(f"  Run with --verbose for full traceback")
-            continue
+    if args.output and len(args.input) > 1:
+        print("✗ --output can only be used with a single input file")
+        sys.exit(1)
+    
+    options = {
+        'output': args.output,
+        'verbose': args.verbose,
+        'drop_bad_time': args.drop_bad_time,
+        'patch_time_jumps': args.patch_time_jumps,
+        'time_threshold': args.time_threshold,
+        'jump_threshold': args.jump_threshold,
+    }
+    
+    if args.jobs > 1 and len(args.input) > 1:
+        # One process per file; each worker's output is printed as it finishes
+        with ProcessPoolExecutor(max_workers=args.jobs) as pool:
+            futures = [pool.submit(convert_file, input_file, options, True)
+                       for input_file in args.input]
+            for future in as_completed(futures):
+                print(future.result(), end='')
+    else:
+        for input_file in args.input:
+            convert_file(input_file, options)
     
     print()
 
 
+def convert_file(input_file, options, capture=False):
+    """
+    Convert one .opl file, see main() for the options
+    
+    Args:
+        input_file: Input .opl path
+        options: Dict of the command line options
+        capture: Return the console output instead of printing it
+                 (used by the --jobs workers)
+    
+    Returns:
+        Captured output when capture is set
+    """
+    if capture:
+        out = io.StringIO()
+        with contextlib.redirect_stdout(out):
+            convert_file(input_file, options)
+        return out.getvalue()
+    
+    input_path = Path(input_file)
+    
+    if not input_path.exists():
+        print(f"✗ File not found: {input_path}")
+        return
+    
+    if not input_path.suffix == '.opl':
+        print(f"⚠ Warning: {input_path} doesn't have .opl extension")
+    
+    print(f"\n{'='*60}")
+    print(f"Converting: {input_path}")
+    print(f"{'='*60}")
+    
+    try:
+        reader = OPLReader(input_path, verbose=options['verbose'])
+        
+        # Read and display header
+        header = reader.read_header()
+        
+        print(f"\nSession Information:")
+        print(f"  Name:     {header['session_name']}")
+        print(f"  Driver:   {header['driver_name']}")
+        print(f"  Vehicle:  {header['vehicle_id']}")
+        print(f"  Date:     {header['timestamp']}")
+        print(f"  Weather:  {header['weather']}, {header['ambient_temp']}°C")
+        
+        # Convert to CSV
+        reader.to_csv(
+            options['output'],
+            drop_bad_time=options['drop_bad_time'],
+            patch_time_jumps=options['patch_time_jumps'],
+            time_threshold=options['time_threshold'],
+            jump_threshold=options['jump_threshold']
+        )
+        
+    except Exception as e:
+        print(f"✗ Error processing {input_path}: {e}")
+        import traceback
+        if options['verbose']:
+            traceback.print_exc(file=sys.stdout)
+        else:
+            print(f"  Run with --verbose for full traceback")
+
+
 if __name__ == '__main__':
     main()
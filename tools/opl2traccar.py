@@ -11,6 +11,7 @@ Usage:
     python3 opl2traccar.py session_00001.opl --device-id mustang-gt
     python3 opl2traccar.py session_00001.opl --realtime --speed 10
     python3 opl2traccar.py session_00001.opl --batch --batch-size 50
+    python3 opl2traccar.py *.opl --jobs 8 --min-distance 5 --min-turn 10 --resume
 
 Traccar Setup:
     1. Install Traccar server: https://www.traccar.org/download/
@@ -20,25 +21,135 @@ Traccar Setup:
 """
 
 import argparse
+import json
+import math
 import sys
 import time
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
 import requests
+from requests.adapters import HTTPAdapter
 from pathlib import Path
 from datetime import datetime, timezone, timedelta
 
 # Import from shared modules
 from opl_types import (
+    COLUMNS,
     SAMPLE_TYPE_GPS_FIX,
+    OPLFile,
     OPLTimestamp,
+    TimestampFilter,
     UnitConverter
 )
 from opl2csv import OPLReader
 
+# Mean Earth radius for decimation distances
+EARTH_RADIUS_M = 6371000.0
+
+# Checkpoint is rewritten after this many confirmed positions
+CHECKPOINT_EVERY = 500
+
+
+def distance_m(lat1, lon1, lat2, lon2):
+    """Great circle (haversine) distance in metres"""
+    phi1 = math.radians(lat1)
+    phi2 = math.radians(lat2)
+    dphi = phi2 - phi1
+    dlambda = math.radians(lon2 - lon1)
+    a = math.sin(dphi / 2) ** 2 + math.cos(phi1) * math.cos(phi2) * math.sin(dlambda / 2) ** 2
+    return 2 * EARTH_RADIUS_M * math.asin(min(1.0, math.sqrt(a)))
+
+
+def decimate(samples, min_distance=0.0, min_turn=0.0):
+    """
+    Drop positions that add nothing to the track
+    
+    A position is kept if it is more than min_distance metres from the
+    last kept one, or its heading is more than min_turn degrees off the
+    last kept heading. The first and last positions are always kept.
+    
+    Args:
+        samples: GPS sample dictionaries in time order
+        min_distance: Metres, 0 to ignore distance
+        min_turn: Degrees, 0 to ignore heading
+    
+    Returns:
+        Kept samples
+    """
+    if len(samples) < 3 or (min_distance <= 0 and min_turn <= 0):
+        return samples
+    
+    kept = [samples[0]]
+    last = samples[0]
+    for sample in samples[1:-1]:
+        if min_distance > 0 and distance_m(last['lat'], last['lon'],
+                                           sample['lat'], sample['lon']) > min_distance:
+            kept.append(sample)
+            last = sample
+            continue
+        if min_turn > 0:
+            turn = abs(sample['heading'] - last['heading']) % 360
+            if min(turn, 360 - turn) > min_turn:
+                kept.append(sample)
+                last = sample
+    kept.append(samples[-1])
+    return kept
+
+
+class Checkpoint:
+    """
+    --resume state for one .opl file, kept next to it as <file>.traccar.json
+    
+    Records the timestamp of the newest position that the server has
+    confirmed along with every position before it, per server and device.
+    A failed position holds the checkpoint back, so the next --resume run
+    retries it.
+    """
+    
+    def __init__(self, opl_file, key):
+        self.path = Path(str(opl_file) + '.traccar.json')
+        self.key = key
+        self.timestamp_us = None
+        self.sent = 0
+        self._dirty = 0
+        try:
+            with open(self.path) as f:
+                state = json.load(f).get(key)
+            if state:
+                self.timestamp_us = state['timestamp_us']
+                self.sent = state['sent']
+        except (OSError, ValueError, KeyError):
+            pass
+    
+    def advance(self, timestamp_us):
+        """Everything up to and including timestamp_us is on the server"""
+        self.timestamp_us = timestamp_us
+        self.sent += 1
+        self._dirty += 1
+        if self._dirty >= CHECKPOINT_EVERY:
+            self.save()
+    
+    def save(self):
+        if self.timestamp_us is None:
+            return
+        try:
+            with open(self.path) as f:
+                state = json.load(f)
+        except (OSError, ValueError):
+            state = {}
+        state[self.key] = {'timestamp_us': self.timestamp_us, 'sent': self.sent}
+        tmp = self.path.with_suffix('.tmp')
+        with open(tmp, 'w') as f:
+            json.dump(state, f, indent=2)
+        tmp.replace(self.path)
+        self._dirty = 0
+
+
 class TraccarUploader:
     """Upload GPS data to Traccar server"""
     
     def __init__(self, server='localhost', port=5055, device_id='openponylogger', 
-                 use_https=False, verbose=False):
+                 use_https=False, verbose=False, jobs=1, post_batch=0):
         """
         Initialize Traccar uploader
         
@@ -48,6 +159,8 @@ class TraccarUploader:
             device_id: Unique device identifier
             use_https: Use HTTPS instead of HTTP
             verbose: Enable debug output
+            jobs: Requests in flight at once
+            post_batch: Positions per JSON POST, 0 to send one GET each
         """
         self.server = server
         self.port = port
@@ -55,10 +168,19 @@ class TraccarUploader:
         self.protocol = 'https' if use_https else 'http'
         self.verbose = verbose
         self.base_url = f"{self.protocol}://{self.server}:{self.port}"
+        self.jobs = max(1, jobs)
+        self.post_batch = post_batch
+        
+        # Keep-alive connections, one per worker
+        self.session = requests.Session()
+        adapter = HTTPAdapter(pool_connections=1, pool_maxsize=self.jobs)
+        self.session.mount('http://', adapter)
+        self.session.mount('https://', adapter)
         
         # Track statistics
         self.points_sent = 0
         self.points_failed = 0
+        self.requests_sent = 0
         self.start_time = None
         
     def log(self, msg):
@@ -70,7 +192,7 @@ class TraccarUploader:
         """Test connection to Traccar server"""
         try:
             # Try to connect to the server
-            response = requests.get(f"{self.protocol}://{self.server}:{self.port}", timeout=5)
+            response = self.session.get(self.base_url, timeout=5)
             self.log(f"✓ Connected to Traccar server at {self.server}:{self.port}")
             return True
         except requests.exceptions.ConnectionError:
@@ -84,6 +206,80 @@ class TraccarUploader:
             print(f"✗ Connection error: {e}")
             return False
     
+    def _params(self, sample):
+        """OsmAnd query parameters for a GPS sample"""
+        # Convert microseconds to datetime (Unix epoch 1970-01-01)
+        timestamp_dt = OPLTimestamp.to_datetime(sample['timestamp_us'], tz=timezone.utc)
+        
+        # Convert speed from MPH to knots (Traccar expects knots)
+        speed_knots = UnitConverter.mph_to_knots(sample['speed'])
+        
+        return {
+            'id': self.device_id,
+            'timestamp': int(timestamp_dt.timestamp()),
+            'lat': f"{sample['lat']:.8f}",
+            'lon': f"{sample['lon']:.8f}",
+            'altitude': f"{sample['alt']:.1f}",
+            'speed': f"{speed_knots:.2f}",  # Should be in knots
+            'bearing': f"{sample['heading']:.1f}",
+            'hdop': f"{sample['hdop']:.2f}",
+        }
+    
+    def _get(self, params):
+        """
+        One OsmAnd GET - safe to call from worker threads
+        
+        Returns:
+            True if the server accepted it
+        """
+        try:
+            response = self.session.get(self.base_url, params=params, timeout=10)
+            if response.status_code == 200:
+                self.log(f"✓ Sent position: {params['lat']}, {params['lon']} @ {params['timestamp']}")
+                return True
+            self.log(f"✗ Failed (HTTP {response.status_code}): {response.text}")
+            return False
+        except requests.exceptions.RequestException as e:
+            self.log(f"✗ Network error: {e}")
+            return False
+    
+    def _post(self, samples):
+        """
+        Several positions in one OsmAnd JSON POST
+        
+        Traccar's OsmAnd decoder takes a JSON body with a "location"
+        object or a list of them (the Transistor / background-geolocation
+        format). Speed is in m/s there, accuracy stands in for hdop.
+        
+        Returns:
+            HTTP status code, or 0 on a network error
+        """
+        locations = []
+        for sample in samples:
+            timestamp_dt = OPLTimestamp.to_datetime(sample['timestamp_us'], tz=timezone.utc)
+            coords = {
+                'latitude': sample['lat'],
+                'longitude': sample['lon'],
+                'altitude': sample['alt'],
+                'speed': sample['speed'] * 0.44704,  # MPH to m/s
+                'heading': sample['heading'],
+                'accuracy': sample['hdop'],
+            }
+            locations.append({
+                'timestamp': timestamp_dt.isoformat().replace('+00:00', 'Z'),
+                # NaN / inf are not valid JSON - leave those fields out
+                'coords': {k: v for k, v in coords.items() if math.isfinite(v)},
+            })
+        try:
+            response = self.session.post(self.base_url, timeout=30,
+                                         json={'device_id': self.device_id, 'location': locations})
+            if response.status_code != 200:
+                self.log(f"✗ Batch failed (HTTP {response.status_code}): {response.text}")
+            return response.status_code
+        except requests.exceptions.RequestException as e:
+            self.log(f"✗ Network error: {e}")
+            return 0
+    
     def send_position(self, lat, lon, timestamp_dt, altitude=0, speed=0, heading=0, hdop=0):
         """
         Send a single GPS position to Traccar using OsmAnd protocol
@@ -104,47 +300,52 @@ class TraccarUploader:
         Returns:
             True if successful, False otherwise
         """
-        try:
-            # Convert timestamp to Unix timestamp (seconds since 1970-01-01)
-            unix_timestamp = int(timestamp_dt.timestamp())
-            
-            # Build parameters (OsmAnd protocol)
-            params = {
-                'id': self.device_id,
-                'timestamp': unix_timestamp,
-                'lat': f"{lat:.8f}",
-                'lon': f"{lon:.8f}",
-                'altitude': f"{altitude:.1f}",
-                'speed': f"{speed:.2f}",  # Should be in knots
-                'bearing': f"{heading:.1f}",
-                'hdop': f"{hdop:.2f}",
-            }
-            
-            # Send HTTP GET request
-            response = requests.get(self.base_url, params=params, timeout=10)
-            
-            if response.status_code == 200:
-                self.points_sent += 1
-                self.log(f"✓ Sent position: {lat:.6f}, {lon:.6f} @ {timestamp_dt.isoformat()}")
-                return True
+        params = {
+            'id': self.device_id,
+            'timestamp': int(timestamp_dt.timestamp()),
+            'lat': f"{lat:.8f}",
+            'lon': f"{lon:.8f}",
+            'altitude': f"{altitude:.1f}",
+            'speed': f"{speed:.2f}",
+            'bearing': f"{heading:.1f}",
+            'hdop': f"{hdop:.2f}",
+        }
+        self.requests_sent += 1
+        if self._get(params):
+            self.points_sent += 1
+            return True
+        self.points_failed += 1
+        return False
+    
+    def _send_unit(self, unit):
+        """
+        Worker: send one unit (a list of samples)
+        
+        Returns:
+            tuple: (list of True/False per sample in order, requests made)
+        """
+        requests_made = 0
+        if len(unit) > 1 and self.post_batch:
+            status = self._post(unit)
+            requests_made += 1
+            if status == 200:
+                return [True] * len(unit), requests_made
+            if status in (400, 404, 405, 415):
+                # Server doesn't take JSON batches - fall back to GETs for good
+                if self.post_batch:
+                    self.post_batch = 0
+                    print(f"⚠ Server rejected a JSON batch (HTTP {status}), "
+                          f"sending one position per request")
             else:
-                self.points_failed += 1
-                self.log(f"✗ Failed (HTTP {response.status_code}): {response.text}")
-                return False
-                
-        except requests.exceptions.RequestException as e:
-            self.points_failed += 1
-            self.log(f"✗ Network error: {e}")
-            return False
-        except Exception as e:
-            self.points_failed += 1
-            self.log(f"✗ Error: {e}")
-            return False
+                return [False] * len(unit), requests_made
+        results = [self._get(self._params(sample)) for sample in unit]
+        return results, requests_made + len(unit)
     
     def upload_opl_file(self, opl_file, realtime=False, playback_speed=1.0, 
                        batch_mode=False, batch_size=10, drop_bad_time=False,
                        patch_time_jumps=False, time_threshold=946684800000000,
-                       jump_threshold=60.0):
+                       jump_threshold=60.0, min_distance=0.0, min_turn=0.0,
+                       resume=False):
         """
         Upload all GPS positions from an OPL file to Traccar
         
@@ -158,16 +359,22 @@ class TraccarUploader:
             patch_time_jumps: Smooth out large time jumps
             time_threshold: Minimum valid timestamp (microseconds)
             jump_threshold: Maximum time jump to allow (seconds)
+            min_distance: Decimate: keep positions moved more than this (m)
+            min_turn: Decimate: keep positions turned more than this (degrees)
+            resume: Skip positions already confirmed by an earlier run
         
         Returns:
             Number of positions successfully uploaded
         """
         self.start_time = time.time()
+        self.points_sent = 0
+        self.points_failed = 0
+        self.requests_sent = 0
         
         # Read OPL file
         print(f"\nReading: {opl_file}")
         reader = OPLReader(opl_file, verbose=self.verbose)
-        header, blocks = reader.read_all()
+        header = reader.read_header()
         
         print(f"\nSession: {header['session_name']}")
         print(f"Driver: {header['driver_name']}")
@@ -177,12 +384,8 @@ class TraccarUploader:
         print(f"Server: {self.base_url}")
         print()
         
-        # Extract all GPS samples
-        gps_samples = []
-        for block in blocks:
-            for sample in block['samples']:
-                if sample['type'] == 'gps':
-                    gps_samples.append(sample)
+        # Extract GPS fixes only - accel/IMU samples are never decoded
+        gps_samples = self._read_gps(opl_file)
         
         if not gps_samples:
             print("✗ No GPS data found in file")
@@ -198,40 +401,83 @@ class TraccarUploader:
             )
             print(f"After filtering: {len(gps_samples)} GPS positions to upload")
         
+        found = len(gps_samples)
+        if min_distance > 0 or min_turn > 0:
+            gps_samples = decimate(gps_samples, min_distance, min_turn)
+            print(f"After decimation: {len(gps_samples)} GPS positions "
+                  f"({found - len(gps_samples)} dropped)")
+        
+        checkpoint = None
+        if resume:
+            checkpoint = Checkpoint(opl_file, f"{self.base_url} {self.device_id}")
+            if checkpoint.timestamp_us is not None:
+                before = len(gps_samples)
+                gps_samples = [s for s in gps_samples if s['timestamp_us'] > checkpoint.timestamp_us]
+                print(f"Resuming: {before - len(gps_samples)} positions already uploaded")
+        
         print()
         
-        # Upload positions
+        if not gps_samples:
+            print("✓ Nothing left to upload")
+            return 0
+        
+        try:
+            if realtime or (self.jobs == 1 and not self.post_batch):
+                self._upload_sequential(gps_samples, realtime, playback_speed,
+                                        batch_mode, batch_size, checkpoint)
+            else:
+                self._upload_concurrent(gps_samples, batch_mode, batch_size, checkpoint)
+        finally:
+            if checkpoint:
+                checkpoint.save()
+        
+        # Final statistics
+        elapsed = time.time() - self.start_time
+        print(f"\n{'='*60}")
+        print(f"Upload Complete!")
+        print(f"{'='*60}")
+        print(f"Sent:     {self.points_sent} positions")
+        print(f"Failed:   {self.points_failed} positions")
+        if found != len(gps_samples):
+            print(f"Skipped:  {found - len(gps_samples)} positions (decimated / resumed)")
+        print(f"Requests: {self.requests_sent} ({self.jobs} in flight)")
+        print(f"Time:     {elapsed:.1f} seconds")
+        print(f"Rate:     {self.points_sent/elapsed:.1f} positions/second")
+        print(f"\nView track in Traccar web UI:")
+        print(f"  {self.protocol}://{self.server}:8082")
+        print(f"  (Default login: admin / admin)")
+        print()
+        
+        return self.points_sent
+    
+    def _progress(self, done, total):
+        elapsed = time.time() - self.start_time
+        rate = done / elapsed if elapsed > 0 else 0
+        remaining = (total - done) / rate if rate > 0 else 0
+        print(f"Progress: {done}/{total} ({done*100//total}%) - "
+              f"{rate:.1f} pts/sec - ETA: {remaining:.0f}s")
+    
+    def _upload_sequential(self, gps_samples, realtime, playback_speed,
+                           batch_mode, batch_size, checkpoint):
+        """One request at a time, optionally paced like the session was"""
         last_timestamp = None
-        batch_count = 0
+        blocked = False     # A failure holds the checkpoint back
         
         for i, sample in enumerate(gps_samples, 1):
-            # Convert microseconds to datetime (Unix epoch 1970-01-01)
             timestamp_us = sample['timestamp_us']
-            timestamp_dt = OPLTimestamp.to_datetime(timestamp_us, tz=timezone.utc)
             
-            # Convert speed from MPH to knots (Traccar expects knots)
-            speed_mph = sample['speed']
-            speed_knots = UnitConverter.mph_to_knots(speed_mph)
-            
-            # Send position
-            success = self.send_position(
-                lat=sample['lat'],
-                lon=sample['lon'],
-                timestamp_dt=timestamp_dt,
-                altitude=sample['alt'],
-                speed=speed_knots,
-                heading=sample['heading'],
-                hdop=sample['hdop']
-            )
+            self.requests_sent += 1
+            if self._get(self._params(sample)):
+                self.points_sent += 1
+                if checkpoint and not blocked:
+                    checkpoint.advance(timestamp_us)
+            else:
+                self.points_failed += 1
+                blocked = True
             
             # Progress update in batch mode
             if batch_mode and i % batch_size == 0:
-                batch_count += 1
-                elapsed = time.time() - self.start_time
-                rate = i / elapsed if elapsed > 0 else 0
-                remaining = (len(gps_samples) - i) / rate if rate > 0 else 0
-                print(f"Progress: {i}/{len(gps_samples)} ({i*100//len(gps_samples)}%) - "
-                      f"{rate:.1f} pts/sec - ETA: {remaining:.0f}s")
+                self._progress(i, len(gps_samples))
             
             # Realtime playback simulation
             if realtime and last_timestamp is not None:
@@ -245,22 +491,58 @@ class TraccarUploader:
                     time.sleep(min(sleep_time, 10))  # Cap at 10 seconds
             
             last_timestamp = timestamp_us
+    
+    def _upload_concurrent(self, gps_samples, batch_mode, batch_size, checkpoint):
+        """
+        Up to self.jobs requests in flight over pooled connections
         
-        # Final statistics
-        elapsed = time.time() - self.start_time
-        print(f"\n{'='*60}")
-        print(f"Upload Complete!")
-        print(f"{'='*60}")
-        print(f"Sent:     {self.points_sent} positions")
-        print(f"Failed:   {self.points_failed} positions")
-        print(f"Time:     {elapsed:.1f} seconds")
-        print(f"Rate:     {self.points_sent/elapsed:.1f} positions/second")
-        print(f"\nView track in Traccar web UI:")
-        print(f"  {self.protocol}://{self.server}:8082")
-        print(f"  (Default login: admin / admin)")
-        print()
+        Results are collected oldest first, so the checkpoint only ever
+        covers a contiguous run of confirmed positions.
+        """
+        unit_size = max(1, self.post_batch)
+        units = [gps_samples[i:i + unit_size] for i in range(0, len(gps_samples), unit_size)]
+        in_flight = deque()
+        done = 0
+        next_progress = batch_size
+        blocked = False
         
-        return self.points_sent
+        def collect():
+            nonlocal done, next_progress, blocked
+            unit, future = in_flight.popleft()
+            results, requests_made = future.result()
+            self.requests_sent += requests_made
+            for sample, ok in zip(unit, results):
+                if ok:
+                    self.points_sent += 1
+                    if checkpoint and not blocked:
+                        checkpoint.advance(sample['timestamp_us'])
+                else:
+                    self.points_failed += 1
+                    blocked = True
+            done += len(unit)
+            if batch_mode and done >= next_progress:
+                self._progress(done, len(gps_samples))
+                next_progress = done + batch_size
+        
+        with ThreadPoolExecutor(max_workers=self.jobs) as pool:
+            for unit in units:
+                if len(in_flight) >= self.jobs:
+                    collect()
+                in_flight.append((unit, pool.submit(self._send_unit, unit)))
+            while in_flight:
+                collect()
+    
+    @staticmethod
+    def _read_gps(opl_file):
+        """GPS fixes from the column decoder as sample dictionaries"""
+        with OPLFile(opl_file) as opl:
+            table = opl.columns('gps')
+        names = ('timestamp_us',) + COLUMNS['gps']
+        if isinstance(table, dict):
+            columns = [table[name] for name in names]
+        else:
+            columns = [table[name].tolist() for name in names]
+        return [dict(zip(names, row)) for row in zip(*columns)]
     
     def _process_timestamps(self, samples, drop_bad_time, patch_time_jumps,
                            time_threshold, jump_threshold):
@@ -277,61 +559,14 @@ class TraccarUploader:
         Returns:
             Processed list of samples
         """
-        if not samples:
-            return samples
-        
+        fix_time = TimestampFilter(drop_bad_time, patch_time_jumps,
+                                   time_threshold, jump_threshold, self.verbose)
         processed = []
-        dropped_count = 0
-        patched_count = 0
-        
-        # Step 1: Drop samples with bad timestamps
-        if drop_bad_time:
-            for sample in samples:
-                if OPLTimestamp.is_rtc_synced(sample['timestamp_us']):
-                    processed.append(sample)
-                else:
-                    dropped_count += 1
-            
-            if dropped_count > 0:
-                print(f"  Dropped {dropped_count} GPS positions with bad timestamps")
-            
-            samples = processed
-            processed = []
-        
-        # Step 2: Patch time jumps
-        if patch_time_jumps and len(samples) > 0:
-            # Convert jump threshold to microseconds
-            jump_threshold_us = jump_threshold * 1_000_000
-            
-            last_timestamp = samples[0]['timestamp_us']
-            time_offset = 0  # Accumulated offset from patching
-            
-            for sample in samples:
-                current_timestamp = sample['timestamp_us']
-                time_diff = current_timestamp - last_timestamp
-                
-                # Detect large forward jump (RTC sync)
-                if time_diff > jump_threshold_us:
-                    # Calculate offset needed to smooth this jump
-                    time_offset = last_timestamp - current_timestamp
-                    patched_count += 1
-                    
-                    if self.verbose:
-                        jump_sec = time_diff / 1_000_000
-                        print(f"  Detected time jump: {jump_sec:.1f}s at position {len(processed)}")
-                
-                # Apply accumulated offset
-                patched_sample = sample.copy()
-                patched_sample['timestamp_us'] = current_timestamp + time_offset
-                processed.append(patched_sample)
-                
-                last_timestamp = patched_sample['timestamp_us']
-            
-            if patched_count > 0:
-                print(f"  Patched {patched_count} time jumps > {jump_threshold}s")
-        else:
-            processed = samples
-        
+        for sample in samples:
+            timestamp = fix_time(sample['timestamp_us'])
+            if timestamp is not None:
+                processed.append(dict(sample, timestamp_us=timestamp))
+        fix_time.report()
         return processed
 
 
@@ -358,6 +593,10 @@ Examples:
   
   # Use HTTPS
   %(prog)s session_00001.opl --server secure.example.com --https
+  
+  # Bulk backfill: 8 requests in flight, JSON batches of 100, only
+  # positions 5m apart or 10 degrees off, pick up where the last run stopped
+  %(prog)s *.opl --jobs 8 --post-batch 100 --min-distance 5 --min-turn 10 --resume
 
 Traccar Server Setup:
   1. Install: https://www.traccar.org/download/
@@ -368,7 +607,7 @@ Traccar Server Setup:
         """
     )
     
-    parser.add_argument('input', help='Input .opl file')
+    parser.add_argument('input', nargs='+', help='Input .opl file(s)')
     parser.add_argument('-s', '--server', default='localhost',
                        help='Traccar server hostname/IP (default: localhost)')
     parser.add_argument('-p', '--port', type=int, default=5055,
@@ -385,6 +624,18 @@ Traccar Server Setup:
                        help='Batch mode with progress updates')
     parser.add_argument('--batch-size', type=int, default=10,
                        help='Positions per batch update (default: 10)')
+    parser.add_argument('-j', '--jobs', type=int, default=1,
+                       help='Requests in flight at once (default: 1, ignored with --realtime)')
+    parser.add_argument('--post-batch', type=int, default=0, metavar='N',
+                       help='Send N positions per JSON POST; falls back to one GET per '
+                            'position if the server refuses (default: 0, off)')
+    parser.add_argument('--min-distance', type=float, default=0.0, metavar='M',
+                       help='Decimate: skip positions less than M metres from the last one sent')
+    parser.add_argument('--min-turn', type=float, default=0.0, metavar='DEG',
+                       help='Decimate: ...unless the heading changed by more than DEG degrees')
+    parser.add_argument('--resume', action='store_true',
+                       help='Skip positions a previous run already uploaded '
+                            '(checkpoint kept in <file>.opl.traccar.json)')
     parser.add_argument('-v', '--verbose', action='store_true',
                        help='Verbose output (show each position sent)')
     parser.add_argument('--test', action='store_true',
@@ -400,11 +651,12 @@ Traccar Server Setup:
     
     args = parser.parse_args()
     
-    # Validate input file
-    input_path = Path(args.input)
-    if not input_path.exists():
-        print(f"✗ File not found: {input_path}")
-        return 1
+    # Validate input files
+    input_paths = [Path(name) for name in args.input]
+    for input_path in input_paths:
+        if not input_path.exists():
+            print(f"✗ File not found: {input_path}")
+            return 1
     
     # Create uploader
     uploader = TraccarUploader(
@@ -412,7 +664,9 @@ Traccar Server Setup:
         port=args.port,
         device_id=args.device_id,
         use_https=args.https,
-        verbose=args.verbose
+        verbose=args.verbose,
+        jobs=1 if args.realtime else args.jobs,
+        post_batch=0 if args.realtime else args.post_batch
     )
     
     # Test connection
@@ -429,25 +683,40 @@ Traccar Server Setup:
         print("✓ Connection test successful")
         return 0
     
-    # Upload file
+    # Upload files
+    total_sent = 0
+    total_failed = 0
+    start_time = time.time()
     try:
-        points_sent = uploader.upload_opl_file(
-            input_path,
-            realtime=args.realtime,
-            playback_speed=args.speed,
-            batch_mode=args.batch,
-            batch_size=args.batch_size,
-            drop_bad_time=args.drop_bad_time,
-            patch_time_jumps=args.patch_time_jumps,
-            time_threshold=args.time_threshold,
-            jump_threshold=args.jump_threshold
-        )
-        
-        return 0 if points_sent > 0 else 1
+        for input_path in input_paths:
+            total_sent += uploader.upload_opl_file(
+                input_path,
+                realtime=args.realtime,
+                playback_speed=args.speed,
+                batch_mode=args.batch,
+                batch_size=args.batch_size,
+                drop_bad_time=args.drop_bad_time,
+                patch_time_jumps=args.patch_time_jumps,
+                time_threshold=args.time_threshold,
+                jump_threshold=args.jump_threshold,
+                min_distance=args.min_distance,
+                min_turn=args.min_turn,
+                resume=args.resume
+            )
+            total_failed += uploader.points_failed
+        
+        if len(input_paths) > 1:
+            elapsed = time.time() - start_time
+            print(f"All files: {total_sent} positions sent, {total_failed} failed, "
+                  f"{elapsed:.1f}s, {total_sent/elapsed:.1f} positions/second")
+        
+        return 0 if total_sent > 0 or args.resume else 1
         
     except KeyboardInterrupt:
         print("\n\n⚠ Upload cancelled by user")
-        print(f"Sent {uploader.points_sent} positions before cancellation")
+        print(f"Sent {total_sent + uploader.points_sent} positions before cancellation")
+        if args.resume:
+            print(f"Run again with --resume to continue")
         return 130
     except Exception as e:
         print(f"\n✗ Error: {e}")
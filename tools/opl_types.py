@@ -7,6 +7,7 @@ This module provides:
 - Timestamp handling (Unix epoch conversions, monotonic detection)
 - Data type definitions and conversions
 - Common validation logic
+- A memory-mapped, column-oriented decoder for bulk conversion (OPLFile)
 
 All OPL tools (opl2csv, opl2traccar, opl-info) should import from here
 to ensure consistent handling of the binary format.
@@ -15,7 +16,15 @@ to ensure consistent handling of the binary format.
 from datetime import datetime, timezone, timedelta
 from typing import Optional, Dict, Any, List
 from dataclasses import dataclass
+from pathlib import Path
+import mmap
 import struct
+import zlib
+
+try:
+    import numpy as np
+except ImportError:
+    np = None   # OPLFile falls back to lists
 
 
 # ============================================================================
@@ -25,17 +34,24 @@ import struct
 # Magic bytes and version
 MAGIC_BYTES = b'OPNY'
 FORMAT_VERSION_MAJOR = 2
-FORMAT_VERSION_MINOR = 0
+FORMAT_VERSION_MINOR = 1  # 2.1: optional compressed data blocks
 
-# Block types (v2.0 spec)
+# Block types - as binary_logger.py writes them. The layouts are also
+# defined for C++ in circuitpython/esp-client/opl_codec.h; a format change
+# touches binary_logger.py, this module and that header together.
 BLOCK_TYPE_SESSION_HEADER = 0x01
-BLOCK_TYPE_HARDWARE_CONFIG = 0x02
-BLOCK_TYPE_DATA_BLOCK = 0x03
-BLOCK_TYPE_SESSION_END = 0x04
+BLOCK_TYPE_DATA_BLOCK = 0x02
+BLOCK_TYPE_SESSION_END = 0x03
+BLOCK_TYPE_HARDWARE_CONFIG = 0x04
 
-# Old block types (for compatibility with older firmware)
-BLOCK_TYPE_DATA_BLOCK_OLD = 0x02  # Old firmware used 0x02 for data blocks
-BLOCK_TYPE_SESSION_END_OLD = 0x03  # Old firmware used 0x03 for session end
+# Block index footer (written after session end by firmware with index support)
+BLOCK_TYPE_INDEX = 0x05
+BLOCK_TYPE_INDEX_TRAILER = 0x06
+INDEX_ENTRY_FORMAT = '<IIQQHB'   # offset, block_seq, ts_start, ts_end, samples, flags
+INDEX_ENTRY_SIZE = struct.calcsize(INDEX_ENTRY_FORMAT)
+INDEX_HEADER_SIZE = 25           # magic, type, session ID, entry count
+INDEX_TRAILER_FORMAT = '<4sB3xII' # magic, type, reserved, index offset, CRC32
+INDEX_TRAILER_SIZE = struct.calcsize(INDEX_TRAILER_FORMAT)
 
 # Hardware types
 HW_TYPE_MAP = {
@@ -65,8 +81,31 @@ CONN_TYPE_MAP = {
 SAMPLE_TYPE_ACCELEROMETER = 0x01
 SAMPLE_TYPE_GPS_FIX = 0x02
 SAMPLE_TYPE_GPS_SATELLITES = 0x03
+SAMPLE_TYPE_GYROSCOPE = 0x04
+SAMPLE_TYPE_MAGNETOMETER = 0x05
+SAMPLE_TYPE_IMU = 0x06          # Accel + gyro (+ mag) float32, one timestamp
+SAMPLE_TYPE_IMU_BURST = 0x07    # Raw int16 FIFO records at a fixed interval
+SAMPLE_TYPE_PROFILE = 0x08      # Main loop stage timings, once a second
+SAMPLE_TYPE_LAP = 0x09          # Start/finish or sector gate crossing
 SAMPLE_TYPE_OBD_PID = 0x10
-SAMPLE_TYPE_EVENT_MARKER = 0x20
+SAMPLE_TYPE_EVENT_MARKER = 0x20 # Starts an event block (full-rate g event window)
+
+# Loop profiler stage ids (circuitpython/profiler.py)
+PROFILE_STAGE_NAMES = ('loop', 'imu_fifo', 'sensors', 'log', 'gps',
+                       'console', 'gc', 'display', 'pixel', 'other')
+
+# Lap event kinds (firmware lap_timer.py)
+LAP_EVENT_NAMES = {
+    1: 'start',
+    2: 'sector',
+    3: 'lap',
+}
+LAP_NO_DELTA = -0x80000000
+
+# Event marker kinds (firmware event_capture.py)
+EVENT_KIND_NAMES = {
+    1: 'g_force',
+}
 
 # Weather conditions
 WEATHER_MAP = {
@@ -78,6 +117,12 @@ WEATHER_MAP = {
     5: "Fog"
 }
 
+# GPS fix payload, and the all-float32 layout of older firmware
+GPS_FIX_FORMAT = '<ddffff'
+GPS_FIX_SIZE = 32
+GPS_FIX_V1_FORMAT = '<ffffff'
+GPS_FIX_V1_SIZE = 24
+
 # Flush flags
 FLUSH_FLAG_TIME = 0x01
 FLUSH_FLAG_SIZE = 0x02
@@ -85,6 +130,9 @@ FLUSH_FLAG_EVENT = 0x04
 FLUSH_FLAG_MANUAL = 0x08
 FLUSH_FLAG_SHUTDOWN = 0x10
 
+# Block flags (share the flush flags byte)
+BLOCK_FLAG_COMPRESSED = 0x80
+
 
 # ============================================================================
 # Timestamp Handling
@@ -223,6 +271,60 @@ class OPLTimestamp:
         }
 
 
+class TimestampFilter:
+    """
+    Streaming --drop-bad-time / --patch-time-jumps
+    
+    Call with each timestamp in file order; returns the timestamp to
+    write, or None to drop the sample. Keeps only the running offset, so
+    it works a block at a time.
+    """
+    
+    def __init__(self, drop_bad_time=False, patch_time_jumps=False,
+                 time_threshold=OPLTimestamp.RTC_THRESHOLD, jump_threshold=60.0, verbose=False):
+        self.drop_bad_time = drop_bad_time
+        self.patch_time_jumps = patch_time_jumps
+        self.time_threshold = time_threshold
+        self.jump_threshold = jump_threshold
+        self.jump_threshold_us = jump_threshold * 1_000_000
+        self.verbose = verbose
+        self.dropped = 0
+        self.patched = 0
+        self._last = None       # Last timestamp written (after patching)
+        self._offset = 0        # Accumulated patch offset
+    
+    @property
+    def active(self):
+        return self.drop_bad_time or self.patch_time_jumps
+    
+    def __call__(self, timestamp_us: int) -> Optional[int]:
+        if self.drop_bad_time and timestamp_us < self.time_threshold:
+            self.dropped += 1
+            return None
+        
+        if self.patch_time_jumps:
+            if self._last is not None and timestamp_us + self._offset - self._last > self.jump_threshold_us:
+                # Large forward jump (RTC sync) - continue from the last timestamp
+                new_offset = self._last - timestamp_us
+                if self.verbose:
+                    print(f"  Detected time jump: {(timestamp_us + self._offset - self._last) / 1_000_000:.1f}s")
+                    print(f"    From: {self._last} µs")
+                    print(f"    To:   {timestamp_us} µs")
+                    print(f"    Applying offset: {new_offset} µs")
+                self._offset = new_offset
+                self.patched += 1
+            timestamp_us += self._offset
+            self._last = timestamp_us
+        return timestamp_us
+    
+    def report(self):
+        """Print what was dropped / patched"""
+        if self.dropped:
+            print(f"  Dropped {self.dropped} samples with bad timestamps (before RTC sync)")
+        if self.patched:
+            print(f"  Patched {self.patched} time jumps > {self.jump_threshold}s")
+
+
 # ============================================================================
 # Data Type Definitions
 # ============================================================================
@@ -259,6 +361,17 @@ class DataBlock:
     samples: List[Dict[str, Any]]
 
 
+@dataclass
+class BlockIndexEntry:
+    """Block index entry - where a data block is and what it covers"""
+    offset: int
+    block_seq: int
+    timestamp_start: int
+    timestamp_end: int
+    sample_count: int
+    flush_flags: int
+
+
 @dataclass
 class AccelSample:
     """Accelerometer sample"""
@@ -308,18 +421,171 @@ class SampleParser:
         gx, gy, gz = struct.unpack('<fff', data[:12])
         return {'gx': gx, 'gy': gy, 'gz': gz}
     
+    @staticmethod
+    def parse_imu(data: bytes) -> Optional[Dict[str, float]]:
+        """
+        Parse combined IMU sample (24 bytes: accel + gyro, or 36 bytes:
+        accel + gyro + mag, all float32)
+        
+        Returns:
+            {gx, gy, gz, rx, ry, rz[, mx, my, mz]} or None if invalid
+            (gx..gz is acceleration in g, rx..rz rotation in °/s)
+        """
+        if len(data) < 24:
+            return None
+        
+        gx, gy, gz, rx, ry, rz = struct.unpack('<ffffff', data[:24])
+        imu = {'gx': gx, 'gy': gy, 'gz': gz, 'rx': rx, 'ry': ry, 'rz': rz}
+        if len(data) >= 36:
+            imu['mx'], imu['my'], imu['mz'] = struct.unpack('<fff', data[24:36])
+        return imu
+    
+    @staticmethod
+    def parse_imu_burst(data: bytes) -> Optional[List[Dict[str, float]]]:
+        """
+        Parse IMU burst sample
+        
+        12-byte header (count, channel mask, interval_us, accel g/LSB,
+        gyro dps/LSB), then count records of int16 X/Y/Z per channel
+        (accel before gyro).
+        
+        Returns:
+            List of {offset_us, gx, gy, gz, rx, ry, rz} dicts, oldest first,
+            or None if invalid
+        """
+        if len(data) < 12:
+            return None
+        
+        count, channels, interval_us, accel_lsb, gyro_lsb = struct.unpack('<BBHff', data[:12])
+        has_accel = bool(channels & 0x01)
+        has_gyro = bool(channels & 0x02)
+        stride = 6 * (has_accel + has_gyro)
+        if stride == 0 or len(data) < 12 + count * stride:
+            return None
+        
+        records = []
+        for i in range(count):
+            values = struct.unpack_from(f'<{stride // 2}h', data, 12 + i * stride)
+            record = {'offset_us': i * interval_us}
+            if has_accel:
+                record['gx'] = values[0] * accel_lsb
+                record['gy'] = values[1] * accel_lsb
+                record['gz'] = values[2] * accel_lsb
+                values = values[3:]
+            if has_gyro:
+                record['rx'] = values[0] * gyro_lsb
+                record['ry'] = values[1] * gyro_lsb
+                record['rz'] = values[2] * gyro_lsb
+            records.append(record)
+        return records
+    
+    @staticmethod
+    def parse_event_marker(data: bytes) -> Optional[Dict]:
+        """
+        Parse event marker sample (13 bytes), first in each event block
+        
+        Kind, index of the block's first record in the window, pre-trigger
+        records (the last one is the trigger), post-trigger records,
+        record interval (us), peak g. The IMU bursts after it are the
+        window at the full FIFO rate.
+        
+        Returns:
+            {kind, first, pre, post, interval_us, peak_g} or None if invalid
+        """
+        if len(data) < 13:
+            return None
+        
+        kind, first, pre, post, interval_us, peak_g = struct.unpack('<BHHHHf', data[:13])
+        return {
+            'kind': EVENT_KIND_NAMES.get(kind, f'kind_{kind}'),
+            'first': first,
+            'pre': pre,
+            'post': post,
+            'interval_us': interval_us,
+            'peak_g': peak_g
+        }
+    
+    @staticmethod
+    def parse_lap(data: bytes) -> Optional[Dict]:
+        """
+        Parse lap event sample (16 bytes), stamped at the gate crossing
+        
+        Kind, gate (0 = start/finish), lap number, split (sector time) us,
+        lap time so far us, delta to the best lap us.
+        
+        Returns:
+            {kind, gate, lap, split_us, lap_us, delta_us} or None if invalid
+            (delta_us is None before the first complete lap)
+        """
+        if len(data) < 16:
+            return None
+        
+        kind, gate, lap, split_us, lap_us, delta_us = struct.unpack('<BBHIIi', data[:16])
+        return {
+            'kind': LAP_EVENT_NAMES.get(kind, f'kind_{kind}'),
+            'gate': gate,
+            'lap': lap,
+            'split_us': split_us,
+            'lap_us': lap_us,
+            'delta_us': None if delta_us == LAP_NO_DELTA else delta_us
+        }
+    
+    @staticmethod
+    def parse_profile(data: bytes) -> Optional[Dict]:
+        """
+        Parse loop profile sample
+        
+        3-byte header (loop count, stage count), then 13 bytes per stage:
+        id, count, min/avg/p99 us (uint16, saturating), max us, then
+        scheduler deadline misses and deferrals (uint16, newer records).
+        
+        Returns:
+            {loops, misses, deferrals,
+             stages: {name: {count, min_us, avg_us, p99_us, max_us}}}
+            or None if invalid (misses/deferrals are None if not recorded)
+        """
+        if len(data) < 3:
+            return None
+        
+        loops, count = struct.unpack('<HB', data[:3])
+        if len(data) < 3 + count * 13:
+            return None
+        
+        stages = {}
+        for i in range(count):
+            stage, n, min_us, avg_us, p99_us, max_us = struct.unpack_from('<BHHHHI', data, 3 + i * 13)
+            name = PROFILE_STAGE_NAMES[stage] if stage < len(PROFILE_STAGE_NAMES) else f'stage_{stage}'
+            stages[name] = {
+                'count': n,
+                'min_us': min_us,
+                'avg_us': avg_us,
+                'p99_us': p99_us,
+                'max_us': max_us
+            }
+        
+        misses = deferrals = None
+        end = 3 + count * 13
+        if len(data) >= end + 4:
+            misses, deferrals = struct.unpack_from('<HH', data, end)
+        return {'loops': loops, 'misses': misses, 'deferrals': deferrals, 'stages': stages}
+    
     @staticmethod
     def parse_gps_fix(data: bytes) -> Optional[Dict[str, float]]:
         """
-        Parse GPS fix sample (24 bytes: 6x float32)
+        Parse GPS fix sample (32 bytes: lat/lon float64, alt, speed,
+        heading, hdop float32 - or 24 bytes, all float32, from older
+        firmware)
         
         Returns:
             {lat, lon, alt, speed, heading, hdop} or None if invalid
         """
-        if len(data) < 24:
+        if len(data) >= GPS_FIX_SIZE:
+            lat, lon, alt, speed, heading, hdop = struct.unpack_from(GPS_FIX_FORMAT, data)
+        elif len(data) >= GPS_FIX_V1_SIZE:
+            lat, lon, alt, speed, heading, hdop = struct.unpack_from(GPS_FIX_V1_FORMAT, data)
+        else:
             return None
         
-        lat, lon, alt, speed, heading, hdop = struct.unpack('<ffffff', data[:24])
         return {
             'lat': lat,
             'lon': lon,
@@ -334,10 +600,12 @@ class SampleParser:
         """
         Parse GPS satellite data
         
-        Three formats supported:
+        Formats supported:
+        - count, then 5 bytes each: (id, azimuth[2], elevation, snr) - as
+          binary_logger.write_gps_satellites() writes it
         - 3 bytes: (id, snr, flags) - compact format
         - 4 bytes: (id, azimuth, elevation, snr) - old format, azimuth limited to 0-255
-        - 5 bytes: (id, azimuth[2], elevation, snr) - new format, full 0-360° azimuth
+        - 5 bytes: (id, azimuth[2], elevation, snr) - full 0-360° azimuth, no count
         
         Returns:
             List of satellite dicts or None if invalid
@@ -347,6 +615,17 @@ class SampleParser:
         
         satellites = []
         
+        # Count-prefixed (current firmware)
+        if len(data) == 1 + data[0] * 5:
+            for sat_id, azimuth, elevation, snr in struct.iter_unpack('<BHBB', data[1:]):
+                satellites.append({
+                    'id': sat_id,
+                    'azimuth': azimuth,
+                    'elevation': elevation,
+                    'snr': snr
+                })
+            return satellites
+        
         # Try 5-byte format first (NEW: id, azimuth[2 bytes], elevation, snr)
         if len(data) % 5 == 0:
             count = len(data) // 5
@@ -386,6 +665,102 @@ class SampleParser:
             return satellites
         
         return None
+    
+    @staticmethod
+    def expand_compressed(data: bytes) -> bytes:
+        """
+        Decode a compressed block's sample data (BLOCK_FLAG_COMPRESSED)
+        into the plain sample encoding, so one parser handles both
+        
+        Layout (see CompressedDataBlock in binary_logger.py): accel, gyro
+        and mag scales (3x float32), then per sample a type byte, a
+        zig-zag varint delta of the ms offset and a type-specific payload
+        of varints relative to per-block predictors.
+        
+        Returns:
+            Plain samples: type (1) + offset ms (2) + length (1) + data
+        """
+        def varint():
+            nonlocal pos
+            value = shift = 0
+            while True:
+                byte = data[pos]
+                pos += 1
+                value |= (byte & 0x7F) << shift
+                if not byte & 0x80:
+                    return value
+                shift += 7
+        
+        def signed():
+            value = varint()
+            return (value >> 1) ^ -(value & 1)
+        
+        if len(data) < 12:
+            return b''
+        scales = dict(zip((SAMPLE_TYPE_ACCELEROMETER, SAMPLE_TYPE_GYROSCOPE,
+                           SAMPLE_TYPE_MAGNETOMETER), struct.unpack('<fff', data[:12])))
+        prev = {sensor: [0, 0, 0] for sensor in scales}
+        gps_origin = None
+        offset_ms = 0
+        out = bytearray()
+        pos = 12
+        
+        def axes(sensor):
+            p = prev[sensor]
+            for axis in range(3):
+                p[axis] += signed()
+            return [v * scales[sensor] for v in p]
+        
+        try:
+            while pos < len(data):
+                sample_type = data[pos]
+                pos += 1
+                offset_ms += signed()
+                
+                if sample_type in scales:
+                    payload = struct.pack('<fff', *axes(sample_type))
+                elif sample_type == SAMPLE_TYPE_IMU:
+                    channels = data[pos]
+                    pos += 1
+                    values = axes(SAMPLE_TYPE_ACCELEROMETER) + axes(SAMPLE_TYPE_GYROSCOPE)
+                    if channels == 9:
+                        values += axes(SAMPLE_TYPE_MAGNETOMETER)
+                    payload = struct.pack(f'<{len(values)}f', *values)
+                elif sample_type == SAMPLE_TYPE_GPS_FIX:
+                    qlat, qlon = signed(), signed()
+                    if gps_origin is None:
+                        gps_origin = (qlat, qlon)
+                    else:
+                        qlat += gps_origin[0]
+                        qlon += gps_origin[1]
+                    alt, speed, heading, hdop = signed(), signed(), signed(), signed()
+                    payload = struct.pack('<ddffff', qlat / 1e7, qlon / 1e7, alt / 10,
+                                          speed / 100, heading / 100, hdop / 100)
+                elif sample_type == SAMPLE_TYPE_IMU_BURST:
+                    count = data[pos]
+                    pos += 1
+                    interval_us = varint()
+                    accel_lsb, gyro_lsb = struct.unpack_from('<ff', data, pos)
+                    pos += 8
+                    record = [0] * 6
+                    values = []
+                    for _ in range(count):
+                        for axis in range(6):
+                            record[axis] += signed()
+                        values.extend(record)
+                    payload = struct.pack('<BBHff', count, 0x03, interval_us, accel_lsb, gyro_lsb)
+                    payload += struct.pack(f'<{len(values)}h', *values)
+                else:
+                    length = varint()
+                    payload = bytes(data[pos:pos + length])
+                    pos += length
+                
+                out += struct.pack('<BHB', sample_type, min(offset_ms, 65535), len(payload))
+                out += payload
+        except (IndexError, struct.error):
+            pass  # Truncated block - keep what decoded
+        
+        return bytes(out)
 
 
 # ============================================================================
@@ -471,6 +846,385 @@ class UnitConverter:
         return (fahrenheit - 32) * 5/9
 
 
+# ============================================================================
+# Block Index
+# ============================================================================
+
+def read_block_index(f) -> Optional[List[BlockIndexEntry]]:
+    """
+    Read the block index footer of a finished session
+    
+    Args:
+        f: OPL file opened in binary mode
+    
+    Returns:
+        List of entries in file order, or None if the file has no valid
+        index (older firmware, or the session was never stopped)
+    """
+    try:
+        f.seek(-INDEX_TRAILER_SIZE, 2)
+    except OSError:
+        return None
+    
+    trailer = f.read(INDEX_TRAILER_SIZE)
+    if len(trailer) != INDEX_TRAILER_SIZE:
+        return None
+    
+    magic, block_type, index_offset, trailer_crc = struct.unpack(INDEX_TRAILER_FORMAT, trailer)
+    if magic != MAGIC_BYTES or block_type != BLOCK_TYPE_INDEX_TRAILER:
+        return None
+    if zlib.crc32(trailer[:12]) != trailer_crc:
+        return None
+    
+    f.seek(index_offset)
+    header = f.read(INDEX_HEADER_SIZE)
+    if len(header) != INDEX_HEADER_SIZE or header[:4] != MAGIC_BYTES or header[4] != BLOCK_TYPE_INDEX:
+        return None
+    
+    count = struct.unpack_from('<I', header, 21)[0]
+    entries = f.read(count * INDEX_ENTRY_SIZE)
+    checksum = f.read(4)
+    if len(entries) != count * INDEX_ENTRY_SIZE or len(checksum) != 4:
+        return None
+    if zlib.crc32(entries, zlib.crc32(header)) != struct.unpack('<I', checksum)[0]:
+        return None
+    
+    return [BlockIndexEntry(*fields) for fields in struct.iter_unpack(INDEX_ENTRY_FORMAT, entries)]
+
+
+def find_blocks_in_range(index: List[BlockIndexEntry], start_us: Optional[int] = None,
+                         end_us: Optional[int] = None) -> List[BlockIndexEntry]:
+    """Entries for data blocks that overlap [start_us, end_us]"""
+    return [e for e in index
+            if (start_us is None or e.timestamp_end >= start_us) and
+               (end_us is None or e.timestamp_start <= end_us)]
+
+
+# ============================================================================
+# Streaming Decoder
+# ============================================================================
+
+# Data block header after magic + type: session ID, sequence, start/end
+# timestamp, flags, sample count, data size - then data and CRC32
+DATA_BLOCK_HEADER = struct.Struct('<16sIQQBHH')
+DATA_BLOCK_HEADER_SIZE = 5 + DATA_BLOCK_HEADER.size
+SAMPLE_HEADER = struct.Struct('<BHB')    # type, timestamp offset (ms), length
+
+# Columns produced by OPLFile, per kind. 'imu' also holds IMU bursts;
+# columns a sample does not carry (mag on 6-axis IMUs) are NaN.
+COLUMNS = {
+    'accel': ('gx', 'gy', 'gz'),
+    'imu': ('gx', 'gy', 'gz', 'rx', 'ry', 'rz', 'mx', 'my', 'mz'),
+    'gps': ('lat', 'lon', 'alt', 'speed', 'heading', 'hdop'),
+}
+COLUMNS['event'] = COLUMNS['imu']    # Full-rate IMU records of event blocks
+
+KIND_SAMPLE_TYPES = {
+    'accel': (SAMPLE_TYPE_ACCELEROMETER,),
+    'imu': (SAMPLE_TYPE_IMU, SAMPLE_TYPE_IMU_BURST),
+    'gps': (SAMPLE_TYPE_GPS_FIX,),
+    'event': (SAMPLE_TYPE_IMU_BURST,),
+}
+
+
+def column_dtype(kind: str):
+    """numpy structured dtype of a kind's columns"""
+    return np.dtype([('timestamp_us', '<i8')] + [(name, '<f8') for name in COLUMNS[kind]])
+
+
+@dataclass
+class BlockView:
+    """A data block inside a mapped file - data is a view, not a copy"""
+    offset: int
+    block_seq: int
+    timestamp_start: int
+    timestamp_end: int
+    flush_flags: int
+    sample_count: int
+    data: Any                  # memoryview (bytes once decompressed)
+
+
+class OPLFile:
+    """
+    Memory-mapped OPL file for bulk decoding
+    
+    Walks block headers in place and decodes sample payloads straight
+    from the mapping. columns() returns numpy structured arrays (one row
+    per sample, see COLUMNS) when numpy is installed; column_chunks()
+    streams the same columns one block at a time as numpy arrays or,
+    without numpy, dicts of lists - so memory stays at one block either
+    way.
+    
+    Example:
+        with OPLFile('session_00001.opl') as opl:
+            imu = opl.columns('imu')
+            print(imu['gx'].max())
+    """
+    
+    def __init__(self, filepath):
+        self.filepath = Path(filepath)
+        self._file = open(self.filepath, 'rb')
+        try:
+            self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        except ValueError:
+            self._map = None           # Empty file
+        self.buf = memoryview(self._map) if self._map is not None else memoryview(b'')
+        self.data_offset = self._skip_headers()
+    
+    def close(self):
+        self.buf.release()
+        if self._map is not None:
+            try:
+                self._map.close()
+            except BufferError:
+                pass    # A BlockView is still held - unmapped when collected
+        self._file.close()
+    
+    def __enter__(self):
+        return self
+    
+    def __exit__(self, *exc):
+        self.close()
+    
+    def _skip_headers(self):
+        """Offset of the first block after the session header (and hardware config)"""
+        buf = self.buf
+        if len(buf) < 33 or buf[:4] != MAGIC_BYTES or buf[4] != BLOCK_TYPE_SESSION_HEADER:
+            raise ValueError(f"{self.filepath}: not an OPL file")
+        
+        # Magic, type, format/hw version, timestamp, session ID, 3 strings
+        pos = 33
+        for _ in range(3):
+            pos += 1 + buf[pos]
+        
+        # Weather, temperature, config and header CRC (newer firmware)
+        if pos < len(buf) and buf[pos] < 10:
+            pos += 11
+        
+        # Hardware config: count, then type, connection, length + identifier
+        if bytes(buf[pos:pos + 4]) == MAGIC_BYTES and buf[pos + 4] == BLOCK_TYPE_HARDWARE_CONFIG:
+            count = buf[pos + 5]
+            item = pos + 6
+            valid = count <= 20
+            for _ in range(count if valid else 0):
+                if item + 3 > len(buf) or buf[item + 2] > 64:
+                    valid = False
+                    break
+                item += 3 + buf[item + 2]
+            if valid:
+                pos = item + 4
+        return pos
+    
+    def blocks(self):
+        """
+        Iterate data blocks in file order (stops at session end)
+        
+        Yields:
+            BlockView - compressed blocks are expanded to the plain encoding
+        """
+        buf = self.buf
+        pos = self.data_offset
+        while pos + DATA_BLOCK_HEADER_SIZE <= len(buf):
+            if bytes(buf[pos:pos + 4]) != MAGIC_BYTES:
+                return
+            block_type = buf[pos + 4]
+            if block_type != BLOCK_TYPE_DATA_BLOCK:
+                return   # Session end
+            
+            _, seq, ts_start, ts_end, flags, count, size = DATA_BLOCK_HEADER.unpack_from(buf, pos + 5)
+            start = pos + DATA_BLOCK_HEADER_SIZE
+            data = buf[start:start + size]
+            if flags & BLOCK_FLAG_COMPRESSED:
+                data = SampleParser.expand_compressed(data)
+            yield BlockView(pos, seq, ts_start, ts_end, flags, count, data)
+            pos = start + size + 4
+    
+    @staticmethod
+    def sample_headers(block):
+        """
+        Yields:
+            (sample type, timestamp_us, payload offset, payload length)
+            for each sample in a block - nothing is copied
+        """
+        data = block.data
+        base = block.timestamp_start
+        unpack = SAMPLE_HEADER.unpack_from
+        pos = 0
+        end = len(data)
+        while pos + 4 <= end:
+            sample_type, offset, length = unpack(data, pos)
+            pos += 4
+            if pos + length > end:
+                return
+            yield sample_type, base + offset * 1000, pos, length
+            pos += length
+    
+    @staticmethod
+    def is_event_block(block):
+        """True for event capture blocks (first sample is an event marker)"""
+        return len(block.data) >= 4 and block.data[0] == SAMPLE_TYPE_EVENT_MARKER
+    
+    def column_chunks(self, kind):
+        """
+        Decode one kind of sample block by block
+        
+        Yields:
+            Per block with samples of that kind, in timestamp order:
+            numpy structured array (column_dtype(kind)), or without numpy
+            a dict of column name -> list including 'timestamp_us'
+        """
+        wanted = KIND_SAMPLE_TYPES[kind]
+        for block in self.blocks():
+            chunk = self.decode_block(block, kind, wanted)
+            if chunk is not None:
+                yield chunk
+    
+    def decode_block(self, block, kind, wanted=None):
+        """
+        Decode one kind of sample from one block
+        
+        Returns:
+            Columns as in column_chunks(), or None if the block has none
+        """
+        wanted = wanted or KIND_SAMPLE_TYPES[kind]
+        # Event blocks hold only 'event' records, kept out of 'imu'
+        if self.is_event_block(block) != (kind == 'event'):
+            return None
+        runs = [s for s in self.sample_headers(block) if s[0] in wanted]
+        if not runs:
+            return None
+        if np is not None:
+            return _decode_numpy(kind, block.data, runs)
+        return _decode_lists(kind, block.data, runs)
+    
+    def columns(self, kind):
+        """
+        Decode all samples of a kind into one table
+        
+        Returns:
+            numpy structured array, or dict of lists without numpy
+        """
+        chunks = list(self.column_chunks(kind))
+        if np is not None:
+            return np.concatenate(chunks) if chunks else np.empty(0, column_dtype(kind))
+        table = {name: [] for name in ('timestamp_us',) + COLUMNS[kind]}
+        for chunk in chunks:
+            for name, values in chunk.items():
+                table[name].extend(values)
+        return table
+
+
+def _decode_numpy(kind, data, runs):
+    """Gather fixed-stride payloads out of a block with one fancy index per layout"""
+    raw = np.frombuffer(data, dtype=np.uint8)
+    out_parts = []
+    
+    def gather(items, layout):
+        offsets = np.fromiter((s[2] for s in items), dtype=np.int64, count=len(items))
+        width = np.dtype(layout).itemsize
+        return raw[offsets[:, None] + np.arange(width)].view(layout).reshape(len(items))
+    
+    def table(stamps, count):
+        rows = np.empty(count, column_dtype(kind))
+        rows['timestamp_us'] = stamps
+        for name in COLUMNS[kind]:
+            rows[name] = np.nan
+        return rows
+    
+    if kind == 'accel':
+        items = [s for s in runs if s[3] >= 12]
+        if items:
+            values = gather(items, [('gx', '<f4'), ('gy', '<f4'), ('gz', '<f4')])
+            rows = table([s[1] for s in items], len(items))
+            for name in COLUMNS['accel']:
+                rows[name] = values[name]
+            out_parts.append(rows)
+    
+    elif kind == 'gps':
+        # 32-byte fixes (float64 lat/lon), or 24-byte float32 from older firmware
+        for layout, fits in (('<f8', lambda n: n >= GPS_FIX_SIZE),
+                             ('<f4', lambda n: GPS_FIX_V1_SIZE <= n < GPS_FIX_SIZE)):
+            items = [s for s in runs if fits(s[3])]
+            if items:
+                values = gather(items, [('lat', layout), ('lon', layout)] +
+                                       [(name, '<f4') for name in COLUMNS['gps'][2:]])
+                rows = table([s[1] for s in items], len(items))
+                for name in COLUMNS['gps']:
+                    rows[name] = values[name]
+                out_parts.append(rows)
+    
+    else:
+        # IMU samples: 24 (accel + gyro) or 36 bytes (+ mag)
+        for width, names in ((36, COLUMNS['imu']), (24, COLUMNS['imu'][:6])):
+            items = [s for s in runs if s[0] == SAMPLE_TYPE_IMU and
+                     (s[3] >= 36 if width == 36 else 24 <= s[3] < 36)]
+            if items:
+                values = gather(items, [(name, '<f4') for name in names])
+                rows = table([s[1] for s in items], len(items))
+                for name in names:
+                    rows[name] = values[name]
+                out_parts.append(rows)
+        
+        # IMU bursts: int16 records at a fixed interval, scaled per burst
+        for sample_type, timestamp_us, pos, length in runs:
+            if sample_type != SAMPLE_TYPE_IMU_BURST or length < 12:
+                continue
+            count, channels, interval_us, accel_lsb, gyro_lsb = struct.unpack_from('<BBHff', data, pos)
+            has_accel = bool(channels & 0x01)
+            has_gyro = bool(channels & 0x02)
+            axes = 3 * (has_accel + has_gyro)
+            if axes == 0 or length < 12 + count * axes * 2:
+                continue
+            records = np.frombuffer(data, dtype='<i2', count=count * axes,
+                                    offset=pos + 12).reshape(count, axes)
+            rows = table(timestamp_us + np.arange(count, dtype=np.int64) * interval_us, count)
+            column = 0
+            if has_accel:
+                for name in ('gx', 'gy', 'gz'):
+                    rows[name] = records[:, column] * accel_lsb
+                    column += 1
+            if has_gyro:
+                for name in ('rx', 'ry', 'rz'):
+                    rows[name] = records[:, column] * gyro_lsb
+                    column += 1
+            out_parts.append(rows)
+    
+    if not out_parts:
+        return np.empty(0, column_dtype(kind))
+    rows = np.concatenate(out_parts) if len(out_parts) > 1 else out_parts[0]
+    if len(out_parts) > 1:
+        rows = rows[np.argsort(rows['timestamp_us'], kind='stable')]
+    return rows
+
+
+def _decode_lists(kind, data, runs):
+    """Pure Python fallback for _decode_numpy - same columns, as lists"""
+    names = COLUMNS[kind]
+    nan = float('nan')
+    rows = []
+    
+    for sample_type, timestamp_us, pos, length in runs:
+        payload = data[pos:pos + length]
+        if kind == 'accel':
+            parsed = [SampleParser.parse_accelerometer(payload)]
+        elif kind == 'gps':
+            parsed = [SampleParser.parse_gps_fix(payload)]
+        elif sample_type == SAMPLE_TYPE_IMU:
+            parsed = [SampleParser.parse_imu(payload)]
+        else:
+            parsed = SampleParser.parse_imu_burst(payload) or []
+        for values in parsed:
+            if values:
+                rows.append((timestamp_us + values.get('offset_us', 0),
+                             [values.get(name, nan) for name in names]))
+    
+    rows.sort(key=lambda row: row[0])
+    table = {'timestamp_us': [row[0] for row in rows]}
+    for i, name in enumerate(names):
+        table[name] = [row[1][i] for row in rows]
+    return table
+
+
 # ============================================================================
 # Sample Type Names
 # ============================================================================
@@ -479,6 +1233,10 @@ SAMPLE_TYPE_NAMES = {
     SAMPLE_TYPE_ACCELEROMETER: 'accel',
     SAMPLE_TYPE_GPS_FIX: 'gps',
     SAMPLE_TYPE_GPS_SATELLITES: 'satellites',
+    SAMPLE_TYPE_IMU: 'imu',
+    SAMPLE_TYPE_IMU_BURST: 'imu',
+    SAMPLE_TYPE_PROFILE: 'profile',
+    SAMPLE_TYPE_LAP: 'lap',
     SAMPLE_TYPE_OBD_PID: 'obd',
     SAMPLE_TYPE_EVENT_MARKER: 'event'
 }
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+prepare_web_assets_esp.py - Build gzipped web assets into a PROGMEM header
+
+Companion to prepare_web_assets_cp.py for the ESP-01s web client. Each
+file in web/ is gzip-compressed (PNGs are stored as-is) and emitted as a
+PROGMEM byte array with its MIME type and a strong ETag (hash of the
+stored bytes), so the sketch can serve it with beginResponse_P(),
+Content-Encoding: gzip and 304 Not Modified - straight from flash,
+nothing copied into RAM.
+
+Files bigger than the per-file budget after compression (the PNG logos
+are megabytes) are skipped with a warning; the ESP-01s has 1MB of flash
+shared with the sketch.
+
+Usage:
+    python3 prepare_web_assets_esp.py web/ circuitpython/esp-client/web_assets.h
+
+The sketch picks the header up automatically (__has_include) on the
+next build; without it the built-in single page is served.
+"""
+
+import argparse
+import gzip
+import hashlib
+import sys
+from pathlib import Path
+
+# Files never served by the ESP client
+SKIP_FILES = {
+    'index-full.html',    # Same as index.html
+    'index-simple.html',  # Superseded by the sketch's built-in page
+}
+
+MIME_TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.ico': 'image/x-icon',
+    '.png': 'image/png',
+    '.svg': 'image/svg+xml',
+}
+
+# Already compressed - stored as-is and served without Content-Encoding
+NO_GZIP = {'.png'}
+
+
+def compress(data):
+    """gzip level 9 with a zero mtime, so the ETag only changes with content"""
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def c_identifier(filename):
+    """web/app.js -> ASSET_APP_JS"""
+    return 'ASSET_' + ''.join(c.upper() if c.isalnum() else '_' for c in filename)
+
+
+def format_bytes(data, per_line=16):
+    """Comma-separated hex bytes, wrapped"""
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append('    ' + ', '.join(f'0x{b:02x}' for b in data[i:i + per_line]) + ',')
+    return '\n'.join(lines)
+
+
+def prepare_web_assets(input_dir, output_file, max_kb):
+    """Compress input_dir/* into output_file"""
+    input_path = Path(input_dir)
+    assets = []
+    total_original = 0
+    total_compressed = 0
+
+    print("Preparing web assets for ESP-01s...")
+    print()
+
+    for path in sorted(input_path.iterdir()):
+        if not path.is_file() or path.name in SKIP_FILES:
+            continue
+
+        mime = MIME_TYPES.get(path.suffix.lower())
+        if not mime:
+            print(f"  {path.name}: unknown type, skipping")
+            continue
+
+        original = path.read_bytes()
+        gzipped = path.suffix.lower() not in NO_GZIP
+        data = compress(original) if gzipped else original
+
+        if len(data) > max_kb * 1024:
+            print(f"  {path.name}: {len(data):,d} bytes "
+                  f"exceeds {max_kb}KB budget, skipping")
+            continue
+
+        etag = '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+        url = '/' if path.name == 'index.html' else '/' + path.name
+        assets.append((url, mime, c_identifier(path.name), data, etag, gzipped))
+
+        total_original += len(original)
+        total_compressed += len(data)
+        print(f"  {path.name}: {len(original):,d} -> {len(data):,d} bytes")
+
+    if not assets:
+        print("Error: no assets to write")
+        return False
+
+    with open(output_file, 'w') as f:
+        f.write("// Generated by tools/prepare_web_assets_esp.py - do not edit\n")
+        f.write("#pragma once\n\n")
+        f.write("#include <Arduino.h>\n\n")
+        f.write("struct WebAsset {\n")
+        f.write("    const char* path;\n")
+        f.write("    const char* mime;\n")
+        f.write("    const uint8_t* data;   // In PROGMEM\n")
+        f.write("    size_t length;\n")
+        f.write("    const char* etag;\n")
+        f.write("    bool gzip;             // Send Content-Encoding: gzip\n")
+        f.write("};\n\n")
+
+        for url, mime, ident, data, etag, gzipped in assets:
+            f.write(f"// {url} ({mime})\n")
+            f.write(f"static const uint8_t {ident}[] PROGMEM = {{\n")
+            f.write(format_bytes(data))
+            f.write("\n};\n\n")
+
+        f.write("static const WebAsset WEB_ASSETS[] = {\n")
+        for url, mime, ident, data, etag, gzipped in assets:
+            etag_literal = etag.replace('"', '\\"')
+            f.write(f'    {{"{url}", "{mime}", {ident}, sizeof({ident}), '
+                    f'"{etag_literal}", {"true" if gzipped else "false"}}},\n')
+        f.write("};\n\n")
+        f.write(f"#define WEB_ASSET_COUNT {len(assets)}\n")
+
+    print()
+    print("=" * 60)
+    print(f"Assets:            {len(assets)}")
+    print(f"Total original:    {total_original:9,d} bytes")
+    print(f"Total compressed:  {total_compressed:9,d} bytes (flash)")
+    print("=" * 60)
+    print()
+    print(f"✅ Header written: {output_file}")
+    print("   Rebuild and flash esp-client.ino to serve the full web UI")
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Build gzipped web assets into a PROGMEM header for the ESP-01s client')
+    parser.add_argument('input_dir', help='Web asset directory (web/)')
+    parser.add_argument('output_file', help='Header to write (esp-client/web_assets.h)')
+    parser.add_argument('--max-kb', type=int, default=64,
+                        help='Skip files larger than this after compression (default 64)')
+    args = parser.parse_args()
+
+    if not Path(args.input_dir).is_dir():
+        print(f"Error: {args.input_dir} is not a directory")
+        sys.exit(1)
+
+    if not prepare_web_assets(args.input_dir, args.output_file, args.max_kb):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
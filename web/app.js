@@ -34,6 +34,7 @@ class OpenPonyLogger {
         this.setupGForceDisplay();
         this.setupGPSDisplay();
         this.setupSessions();
+        this.setupSessionChart();
         this.setupFuelLog();
         this.setupPIDTesting();
         this.setupConfig();
@@ -294,6 +295,7 @@ class OpenPonyLogger {
                 break;
             case 'sessions':
                 this.renderSessions();
+                this.fetchChart();
                 break;
             case 'status':
                 this.updateStatus();
@@ -729,6 +731,179 @@ class OpenPonyLogger {
         this.renderSessions();
     }
 
+    // Session Chart - min/max/avg bins from the ESP's chart pyramid
+    // (/api/chart), ~250 points whatever the session length
+    setupSessionChart() {
+        const canvas = document.getElementById('chartCanvas');
+        canvas.width = 1000;
+        canvas.height = 300;
+        this.chartCtx = canvas.getContext('2d');
+        this.chart = {
+            range: null,      // [from, to] in ESP ms, null = whole session, live
+            zoomStack: [],
+            data: null,
+            dragX: null
+        };
+        this.chartChannels = [
+            { name: 'G Total', unit: 'g', scale: 0.02, signed: false },
+            { name: 'Speed', unit: 'MPH', scale: 1, signed: false },
+            { name: 'Lateral G', unit: 'g', scale: 0.02, signed: true },
+            { name: 'Longitudinal G', unit: 'g', scale: 0.02, signed: true }
+        ];
+
+        document.getElementById('chartChannel').addEventListener('change', () => this.drawChart());
+        document.getElementById('chartFull').addEventListener('click', () => {
+            this.chart.range = null;
+            this.chart.zoomStack = [];
+            this.fetchChart();
+        });
+        document.getElementById('chartZoomOut').addEventListener('click', () => {
+            this.chart.range = this.chart.zoomStack.pop() || null;
+            this.fetchChart();
+        });
+
+        // Drag to zoom into a time range
+        const toMs = (event) => {
+            const data = this.chart.data;
+            const rect = canvas.getBoundingClientRect();
+            const x = (event.clientX - rect.left) / rect.width;
+            return data.firstMs + x * data.count * data.binMs;
+        };
+        canvas.addEventListener('pointerdown', (event) => {
+            if (this.chart.data && this.chart.data.count) this.chart.dragX = toMs(event);
+        });
+        canvas.addEventListener('pointerup', (event) => {
+            if (this.chart.dragX === null) return;
+            const from = Math.min(this.chart.dragX, toMs(event));
+            const to = Math.max(this.chart.dragX, toMs(event));
+            this.chart.dragX = null;
+            if (to - from < this.chart.data.binMs * 4) return;
+            this.chart.zoomStack.push(this.chart.range);
+            this.chart.range = [Math.floor(from), Math.ceil(to)];
+            this.fetchChart();
+        });
+
+        // Follow the session while showing all of it
+        setInterval(() => {
+            const activeTab = document.querySelector('.tab-button.active')?.dataset.tab;
+            if (activeTab === 'sessions' && this.chart.range === null) this.fetchChart();
+        }, 5000);
+    }
+
+    async fetchChart() {
+        try {
+            const range = this.chart.range;
+            const query = range ? `?from=${range[0]}&to=${range[1]}` : '';
+            const response = await fetch('/api/chart' + query);
+            if (!response.ok) throw new Error(`HTTP ${response.status}`);
+
+            // ChartHeader (20 bytes) then count bins of channels * min, max, avg
+            const view = new DataView(await response.arrayBuffer());
+            const data = {
+                level: view.getUint8(0),
+                channels: view.getUint8(1),
+                count: view.getUint16(2, true),
+                binMs: view.getUint32(4, true),
+                firstMs: view.getUint32(8, true),
+                startMs: view.getUint32(12, true),
+                nowMs: view.getUint32(16, true),
+                view: view
+            };
+            this.chart.data = data;
+            this.drawChart();
+        } catch (error) {
+            console.error('Failed to fetch chart:', error);
+        }
+    }
+
+    drawChart() {
+        const ctx = this.chartCtx;
+        const canvas = ctx.canvas;
+        const data = this.chart.data;
+        const info = document.getElementById('chartInfo');
+
+        ctx.fillStyle = '#0a0a0a';
+        ctx.fillRect(0, 0, canvas.width, canvas.height);
+        if (!data || data.count === 0) {
+            info.textContent = 'No telemetry charted yet';
+            return;
+        }
+
+        const channel = parseInt(document.getElementById('chartChannel').value);
+        const meta = this.chartChannels[channel];
+        const binSize = data.channels * 3;
+        const value = (i, stat) => {
+            const offset = 20 + i * binSize + channel * 3 + stat;
+            const raw = meta.signed ? data.view.getInt8(offset) : data.view.getUint8(offset);
+            return raw * meta.scale;
+        };
+        const empty = (i) => data.view.getUint8(20 + i * binSize) > data.view.getUint8(20 + i * binSize + 1);
+
+        let lo = Infinity;
+        let hi = -Infinity;
+        for (let i = 0; i < data.count; i++) {
+            if (empty(i)) continue;
+            lo = Math.min(lo, value(i, 0));
+            hi = Math.max(hi, value(i, 1));
+        }
+        if (lo === Infinity) {
+            info.textContent = 'No telemetry in this range';
+            return;
+        }
+        if (hi - lo < meta.scale * 10) {
+            hi += meta.scale * 5;
+            lo -= meta.scale * 5;
+        }
+
+        const pad = 30;
+        const x = (i) => (i + 0.5) * canvas.width / data.count;
+        const y = (v) => canvas.height - pad - (v - lo) / (hi - lo) * (canvas.height - 2 * pad);
+
+        // Grid and scale
+        ctx.strokeStyle = '#404040';
+        ctx.fillStyle = '#b0b0b0';
+        ctx.font = '14px sans-serif';
+        ctx.textAlign = 'left';
+        ctx.lineWidth = 1;
+        for (let k = 0; k <= 4; k++) {
+            const v = lo + (hi - lo) * k / 4;
+            ctx.beginPath();
+            ctx.moveTo(0, y(v));
+            ctx.lineTo(canvas.width, y(v));
+            ctx.stroke();
+            ctx.fillText(`${v.toFixed(meta.scale < 1 ? 2 : 0)} ${meta.unit}`, 4, y(v) - 4);
+        }
+
+        // Min/max band, then the average
+        ctx.fillStyle = 'rgba(255, 107, 53, 0.3)';
+        for (let i = 0; i < data.count; i++) {
+            if (empty(i)) continue;
+            const top = y(value(i, 1));
+            ctx.fillRect(x(i) - canvas.width / data.count / 2, top,
+                         Math.max(1, canvas.width / data.count), Math.max(1, y(value(i, 0)) - top));
+        }
+        ctx.strokeStyle = '#ff6b35';
+        ctx.lineWidth = 2;
+        ctx.beginPath();
+        let drawing = false;
+        for (let i = 0; i < data.count; i++) {
+            if (empty(i)) {
+                drawing = false;
+                continue;
+            }
+            if (drawing) ctx.lineTo(x(i), y(value(i, 2)));
+            else ctx.moveTo(x(i), y(value(i, 2)));
+            drawing = true;
+        }
+        ctx.stroke();
+
+        const from = Math.max(0, (data.firstMs - data.startMs) / 1000);
+        const to = from + data.count * data.binMs / 1000;
+        info.textContent = `${meta.name}: ${this.formatDuration(Math.floor(from))} - ` +
+            `${this.formatDuration(Math.floor(to))} into the session, ` +
+            `${data.count} points of ${data.binMs / 1000}s. Drag across the chart to zoom in`;
+    }
+
     toggleRecording() {
         this.isRecording = !this.isRecording;
         const button = document.getElementById('startSession');